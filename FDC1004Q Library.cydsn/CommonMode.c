@@ -0,0 +1,194 @@
+/**
+*   \brief Source file for the software common-mode rejection.
+*/
+
+#include "CommonMode.h"
+
+/**
+*   \brief Limit of the changes accumulated by the calibration.
+*
+*   With at most #COMMON_MODE_CALIBRATION_MAX_FRAMES frames, the sums
+*   of the products always fit in 64 bits.
+*/
+#define COMMON_MODE_DELTA_LIMIT ((1L << 23) - 1)
+
+// Reference weights
+static int16_t common_mode_weights[COMMON_MODE_CHANNELS];
+
+// Coupling coefficients, 0 for the reference channels
+static int32_t common_mode_coupling[COMMON_MODE_CHANNELS];
+
+// Reference of the baseline frame
+static int32_t common_mode_baseline;
+
+// Set when the next frame must become the baseline
+static uint8_t common_mode_baseline_pending = 1;
+
+// Calibration sums
+static int64_t common_mode_sum_rr;
+static int64_t common_mode_sum_rc[COMMON_MODE_CHANNELS];
+static uint16_t common_mode_frames;
+
+// Calibration frame baseline
+static int32_t common_mode_calibration_base[COMMON_MODE_CHANNELS];
+
+// Compute the reference of a frame
+static int32_t common_mode_reference(const int32_t* capacitance);
+
+// Clamp a change accumulated by the calibration
+static int32_t common_mode_clamp(int32_t delta);
+
+uint8_t CommonMode_SetReference(const int16_t* weights)
+{
+    uint8_t references = 0;
+    for (uint8_t ch = 0; ch < COMMON_MODE_CHANNELS; ch++)
+    {
+        if (weights[ch] != 0)
+        {
+            references++;
+        }
+    }
+    if ((references == 0) || (references == COMMON_MODE_CHANNELS))
+    {
+        return FDC_CONF_ERR;
+    }
+    for (uint8_t ch = 0; ch < COMMON_MODE_CHANNELS; ch++)
+    {
+        common_mode_weights[ch] = weights[ch];
+        common_mode_coupling[ch] = (weights[ch] != 0) ? 0 : (1L << COMMON_MODE_COUPLING_FRACT_BITS);
+    }
+    common_mode_baseline_pending = 1;
+    return FDC_OK;
+}
+
+void CommonMode_SetCoupling(const int32_t* coupling)
+{
+    for (uint8_t ch = 0; ch < COMMON_MODE_CHANNELS; ch++)
+    {
+        common_mode_coupling[ch] = (common_mode_weights[ch] != 0) ? 0 : coupling[ch];
+    }
+}
+
+void CommonMode_GetCoupling(int32_t* coupling)
+{
+    for (uint8_t ch = 0; ch < COMMON_MODE_CHANNELS; ch++)
+    {
+        coupling[ch] = common_mode_coupling[ch];
+    }
+}
+
+void CommonMode_StartCalibration(void)
+{
+    common_mode_sum_rr = 0;
+    for (uint8_t ch = 0; ch < COMMON_MODE_CHANNELS; ch++)
+    {
+        common_mode_sum_rc[ch] = 0;
+    }
+    common_mode_frames = 0;
+}
+
+void CommonMode_AddCalibrationFrame(const int32_t* capacitance)
+{
+    if (common_mode_frames == COMMON_MODE_CALIBRATION_MAX_FRAMES)
+    {
+        return;
+    }
+    int32_t reference = common_mode_reference(capacitance);
+    if (common_mode_frames == 0)
+    {
+        // Changes are measured from the first frame
+        for (uint8_t ch = 0; ch < COMMON_MODE_CHANNELS; ch++)
+        {
+            common_mode_calibration_base[ch] = capacitance[ch];
+        }
+        common_mode_baseline = reference;
+        common_mode_baseline_pending = 0;
+    }
+    int32_t delta_r = common_mode_clamp(reference - common_mode_baseline);
+    common_mode_sum_rr += (int64_t)delta_r * delta_r;
+    for (uint8_t ch = 0; ch < COMMON_MODE_CHANNELS; ch++)
+    {
+        int32_t delta_c = common_mode_clamp(capacitance[ch] - common_mode_calibration_base[ch]);
+        common_mode_sum_rc[ch] += (int64_t)delta_r * delta_c;
+    }
+    common_mode_frames++;
+}
+
+uint8_t CommonMode_FinishCalibration(void)
+{
+    if (common_mode_sum_rr == 0)
+    {
+        return FDC_CONF_ERR;
+    }
+    for (uint8_t ch = 0; ch < COMMON_MODE_CHANNELS; ch++)
+    {
+        if (common_mode_weights[ch] != 0)
+        {
+            continue;
+        }
+        // Least squares slope, scaled down so that the shift cannot overflow
+        int64_t sum_rc = common_mode_sum_rc[ch];
+        int64_t sum_rr = common_mode_sum_rr;
+        while ((sum_rr > (1LL << 46)) || (sum_rc > (1LL << 46)) || (sum_rc < -(1LL << 46)))
+        {
+            sum_rc /= 2;
+            sum_rr /= 2;
+        }
+        int64_t coupling = (sum_rc * (1L << COMMON_MODE_COUPLING_FRACT_BITS)) / sum_rr;
+        if (coupling > INT32_MAX)
+        {
+            coupling = INT32_MAX;
+        }
+        else if (coupling < -INT32_MAX)
+        {
+            coupling = -INT32_MAX;
+        }
+        common_mode_coupling[ch] = (int32_t)coupling;
+    }
+    return FDC_OK;
+}
+
+void CommonMode_Process(const int32_t* capacitance, int32_t* result)
+{
+    int32_t reference = common_mode_reference(capacitance);
+    if (common_mode_baseline_pending)
+    {
+        common_mode_baseline = reference;
+        common_mode_baseline_pending = 0;
+    }
+    int32_t delta_r = reference - common_mode_baseline;
+    for (uint8_t ch = 0; ch < COMMON_MODE_CHANNELS; ch++)
+    {
+        int64_t correction = (int64_t)delta_r * common_mode_coupling[ch];
+        result[ch] = capacitance[ch] - (int32_t)(correction >> COMMON_MODE_COUPLING_FRACT_BITS);
+    }
+}
+
+// ===================================================================
+//                         HELPER FUNCTIONS
+// ===================================================================
+
+int32_t common_mode_reference(const int32_t* capacitance)
+{
+    int64_t reference = 0;
+    for (uint8_t ch = 0; ch < COMMON_MODE_CHANNELS; ch++)
+    {
+        reference += (int64_t)capacitance[ch] * common_mode_weights[ch];
+    }
+    return (int32_t)(reference >> COMMON_MODE_WEIGHT_FRACT_BITS);
+}
+
+int32_t common_mode_clamp(int32_t delta)
+{
+    if (delta > COMMON_MODE_DELTA_LIMIT)
+    {
+        return COMMON_MODE_DELTA_LIMIT;
+    }
+    if (delta < -COMMON_MODE_DELTA_LIMIT)
+    {
+        return -COMMON_MODE_DELTA_LIMIT;
+    }
+    return delta;
+}
+
+/* [] END OF FILE */
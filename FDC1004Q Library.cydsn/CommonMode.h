@@ -0,0 +1,115 @@
+/**
+*   \file CommonMode.h
+*   \brief Software common-mode rejection.
+*
+*   This file contains a processing stage that removes the drift shared by
+*   all the inputs (e.g. temperature and humidity changes) without using
+*   the differential measurement mode of the FDC1004Q, which takes a
+*   measurement slot for each pair. A reference signal is computed for
+*   each frame as a weighted combination of the channels, and each of the
+*   other channels is corrected by subtracting the change of the reference
+*   scaled by its own coupling coefficient. Since all the channels of a frame
+*   are corrected with the reference of the same frame, the frames must be
+*   complete (see #FDC_ReadAllMeasurements).
+*
+*   The coupling coefficients are learned during a calibration period in
+*   which only the environment changes, with a least squares fit of the
+*   change of each channel against the change of the reference. Each frame
+*   takes four multiply-accumulates for the reference and one multiplication
+*   per corrected channel; the only division is done when the calibration
+*   is completed.
+*
+*   \author Davide Marzorati
+*/
+
+#ifndef __COMMON_MODE_H__
+    #define __COMMON_MODE_H__
+
+    #include "FDC1004Q.h"
+
+    /**
+    *   \brief Number of channels in each frame.
+    */
+    #define COMMON_MODE_CHANNELS 4
+
+    /**
+    *   \brief Number of fractional bits of the reference weights.
+    */
+    #define COMMON_MODE_WEIGHT_FRACT_BITS 15
+
+    /**
+    *   \brief Number of fractional bits of the coupling coefficients.
+    */
+    #define COMMON_MODE_COUPLING_FRACT_BITS 16
+
+    /**
+    *   \brief Maximum number of frames used by a calibration.
+    *
+    *   Further frames are ignored.
+    */
+    #define COMMON_MODE_CALIBRATION_MAX_FRAMES 65535
+
+    /**
+    *   \brief Set the reference.
+    *
+    *   Channels with a non-zero weight are part of the reference and are
+    *   not corrected. The coupling coefficients are set to unity and the
+    *   reference baseline is taken from the next frame.
+    *   \param[in] weights the weight of each channel, with
+    *       #COMMON_MODE_WEIGHT_FRACT_BITS fractional bits. For a single
+    *       reference channel, use a weight of 1 (32767) on that channel.
+    *   \retval #FDC_OK if the reference was set.
+    *   \retval #FDC_CONF_ERR if all the weights are 0 or no channel is left
+    *       to be corrected.
+    */
+    uint8_t CommonMode_SetReference(const int16_t* weights);
+
+    /**
+    *   \brief Set the coupling coefficients.
+    *   \param[in] coupling the coefficient of each channel, with
+    *       #COMMON_MODE_COUPLING_FRACT_BITS fractional bits. The values of
+    *       the reference channels are ignored.
+    */
+    void CommonMode_SetCoupling(const int32_t* coupling);
+
+    /**
+    *   \brief Read the coupling coefficients.
+    *   \param[out] coupling the coefficient of each channel, with
+    *       #COMMON_MODE_COUPLING_FRACT_BITS fractional bits.
+    */
+    void CommonMode_GetCoupling(int32_t* coupling);
+
+    /**
+    *   \brief Start learning the coupling coefficients.
+    *
+    *   The first calibration frame becomes the reference baseline.
+    */
+    void CommonMode_StartCalibration(void);
+
+    /**
+    *   \brief Add a frame to the calibration.
+    *   \param[in] capacitance the capacitance of the four channels,
+    *       in units of the measurement LSB.
+    */
+    void CommonMode_AddCalibrationFrame(const int32_t* capacitance);
+
+    /**
+    *   \brief Complete the calibration and update the coupling coefficients.
+    *   \retval #FDC_OK if the coefficients were updated.
+    *   \retval #FDC_CONF_ERR if the reference did not change during the
+    *       calibration. The previous coefficients are kept.
+    */
+    uint8_t CommonMode_FinishCalibration(void);
+
+    /**
+    *   \brief Remove the common-mode change from a frame.
+    *
+    *   The reference channels are passed through unchanged.
+    *   \param[in] capacitance the capacitance of the four channels,
+    *       in units of the measurement LSB.
+    *   \param[out] result the corrected capacitance of the four channels.
+    */
+    void CommonMode_Process(const int32_t* capacitance, int32_t* result);
+
+#endif
+/* [] END OF FILE */
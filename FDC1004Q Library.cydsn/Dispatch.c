@@ -0,0 +1,122 @@
+/**
+*   \brief Source file for the dispatch of sample frames.
+*/
+
+#include "Dispatch.h"
+
+// Subscriber entry
+typedef struct {
+    Dispatch_Callback callback;
+    void* context;
+    uint8_t priority;
+    Dispatch_Stats stats;
+} Dispatch_Subscriber;
+
+// Subscribers, by ID
+static Dispatch_Subscriber dispatch_subscribers[DISPATCH_MAX_SUBSCRIBERS];
+static uint8_t dispatch_count;
+
+// IDs of the subscribers, in call order
+static uint8_t dispatch_order[DISPATCH_MAX_SUBSCRIBERS];
+
+// Frame slot
+static Dispatch_Frame dispatch_slot;
+
+// Clock used for time accounting
+static Dispatch_Clock dispatch_clock;
+
+void Dispatch_Init(Dispatch_Clock clock)
+{
+    dispatch_clock = clock;
+    dispatch_count = 0;
+}
+
+uint8_t Dispatch_Subscribe(Dispatch_Callback callback, void* context, uint8_t priority)
+{
+    if ((dispatch_count == DISPATCH_MAX_SUBSCRIBERS) || (callback == NULL))
+    {
+        return DISPATCH_NONE;
+    }
+    uint8_t id = dispatch_count;
+    Dispatch_Subscriber* subscriber = &dispatch_subscribers[id];
+    subscriber->callback = callback;
+    subscriber->context = context;
+    subscriber->priority = priority;
+    subscriber->stats.calls = 0;
+    subscriber->stats.total_time = 0;
+    subscriber->stats.max_time = 0;
+    
+    // Insert after the subscribers with the same or higher priority
+    uint8_t position = dispatch_count;
+    while ((position > 0) && (dispatch_subscribers[dispatch_order[position - 1]].priority > priority))
+    {
+        dispatch_order[position] = dispatch_order[position - 1];
+        position--;
+    }
+    dispatch_order[position] = id;
+    dispatch_count++;
+    return id;
+}
+
+Dispatch_Frame* Dispatch_GetSlot(void)
+{
+    return &dispatch_slot;
+}
+
+void Dispatch_Publish(void)
+{
+    for (uint8_t i = 0; i < dispatch_count; i++)
+    {
+        Dispatch_Subscriber* subscriber = &dispatch_subscribers[dispatch_order[i]];
+        uint32_t start = (dispatch_clock != NULL) ? dispatch_clock() : 0;
+        subscriber->callback(&dispatch_slot, subscriber->context);
+        subscriber->stats.calls++;
+        if (dispatch_clock != NULL)
+        {
+            uint32_t elapsed = dispatch_clock() - start;
+            subscriber->stats.total_time += elapsed;
+            if (elapsed > subscriber->stats.max_time)
+            {
+                subscriber->stats.max_time = elapsed;
+            }
+        }
+    }
+}
+
+uint8_t Dispatch_GetStats(uint8_t id, Dispatch_Stats* stats)
+{
+    if (id >= dispatch_count)
+    {
+        return FDC_CONF_ERR;
+    }
+    *stats = dispatch_subscribers[id].stats;
+    return FDC_OK;
+}
+
+uint8_t Dispatch_GetSlowest(void)
+{
+    uint8_t slowest = DISPATCH_NONE;
+    uint32_t max_time = 0;
+    for (uint8_t id = 0; id < dispatch_count; id++)
+    {
+        if ((dispatch_subscribers[id].stats.calls > 0) && 
+            ((slowest == DISPATCH_NONE) || (dispatch_subscribers[id].stats.max_time > max_time)))
+        {
+            slowest = id;
+            max_time = dispatch_subscribers[id].stats.max_time;
+        }
+    }
+    return slowest;
+}
+
+void Dispatch_ClearStats(void)
+{
+    for (uint8_t id = 0; id < dispatch_count; id++)
+    {
+        dispatch_subscribers[id].stats.calls = 0;
+        dispatch_subscribers[id].stats.total_time = 0;
+        dispatch_subscribers[id].stats.max_time = 0;
+    }
+}
+
+/* [] END OF FILE */
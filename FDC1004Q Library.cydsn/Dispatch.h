@@ -0,0 +1,125 @@
+/**
+*   \file Dispatch.h
+*   \brief Dispatch of sample frames to their consumers.
+*
+*   This file contains a small publish/subscribe registry for the sample
+*   frames. The acquisition code fills the single frame slot returned by
+*   #Dispatch_GetSlot and publishes it; every registered consumer is then
+*   called in priority order with a const pointer to the same slot, so
+*   adding a consumer never adds a copy of the frame. The time spent in
+*   each consumer is measured with a clock supplied by the application,
+*   so that the slowest consumer can be found.
+*
+*   \author Davide Marzorati
+*/
+
+#ifndef __DISPATCH_H__
+    #define __DISPATCH_H__
+
+    #include "FDC1004Q.h"
+
+    /**
+    *   \brief Maximum number of subscribers.
+    */
+    #ifndef DISPATCH_MAX_SUBSCRIBERS
+        #define DISPATCH_MAX_SUBSCRIBERS 8
+    #endif
+
+    /**
+    *   \brief Value returned when no subscriber is found.
+    */
+    #define DISPATCH_NONE 0xFF
+
+    /**
+    *   \brief Frame of samples.
+    */
+    typedef struct {
+        /** Timestamp of the frame **/
+        uint32_t timestamp;
+        /** Raw measurements, as returned by #FDC_ReadRawMeasurement **/
+        uint32_t capacitance[4];
+        /** CAPDAC settings the measurements were taken with **/
+        uint8_t capdac[4];
+        /** Capacitance in units of the measurement LSB, converted with the CAPDAC settings above **/
+        int32_t value[4];
+    } Dispatch_Frame;
+
+    /**
+    *   \brief Subscriber callback.
+    *   \param[in] frame the published frame, valid only during the call.
+    *   \param context the context pointer given at subscription.
+    */
+    typedef void (*Dispatch_Callback)(const Dispatch_Frame* frame, void* context);
+
+    /**
+    *   \brief Clock used to measure the time spent by the subscribers.
+    */
+    typedef uint32_t (*Dispatch_Clock)(void);
+
+    /**
+    *   \brief Statistics of a subscriber.
+    */
+    typedef struct {
+        /** Number of frames delivered **/
+        uint32_t calls;
+        /** Total time spent in the callback, in clock ticks **/
+        uint32_t total_time;
+        /** Longest time spent in a single call, in clock ticks **/
+        uint32_t max_time;
+    } Dispatch_Stats;
+
+    /**
+    *   \brief Initialize the registry.
+    *
+    *   All the subscribers are removed.
+    *   \param clock the clock used to measure the subscribers,
+    *       or NULL to disable time accounting.
+    */
+    void Dispatch_Init(Dispatch_Clock clock);
+
+    /**
+    *   \brief Register a subscriber.
+    *
+    *   Subscribers are called by increasing priority value; subscribers
+    *   with the same priority are called in subscription order.
+    *   \param callback the function called for each frame.
+    *   \param context the pointer passed to the callback.
+    *   \param priority the priority, 0 being the first to be called.
+    *   \return the ID of the subscriber, or #DISPATCH_NONE if the registry is full.
+    */
+    uint8_t Dispatch_Subscribe(Dispatch_Callback callback, void* context, uint8_t priority);
+
+    /**
+    *   \brief Get the frame slot to be filled before publishing.
+    *   \return pointer to the frame slot.
+    */
+    Dispatch_Frame* Dispatch_GetSlot(void);
+
+    /**
+    *   \brief Deliver the frame slot to all the subscribers.
+    */
+    void Dispatch_Publish(void);
+
+    /**
+    *   \brief Read the statistics of a subscriber.
+    *   \param id the ID of the subscriber.
+    *   \param[out] stats pointer to the structure to be filled.
+    *   \retval #FDC_OK if everything ok.
+    *   \retval #FDC_CONF_ERR if the ID is not valid.
+    */
+    uint8_t Dispatch_GetStats(uint8_t id, Dispatch_Stats* stats);
+
+    /**
+    *   \brief Find the slowest subscriber.
+    *   \return the ID of the subscriber with the longest single call,
+    *       or #DISPATCH_NONE if no frame was delivered.
+    */
+    uint8_t Dispatch_GetSlowest(void);
+
+    /**
+    *   \brief Clear the statistics of all the subscribers.
+    */
+    void Dispatch_ClearStats(void);
+
+#endif
+/* [] END OF FILE */
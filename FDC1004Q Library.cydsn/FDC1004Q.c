@@ -3,22 +3,13 @@
 */
 
 #include "FDC1004Q.h"
+#include "FDC1004Q_Trace.h"
 #include "I2C_Interface.h"
+#include "I2C_Arbiter.h"
 
-/**
-*   \brief I2C Address of the FDC1004Q sensor.
-*/
-#define FDC1004Q_I2C_ADDR 0x50
-
-/**
-*   \brief Expected manufacturer ID value.
-*/
-#define FDC1004Q_MANUFACTURED_ID_VALUE 0x5449
-
-/**
-*   \brief Expected device ID value.
-*/
-#define FDC1004Q_DEVICE_ID_VALUE 0x1004
+#if I2C_BATCH_MAX_READS < 8
+    #error "FDC_ReadAllMeasurements needs I2C_BATCH_MAX_READS of at least 8"
+#endif
 
 // =============================================
 //               FDC REGISTER BITS
@@ -39,17 +30,41 @@
 */
 #define FIXED_POINT_FRACTIONAL_BITS_GAIN   14
 
+#ifndef FDC_NO_FLOAT
 // Converts unsigned fixed point format to double
 static float fixed_to_float_unsigned(uint16_t input, uint8_t fract_bits);
 
 // Converts double to unsigned fixed point format
 static int16_t float_to_fixed_unsigned(float input, uint8_t fract_bits);
+#endif
+
+// Read-modify-write of a register, holding the driver lock
+static uint8_t fdc_update_register(uint8_t reg_addr, uint16_t clear_mask, uint16_t set_mask);
+
+// State of the device driven by the blocking API
+static FDC_State fdc_state;
+
+// Saturation conditions to be detected
+static uint8_t fdc_saturation_flags = FDC_SAT_HIGH | FDC_SAT_LOW;
+
+// Arbiter priority and bus segment of the register accesses
+static uint8_t fdc_bus_priority = FDC_BUS_DIRECT;
+static uint8_t fdc_bus_segment;
+
+// Access a register directly or through the arbiter
+static uint8_t fdc_transfer(uint8_t op, uint8_t reg_addr, uint8_t* data);
+
+
+// Read CONF_MEASx register, using the shadow copy if up to date
+static uint8_t fdc_read_conf_meas(uint8_t channel, uint16_t* value);
 
+#ifndef FDC_NO_FLOAT
 // Converts signed fixed point format to double
 static float fixed_to_float_signed(int16_t input, uint8_t fract_bits);
 
 // Converts double to signed fixed point format
 static int16_t float_to_fixed_signed(float input, uint8_t fract_bits);
+#endif
 
 // ===========================================================
 //                 INITIALIZATION FUNCTIONS
@@ -97,11 +112,9 @@ uint8_t FDC_Reset(void)
     // Read FDC register, set RESET bit, write FDC register
     uint8_t temp[2];
     uint16_t register_value = 0;
-    uint8_t error = FDC_ReadRegister(FDC1004Q_FDC_CONF, temp);
+    uint8_t error = fdc_update_register(FDC1004Q_FDC_CONF, 0, 1 << FDC_FDC_CONF_RESET_BIT);
     if (error == FDC_OK)
     {
-        temp[0] |= 1 << (FDC_FDC_CONF_RESET_BIT-8);
-        error = FDC_WriteRegister(FDC1004Q_FDC_CONF, temp);
         // Wait for reset to be completed
         uint8_t flag = 1;
         do
@@ -126,18 +139,8 @@ uint8_t FDC_SetSampleRate(uint8_t sampleRate)
 {
     if (sampleRate > FDC_400_Hz)
         return FDC_CONF_ERR;
-    // Read FDC register, set RATE bits, write FDC register
-    uint8_t temp[2];
-    uint8_t error = FDC_ReadRegister(FDC1004Q_FDC_CONF, temp);
-    if (error == FDC_OK)
-    {
-        // Clear bits [11:10]
-        temp[0] &= ~0x0C;
-        temp[0] |= (sampleRate << 2);
-        error = FDC_WriteRegister(FDC1004Q_FDC_CONF, temp);
-
-    }
-    return error; 
+    // Read FDC register, set RATE bits [11:10], write FDC register
+    return fdc_update_register(FDC1004Q_FDC_CONF, 0x0C00, sampleRate << 10);
 }
 
 // Read sample rate
@@ -152,6 +155,7 @@ uint8_t FDC_ReadSampleRate(uint8_t* sampleRate)
     return error; 
 }
 
+#ifndef FDC_NO_FLOAT
 // Set offset calibration in float format
 uint8_t FDC_SetOffsetCalibration(uint8_t channel, float offset)
 {
@@ -167,19 +171,21 @@ uint8_t FDC_SetOffsetCalibration(uint8_t channel, float offset)
     uint8_t temp[2] = {offset_raw >> 8, offset_raw & 0xFF};
     return FDC_WriteRegister(FDC1004Q_OFFSET_CAL_CIN1 + channel, temp);
 }
+#endif
 
 // Set offset calibration in raw format
 uint8_t FDC_SetRawOffsetCalibration(uint8_t channel, int16_t offset)
 {
     if (channel > FDC_CH_4)
         return FDC_CONF_ERR;
-    float offset_f = fixed_to_float_signed(offset, FIXED_POINT_FRACTIONAL_BITS_OFFSET);
-    if ( (offset_f < 0) || (offset_f > 16))
+    // Q5.11 values are below 16 pF, so only the sign must be checked
+    if (offset < 0)
         return FDC_CONF_ERR;
     uint8_t temp[2] = {offset >> 8, offset & 0xFF};
     return FDC_WriteRegister(FDC1004Q_OFFSET_CAL_CIN1 + channel, temp);
 }
 
+#ifndef FDC_NO_FLOAT
 // Read offset calibration in float format
 uint8_t FDC_ReadOffsetCalibration(uint8_t channel, float* offset)
 {
@@ -197,6 +203,7 @@ uint8_t FDC_ReadOffsetCalibration(uint8_t channel, float* offset)
     }
     return error;
 }
+#endif
 
 // Read offset calibration as signed int
 uint8_t FDC_ReadRawOffsetCalibration(uint8_t channel, int16_t* offset)
@@ -212,6 +219,7 @@ uint8_t FDC_ReadRawOffsetCalibration(uint8_t channel, int16_t* offset)
     return error;
 }
 
+#ifndef FDC_NO_FLOAT
 // Set calibration gain in float format
 uint8_t FDC_SetGainCalibration(uint8_t channel, float gain)
 {
@@ -223,19 +231,19 @@ uint8_t FDC_SetGainCalibration(uint8_t channel, float gain)
     uint8_t temp[2] = {gain_u16 >> 8, gain_u16 & 0xFF};
     return FDC_WriteRegister(FDC1004Q_GAIN_CAL_CIN1 + channel, temp);
 }
+#endif
 
 // Set gain calibration in raw format
 uint8_t FDC_SetRawGainCalibration(uint8_t channel, uint16_t gain)
 {
     if (channel > FDC_CH_4)
         return FDC_CONF_ERR;
-    float gain_f = fixed_to_float_unsigned(gain, FIXED_POINT_FRACTIONAL_BITS_GAIN);
-    if ( (gain_f < 0) || (gain_f > 4))
-        return FDC_CONF_ERR;
+    // Every Q2.14 value is between 0 and 4, so no range check is needed
     uint8_t temp[2] = {gain >> 8, gain & 0xFF};
     return FDC_WriteRegister(FDC1004Q_GAIN_CAL_CIN1 + channel, temp);
 }
 
+#ifndef FDC_NO_FLOAT
 // Read gain calibration in float format
 uint8_t FDC_ReadGainCalibration(uint8_t channel, float* gain)
 {
@@ -249,6 +257,7 @@ uint8_t FDC_ReadGainCalibration(uint8_t channel, float* gain)
     }
     return error;
 }
+#endif
 
 // Read raw gain calibration in raw format
 uint8_t FDC_ReadRawGainCalibration(uint8_t channel, uint16_t* gain)
@@ -273,17 +282,8 @@ uint8_t FDC_InitMeasurement(uint8_t channel)
 {
     if (channel > FDC_CH_4)
         return FDC_CONF_ERR;
-    uint8_t temp[2];
-    uint8_t error = FDC_ReadRegister(FDC1004Q_FDC_CONF, temp);
-    if (error == FDC_OK)
-    {
-        // Clear bit of channel
-        temp[1] &= ~ ( 1 << (7 - channel));
-        // Set bit
-        temp[1] |= (1 << (7 - channel));
-        error = FDC_WriteRegister(FDC1004Q_FDC_CONF, temp);
-    }
-    return error;
+    // Set bit of channel
+    return fdc_update_register(FDC1004Q_FDC_CONF, 0, 1 << (7 - channel));
 }
 
 // Stop a measurement for a given channel
@@ -291,16 +291,8 @@ uint8_t FDC_StopMeasurement(uint8_t channel)
 {
     if (channel > FDC_CH_4)
         return FDC_CONF_ERR;
-    uint8_t temp[2];
-    uint8_t error = FDC_ReadRegister(FDC1004Q_FDC_CONF, temp);
-    if (error == FDC_OK)
-    {
-        // Clear bit of channel
-        temp[1] &= ~ (1 << (7 - channel));
-       
-        error = FDC_WriteRegister(FDC1004Q_FDC_CONF, temp);
-    }
-    return error;
+    // Clear bit of channel
+    return fdc_update_register(FDC1004Q_FDC_CONF, 1 << (7 - channel), 0);
 }
 
 // Check if channel measurement is complete
@@ -320,44 +312,16 @@ uint8_t FDC_IsMeasurementDone(uint8_t channel, uint8_t* done)
 // Enable repeated measurements --> all measurements must be already enabled
 uint8_t FDC_EnableRepeatMeasurement(uint8_t channel_flags)
 {
-    // Read FDC register, set REPEAT Bits and write register again
-    uint8_t temp[2];
-    // Disable all measurements
-    uint8_t error = FDC_CONF_ERR;
-    for (uint8_t ch = FDC_CH_1; ch < FDC_CH_4; ch ++)
-    {
-        error = FDC_StopMeasurement(ch);
-        if ( error != FDC_OK)
-        {
-            return FDC_COMM_ERR;
-        }
-    }
-    // Read configuration register
-    error = FDC_ReadRegister(FDC1004Q_FDC_CONF, temp);
-    if (error == FDC_OK)
-    {
-        // Set REPEAT bit
-        temp[0] |= 1;
-        temp[1] |= channel_flags;
-        error = FDC_WriteRegister(FDC1004Q_FDC_CONF, temp);
-        
-    }
-    return error; 
+    // Replace channel bits [7:4] and set REPEAT bit 8, so that the channels
+    // left out are stopped
+    return fdc_update_register(FDC1004Q_FDC_CONF, 0x00F0, 0x0100 | (channel_flags & 0xF0));
 }
 
 // Disable repeated measurements
 uint8_t FDC_DisableRepeatMeasurement(void)
 {
-   // Read FDC register, set REPEAT Bits
-    uint8_t temp[2];
-    uint8_t error = FDC_ReadRegister(FDC1004Q_FDC_CONF, temp);
-    if (error == FDC_OK)
-    {
-        // Clear bit 8
-        temp[0] &= 0xFE;
-        error = FDC_WriteRegister(FDC1004Q_FDC_CONF, temp);
-    }
-    return error;  
+    // Read FDC register, clear REPEAT bit 8
+    return fdc_update_register(FDC1004Q_FDC_CONF, 0x0100, 0);
 }
 
 // Configure inputs for measurement
@@ -374,26 +338,9 @@ uint8_t FDC_ConfigureMeasurementInput(uint8_t meas_channel,
     }
     if (meas_channel > FDC_CH_4)
         return FDC_CONF_ERR;
-    // Read current value in the register
-    uint8_t temp[2];
-    uint8_t error = FDC_ReadRegister(FDC1004Q_CONF_MEAS1 + meas_channel, temp);
-    if ( error == I2C_NO_ERROR)
-    {
-        uint16_t temp16 = temp[0] << 8 | temp[1];
-        // Clear all required bits
-        temp16 &= ~0xFFF0;
-        // Configure capdac
-        temp16 |= capdac << 5;
-        // Configure pos
-        temp16 |= pos << 13;
-        // Configure neg
-        temp16 |= neg << 10;
-        // Write new register value
-        temp[0] = temp16 >> 8;
-        temp[1] = temp16 & 0xFF;
-        error = FDC_WriteRegister(FDC1004Q_CONF_MEAS1 + meas_channel, temp);
-    }
-    return error;
+    // Configure pos, neg and capdac
+    return fdc_update_register(FDC1004Q_CONF_MEAS1 + meas_channel, 0xFFF0,
+                                pos << 13 | neg << 10 | capdac << 5);
 }
 
 // Configure channel
@@ -435,28 +382,52 @@ uint8_t FDC_ReadRawMeasurement(uint8_t channel, uint32_t* capacitance)
     return error;
 }
 
-// Read capaciity in float format
-uint8_t FDC_ReadMeasurement(uint8_t channel, double* capacitance)
+// Read capacity in fixed point format
+uint8_t FDC_ReadFixedMeasurement(uint8_t channel, int32_t* capacitance)
 {
     if (channel > FDC_CH_4)
         return FDC_CONF_ERR;
     uint32_t capRaw;
     uint8_t error = FDC_ReadRawMeasurement(channel, &capRaw);
+    if ((error == FDC_OK) && (FDC_CheckSaturation(capRaw) != FDC_SAT_NONE))
+    {
+        error = FDC_MEAS_SATURATED;
+    }
     if ( error == FDC_OK)
     {
-        double temp_cap = (double)(capRaw >> 8);
-        if (temp_cap > ( (1 << 23) -1))
+        // Read current capdac setting
+        uint16_t temp16;
+        error = fdc_read_conf_meas(channel, &temp16);
+        if ( error == FDC_OK)
         {
-            temp_cap -= ( 1 << 24);
+            uint8_t capdac = (temp16 >> 5) & 0x1F;
+            FDC_ConvertRawMeasurementsFixed(&capRaw, &capdac, capacitance, 1);
         }
-        temp_cap /= (2<<18);
+    }
+    return error;
+}
+
+#ifndef FDC_NO_FLOAT
+// Read capaciity in float format
+uint8_t FDC_ReadMeasurement(uint8_t channel, double* capacitance)
+{
+    if (channel > FDC_CH_4)
+        return FDC_CONF_ERR;
+    uint32_t capRaw;
+    uint8_t error = FDC_ReadRawMeasurement(channel, &capRaw);
+    if ((error == FDC_OK) && (FDC_CheckSaturation(capRaw) != FDC_SAT_NONE))
+    {
+        error = FDC_MEAS_SATURATED;
+    }
+    if ( error == FDC_OK)
+    {
+        double temp_cap = FDC_ConvertRawMeasurement(capRaw);
         // Read current capdac setting
-        uint8_t temp[2];
-        error = FDC_ReadRegister(FDC1004Q_CONF_MEAS1 + channel, temp);
-        if ( error == I2C_NO_ERROR)
+        uint16_t temp16;
+        error = fdc_read_conf_meas(channel, &temp16);
+        if ( error == FDC_OK)
         {
             // Read current capdac
-            uint16_t temp16 = temp[0] << 8 | temp[1];
             uint8_t capdac = (temp16 >> 5) & 0x1F;
             // Add offset
             *capacitance = temp_cap + capdac * FDC_CAPDAC_FACTOR;
@@ -469,13 +440,38 @@ uint8_t FDC_ReadMeasurement(uint8_t channel, double* capacitance)
 // Convert raw to double
 double FDC_ConvertRawMeasurement(uint32_t capacitance)
 {
-    double temp_cap = (double)(capacitance >> 8);
-    if (temp_cap > ( (1 << 23) -1))
+    // 24-bit two's complement value, sign extended by the arithmetic shift.
+    // Multiplying by 2^-19 is exact, so no division is required.
+    return (double)((int32_t)capacitance >> 8) * FDC_MEAS_LSB_PF;
+}
+
+// Convert array of raw values to float
+void FDC_ConvertRawMeasurements(const uint32_t* capacitance, 
+                                const uint8_t* capdac,
+                                float* result,
+                                uint16_t count)
+{
+    // Both terms are exact in float, so the sum is rounded only once
+    // as in the conversion of the double result
+    for (uint16_t i = 0; i < count; i++)
     {
-        temp_cap -= ( 1 << 24);
+        float offset = (capdac != NULL) ? (float)capdac[i] * (float)FDC_CAPDAC_FACTOR : 0.0f;
+        result[i] = (float)((int32_t)capacitance[i] >> 8) * (float)FDC_MEAS_LSB_PF + offset;
+    }
+}
+#endif
+
+// Convert array of raw values to fixed point
+void FDC_ConvertRawMeasurementsFixed(const uint32_t* capacitance, 
+                                    const uint8_t* capdac,
+                                    int32_t* result,
+                                    uint16_t count)
+{
+    for (uint16_t i = 0; i < count; i++)
+    {
+        int32_t offset = (capdac != NULL) ? capdac[i] * FDC_CAPDAC_FIXED_FACTOR : 0;
+        result[i] = ((int32_t)capacitance[i] >> 8) + offset;
     }
-    temp_cap /= (2<<18);
-    return temp_cap;
 }
 
 uint8_t FDC_ReadRawCapdacSetting(uint8_t channel, uint8_t* capdac)
@@ -494,6 +490,7 @@ uint8_t FDC_ReadRawCapdacSetting(uint8_t channel, uint8_t* capdac)
     return error;
 }
 
+#ifndef FDC_NO_FLOAT
 uint8_t FDC_ReadCapdacSetting(uint8_t channel, float* capdac)
 {
     if (channel > FDC_CH_4)
@@ -510,6 +507,8 @@ uint8_t FDC_ReadCapdacSetting(uint8_t channel, float* capdac)
     }
     return error;
 }
+#endif
+
 uint8_t FDC_ReadPositiveChannelSetting(uint8_t channel, uint8_t* input)
 {
     if (channel > FDC_CH_4)
@@ -534,8 +533,8 @@ uint8_t FDC_ReadNegativeChannelSetting(uint8_t channel, uint8_t* input)
     // Read current capdac setting
     uint8_t temp[2];
     
-    uint8_t error = I2C_Peripheral_ReadRegisterMulti(FDC1004Q_I2C_ADDR, FDC1004Q_CONF_MEAS1 + channel, 2, temp);
-    if ( error == I2C_NO_ERROR)
+    uint8_t error = FDC_ReadRegister(FDC1004Q_CONF_MEAS1 + channel, temp);
+    if ( error == FDC_OK)
     {
         uint16_t temp16 = temp[0] << 8 | temp[1];
         *input = (temp16 >> 10) & 0x07;
@@ -558,6 +557,124 @@ uint8_t FDC_HasNewData(uint8_t* done)
 }
 
 
+// Read new measurements of a set of channels
+uint8_t FDC_ReadAllMeasurements(uint8_t mask, FDC_Frame* frame)
+{
+    frame->valid = 0;
+    frame->saturated = 0;
+    uint8_t temp[2];
+    FDC_LOCK();
+    uint8_t error = FDC_ReadRegister(FDC1004Q_FDC_CONF, temp);
+    if (error != FDC_OK)
+    {
+        FDC_UNLOCK();
+        return error;
+    }
+    // The register pointer does not auto-increment, so each half
+    // of a measurement register needs its own read: all of them
+    // are issued as a single batch
+    uint8_t done = temp[1] & mask & FDC_DONE_CH_ALL;
+    uint8_t reg_addr[2 * 4];
+    uint8_t data[2 * 2 * 4];
+    uint8_t count = 0;
+    for (uint8_t ch = FDC_CH_1; ch <= FDC_CH_4; ch++)
+    {
+        if (done & (FDC_DONE_CH_1 >> ch))
+        {
+            reg_addr[count++] = FDC1004Q_MEAS1_MSB + (2*ch);
+            reg_addr[count++] = FDC1004Q_MEAS1_LSB + (2*ch);
+        }
+    }
+    error = FDC_ReadRegisters(reg_addr, data, count);
+    if (error != FDC_OK)
+    {
+        FDC_UNLOCK();
+        return error;
+    }
+    uint8_t* meas = data;
+    for (uint8_t ch = FDC_CH_1; ch <= FDC_CH_4; ch++)
+    {
+        if (done & (FDC_DONE_CH_1 >> ch))
+        {
+            uint16_t conf_meas;
+            frame->capacitance[ch] = ((uint32_t)meas[0] << 24) | ((uint32_t)meas[1] << 16) |
+                                     (meas[2] << 8) | meas[3];
+            meas += 4;
+            error = fdc_read_conf_meas(ch, &conf_meas);
+            if (error != FDC_OK)
+            {
+                FDC_UNLOCK();
+                return error;
+            }
+            frame->capdac[ch] = (conf_meas >> 5) & 0x1F;
+            if (FDC_CheckSaturation(frame->capacitance[ch]) != FDC_SAT_NONE)
+            {
+                frame->saturated |= (FDC_DONE_CH_1 >> ch);
+            }
+            else
+            {
+                frame->valid |= (FDC_DONE_CH_1 >> ch);
+            }
+        }
+    }
+    FDC_UNLOCK();
+    return FDC_OK;
+}
+
+// ===========================================================
+//                   SATURATION DETECTION
+// ===========================================================
+
+void FDC_SetSaturationDetection(uint8_t flags)
+{
+    fdc_saturation_flags = flags & (FDC_SAT_HIGH | FDC_SAT_LOW);
+}
+
+uint8_t FDC_CheckSaturation(uint32_t capacitance)
+{
+    // The 8 LSBs are always 0
+    capacitance &= 0xFFFFFF00;
+    if (capacitance == FDC_RAW_SAT_HIGH)
+    {
+        return fdc_saturation_flags & FDC_SAT_HIGH;
+    }
+    if (capacitance == FDC_RAW_SAT_LOW)
+    {
+        return fdc_saturation_flags & FDC_SAT_LOW;
+    }
+    return FDC_SAT_NONE;
+}
+
+uint8_t FDC_CorrectiveCapdac(uint8_t capdac, uint8_t saturation)
+{
+    if (saturation == FDC_SAT_HIGH)
+    {
+        return (capdac + FDC_CAPDAC_RECOVERY_STEPS > FDC_CAPDAC_MAX) ? 
+                    FDC_CAPDAC_MAX : capdac + FDC_CAPDAC_RECOVERY_STEPS;
+    }
+    if (saturation == FDC_SAT_LOW)
+    {
+        return (capdac < FDC_CAPDAC_RECOVERY_STEPS) ? 0 : capdac - FDC_CAPDAC_RECOVERY_STEPS;
+    }
+    return capdac;
+}
+
+uint8_t FDC_ReadSaturationCount(uint8_t channel, uint32_t* count)
+{
+    if (channel > FDC_CH_4)
+        return FDC_CONF_ERR;
+    *count = fdc_state.saturation_count[channel];
+    return FDC_OK;
+}
+
+void FDC_ClearSaturationCounts(void)
+{
+    for (uint8_t ch = FDC_CH_1; ch <= FDC_CH_4; ch++)
+    {
+        fdc_state.saturation_count[ch] = 0;
+    }
+}
+
 // ===========================================================
 //      MANUFACTURER ID / DEVICE ID FUNCTIONS
 // ===========================================================
@@ -596,29 +713,174 @@ uint8_t FDC_ReadDeviceId(uint16_t* reg_value)
 // Read register with 16 bit of data
 uint8_t FDC_ReadRegister(uint8_t reg_addr, uint8_t* data)
 {
-    uint8_t error = I2C_Peripheral_ReadRegisterMulti(FDC1004Q_I2C_ADDR, reg_addr, 2, data);
+    FDC_LOCK();
+    FDC_TRACE_BEGIN();
+    uint8_t error = fdc_transfer(I2C_ARBITER_READ, reg_addr, data);
     if (error == I2C_NO_ERROR)
     {
-        return FDC_OK;
+        FDC_TrackRegister(NULL, reg_addr, data);
+        error = FDC_OK;
     }
     else
     {
-        return FDC_COMM_ERR;
+        error = FDC_COMM_ERR;
     }
+    FDC_TRACE_END(FDC_TRACE_OP_READ, reg_addr, data, error);
+    FDC_UNLOCK();
+    return error;
 }
 
 // Write register with 16 bit of data
 uint8_t FDC_WriteRegister(uint8_t reg_addr, uint8_t* data)
 {
-    uint8_t error = I2C_Peripheral_WriteRegisterMulti(FDC1004Q_I2C_ADDR, reg_addr, 2, data);
+    FDC_LOCK();
+    FDC_TRACE_BEGIN();
+    uint8_t error = fdc_transfer(I2C_ARBITER_WRITE, reg_addr, data);
     if (error == I2C_NO_ERROR)
     {
+        FDC_TrackRegister(NULL, reg_addr, data);
+        error = FDC_OK;
+    }
+    else
+    {
+        error = FDC_COMM_ERR;
+    }
+    FDC_TRACE_END(FDC_TRACE_OP_WRITE, reg_addr, data, error);
+    FDC_UNLOCK();
+    return error;
+}
+
+// Read several registers with 16 bit of data
+uint8_t FDC_ReadRegisters(const uint8_t* reg_addr, uint8_t* data, uint8_t count)
+{
+    I2C_RegisterRead reads[I2C_BATCH_MAX_READS];
+    if (count > I2C_BATCH_MAX_READS)
+        return FDC_CONF_ERR;
+    if (count == 0)
         return FDC_OK;
+    for (uint8_t i = 0; i < count; i++)
+    {
+        reads[i].register_address = reg_addr[i];
+        reads[i].register_count = 2;
+        reads[i].data = &data[2*i];
+    }
+    FDC_LOCK();
+    uint8_t error = FDC_OK;
+    if (fdc_bus_priority == FDC_BUS_DIRECT)
+    {
+        // A single transfer: its registers share its start and duration
+        FDC_TRACE_BEGIN();
+        error = I2C_Peripheral_ReadRegisterBatch(FDC1004Q_I2C_ADDR, reads, count);
+        error = (error == I2C_NO_ERROR) ? FDC_OK : FDC_COMM_ERR;
+        for (uint8_t i = 0; i < count; i++)
+        {
+            if (error == FDC_OK)
+            {
+                FDC_TrackRegister(NULL, reg_addr[i], &data[2*i]);
+            }
+            FDC_TRACE_END(FDC_TRACE_OP_READ, reg_addr[i], &data[2*i], error);
+        }
     }
     else
     {
-        return FDC_COMM_ERR;
+        // One transfer per register, each traced on its own
+        for (uint8_t i = 0; (i < count) && (error == FDC_OK); i++)
+        {
+            FDC_TRACE_BEGIN();
+            error = fdc_transfer(I2C_ARBITER_READ, reg_addr[i], &data[2*i]);
+            error = (error == I2C_NO_ERROR) ? FDC_OK : FDC_COMM_ERR;
+            if (error == FDC_OK)
+            {
+                FDC_TrackRegister(NULL, reg_addr[i], &data[2*i]);
+            }
+            FDC_TRACE_END(FDC_TRACE_OP_READ, reg_addr[i], &data[2*i], error);
+        }
+    }
+    FDC_UNLOCK();
+    return error;
+}
+
+// Route the register accesses through the arbiter
+void FDC_SetBusPriority(uint8_t priority, uint8_t bus)
+{
+    FDC_LOCK();
+    fdc_bus_priority = priority;
+    fdc_bus_segment = bus;
+    FDC_UNLOCK();
+}
+
+// Clear the state of a device
+void FDC_InitState(FDC_State* state)
+{
+    for (uint8_t ch = FDC_CH_1; ch <= FDC_CH_4; ch++)
+    {
+        state->conf_meas[ch] = 0;
+        state->meas_msb[ch] = 0;
+        state->saturation_count[ch] = 0;
+    }
+    state->conf_meas_valid = 0;
+}
+
+// Keep the driver state in line with register accesses
+void FDC_TrackRegister(FDC_State* state, uint8_t reg_addr, const uint8_t* data)
+{
+    FDC_LOCK();
+    if (state == NULL)
+    {
+        state = &fdc_state;
+    }
+    if ((reg_addr >= FDC1004Q_CONF_MEAS1) && (reg_addr <= FDC1004Q_CONF_MEAS4))
+    {
+        uint8_t channel = reg_addr - FDC1004Q_CONF_MEAS1;
+        // Reserved bits always read 0
+        state->conf_meas[channel] = (data[0] << 8 | data[1]) & 0xFFE0;
+        state->conf_meas_valid |= (1 << channel);
+    }
+    else if ((reg_addr == FDC1004Q_FDC_CONF) && (data[0] & (1 << (FDC_FDC_CONF_RESET_BIT-8))))
+    {
+        // Registers go back to their default value on reset
+        state->conf_meas_valid = 0;
+    }
+    else if (reg_addr <= FDC1004Q_MEAS4_LSB)
+    {
+        // The measurement registers start at address 0
+        uint8_t channel = (reg_addr - FDC1004Q_MEAS1_MSB) >> 1;
+        if (((reg_addr - FDC1004Q_MEAS1_MSB) & 0x01) == 0)
+        {
+            state->meas_msb[channel] = data[0] << 8 | data[1];
+        }
+        else
+        {
+            // A measurement is complete once its LSB half is read
+            uint32_t capacitance = ((uint32_t)state->meas_msb[channel] << 16) | (data[0] << 8 | data[1]);
+            if (FDC_CheckSaturation(capacitance) != FDC_SAT_NONE)
+            {
+                state->saturation_count[channel]++;
+            }
+        }
+    }
+    FDC_UNLOCK();
+}
+
+// Read a register from the copy kept by the driver
+uint8_t FDC_ReadCachedRegister(const FDC_State* state, uint8_t reg_addr, uint8_t* data)
+{
+    uint8_t error = FDC_CONF_ERR;
+    FDC_LOCK();
+    if (state == NULL)
+    {
+        state = &fdc_state;
     }
+    if ((reg_addr >= FDC1004Q_CONF_MEAS1) && (reg_addr <= FDC1004Q_CONF_MEAS4) &&
+        (state->conf_meas_valid & (1 << (reg_addr - FDC1004Q_CONF_MEAS1))))
+    {
+        uint16_t value = state->conf_meas[reg_addr - FDC1004Q_CONF_MEAS1];
+        data[0] = value >> 8;
+        data[1] = value & 0xFF;
+        error = FDC_OK;
+    }
+    FDC_UNLOCK();
+    return error;
 }
 
 
@@ -627,6 +889,68 @@ uint8_t FDC_WriteRegister(uint8_t reg_addr, uint8_t* data)
 //                         HELPER FUNCTIONS
 // ===================================================================
 
+uint8_t fdc_update_register(uint8_t reg_addr, uint16_t clear_mask, uint16_t set_mask)
+{
+    uint8_t temp[2];
+    FDC_LOCK();
+    uint8_t error = FDC_ReadRegister(reg_addr, temp);
+    if (error == FDC_OK)
+    {
+        uint16_t temp16 = temp[0] << 8 | temp[1];
+        temp16 &= ~clear_mask;
+        temp16 |= set_mask;
+        temp[0] = temp16 >> 8;
+        temp[1] = temp16 & 0xFF;
+        error = FDC_WriteRegister(reg_addr, temp);
+    }
+    FDC_UNLOCK();
+    return error;
+}
+
+uint8_t fdc_transfer(uint8_t op, uint8_t reg_addr, uint8_t* data)
+{
+    if (fdc_bus_priority == FDC_BUS_DIRECT)
+    {
+        return (op == I2C_ARBITER_READ) ?
+                    I2C_Peripheral_ReadRegisterMulti(FDC1004Q_I2C_ADDR, reg_addr, 2, data) :
+                    I2C_Peripheral_WriteRegisterMulti(FDC1004Q_I2C_ADDR, reg_addr, 2, data);
+    }
+    I2C_Transaction transaction;
+    transaction.device_address = FDC1004Q_I2C_ADDR;
+    transaction.register_address = reg_addr;
+    transaction.register_count = 2;
+    transaction.op = op;
+    transaction.priority = fdc_bus_priority;
+    transaction.data = data;
+    transaction.has_deadline = 0;
+    transaction.callback = NULL;
+    transaction.context = NULL;
+    transaction.bus = fdc_bus_segment;
+    return I2C_Arbiter_Transfer(&transaction);
+}
+
+uint8_t fdc_read_conf_meas(uint8_t channel, uint16_t* value)
+{
+    uint8_t error = FDC_OK;
+    FDC_LOCK();
+    if (fdc_state.conf_meas_valid & (1 << channel))
+    {
+        *value = fdc_state.conf_meas[channel];
+    }
+    else
+    {
+        uint8_t temp[2];
+        error = FDC_ReadRegister(FDC1004Q_CONF_MEAS1 + channel, temp);
+        if (error == FDC_OK)
+        {
+            *value = temp[0] << 8 | temp[1];
+        }
+    }
+    FDC_UNLOCK();
+    return error;
+}
+
+#ifndef FDC_NO_FLOAT
 float fixed_to_float_unsigned(uint16_t input, uint8_t fract_bits)
 {
     return ((float)input / (float)(1 << fract_bits));
@@ -646,5 +970,6 @@ int16_t float_to_fixed_signed(float input, uint8_t fract_bits)
 {
     return (int16_t)(input * (1 << fract_bits));
 }
+#endif
 
 /* [] END OF FILE */
@@ -13,7 +13,93 @@
     #define __FDC1004Q_H__
     
     #include "FDC1004Q_Defs.h"
-    #include "project.h"
+    #if defined(FDC_SIMULATION) || defined(I2C_INTERFACE_LINUX)
+        #include <stddef.h>
+        #include <stdint.h>
+    #else
+        #include "project.h"
+        #include "cyapicallbacks.h"
+    #endif
+    
+    /**
+    *   \brief Acquire exclusive access to the driver.
+    *
+    *   The driver holds this lock during read-modify-write sequences on the
+    *   configuration registers, while reading a frame and while updating its
+    *   copy of the CONF_MEASx registers, so that its functions can be called
+    *   from several tasks. The lock is taken again by nested calls, so it must
+    *   be recursive (e.g. a FreeRTOS recursive mutex). Define #FDC_LOCK and
+    *   #FDC_UNLOCK in cyapicallbacks.h to enable it; by default they expand
+    *   to nothing. When #FDC_RTOS is defined they take and give the mutex of
+    *   the FreeRTOS layer (see FDC1004Q_Rtos.h).
+    */
+    #if defined(FDC_RTOS) && !defined(FDC_LOCK)
+        void FDC_Rtos_Lock(void);
+        void FDC_Rtos_Unlock(void);
+        #define FDC_LOCK() FDC_Rtos_Lock()
+        #define FDC_UNLOCK() FDC_Rtos_Unlock()
+    #endif
+    
+    #ifndef FDC_LOCK
+        #define FDC_LOCK()
+    #endif
+    
+    /**
+    *   \brief Release exclusive access to the driver.
+    */
+    #ifndef FDC_UNLOCK
+        #define FDC_UNLOCK()
+    #endif
+    
+    /**
+    *   \def FDC_NO_FLOAT
+    *   \brief Build the driver without floating point support.
+    *
+    *   Define this symbol in the compiler options to remove the functions
+    *   working with float and double values, so that the soft-float library
+    *   is not linked. The Raw and Fixed variants of the same functions are
+    *   always available.
+    */
+    
+    /**
+    *   \def FDC_RTOS
+    *   \brief Build the FreeRTOS layer of the driver.
+    *
+    *   Define this symbol in the compiler options to build FDC1004Q_Rtos.c
+    *   and protect the driver and the I2C interface with its mutexes.
+    */
+    
+    /**
+    *   \brief Measurements of the four channels read at once.
+    */
+    typedef struct {
+        /** Raw measurements, as returned by #FDC_ReadRawMeasurement **/
+        uint32_t capacitance[4];
+        /** CAPDAC setting of each channel when the frame was read **/
+        uint8_t capdac[4];
+        /** Channels holding a new measurement, as #FDC_DONE_CH_1 ... #FDC_DONE_CH_4 flags **/
+        uint8_t valid;
+        /** Channels whose new measurement is saturated, as #FDC_DONE_CH_1 ... #FDC_DONE_CH_4 flags **/
+        uint8_t saturated;
+    } FDC_Frame;
+    
+    /**
+    *   \brief State kept by the driver for a device.
+    *
+    *   The driver keeps one of these for the device driven by the blocking
+    *   API. Code driving other devices keeps one per device and updates it
+    *   with #FDC_TrackRegister.
+    */
+    typedef struct {
+        /** Copy of the CONF_MEASx registers **/
+        uint16_t conf_meas[4];
+        /** MSB half of the last MEASx_MSB register read **/
+        uint16_t meas_msb[4];
+        /** Saturated measurements read from each channel **/
+        uint32_t saturation_count[4];
+        /** Channels whose copy of CONF_MEASx is up to date (bit n for channel n) **/
+        uint8_t conf_meas_valid;
+    } FDC_State;
     
     // ===========================================================
     //                 INITIALIZATION FUNCTIONS
@@ -89,6 +175,7 @@
     */
     uint8_t FDC_ReadSampleRate(uint8_t* sampleRate);
     
+    #ifndef FDC_NO_FLOAT
     /**
     *   \brief Read channel offset calibration register as float value.
     *
@@ -108,6 +195,7 @@
     *   \retval #FDC_CONF_ERR if wrong value for channel.
     */
     uint8_t FDC_ReadOffsetCalibration(uint8_t channel, float* offset);
+    #endif
     
     /**
     *   \brief Read channel offset calibration register as Q5.11 format.
@@ -128,6 +216,7 @@
     */
     uint8_t FDC_ReadRawOffsetCalibration(uint8_t channel, int16_t* offset);
     
+    #ifndef FDC_NO_FLOAT
     /**
     *   \brief Set channel offset calibration register in float format.
     *
@@ -146,6 +235,7 @@
     *   \retval #FDC_CONF_ERR if offset value is not between limits or channel not correct. 
     */
     uint8_t FDC_SetOffsetCalibration(uint8_t channel, float offset);
+    #endif
     
     /**
     *   \brief Set channel offset calibration register in raw format.
@@ -166,6 +256,7 @@
     */
     uint8_t FDC_SetRawOffsetCalibration(uint8_t channel, int16_t offset);
     
+    #ifndef FDC_NO_FLOAT
     /**
     *   \brief Read gain calibration register in float format.
     *
@@ -184,6 +275,7 @@
     *   \retval #FDC_CONF_ERR if channel value not correct.
     */
     uint8_t FDC_ReadGainCalibration(uint8_t channel, float* gain);
+    #endif
     
     /**
     *   \brief Read gain calibration register in fixed point Q2.14 formta.
@@ -205,6 +297,7 @@
     */
     uint8_t FDC_ReadRawGainCalibration(uint8_t channel, uint16_t* gain);
     
+    #ifndef FDC_NO_FLOAT
     /**
     *   \brief Set gain calibration register.
     *
@@ -224,6 +317,7 @@
     *   \retval #FDC_CONF_ERR if channel value not correct or gain value too high.
     */
     uint8_t FDC_SetGainCalibration(uint8_t channel, float gain);
+    #endif
     
     /**
     *   \brief Set gain calibration register in Q2.14 format.
@@ -374,6 +468,7 @@
     */
     uint8_t FDC_ReadRawCapdacSetting(uint8_t channel, uint8_t* capdac);
     
+    #ifndef FDC_NO_FLOAT
     /**
     *   \brief Read current capdac setting in float format.
     *
@@ -391,6 +486,7 @@
     *   \retval #FDC_CONF_ERR if channel value not correct.
     */
     uint8_t FDC_ReadCapdacSetting(uint8_t channel, float* capdac);
+    #endif
     
     /**
     *   \brief Read current positive input channel setting.
@@ -451,6 +547,28 @@
     */
     uint8_t FDC_ReadRawMeasurement(uint8_t channel, uint32_t* capacitance);
     
+    /**
+    *   \brief Read capacitance measurement in fixed point format.
+    *
+    *   This function reads the content of the measurement registers, adding
+    *   the offset specified by the capdac setting. The result is expressed
+    *   in units of the measurement LSB (\f$ 2^{-19} \f$ pF), see
+    *   #FDC_ConvertRawMeasurementsFixed.
+    *   \param[in] channel the channel for which the measurement must be read.
+    *       Possible values are:
+    *           - #FDC_CH_1
+    *           - #FDC_CH_2
+    *           - #FDC_CH_3
+    *           - #FDC_CH_4
+    *   \param[out] capacitance pointer to variable where the result will be stored.
+    *   \retval #FDC_OK if everything ok
+    *   \retval #FDC_COMM_ERR if error occurred during communication
+    *   \retval #FDC_CONF_ERR if channel value not correct.
+    *   \retval #FDC_MEAS_SATURATED if the measurement is saturated. The result is not stored.
+    */
+    uint8_t FDC_ReadFixedMeasurement(uint8_t channel, int32_t* capacitance);
+    
+    #ifndef FDC_NO_FLOAT
     /**
     *   \brief Read capacitance measurement in double format.
     *
@@ -465,6 +583,7 @@
     *   \param[out] capacitance pointer to variable where the result will be stored.
     *   \retval #FDC_OK if everything ok
     *   \retval #FDC_COMM_ERR if error occurred during communication
+    *   \retval #FDC_MEAS_SATURATED if the measurement is saturated. The result is not stored.
     */
     uint8_t FDC_ReadMeasurement(uint8_t channel, double* capacitance);
     
@@ -478,6 +597,43 @@
     *   \return capacitance value converted in double format
     */
     double FDC_ConvertRawMeasurement(uint32_t capacitance);
+    
+    /**
+    *   \brief Convert an array of raw capacitance measurements in float format.
+    *
+    *   This function converts a batch of raw measurements, as returned by
+    *   #FDC_ReadRawMeasurement, adding the offset of the CAPDAC setting used
+    *   for each sample. Each result is bit-identical to the float conversion
+    *   of #FDC_ConvertRawMeasurement plus the CAPDAC offset. The loop has no
+    *   branches and no divisions, so that it can be vectorised when the
+    *   driver is compiled for a host.
+    *   \param[in] capacitance array of raw capacitance values.
+    *   \param[in] capdac array of raw CAPDAC settings, or NULL if no offset must be added.
+    *   \param[out] result array where the capacitance values (pF) will be stored.
+    *   \param count number of samples to be converted.
+    */
+    void FDC_ConvertRawMeasurements(const uint32_t* capacitance, 
+                                    const uint8_t* capdac,
+                                    float* result,
+                                    uint16_t count);
+    #endif
+    
+    /**
+    *   \brief Convert an array of raw capacitance measurements in fixed point format.
+    *
+    *   This function converts a batch of raw measurements to signed values
+    *   expressed in units of the measurement LSB (\f$ 2^{-19} \f$ pF),
+    *   adding the offset of the CAPDAC setting used for each sample.
+    *   Only integer operations are used, and the result is exact.
+    *   \param[in] capacitance array of raw capacitance values.
+    *   \param[in] capdac array of raw CAPDAC settings, or NULL if no offset must be added.
+    *   \param[out] result array where the capacitance values will be stored.
+    *   \param count number of samples to be converted.
+    */
+    void FDC_ConvertRawMeasurementsFixed(const uint32_t* capacitance, 
+                                        const uint8_t* capdac,
+                                        int32_t* result,
+                                        uint16_t count);
 
     /**
     *    \brief Check if new measurement data are available to be read.
@@ -489,6 +645,83 @@
     */
     uint8_t FDC_HasNewData(uint8_t* done);
     
+    /**
+    *   \brief Read the new measurements of a set of channels.
+    *
+    *   This function reads #FDC1004Q_FDC_CONF once and then reads the
+    *   measurement registers of the requested channels whose DONE bit is set,
+    *   so that a frame costs one transaction plus two transactions (MSB and
+    *   LSB) per new measurement. The CAPDAC settings are taken from a copy of
+    *   the CONF_MEASx registers kept by the driver, so that they do not
+    *   cost any transaction once known.
+    *   \param mask the channels of interest, as OR of #FDC_DONE_CH_1,
+    *       #FDC_DONE_CH_2, #FDC_DONE_CH_3 and #FDC_DONE_CH_4.
+    *   New measurements found saturated (see #FDC_CheckSaturation) are
+    *   flagged in the saturated field instead of the valid field, so that
+    *   they are not mistaken for real values; their raw value and CAPDAC
+    *   setting are still stored to choose a new CAPDAC setting.
+    *   \param[out] frame pointer to the frame to be filled. Only the channels
+    *       flagged in its valid or saturated field are updated.
+    *   \retval #FDC_OK if everything ok.
+    *   \retval #FDC_COMM_ERR if error occurred during communication.
+    */
+    uint8_t FDC_ReadAllMeasurements(uint8_t mask, FDC_Frame* frame);
+    
+    // ===========================================================
+    //                   SATURATION DETECTION
+    // ===========================================================
+    
+    /**
+    *   \brief Select the saturation conditions to be detected.
+    *
+    *   When the input is out of the range allowed by the CAPDAC setting, the
+    *   measurement is pinned at one end of the 24-bit range. By default both
+    *   ends are detected.
+    *   \param flags OR of #FDC_SAT_HIGH and #FDC_SAT_LOW, or #FDC_SAT_NONE
+    *       to disable the detection.
+    */
+    void FDC_SetSaturationDetection(uint8_t flags);
+    
+    /**
+    *   \brief Check if a raw measurement is saturated.
+    *   \param capacitance the raw measurement, as returned by #FDC_ReadRawMeasurement.
+    *   \retval #FDC_SAT_HIGH if pinned at the positive end and detection enabled.
+    *   \retval #FDC_SAT_LOW if pinned at the negative end and detection enabled.
+    *   \retval #FDC_SAT_NONE otherwise.
+    */
+    uint8_t FDC_CheckSaturation(uint32_t capacitance);
+    
+    /**
+    *   \brief Choose the CAPDAC setting to recover from a saturated measurement.
+    *
+    *   The setting is moved by #FDC_CAPDAC_RECOVERY_STEPS in the direction of
+    *   the saturation, so that inputs up to 28 pF past the end of the range
+    *   are measured by the next conversion and inputs up to 56 pF past it
+    *   by the following one.
+    *   \param capdac the CAPDAC setting the saturated measurement was taken with.
+    *   \param saturation the saturation, as returned by #FDC_CheckSaturation.
+    *   \return the new CAPDAC setting, between 0 and #FDC_CAPDAC_MAX.
+    */
+    uint8_t FDC_CorrectiveCapdac(uint8_t capdac, uint8_t saturation);
+    
+    /**
+    *   \brief Read the number of saturated measurements of a channel.
+    *
+    *   Saturated measurements are counted whenever they are read with
+    *   #FDC_ReadRawMeasurement, directly or through the other read functions,
+    *   or by code reporting its accesses with #FDC_TrackRegister.
+    *   \param channel the channel, from #FDC_CH_1 to #FDC_CH_4.
+    *   \param[out] count pointer to variable where the count will be stored.
+    *   \retval #FDC_OK if everything ok.
+    *   \retval #FDC_CONF_ERR if channel value not correct.
+    */
+    uint8_t FDC_ReadSaturationCount(uint8_t channel, uint32_t* count);
+    
+    /**
+    *   \brief Clear the saturation counters of all channels.
+    */
+    void FDC_ClearSaturationCounts(void);
+    
     // ===========================================================
     //             MANUFACTURER / DEVICE ID REGISTERS
     // ===========================================================
@@ -544,6 +777,78 @@
     */
     uint8_t FDC_WriteRegister(uint8_t reg_addr, uint8_t* data);
     
+    /**
+    *   \brief Read several registers from the FDC1004Q.
+    *   
+    *   The reads are issued in order as a single batch (see
+    *   #I2C_Peripheral_ReadRegisterBatch), holding the bus between them,
+    *   or as one arbiter transaction each (see #FDC_SetBusPriority).
+    *   \param[in] reg_addr the addresses of the registers to be read.
+    *   \param[out] data the 16-bit values read, two bytes per register.
+    *   \param count the number of registers, up to #I2C_BATCH_MAX_READS.
+    *   \retval #FDC_OK if everything ok.
+    *   \retval #FDC_COMM_ERR if error occurred during communication.
+    *   \retval #FDC_CONF_ERR if too many registers are requested.
+    */
+    uint8_t FDC_ReadRegisters(const uint8_t* reg_addr, uint8_t* data, uint8_t count);
+    
+    /**
+    *   \brief Priority of #FDC_SetBusPriority selecting direct access to the bus.
+    */
+    #define FDC_BUS_DIRECT 0xFF
+    
+    /**
+    *   \brief Route the register accesses through the I2C arbiter.
+    *
+    *   By default the register accesses of the blocking API go straight to
+    *   the I2C interface. When the bus is shared through the arbiter (see
+    *   I2C_Arbiter.h), set a priority so that each access is run with
+    *   #I2C_Arbiter_Transfer: it then overtakes the lower priority
+    *   transactions queued by the other drivers, which in turn only wait
+    *   for a single register access of the FDC1004Q at a time.
+    *   \param priority from #I2C_ARBITER_PRIORITY_HIGH to #I2C_ARBITER_PRIORITY_BULK,
+    *       or #FDC_BUS_DIRECT to go back to direct accesses.
+    *   \param bus bus segment of the device (see #I2C_Arbiter_SetBusSelect),
+    *       0 when the bus has a single segment.
+    */
+    void FDC_SetBusPriority(uint8_t priority, uint8_t bus);
+    
+    /**
+    *   \brief Clear the state of a device.
+    *   \param[out] state the state to be cleared.
+    */
+    void FDC_InitState(FDC_State* state);
+    
+    /**
+    *   \brief Update the state of a device after a register access.
+    *   
+    *   The driver keeps a copy of the CONF_MEASx registers and counts
+    *   saturated measurements while registers are accessed with
+    *   #FDC_ReadRegister and #FDC_WriteRegister. Code accessing the
+    *   registers by other means (e.g. through the I2C arbiter) must call
+    *   this function after each successful read or write, so that the
+    *   state stays consistent.
+    *   \param state the state of the device, or NULL for the device
+    *       driven by the blocking API.
+    *   \param[in] reg_addr the address of the register.
+    *   \param[in] data the 16-bit value read from or written to the register.
+    */
+    void FDC_TrackRegister(FDC_State* state, uint8_t reg_addr, const uint8_t* data);
+    
+    /**
+    *   \brief Read a register from the copy kept in the state of a device.
+    *   
+    *   No I2C transaction is carried out. Only the CONF_MEASx registers
+    *   are kept, once they have been read or written at least once.
+    *   \param[in] state the state of the device, or NULL for the device
+    *       driven by the blocking API.
+    *   \param[in] reg_addr the address of the register.
+    *   \param[out] data the 16-bit value of the register.
+    *   \retval #FDC_OK if the value is known to the driver.
+    *   \retval #FDC_CONF_ERR if the value must be read from the device.
+    */
+    uint8_t FDC_ReadCachedRegister(const FDC_State* state, uint8_t reg_addr, uint8_t* data);
+    
     
 #endif
 /* [] END OF FILE */
@@ -0,0 +1,382 @@
+/**
+*   \brief Source file for the asynchronous FDC1004Q API.
+*/
+
+#include "FDC1004Q_Async.h"
+
+#include <stddef.h>
+
+// Mark the fall through into the case of a resume point
+#if defined(__GNUC__) && (__GNUC__ >= 7)
+    #define FDC_ASYNC_FALLTHROUGH __attribute__((fallthrough))
+#else
+    #define FDC_ASYNC_FALLTHROUGH
+#endif
+
+// Start of the body of an asynchronous operation
+#define FDC_ASYNC_BEGIN(ctx) switch ((ctx)->line) { case 0:
+
+// Return from an asynchronous operation
+#define FDC_ASYNC_EXIT(ctx, result) do { (ctx)->line = 0; return (result); } while (0)
+
+// End of the body of an asynchronous operation
+#define FDC_ASYNC_END(ctx) } (ctx)->line = 0; return FDC_COMM_ERR;
+
+// Return to the caller, and resume from here on the next call
+#define FDC_ASYNC_YIELD(ctx) (ctx)->line = __LINE__; return FDC_ASYNC_PENDING; case __LINE__:
+
+// Transfer a register through the arbiter, yielding until done.
+// The result is left in ctx->error.
+#define FDC_ASYNC_TRANSFER(ctx, reg_addr, operation)            \
+    fdc_async_prepare((ctx), (reg_addr), (operation));          \
+    (ctx)->line = __LINE__; FDC_ASYNC_FALLTHROUGH; case __LINE__: \
+    if (fdc_async_poll(ctx) == FDC_ASYNC_PENDING)               \
+    {                                                           \
+        return FDC_ASYNC_PENDING;                               \
+    }
+
+// Context holding the read-modify-write lock of the device of the blocking API
+static FDC_AsyncContext* fdc_async_rmw_owner;
+
+// Read-modify-write lock of the device of a context
+static FDC_AsyncContext** fdc_async_rmw_lock(FDC_AsyncContext* ctx);
+
+// State of the device of a context (NULL for the device of the blocking API)
+static FDC_State* fdc_async_state(FDC_AsyncContext* ctx);
+
+// Prepare a register transaction
+static void fdc_async_prepare(FDC_AsyncContext* ctx, uint8_t reg_addr, uint8_t op);
+
+// Submit the transaction and check its status
+static uint8_t fdc_async_poll(FDC_AsyncContext* ctx);
+
+// Read-modify-write of a register, holding the read-modify-write lock
+static uint8_t fdc_async_update_register(FDC_AsyncContext* ctx, uint8_t reg_addr,
+                                         uint16_t clear_mask, uint16_t set_mask);
+
+// ===========================================================
+//                      INITIALIZATION
+// ===========================================================
+
+void FDC_Async_InitDevice(FDC_AsyncDevice* device, uint8_t address, uint8_t bus)
+{
+    device->address = address;
+    device->bus = bus;
+    device->rmw_owner = NULL;
+    FDC_InitState(&device->state);
+}
+
+void FDC_Async_Init(FDC_AsyncContext* ctx, FDC_AsyncDevice* device, uint8_t priority)
+{
+    ctx->device = device;
+    ctx->line = 0;
+    ctx->queued = 0;
+    ctx->error = FDC_OK;
+    ctx->transaction.device_address = (device != NULL) ? device->address : FDC1004Q_I2C_ADDR;
+    ctx->transaction.bus = (device != NULL) ? device->bus : 0;
+    ctx->transaction.register_count = 2;
+    ctx->transaction.priority = priority;
+    ctx->transaction.status = I2C_ARBITER_DONE;
+    ctx->transaction.data = ctx->data;
+    ctx->transaction.has_deadline = 0;
+    ctx->transaction.callback = NULL;
+    ctx->transaction.context = ctx;
+}
+
+uint8_t FDC_Async_IsBusy(const FDC_AsyncContext* ctx)
+{
+    return (ctx->line != 0) ? 1 : 0;
+}
+
+uint8_t FDC_Async_Reset(FDC_AsyncContext* ctx)
+{
+    FDC_ASYNC_BEGIN(ctx);
+    while ((*fdc_async_rmw_lock(ctx) != NULL) && (*fdc_async_rmw_lock(ctx) != ctx))
+    {
+        FDC_ASYNC_YIELD(ctx);
+    }
+    *fdc_async_rmw_lock(ctx) = ctx;
+    FDC_ASYNC_TRANSFER(ctx, FDC1004Q_FDC_CONF, I2C_ARBITER_READ);
+    if (ctx->error == FDC_OK)
+    {
+        ctx->data[0] |= 0x80;
+        FDC_ASYNC_TRANSFER(ctx, FDC1004Q_FDC_CONF, I2C_ARBITER_WRITE);
+    }
+    *fdc_async_rmw_lock(ctx) = NULL;
+    if (ctx->error != FDC_OK)
+    {
+        FDC_ASYNC_EXIT(ctx, ctx->error);
+    }
+    // Wait for reset to be completed
+    for (ctx->polls = 0; ctx->polls < FDC_ASYNC_RESET_POLLS; ctx->polls++)
+    {
+        FDC_ASYNC_TRANSFER(ctx, FDC1004Q_FDC_CONF, I2C_ARBITER_READ);
+        if (ctx->error != FDC_OK)
+        {
+            FDC_ASYNC_EXIT(ctx, ctx->error);
+        }
+        if ((ctx->data[0] & 0x80) == 0)
+        {
+            FDC_ASYNC_EXIT(ctx, FDC_OK);
+        }
+    }
+    FDC_ASYNC_END(ctx);
+}
+
+uint8_t FDC_Async_IsDeviceConnected(FDC_AsyncContext* ctx)
+{
+    FDC_ASYNC_BEGIN(ctx);
+    FDC_ASYNC_TRANSFER(ctx, FDC1004Q_MANUFACTURER_ID, I2C_ARBITER_READ);
+    if ((ctx->error != FDC_OK) ||
+        ((ctx->data[0] << 8 | ctx->data[1]) != FDC1004Q_MANUFACTURED_ID_VALUE))
+    {
+        FDC_ASYNC_EXIT(ctx, FDC_DEV_NOT_FOUND);
+    }
+    FDC_ASYNC_TRANSFER(ctx, FDC1004Q_DEVICE_ID, I2C_ARBITER_READ);
+    if ((ctx->error != FDC_OK) ||
+        ((ctx->data[0] << 8 | ctx->data[1]) != FDC1004Q_DEVICE_ID_VALUE))
+    {
+        FDC_ASYNC_EXIT(ctx, FDC_DEV_NOT_FOUND);
+    }
+    FDC_ASYNC_EXIT(ctx, FDC_OK);
+    FDC_ASYNC_END(ctx);
+}
+
+// ===========================================================
+//                      CONFIGURATION
+// ===========================================================
+
+uint8_t FDC_Async_SetSampleRate(FDC_AsyncContext* ctx, uint8_t sampleRate)
+{
+    if (sampleRate > FDC_400_Hz)
+        return FDC_CONF_ERR;
+    // Set RATE bits [11:10]
+    return fdc_async_update_register(ctx, FDC1004Q_FDC_CONF, 0x0C00, sampleRate << 10);
+}
+
+uint8_t FDC_Async_ConfigureMeasurementInput(FDC_AsyncContext* ctx,
+                                            uint8_t meas_channel,
+                                            uint8_t pos,
+                                            uint8_t neg,
+                                            uint8_t capdac)
+{
+    if ( ( neg == pos ) || ( pos > neg) || (capdac > 31) || (pos == FDC_CAPDAC) || (pos == FDC_DISABLED) )
+        return FDC_CONF_ERR;
+    if (meas_channel > FDC_CH_4)
+        return FDC_CONF_ERR;
+    return fdc_async_update_register(ctx, FDC1004Q_CONF_MEAS1 + meas_channel, 0xFFF0,
+                                     pos << 13 | neg << 10 | capdac << 5);
+}
+
+uint8_t FDC_Async_InitMeasurement(FDC_AsyncContext* ctx, uint8_t channel)
+{
+    if (channel > FDC_CH_4)
+        return FDC_CONF_ERR;
+    return fdc_async_update_register(ctx, FDC1004Q_FDC_CONF, 0, 1 << (7 - channel));
+}
+
+uint8_t FDC_Async_EnableRepeatMeasurement(FDC_AsyncContext* ctx, uint8_t channel_flags)
+{
+    // Replace channel bits [7:4] and set REPEAT bit 8
+    return fdc_async_update_register(ctx, FDC1004Q_FDC_CONF, 0x00F0,
+                                     0x0100 | (channel_flags & 0xF0));
+}
+
+uint8_t FDC_Async_DisableRepeatMeasurement(FDC_AsyncContext* ctx)
+{
+    return fdc_async_update_register(ctx, FDC1004Q_FDC_CONF, 0x0100, 0);
+}
+
+// ===========================================================
+//                      READOUT
+// ===========================================================
+
+uint8_t FDC_Async_HasNewData(FDC_AsyncContext* ctx, uint8_t* done)
+{
+    FDC_ASYNC_BEGIN(ctx);
+    FDC_ASYNC_TRANSFER(ctx, FDC1004Q_FDC_CONF, I2C_ARBITER_READ);
+    if (ctx->error == FDC_OK)
+    {
+        *done = ctx->data[1] & FDC_DONE_CH_ALL;
+    }
+    FDC_ASYNC_EXIT(ctx, ctx->error);
+    FDC_ASYNC_END(ctx);
+}
+
+uint8_t FDC_Async_ReadRawMeasurement(FDC_AsyncContext* ctx,
+                                     uint8_t channel,
+                                     uint32_t* capacitance)
+{
+    if (channel > FDC_CH_4)
+        return FDC_CONF_ERR;
+    FDC_ASYNC_BEGIN(ctx);
+    FDC_ASYNC_TRANSFER(ctx, FDC1004Q_MEAS1_MSB + (2*channel), I2C_ARBITER_READ);
+    if (ctx->error != FDC_OK)
+    {
+        FDC_ASYNC_EXIT(ctx, ctx->error);
+    }
+    *capacitance = ((uint32_t)ctx->data[0] << 24) | ((uint32_t)ctx->data[1] << 16);
+    FDC_ASYNC_TRANSFER(ctx, FDC1004Q_MEAS1_LSB + (2*channel), I2C_ARBITER_READ);
+    if (ctx->error == FDC_OK)
+    {
+        *capacitance |= ctx->data[0] << 8 | ctx->data[1];
+    }
+    FDC_ASYNC_EXIT(ctx, ctx->error);
+    FDC_ASYNC_END(ctx);
+}
+
+uint8_t FDC_Async_ReadAllMeasurements(FDC_AsyncContext* ctx, uint8_t mask, FDC_Frame* frame)
+{
+    FDC_ASYNC_BEGIN(ctx);
+    frame->valid = 0;
+    frame->saturated = 0;
+    FDC_ASYNC_TRANSFER(ctx, FDC1004Q_FDC_CONF, I2C_ARBITER_READ);
+    if (ctx->error != FDC_OK)
+    {
+        FDC_ASYNC_EXIT(ctx, ctx->error);
+    }
+    // Channels to be read
+    ctx->value = ctx->data[1] & mask & FDC_DONE_CH_ALL;
+    for (ctx->index = FDC_CH_1; ctx->index <= FDC_CH_4; ctx->index++)
+    {
+        if ((ctx->value & (FDC_DONE_CH_1 >> ctx->index)) == 0)
+        {
+            continue;
+        }
+        FDC_ASYNC_TRANSFER(ctx, FDC1004Q_MEAS1_MSB + (2*ctx->index), I2C_ARBITER_READ);
+        if (ctx->error != FDC_OK)
+        {
+            FDC_ASYNC_EXIT(ctx, ctx->error);
+        }
+        frame->capacitance[ctx->index] = ((uint32_t)ctx->data[0] << 24) |
+                                         ((uint32_t)ctx->data[1] << 16);
+        FDC_ASYNC_TRANSFER(ctx, FDC1004Q_MEAS1_LSB + (2*ctx->index), I2C_ARBITER_READ);
+        if (ctx->error != FDC_OK)
+        {
+            FDC_ASYNC_EXIT(ctx, ctx->error);
+        }
+        frame->capacitance[ctx->index] |= ctx->data[0] << 8 | ctx->data[1];
+        if (FDC_ReadCachedRegister(fdc_async_state(ctx), FDC1004Q_CONF_MEAS1 + ctx->index,
+                                   ctx->data) != FDC_OK)
+        {
+            FDC_ASYNC_TRANSFER(ctx, FDC1004Q_CONF_MEAS1 + ctx->index, I2C_ARBITER_READ);
+            if (ctx->error != FDC_OK)
+            {
+                FDC_ASYNC_EXIT(ctx, ctx->error);
+            }
+        }
+        frame->capdac[ctx->index] = ((ctx->data[0] << 8 | ctx->data[1]) >> 5) & 0x1F;
+        if (FDC_CheckSaturation(frame->capacitance[ctx->index]) != FDC_SAT_NONE)
+        {
+            frame->saturated |= (FDC_DONE_CH_1 >> ctx->index);
+        }
+        else
+        {
+            frame->valid |= (FDC_DONE_CH_1 >> ctx->index);
+        }
+    }
+    FDC_ASYNC_EXIT(ctx, FDC_OK);
+    FDC_ASYNC_END(ctx);
+}
+
+// ===========================================================
+//                      REGISTERS
+// ===========================================================
+
+uint8_t FDC_Async_ReadRegister(FDC_AsyncContext* ctx, uint8_t reg_addr, uint8_t* data)
+{
+    FDC_ASYNC_BEGIN(ctx);
+    FDC_ASYNC_TRANSFER(ctx, reg_addr, I2C_ARBITER_READ);
+    if (ctx->error == FDC_OK)
+    {
+        data[0] = ctx->data[0];
+        data[1] = ctx->data[1];
+    }
+    FDC_ASYNC_EXIT(ctx, ctx->error);
+    FDC_ASYNC_END(ctx);
+}
+
+uint8_t FDC_Async_WriteRegister(FDC_AsyncContext* ctx, uint8_t reg_addr, const uint8_t* data)
+{
+    FDC_ASYNC_BEGIN(ctx);
+    ctx->data[0] = data[0];
+    ctx->data[1] = data[1];
+    FDC_ASYNC_TRANSFER(ctx, reg_addr, I2C_ARBITER_WRITE);
+    FDC_ASYNC_EXIT(ctx, ctx->error);
+    FDC_ASYNC_END(ctx);
+}
+
+// ===================================================================
+//                         HELPER FUNCTIONS
+// ===================================================================
+
+void fdc_async_prepare(FDC_AsyncContext* ctx, uint8_t reg_addr, uint8_t op)
+{
+    ctx->transaction.register_address = reg_addr;
+    ctx->transaction.op = op;
+    ctx->queued = 0;
+}
+
+uint8_t fdc_async_poll(FDC_AsyncContext* ctx)
+{
+    if (ctx->queued == 0)
+    {
+        // Retry on the next call if the queue is full
+        if (I2C_Arbiter_Submit(&ctx->transaction) != I2C_NO_ERROR)
+        {
+            return FDC_ASYNC_PENDING;
+        }
+        ctx->queued = 1;
+    }
+    if (ctx->transaction.status == I2C_ARBITER_PENDING)
+    {
+        return FDC_ASYNC_PENDING;
+    }
+    ctx->queued = 0;
+    if (ctx->transaction.status == I2C_ARBITER_DONE)
+    {
+        FDC_TrackRegister(fdc_async_state(ctx), ctx->transaction.register_address, ctx->data);
+        ctx->error = FDC_OK;
+    }
+    else
+    {
+        ctx->error = FDC_COMM_ERR;
+    }
+    return ctx->error;
+}
+
+uint8_t fdc_async_update_register(FDC_AsyncContext* ctx, uint8_t reg_addr,
+                                  uint16_t clear_mask, uint16_t set_mask)
+{
+    FDC_ASYNC_BEGIN(ctx);
+    while ((*fdc_async_rmw_lock(ctx) != NULL) && (*fdc_async_rmw_lock(ctx) != ctx))
+    {
+        FDC_ASYNC_YIELD(ctx);
+    }
+    *fdc_async_rmw_lock(ctx) = ctx;
+    FDC_ASYNC_TRANSFER(ctx, reg_addr, I2C_ARBITER_READ);
+    if (ctx->error == FDC_OK)
+    {
+        ctx->value = ctx->data[0] << 8 | ctx->data[1];
+        ctx->value &= ~clear_mask;
+        ctx->value |= set_mask;
+        ctx->data[0] = ctx->value >> 8;
+        ctx->data[1] = ctx->value & 0xFF;
+        FDC_ASYNC_TRANSFER(ctx, reg_addr, I2C_ARBITER_WRITE);
+    }
+    *fdc_async_rmw_lock(ctx) = NULL;
+    FDC_ASYNC_EXIT(ctx, ctx->error);
+    FDC_ASYNC_END(ctx);
+}
+
+FDC_AsyncContext** fdc_async_rmw_lock(FDC_AsyncContext* ctx)
+{
+    return (ctx->device != NULL) ? &ctx->device->rmw_owner : &fdc_async_rmw_owner;
+}
+
+FDC_State* fdc_async_state(FDC_AsyncContext* ctx)
+{
+    return (ctx->device != NULL) ? &ctx->device->state : NULL;
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,297 @@
+/**
+*   \file FDC1004Q_Async.h
+*   \brief Header file for the asynchronous FDC1004Q API.
+*
+*   This file contains the declarations of a non-blocking variant of the
+*   FDC1004Q API, meant for bare-metal applications that cannot wait for
+*   the I2C bus. Each function is a stackless coroutine: it submits its
+*   register accesses to the I2C arbiter and returns #FDC_ASYNC_PENDING at
+*   each transaction, resuming where it stopped on the next call. The state
+*   of an operation is kept in a #FDC_AsyncContext owned by the caller, so
+*   that no per-task stack and no RTOS are required, and many operations
+*   can be in flight at the same time.
+*
+*   An operation is carried out by calling the same function, with the same
+*   context and arguments, until it returns a value other than
+*   #FDC_ASYNC_PENDING, while #I2C_Arbiter_Process is called from the main
+*   loop to move the transactions on the bus:
+*
+*   \code
+*   FDC_Async_InitDevice(&dev, FDC1004Q_I2C_ADDR, bus);
+*   FDC_Async_Init(&ctx, &dev, I2C_ARBITER_PRIORITY_HIGH);
+*   ...
+*   error = FDC_Async_ReadAllMeasurements(&ctx, FDC_DONE_CH_ALL, &frame);
+*   if (error != FDC_ASYNC_PENDING)
+*   {
+*       // Frame read, or error
+*   }
+*   I2C_Arbiter_Process();
+*   \endcode
+*
+*   A context runs one operation at a time, and an operation must be run
+*   to completion before the context is used for another one. The output
+*   arguments are valid only once the operation returns #FDC_OK.
+*   Each context drives one device. Several devices sharing the same I2C
+*   address (e.g. many FDC1004Q) are told apart by the bus segment they sit
+*   on, behind a bus multiplexer driven by the arbiter (see
+*   #I2C_Arbiter_SetBusSelect and #I2C_Mux_Select). Each device is described
+*   by a #FDC_AsyncDevice, which holds its copy of the CONF_MEASx registers
+*   and its saturation counters, and any number of contexts can work on the
+*   same device at the same time. Read-modify-write sequences on a device
+*   are serialized among its contexts.
+*
+*   Contexts created without a device drive the device of the blocking API:
+*   register accesses are then reported to the driver with #FDC_TrackRegister,
+*   so that both APIs share its state. Read-modify-write sequences are not
+*   serialized against the blocking API: the two must not modify the same
+*   register at the same time.
+*
+*   \author Davide Marzorati
+*/
+
+#ifndef __FDC1004Q_ASYNC_H__
+    #define __FDC1004Q_ASYNC_H__
+
+    #include "FDC1004Q.h"
+    #include "I2C_Arbiter.h"
+
+    /**
+    *   \brief Value returned while an operation is still in progress.
+    */
+    #define FDC_ASYNC_PENDING 0xFF
+
+    /**
+    *   \brief Number of times the reset bit is polled before giving up.
+    */
+    #ifndef FDC_ASYNC_RESET_POLLS
+        #define FDC_ASYNC_RESET_POLLS 100
+    #endif
+
+    typedef struct FDC_AsyncContext FDC_AsyncContext;
+    
+    /**
+    *   \brief Device driven by the asynchronous API.
+    */
+    typedef struct {
+        /** I2C address of the device **/
+        uint8_t address;
+        /** Bus segment of the device, see #I2C_Arbiter_SetBusSelect **/
+        uint8_t bus;
+        /** State of the device: CONF_MEASx copy and saturation counters **/
+        FDC_State state;
+        /** Context holding the read-modify-write lock, private **/
+        FDC_AsyncContext* rmw_owner;
+    } FDC_AsyncDevice;
+
+    /**
+    *   \brief State of an asynchronous operation.
+    *
+    *   The fields are private to the asynchronous API.
+    */
+    struct FDC_AsyncContext {
+        /** Device driven by the context, NULL for the device of the blocking API **/
+        FDC_AsyncDevice* device;
+        /** Resume point of the operation, 0 when idle **/
+        uint16_t line;
+        /** Transaction submitted to the arbiter **/
+        I2C_Transaction transaction;
+        /** Register value being transferred **/
+        uint8_t data[2];
+        /** Set while the transaction is in the arbiter queue **/
+        uint8_t queued;
+        /** Result of the last transaction **/
+        uint8_t error;
+        /** Channel being processed **/
+        uint8_t index;
+        /** Register value kept across transactions **/
+        uint16_t value;
+        /** Number of polls carried out **/
+        uint16_t polls;
+    };
+
+    // ===========================================================
+    //                      INITIALIZATION
+    // ===========================================================
+
+    /**
+    *   \brief Initialize a device.
+    *   \param[out] device the device.
+    *   \param address the I2C address of the device, e.g. #FDC1004Q_I2C_ADDR.
+    *   \param bus the bus segment of the device (0 if the bus has a single segment).
+    */
+    void FDC_Async_InitDevice(FDC_AsyncDevice* device, uint8_t address, uint8_t bus);
+
+    /**
+    *   \brief Initialize an asynchronous context.
+    *   \param[out] ctx the context.
+    *   \param device the device driven by the context, or NULL for the
+    *       device of the blocking API.
+    *   \param priority the arbiter priority of its transactions, from
+    *       #I2C_ARBITER_PRIORITY_HIGH to #I2C_ARBITER_PRIORITY_BULK.
+    */
+    void FDC_Async_Init(FDC_AsyncContext* ctx, FDC_AsyncDevice* device, uint8_t priority);
+
+    /**
+    *   \brief Check if an operation is in progress on a context.
+    *   \param[in] ctx the context.
+    *   \retval 1 if an operation returned #FDC_ASYNC_PENDING and is not complete.
+    *   \retval 0 if the context is idle.
+    */
+    uint8_t FDC_Async_IsBusy(const FDC_AsyncContext* ctx);
+
+    /**
+    *   \brief Reset the sensor, see #FDC_Reset.
+    *   \param ctx the context.
+    *   \retval #FDC_ASYNC_PENDING if the operation is in progress.
+    *   \retval #FDC_OK if everything ok.
+    *   \retval #FDC_COMM_ERR if error occurred during communication, or
+    *       if the reset did not complete within #FDC_ASYNC_RESET_POLLS polls.
+    */
+    uint8_t FDC_Async_Reset(FDC_AsyncContext* ctx);
+
+    /**
+    *   \brief Check if the device is connected, see #FDC_IsDeviceConnected.
+    *   \param ctx the context.
+    *   \retval #FDC_ASYNC_PENDING if the operation is in progress.
+    *   \retval #FDC_OK if device found.
+    *   \retval #FDC_DEV_NOT_FOUND if device not found.
+    */
+    uint8_t FDC_Async_IsDeviceConnected(FDC_AsyncContext* ctx);
+
+    // ===========================================================
+    //                      CONFIGURATION
+    // ===========================================================
+
+    /**
+    *   \brief Set the sample rate, see #FDC_SetSampleRate.
+    *   \param ctx the context.
+    *   \param sampleRate the sample rate, from #FDC_100_Hz to #FDC_400_Hz.
+    *   \retval #FDC_ASYNC_PENDING if the operation is in progress.
+    *   \retval #FDC_OK if everything ok.
+    *   \retval #FDC_COMM_ERR if error occurred during communication.
+    *   \retval #FDC_CONF_ERR if the sample rate is not correct.
+    */
+    uint8_t FDC_Async_SetSampleRate(FDC_AsyncContext* ctx, uint8_t sampleRate);
+
+    /**
+    *   \brief Configure the inputs of a channel, see #FDC_ConfigureMeasurementInput.
+    *   \param ctx the context.
+    *   \param meas_channel the channel, from #FDC_CH_1 to #FDC_CH_4.
+    *   \param pos the positive input.
+    *   \param neg the negative input.
+    *   \param capdac the CAPDAC setting.
+    *   \retval #FDC_ASYNC_PENDING if the operation is in progress.
+    *   \retval #FDC_OK if everything ok.
+    *   \retval #FDC_COMM_ERR if error occurred during communication.
+    *   \retval #FDC_CONF_ERR if the configuration is not correct.
+    */
+    uint8_t FDC_Async_ConfigureMeasurementInput(FDC_AsyncContext* ctx,
+                                                uint8_t meas_channel,
+                                                uint8_t pos,
+                                                uint8_t neg,
+                                                uint8_t capdac);
+
+    /**
+    *   \brief Start a single measurement, see #FDC_InitMeasurement.
+    *   \param ctx the context.
+    *   \param channel the channel, from #FDC_CH_1 to #FDC_CH_4.
+    *   \retval #FDC_ASYNC_PENDING if the operation is in progress.
+    *   \retval #FDC_OK if everything ok.
+    *   \retval #FDC_COMM_ERR if error occurred during communication.
+    *   \retval #FDC_CONF_ERR if channel value not correct.
+    */
+    uint8_t FDC_Async_InitMeasurement(FDC_AsyncContext* ctx, uint8_t channel);
+
+    /**
+    *   \brief Enable repeated measurements, see #FDC_EnableRepeatMeasurement.
+    *
+    *   The channel bits are replaced and the REPEAT bit is set with a
+    *   single read-modify-write sequence.
+    *   \param ctx the context.
+    *   \param channel_flags the channels, as OR of #FDC_RP_CH_1 ... #FDC_RP_CH_4.
+    *   \retval #FDC_ASYNC_PENDING if the operation is in progress.
+    *   \retval #FDC_OK if everything ok.
+    *   \retval #FDC_COMM_ERR if error occurred during communication.
+    */
+    uint8_t FDC_Async_EnableRepeatMeasurement(FDC_AsyncContext* ctx, uint8_t channel_flags);
+
+    /**
+    *   \brief Disable repeated measurements, see #FDC_DisableRepeatMeasurement.
+    *   \param ctx the context.
+    *   \retval #FDC_ASYNC_PENDING if the operation is in progress.
+    *   \retval #FDC_OK if everything ok.
+    *   \retval #FDC_COMM_ERR if error occurred during communication.
+    */
+    uint8_t FDC_Async_DisableRepeatMeasurement(FDC_AsyncContext* ctx);
+
+    // ===========================================================
+    //                      READOUT
+    // ===========================================================
+
+    /**
+    *   \brief Check which channels have new data, see #FDC_HasNewData.
+    *   \param ctx the context.
+    *   \param[out] done the DONE bits, as #FDC_DONE_CH_1 ... #FDC_DONE_CH_4 flags.
+    *   \retval #FDC_ASYNC_PENDING if the operation is in progress.
+    *   \retval #FDC_OK if everything ok.
+    *   \retval #FDC_COMM_ERR if error occurred during communication.
+    */
+    uint8_t FDC_Async_HasNewData(FDC_AsyncContext* ctx, uint8_t* done);
+
+    /**
+    *   \brief Read a measurement in raw format, see #FDC_ReadRawMeasurement.
+    *   \param ctx the context.
+    *   \param channel the channel, from #FDC_CH_1 to #FDC_CH_4.
+    *   \param[out] capacitance the raw measurement.
+    *   \retval #FDC_ASYNC_PENDING if the operation is in progress.
+    *   \retval #FDC_OK if everything ok.
+    *   \retval #FDC_COMM_ERR if error occurred during communication.
+    *   \retval #FDC_CONF_ERR if channel value not correct.
+    */
+    uint8_t FDC_Async_ReadRawMeasurement(FDC_AsyncContext* ctx,
+                                         uint8_t channel,
+                                         uint32_t* capacitance);
+
+    /**
+    *   \brief Read the new measurements of a set of channels, see #FDC_ReadAllMeasurements.
+    *
+    *   The CAPDAC settings are taken from the copy of the CONF_MEASx
+    *   registers kept for the device, and read from the device only when
+    *   not known.
+    *   \param ctx the context.
+    *   \param mask the channels to be read, as #FDC_DONE_CH_1 ... #FDC_DONE_CH_4 flags.
+    *   \param[out] frame the measurements.
+    *   \retval #FDC_ASYNC_PENDING if the operation is in progress.
+    *   \retval #FDC_OK if everything ok.
+    *   \retval #FDC_COMM_ERR if error occurred during communication.
+    */
+    uint8_t FDC_Async_ReadAllMeasurements(FDC_AsyncContext* ctx, uint8_t mask, FDC_Frame* frame);
+
+    // ===========================================================
+    //                      REGISTERS
+    // ===========================================================
+
+    /**
+    *   \brief Read a register, see #FDC_ReadRegister.
+    *   \param ctx the context.
+    *   \param reg_addr the address of the register.
+    *   \param[out] data the 16-bit value of the register.
+    *   \retval #FDC_ASYNC_PENDING if the operation is in progress.
+    *   \retval #FDC_OK if everything ok.
+    *   \retval #FDC_COMM_ERR if error occurred during communication.
+    */
+    uint8_t FDC_Async_ReadRegister(FDC_AsyncContext* ctx, uint8_t reg_addr, uint8_t* data);
+
+    /**
+    *   \brief Write a register, see #FDC_WriteRegister.
+    *   \param ctx the context.
+    *   \param reg_addr the address of the register.
+    *   \param[in] data the 16-bit value to be written.
+    *   \retval #FDC_ASYNC_PENDING if the operation is in progress.
+    *   \retval #FDC_OK if everything ok.
+    *   \retval #FDC_COMM_ERR if error occurred during communication.
+    */
+    uint8_t FDC_Async_WriteRegister(FDC_AsyncContext* ctx, uint8_t reg_addr, const uint8_t* data);
+
+#endif
+/* [] END OF FILE */
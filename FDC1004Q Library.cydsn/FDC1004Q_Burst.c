@@ -0,0 +1,193 @@
+/**
+*   \brief Source file for the FDC1004Q pre-trigger burst recorder.
+*/
+
+#include "FDC1004Q_Burst.h"
+
+// Sample ring
+static FDC_BurstSample burst_ring[FDC_BURST_SAMPLES];
+
+// Position where the next sample will be written
+static uint16_t burst_head;
+
+// Number of valid samples in the ring
+static uint16_t burst_count;
+
+// Samples still to be recorded after the trigger
+static uint16_t burst_post_left;
+
+// Settings
+static FDC_BurstTrigger burst_trigger;
+static uint16_t burst_post_samples;
+
+// Header of the current burst
+static FDC_BurstHeader burst_header;
+
+// State of the recorder
+static volatile uint8_t burst_state = FDC_BURST_IDLE;
+
+// Set by FDC_Burst_Trigger
+static volatile uint8_t burst_external;
+
+// Monitored value of the previous sample
+static int32_t burst_previous;
+static uint8_t burst_previous_valid;
+
+// Next sample to be sent out
+static uint16_t burst_send_index;
+
+// Check the trigger conditions on a sample
+static uint8_t burst_check_trigger(const uint32_t* capacitance, const uint8_t* capdac);
+
+uint8_t FDC_Burst_Arm(uint16_t node_id, const FDC_BurstTrigger* trigger, uint16_t post_samples)
+{
+    if ((trigger->channel > FDC_CH_4) || (post_samples >= FDC_BURST_SAMPLES))
+    {
+        return FDC_CONF_ERR;
+    }
+    burst_state = FDC_BURST_IDLE;
+    burst_trigger = *trigger;
+    burst_post_samples = post_samples;
+    burst_head = 0;
+    burst_count = 0;
+    burst_external = 0;
+    burst_previous_valid = 0;
+    burst_header.magic = FDC_BURST_MAGIC;
+    burst_header.version = FDC_BURST_VERSION;
+    burst_header.node_id = node_id;
+    burst_header.trigger_channel = trigger->channel;
+    burst_header.reserved = 0;
+    burst_state = FDC_BURST_ARMED;
+    return FDC_OK;
+}
+
+void FDC_Burst_Disarm(void)
+{
+    burst_state = FDC_BURST_IDLE;
+}
+
+void FDC_Burst_Trigger(void)
+{
+    burst_external = 1;
+}
+
+uint8_t FDC_Burst_AddSample(uint32_t timestamp,
+                            const uint32_t* capacitance,
+                            const uint8_t* capdac)
+{
+    if ((burst_state != FDC_BURST_ARMED) && (burst_state != FDC_BURST_TRIGGERED))
+    {
+        return 0;
+    }
+    FDC_BurstSample* sample = &burst_ring[burst_head];
+    sample->timestamp = timestamp;
+    for (uint8_t ch = 0; ch < FDC_BURST_CHANNELS; ch++)
+    {
+        sample->raw[ch] = (int32_t)capacitance[ch] >> 8;
+        sample->capdac[ch] = capdac[ch];
+    }
+    burst_head = (burst_head + 1 == FDC_BURST_SAMPLES) ? 0 : burst_head + 1;
+    if (burst_count < FDC_BURST_SAMPLES)
+    {
+        burst_count++;
+    }
+    
+    if (burst_state == FDC_BURST_ARMED)
+    {
+        uint8_t source = burst_check_trigger(capacitance, capdac);
+        if (source == 0)
+        {
+            return 0;
+        }
+        burst_header.trigger_source = source;
+        burst_header.trigger_timestamp = timestamp;
+        burst_post_left = burst_post_samples;
+        burst_state = FDC_BURST_TRIGGERED;
+    }
+    else
+    {
+        burst_post_left--;
+    }
+    
+    if (burst_post_left > 0)
+    {
+        return 0;
+    }
+    // Trigger sample is followed by the post-trigger window
+    burst_header.sample_count = burst_count;
+    burst_header.trigger_index = burst_count - 1 - burst_post_samples;
+    burst_send_index = 0;
+    burst_state = FDC_BURST_READY;
+    return 1;
+}
+
+uint8_t FDC_Burst_GetState(void)
+{
+    return burst_state;
+}
+
+uint8_t FDC_Burst_SendNext(FDC_Capture_Write write)
+{
+    if (burst_state == FDC_BURST_READY)
+    {
+        write((const uint8_t*)&burst_header, sizeof(burst_header));
+        burst_state = FDC_BURST_SENDING;
+        return 1;
+    }
+    if (burst_state != FDC_BURST_SENDING)
+    {
+        return 0;
+    }
+    // Oldest sample first
+    uint16_t index = burst_head + (FDC_BURST_SAMPLES - burst_count) + burst_send_index;
+    if (index >= FDC_BURST_SAMPLES)
+    {
+        index -= FDC_BURST_SAMPLES;
+    }
+    write((const uint8_t*)&burst_ring[index], sizeof(FDC_BurstSample));
+    burst_send_index++;
+    if (burst_send_index == burst_count)
+    {
+        burst_state = FDC_BURST_IDLE;
+        return 0;
+    }
+    return 1;
+}
+
+// ===================================================================
+//                         HELPER FUNCTIONS
+// ===================================================================
+
+uint8_t burst_check_trigger(const uint32_t* capacitance, const uint8_t* capdac)
+{
+    if (burst_external)
+    {
+        burst_external = 0;
+        return FDC_BURST_TRIGGER_EXTERNAL;
+    }
+    int32_t value;
+    FDC_ConvertRawMeasurementsFixed(&capacitance[burst_trigger.channel],
+                                    &capdac[burst_trigger.channel], &value, 1);
+    uint8_t source = 0;
+    if ((burst_trigger.conditions & FDC_BURST_TRIGGER_ABOVE) && (value >= burst_trigger.level))
+    {
+        source = FDC_BURST_TRIGGER_ABOVE;
+    }
+    else if ((burst_trigger.conditions & FDC_BURST_TRIGGER_BELOW) && (value <= burst_trigger.level))
+    {
+        source = FDC_BURST_TRIGGER_BELOW;
+    }
+    else if ((burst_trigger.conditions & FDC_BURST_TRIGGER_SLOPE) && burst_previous_valid)
+    {
+        int32_t change = value - burst_previous;
+        if ((change >= burst_trigger.slope) || (-change >= burst_trigger.slope))
+        {
+            source = FDC_BURST_TRIGGER_SLOPE;
+        }
+    }
+    burst_previous = value;
+    burst_previous_valid = 1;
+    return source;
+}
+
+/* [] END OF FILE */
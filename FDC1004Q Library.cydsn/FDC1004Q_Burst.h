@@ -0,0 +1,213 @@
+/**
+*   \file FDC1004Q_Burst.h
+*   \brief Header file for the FDC1004Q pre-trigger burst recorder.
+*
+*   The recorder keeps the most recent samples in a RAM ring while armed.
+*   When the trigger fires (level, slope or an external request), it
+*   records a configurable number of post-trigger samples and freezes the
+*   ring, so that the samples around a transient event are kept even if
+*   the continuous output is decimated or too slow to follow them.
+*   The burst is then sent out in binary format, one sample at a time, so
+*   that the transfer can be spread over the main loop without delaying
+*   the acquisition.
+*
+*   The output starts with a #FDC_BurstHeader followed by
+*   #FDC_BurstHeader::sample_count #FDC_BurstSample records in
+*   chronological order. All fields are little-endian.
+*
+*   The RAM used by the ring is set at compile time with
+*   #FDC_BURST_SAMPLES and is reported by #FDC_BURST_MEMORY_SIZE.
+*
+*   \author Davide Marzorati
+*/
+
+#ifndef __FDC1004Q_BURST_H__
+    #define __FDC1004Q_BURST_H__
+
+    #include "FDC1004Q.h"
+    #include "FDC1004Q_Capture.h"
+
+    /**
+    *   \brief Number of samples kept in the ring.
+    */
+    #ifndef FDC_BURST_SAMPLES
+        #define FDC_BURST_SAMPLES 256
+    #endif
+
+    #if (FDC_BURST_SAMPLES < 2) || (FDC_BURST_SAMPLES > 65535)
+        #error "FDC_BURST_SAMPLES must be between 2 and 65535"
+    #endif
+
+    /**
+    *   \brief Magic number at the start of each burst ("FDCE").
+    */
+    #define FDC_BURST_MAGIC 0x45434446UL
+
+    /**
+    *   \brief Version of the burst layout.
+    */
+    #define FDC_BURST_VERSION 1
+
+    /**
+    *   \brief Number of channels stored in each sample.
+    */
+    #define FDC_BURST_CHANNELS 4
+
+    /**
+    *   \brief Trigger when the channel value rises to the level.
+    */
+    #define FDC_BURST_TRIGGER_ABOVE    0x01
+
+    /**
+    *   \brief Trigger when the channel value falls to the level.
+    */
+    #define FDC_BURST_TRIGGER_BELOW    0x02
+
+    /**
+    *   \brief Trigger when the channel value changes by the slope between two samples.
+    */
+    #define FDC_BURST_TRIGGER_SLOPE    0x04
+
+    /**
+    *   \brief Trigger requested with #FDC_Burst_Trigger.
+    */
+    #define FDC_BURST_TRIGGER_EXTERNAL 0x08
+
+    /**
+    *   \brief States of the recorder.
+    */
+    typedef enum {
+        /** Not recording **/
+        FDC_BURST_IDLE,
+        /** Filling the pre-trigger ring, waiting for the trigger **/
+        FDC_BURST_ARMED,
+        /** Trigger fired, filling the post-trigger window **/
+        FDC_BURST_TRIGGERED,
+        /** Burst complete, waiting to be sent out **/
+        FDC_BURST_READY,
+        /** Burst being sent out **/
+        FDC_BURST_SENDING
+    } FDC_BurstState;
+
+    /**
+    *   \brief Trigger settings.
+    *
+    *   The trigger works on the capacitance of a single channel, in units of
+    *   the measurement LSB with the CAPDAC offset added (see
+    *   #FDC_ConvertRawMeasurementsFixed), so that CAPDAC changes do not
+    *   fire it.
+    */
+    typedef struct {
+        /** Enabled conditions, OR of FDC_BURST_TRIGGER_* flags **/
+        uint8_t conditions;
+        /** Channel monitored by the level and slope conditions **/
+        uint8_t channel;
+        /** Level for #FDC_BURST_TRIGGER_ABOVE and #FDC_BURST_TRIGGER_BELOW **/
+        int32_t level;
+        /** Minimum absolute change for #FDC_BURST_TRIGGER_SLOPE **/
+        int32_t slope;
+    } FDC_BurstTrigger;
+
+    /**
+    *   \brief Header of a burst.
+    */
+    typedef struct {
+        /** Magic number, #FDC_BURST_MAGIC **/
+        uint32_t magic;
+        /** Layout version, #FDC_BURST_VERSION **/
+        uint16_t version;
+        /** ID of the node that recorded the burst **/
+        uint16_t node_id;
+        /** Number of samples in the burst **/
+        uint16_t sample_count;
+        /** Index of the sample that fired the trigger **/
+        uint16_t trigger_index;
+        /** Condition that fired the trigger, one of the FDC_BURST_TRIGGER_* flags **/
+        uint8_t trigger_source;
+        /** Channel monitored by the trigger **/
+        uint8_t trigger_channel;
+        /** Reserved, set to 0 **/
+        uint16_t reserved;
+        /** Timestamp of the sample that fired the trigger **/
+        uint32_t trigger_timestamp;
+    } FDC_BurstHeader;
+
+    /**
+    *   \brief Sample of a burst.
+    */
+    typedef struct {
+        /** Timestamp of the sample **/
+        uint32_t timestamp;
+        /** Measurements, sign extended 24-bit values **/
+        int32_t raw[FDC_BURST_CHANNELS];
+        /** CAPDAC settings the measurements were taken with **/
+        uint8_t capdac[FDC_BURST_CHANNELS];
+    } FDC_BurstSample;
+
+    /**
+    *   \brief RAM used by the ring, in bytes.
+    */
+    #define FDC_BURST_MEMORY_SIZE (FDC_BURST_SAMPLES * sizeof(FDC_BurstSample))
+
+    /**
+    *   \brief Arm the recorder.
+    *
+    *   Any burst not yet sent out is discarded.
+    *   \param node_id the ID of the node, stored in the burst header.
+    *   \param[in] trigger the trigger settings.
+    *   \param post_samples the number of samples recorded after the trigger,
+    *       up to #FDC_BURST_SAMPLES - 1. The remaining samples of the ring
+    *       hold the pre-trigger history.
+    *   \retval #FDC_OK if the recorder was armed.
+    *   \retval #FDC_CONF_ERR if the settings are not valid.
+    */
+    uint8_t FDC_Burst_Arm(uint16_t node_id, const FDC_BurstTrigger* trigger, uint16_t post_samples);
+
+    /**
+    *   \brief Stop the recorder and discard the burst.
+    */
+    void FDC_Burst_Disarm(void);
+
+    /**
+    *   \brief Fire the trigger from outside.
+    *
+    *   The trigger fires at the next sample, if the recorder is armed.
+    */
+    void FDC_Burst_Trigger(void);
+
+    /**
+    *   \brief Add a sample to the recorder.
+    *
+    *   This function only copies the sample and checks the trigger,
+    *   so it can be called from the acquisition path.
+    *   \param timestamp the timestamp of the sample.
+    *   \param[in] capacitance the raw measurements of the four channels,
+    *       as returned by #FDC_ReadRawMeasurement.
+    *   \param[in] capdac the CAPDAC settings the measurements were taken with.
+    *   \retval 1 if the burst was completed by this sample.
+    *   \retval 0 otherwise.
+    */
+    uint8_t FDC_Burst_AddSample(uint32_t timestamp,
+                                const uint32_t* capacitance,
+                                const uint8_t* capdac);
+
+    /**
+    *   \brief Read the state of the recorder.
+    *   \return the state, see #FDC_BurstState.
+    */
+    uint8_t FDC_Burst_GetState(void);
+
+    /**
+    *   \brief Send out the next part of a completed burst.
+    *
+    *   The first call sends the header, and each following call sends one
+    *   sample. When the last sample is sent, the recorder goes back to
+    *   #FDC_BURST_IDLE.
+    *   \param write the callback used to output the data.
+    *   \retval 1 if there is more data to be sent.
+    *   \retval 0 if the burst was completely sent or there is no burst.
+    */
+    uint8_t FDC_Burst_SendNext(FDC_Capture_Write write);
+
+#endif
+/* [] END OF FILE */
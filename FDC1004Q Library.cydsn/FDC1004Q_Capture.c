@@ -0,0 +1,108 @@
+/**
+*   \brief Source file for the FDC1004Q binary capture recorder.
+*/
+
+#include "FDC1004Q_Capture.h"
+
+#include <string.h>
+
+// Block being filled
+static FDC_CaptureBlock capture_block;
+
+// Output callback
+static FDC_Capture_Write capture_write;
+
+// Recorded channels
+static uint8_t capture_channel_mask;
+
+// ID of the node
+static uint16_t capture_node_id;
+
+// Sequence number of the next block
+static uint32_t capture_sequence;
+
+// Clear the block and prepare its header
+static void capture_new_block(void);
+
+void FDC_Capture_Start(uint16_t node_id, uint8_t channel_mask, FDC_Capture_Write write)
+{
+    capture_node_id = node_id;
+    capture_write = write;
+    capture_channel_mask = channel_mask;
+    capture_sequence = 0;
+    capture_new_block();
+}
+
+uint8_t FDC_Capture_AddSample(uint32_t timestamp,
+                              const uint32_t* capacitance,
+                              const uint8_t* capdac)
+{
+    FDC_CaptureHeader* header = &capture_block.header;
+    uint8_t index = header->sample_count;
+    if (index == 0)
+    {
+        header->first_timestamp = timestamp;
+    }
+    header->last_timestamp = timestamp;
+    capture_block.timestamp[index] = timestamp;
+    for (uint8_t ch = FDC_CH_1; ch <= FDC_CH_4; ch++)
+    {
+        if (capture_channel_mask & (FDC_RP_CH_1 >> ch))
+        {
+            capture_block.raw[ch][index] = (int32_t)capacitance[ch] >> 8;
+            capture_block.capdac[ch][index] = capdac[ch];
+        }
+    }
+    header->sample_count++;
+    if (header->sample_count == FDC_CAPTURE_BLOCK_SAMPLES)
+    {
+        FDC_Capture_Flush();
+        return 1;
+    }
+    return 0;
+}
+
+void FDC_Capture_Flush(void)
+{
+    if (capture_block.header.sample_count == 0)
+    {
+        return;
+    }
+    if (capture_write != NULL)
+    {
+        capture_block.header.crc = FDC_Capture_Crc16((const uint8_t*)&capture_block, 
+                                                     sizeof(capture_block));
+        capture_write((const uint8_t*)&capture_block, sizeof(capture_block));
+    }
+    capture_sequence++;
+    capture_new_block();
+}
+
+void capture_new_block(void)
+{
+    memset(&capture_block, 0, sizeof(capture_block));
+    capture_block.header.magic = FDC_CAPTURE_MAGIC;
+    capture_block.header.version = FDC_CAPTURE_VERSION;
+    capture_block.header.channel_mask = capture_channel_mask;
+    capture_block.header.sequence = capture_sequence;
+    capture_block.header.node_id = capture_node_id;
+}
+
+uint16_t FDC_Capture_Crc16(const uint8_t* data, uint16_t length)
+{
+    // Polynomial 0x1021, processed one nibble at a time
+    static const uint16_t crc_table[16] = {
+        0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
+        0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF
+    };
+    uint16_t crc = 0xFFFF;
+    while (length-- > 0)
+    {
+        crc = (crc << 4) ^ crc_table[(crc >> 12) ^ (*data >> 4)];
+        crc = (crc << 4) ^ crc_table[(crc >> 12) ^ (*data & 0x0F)];
+        data++;
+    }
+    return crc;
+}
+
+/* [] END OF FILE */
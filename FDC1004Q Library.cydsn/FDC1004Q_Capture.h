@@ -0,0 +1,148 @@
+/**
+*   \file FDC1004Q_Capture.h
+*   \brief Header file for the FDC1004Q binary capture recorder.
+*
+*   The recorder packs measurement samples into fixed-size columnar blocks
+*   that can be streamed to a host and written unchanged to a capture file.
+*   Each block starts with a #FDC_CaptureHeader and stores the timestamps,
+*   the raw measurements and the CAPDAC settings of each channel as
+*   separate columns, so that a reader mapping the file in memory can
+*   access a single channel without touching the others.
+*
+*   Since all blocks have the same size (sizeof(#FDC_CaptureBlock)), block
+*   k always starts at offset k * sizeof(#FDC_CaptureBlock) in the file.
+*   The time range stored in each header forms a sparse index: a time query
+*   is solved with a binary search over the block headers, and only the
+*   pages of the matching blocks and columns need to be read.
+*   All fields are little-endian.
+*
+*   When many nodes stream to the same host, the node ID identifies the
+*   source of each block, gaps in the sequence number reveal lost blocks
+*   and the CRC rejects blocks corrupted on the serial link.
+*
+*   \author Davide Marzorati
+*/
+
+#ifndef __FDC1004Q_CAPTURE_H__
+    #define __FDC1004Q_CAPTURE_H__
+
+    #include "FDC1004Q.h"
+
+    /**
+    *   \brief Number of samples stored in each block.
+    *
+    *   Must be a multiple of 4 so that the columns stay aligned,
+    *   and must fit the 8-bit sample count of the header.
+    */
+    #ifndef FDC_CAPTURE_BLOCK_SAMPLES
+        #define FDC_CAPTURE_BLOCK_SAMPLES 32
+    #endif
+
+    #if ((FDC_CAPTURE_BLOCK_SAMPLES % 4) != 0) || (FDC_CAPTURE_BLOCK_SAMPLES > 252)
+        #error "FDC_CAPTURE_BLOCK_SAMPLES must be a multiple of 4, up to 252"
+    #endif
+
+    /**
+    *   \brief Magic number at the start of each block ("FDCB").
+    */
+    #define FDC_CAPTURE_MAGIC 0x42434446UL
+
+    /**
+    *   \brief Version of the block layout.
+    */
+    #define FDC_CAPTURE_VERSION 2
+
+    /**
+    *   \brief Number of channels stored in each block.
+    */
+    #define FDC_CAPTURE_CHANNELS 4
+
+    /**
+    *   \brief Header of a capture block.
+    */
+    typedef struct {
+        /** Magic number, #FDC_CAPTURE_MAGIC **/
+        uint32_t magic;
+        /** Layout version, #FDC_CAPTURE_VERSION **/
+        uint16_t version;
+        /** Recorded channels, as #FDC_RP_CH_1 ... #FDC_RP_CH_4 flags **/
+        uint8_t channel_mask;
+        /** Number of valid samples in the block **/
+        uint8_t sample_count;
+        /** Sequence number of the block **/
+        uint32_t sequence;
+        /** Timestamp of the first sample in the block **/
+        uint32_t first_timestamp;
+        /** Timestamp of the last sample in the block **/
+        uint32_t last_timestamp;
+        /** ID of the node that recorded the block **/
+        uint16_t node_id;
+        /** CRC-16/CCITT-FALSE of the whole block, computed with this field set to 0 **/
+        uint16_t crc;
+    } FDC_CaptureHeader;
+
+    /**
+    *   \brief Capture block.
+    *
+    *   Unused samples of a partially filled block are set to 0.
+    */
+    typedef struct {
+        /** Block header **/
+        FDC_CaptureHeader header;
+        /** Timestamp column **/
+        uint32_t timestamp[FDC_CAPTURE_BLOCK_SAMPLES];
+        /** Measurement columns, sign extended 24-bit values **/
+        int32_t raw[FDC_CAPTURE_CHANNELS][FDC_CAPTURE_BLOCK_SAMPLES];
+        /** CAPDAC columns **/
+        uint8_t capdac[FDC_CAPTURE_CHANNELS][FDC_CAPTURE_BLOCK_SAMPLES];
+    } FDC_CaptureBlock;
+
+    /**
+    *   \brief Callback used to output completed blocks.
+    */
+    typedef void (*FDC_Capture_Write)(const uint8_t* data, uint16_t length);
+
+    /**
+    *   \brief Start a new capture.
+    *
+    *   This function clears the current block and restarts the block
+    *   sequence number from 0.
+    *   \param node_id the ID of the node, stored in each block header.
+    *   \param channel_mask the recorded channels, as OR of #FDC_RP_CH_1,
+    *       #FDC_RP_CH_2, #FDC_RP_CH_3 and #FDC_RP_CH_4.
+    *   \param write the callback used to output completed blocks.
+    */
+    void FDC_Capture_Start(uint16_t node_id, uint8_t channel_mask, FDC_Capture_Write write);
+
+    /**
+    *   \brief Add a sample to the capture.
+    *
+    *   The block is written out as soon as it is full.
+    *   \param timestamp the timestamp of the sample.
+    *   \param[in] capacitance the raw measurements of the four channels,
+    *       as returned by #FDC_ReadRawMeasurement.
+    *   \param[in] capdac the CAPDAC settings of the four channels.
+    *   \retval 1 if a block was written out.
+    *   \retval 0 otherwise.
+    */
+    uint8_t FDC_Capture_AddSample(uint32_t timestamp,
+                                  const uint32_t* capacitance,
+                                  const uint8_t* capdac);
+
+    /**
+    *   \brief Write out the current block, even if partially filled.
+    */
+    void FDC_Capture_Flush(void);
+    
+    /**
+    *   \brief Compute the CRC-16/CCITT-FALSE of a buffer.
+    *
+    *   The host uses the same function to validate received blocks.
+    *   \param[in] data the buffer.
+    *   \param length the length of the buffer.
+    *   \return the CRC value.
+    */
+    uint16_t FDC_Capture_Crc16(const uint8_t* data, uint16_t length);
+
+#endif
+/* [] END OF FILE */
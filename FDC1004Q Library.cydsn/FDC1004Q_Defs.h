@@ -13,6 +13,19 @@
     */
     #define FDC_CAPDAC_FACTOR 3.125
     
+    /**
+    *   \brief CAPDAC multiplying factor in measurement LSBs.
+    *
+    *   One CAPDAC step (3.125 pF) expressed in units of the measurement
+    *   LSB, that is \f$ 3.125 \cdot 2^{19} \f$.
+    */
+    #define FDC_CAPDAC_FIXED_FACTOR 1638400L
+    
+    /**
+    *   \brief Weight of the measurement LSB in pF (\f$ 2^{-19} \f$).
+    */
+    #define FDC_MEAS_LSB_PF (1.0 / 524288.0)
+    
     // =============================================
     //              FDC1004Q REGISTERS
     // ============================================= 
@@ -348,6 +361,25 @@
     */
     #define FDC1004Q_DEVICE_ID 0xFF
     
+    // =============================================
+    //               DEVICE IDENTIFICATION
+    // ============================================= 
+    
+    /**
+    *   \brief I2C Address of the FDC1004Q sensor.
+    */
+    #define FDC1004Q_I2C_ADDR 0x50
+    
+    /**
+    *   \brief Expected manufacturer ID value.
+    */
+    #define FDC1004Q_MANUFACTURED_ID_VALUE 0x5449
+    
+    /**
+    *   \brief Expected device ID value.
+    */
+    #define FDC1004Q_DEVICE_ID_VALUE 0x1004
+    
     // =============================================
     //               ERRORS
     // ============================================= 
@@ -377,6 +409,11 @@
     */
     #define FDC_MEAS_NOT_DONE   4 
     
+    /**
+    *   \brief Measurement saturated error.
+    */
+    #define FDC_MEAS_SATURATED  5
+    
     // =============================================
     //               SAMPLE RATE VALUES
     // ============================================= 
@@ -477,6 +514,77 @@
     */
     #define     FDC_RP_CH_4 0x10  
     
+    // =============================================
+    //               FDC1004Q DONE FLAGS
+    // ============================================= 
+    
+    /**
+    *   \brief Measurement done flag for channel 1
+    */
+    #define     FDC_DONE_CH_1 0x08
+    
+    /**
+    *   \brief Measurement done flag for channel 2
+    */
+    #define     FDC_DONE_CH_2 0x04
+    
+    /**
+    *   \brief Measurement done flag for channel 3
+    */
+    #define     FDC_DONE_CH_3 0x02
+    
+    /**
+    *   \brief Measurement done flag for channel 4
+    */
+    #define     FDC_DONE_CH_4 0x01
+    
+    /**
+    *   \brief Measurement done flags for all channels
+    */
+    #define     FDC_DONE_CH_ALL 0x0F
+    
+    // =============================================
+    //               SATURATION FLAGS
+    // ============================================= 
+    
+    /**
+    *   \brief Measurement not saturated.
+    */
+    #define     FDC_SAT_NONE 0x00
+    
+    /**
+    *   \brief Measurement saturated at the positive end of the range.
+    */
+    #define     FDC_SAT_HIGH 0x01
+    
+    /**
+    *   \brief Measurement saturated at the negative end of the range.
+    */
+    #define     FDC_SAT_LOW  0x02
+    
+    /**
+    *   \brief Raw measurement saturated at the positive end (0x7FFFFF).
+    */
+    #define     FDC_RAW_SAT_HIGH 0x7FFFFF00UL
+    
+    /**
+    *   \brief Raw measurement saturated at the negative end (0x800000).
+    */
+    #define     FDC_RAW_SAT_LOW  0x80000000UL
+    
+    /**
+    *   \brief Maximum CAPDAC value.
+    */
+    #define     FDC_CAPDAC_MAX 31
+    
+    /**
+    *   \brief CAPDAC change used to recover from a saturated measurement.
+    *
+    *   Nine steps (28.125 pF) move the +/- 15 pF input range by almost
+    *   its whole width, keeping a small overlap with the previous range.
+    */
+    #define     FDC_CAPDAC_RECOVERY_STEPS 9
+    
 
     
 #endif
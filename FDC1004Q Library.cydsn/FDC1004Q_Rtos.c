@@ -0,0 +1,280 @@
+/**
+*   \brief Source file for the FreeRTOS integration of the FDC1004Q driver.
+*/
+
+#if defined(FDC_RTOS)
+
+#include "FDC1004Q_Rtos.h"
+
+/**
+*   \brief Request served by the bus task.
+*/
+typedef struct {
+    FDC_Rtos_Function function;
+    void* argument;
+    // Task waiting for the result
+    TaskHandle_t task;
+    uint8_t* result;
+} FDC_Rtos_Request;
+
+/**
+*   \brief Argument of rtos_start_streaming.
+*/
+typedef struct {
+    uint8_t mask;
+    TickType_t period;
+} FDC_Rtos_Streaming;
+
+/**
+*   \brief Argument of rtos_subscribe and rtos_get_dropped.
+*/
+typedef struct {
+    QueueHandle_t queue;
+    UBaseType_t depth;
+    uint32_t dropped;
+} FDC_Rtos_Subscriber;
+
+// Kernel objects
+static TaskHandle_t rtos_task;
+static QueueHandle_t rtos_requests;
+static SemaphoreHandle_t rtos_driver_mutex;
+static SemaphoreHandle_t rtos_bus_mutex;
+
+// Subscribers, only accessed by the bus task
+static QueueHandle_t rtos_subscribers[FDC_RTOS_MAX_SUBSCRIBERS];
+static uint32_t rtos_dropped[FDC_RTOS_MAX_SUBSCRIBERS];
+static uint8_t rtos_subscriber_count;
+
+// Streaming settings, only accessed by the bus task
+static uint8_t rtos_streaming;
+static uint8_t rtos_mask;
+static TickType_t rtos_period;
+static TickType_t rtos_last_poll;
+
+// Counters, only accessed by the bus task
+static FDC_Rtos_Stats rtos_stats;
+
+// Bus task
+static void rtos_bus_task(void* parameters);
+
+// Read a frame and deliver it to the subscribers
+static void rtos_poll(void);
+
+// Functions run on the bus task for the API
+static uint8_t rtos_start_streaming(void* argument);
+static uint8_t rtos_stop_streaming(void* argument);
+static uint8_t rtos_subscribe(void* argument);
+static uint8_t rtos_get_dropped(void* argument);
+static uint8_t rtos_get_stats(void* argument);
+
+uint8_t FDC_Rtos_Init(UBaseType_t priority, configSTACK_DEPTH_TYPE stack_depth)
+{
+    rtos_requests = xQueueCreate(FDC_RTOS_REQUEST_DEPTH, sizeof(FDC_Rtos_Request));
+    SemaphoreHandle_t driver_mutex = xSemaphoreCreateRecursiveMutex();
+    SemaphoreHandle_t bus_mutex = xSemaphoreCreateRecursiveMutex();
+    if ((rtos_requests == NULL) || (driver_mutex == NULL) || (bus_mutex == NULL))
+    {
+        return FDC_CONF_ERR;
+    }
+    rtos_driver_mutex = driver_mutex;
+    rtos_bus_mutex = bus_mutex;
+    if (xTaskCreate(rtos_bus_task, "FDC bus", stack_depth, NULL, priority, &rtos_task) != pdPASS)
+    {
+        return FDC_CONF_ERR;
+    }
+    return FDC_OK;
+}
+
+uint8_t FDC_Rtos_Call(FDC_Rtos_Function function, void* argument)
+{
+    TaskHandle_t caller = xTaskGetCurrentTaskHandle();
+    if ((xTaskGetSchedulerState() == taskSCHEDULER_NOT_STARTED) || (caller == rtos_task))
+    {
+        return function(argument);
+    }
+    uint8_t result;
+    FDC_Rtos_Request request = { function, argument, caller, &result };
+    xQueueSend(rtos_requests, &request, portMAX_DELAY);
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    return result;
+}
+
+uint8_t FDC_Rtos_StartStreaming(uint8_t mask, TickType_t period)
+{
+    if (period == 0)
+    {
+        return FDC_CONF_ERR;
+    }
+    FDC_Rtos_Streaming streaming = { mask, period };
+    return FDC_Rtos_Call(rtos_start_streaming, &streaming);
+}
+
+uint8_t FDC_Rtos_StopStreaming(void)
+{
+    return FDC_Rtos_Call(rtos_stop_streaming, NULL);
+}
+
+QueueHandle_t FDC_Rtos_Subscribe(UBaseType_t depth)
+{
+    FDC_Rtos_Subscriber subscriber = { NULL, depth, 0 };
+    FDC_Rtos_Call(rtos_subscribe, &subscriber);
+    return subscriber.queue;
+}
+
+uint32_t FDC_Rtos_GetDropped(QueueHandle_t queue)
+{
+    FDC_Rtos_Subscriber subscriber = { queue, 0, 0 };
+    FDC_Rtos_Call(rtos_get_dropped, &subscriber);
+    return subscriber.dropped;
+}
+
+void FDC_Rtos_GetStats(FDC_Rtos_Stats* stats)
+{
+    FDC_Rtos_Call(rtos_get_stats, stats);
+}
+
+void FDC_Rtos_Lock(void)
+{
+    if (rtos_driver_mutex != NULL)
+    {
+        xSemaphoreTakeRecursive(rtos_driver_mutex, portMAX_DELAY);
+    }
+}
+
+void FDC_Rtos_Unlock(void)
+{
+    if (rtos_driver_mutex != NULL)
+    {
+        xSemaphoreGiveRecursive(rtos_driver_mutex);
+    }
+}
+
+void FDC_Rtos_LockBus(void)
+{
+    if (rtos_bus_mutex != NULL)
+    {
+        xSemaphoreTakeRecursive(rtos_bus_mutex, portMAX_DELAY);
+    }
+}
+
+void FDC_Rtos_UnlockBus(void)
+{
+    if (rtos_bus_mutex != NULL)
+    {
+        xSemaphoreGiveRecursive(rtos_bus_mutex);
+    }
+}
+
+void rtos_bus_task(void* parameters)
+{
+    (void)parameters;
+    for (;;)
+    {
+        TickType_t wait = portMAX_DELAY;
+        if (rtos_streaming)
+        {
+            TickType_t elapsed = xTaskGetTickCount() - rtos_last_poll;
+            if (elapsed >= rtos_period)
+            {
+                rtos_poll();
+                rtos_last_poll += rtos_period;
+                // Skip the periods missed while serving the requests
+                if ((TickType_t)(xTaskGetTickCount() - rtos_last_poll) >= rtos_period)
+                {
+                    rtos_last_poll = xTaskGetTickCount();
+                }
+                continue;
+            }
+            wait = rtos_period - elapsed;
+        }
+        FDC_Rtos_Request request;
+        if (xQueueReceive(rtos_requests, &request, wait) == pdPASS)
+        {
+            *request.result = request.function(request.argument);
+            rtos_stats.requests++;
+            xTaskNotifyGive(request.task);
+        }
+    }
+}
+
+void rtos_poll(void)
+{
+    FDC_Rtos_Sample sample;
+    if (FDC_ReadAllMeasurements(rtos_mask, &sample.frame) != FDC_OK)
+    {
+        rtos_stats.errors++;
+        return;
+    }
+    if ((sample.frame.valid | sample.frame.saturated) == 0)
+    {
+        return;
+    }
+    sample.timestamp = FDC_RTOS_CLOCK();
+    rtos_stats.frames++;
+    for (uint8_t i = 0; i < rtos_subscriber_count; i++)
+    {
+        if (xQueueSend(rtos_subscribers[i], &sample, 0) != pdPASS)
+        {
+            rtos_dropped[i]++;
+            rtos_stats.dropped++;
+        }
+    }
+}
+
+uint8_t rtos_start_streaming(void* argument)
+{
+    const FDC_Rtos_Streaming* streaming = argument;
+    rtos_mask = streaming->mask;
+    rtos_period = streaming->period;
+    rtos_last_poll = xTaskGetTickCount();
+    rtos_streaming = 1;
+    return FDC_OK;
+}
+
+uint8_t rtos_stop_streaming(void* argument)
+{
+    (void)argument;
+    rtos_streaming = 0;
+    return FDC_OK;
+}
+
+uint8_t rtos_subscribe(void* argument)
+{
+    FDC_Rtos_Subscriber* subscriber = argument;
+    if (rtos_subscriber_count == FDC_RTOS_MAX_SUBSCRIBERS)
+    {
+        return FDC_CONF_ERR;
+    }
+    subscriber->queue = xQueueCreate(subscriber->depth, sizeof(FDC_Rtos_Sample));
+    if (subscriber->queue == NULL)
+    {
+        return FDC_CONF_ERR;
+    }
+    rtos_dropped[rtos_subscriber_count] = 0;
+    rtos_subscribers[rtos_subscriber_count++] = subscriber->queue;
+    return FDC_OK;
+}
+
+uint8_t rtos_get_dropped(void* argument)
+{
+    FDC_Rtos_Subscriber* subscriber = argument;
+    for (uint8_t i = 0; i < rtos_subscriber_count; i++)
+    {
+        if (rtos_subscribers[i] == subscriber->queue)
+        {
+            subscriber->dropped = rtos_dropped[i];
+            return FDC_OK;
+        }
+    }
+    return FDC_CONF_ERR;
+}
+
+uint8_t rtos_get_stats(void* argument)
+{
+    *(FDC_Rtos_Stats*)argument = rtos_stats;
+    return FDC_OK;
+}
+
+#endif
+
+/* [] END OF FILE */
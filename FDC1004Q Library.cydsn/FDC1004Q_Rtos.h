@@ -0,0 +1,175 @@
+/**
+*   \file FDC1004Q_Rtos.h
+*   \brief Header file for the FreeRTOS integration of the FDC1004Q driver.
+*
+*   A single task, the bus task, owns the sensor: it serves the requests
+*   that the other tasks submit through a queue, and polls the new
+*   measurements at a fixed period, delivering each frame to the bounded
+*   queues of the subscribers. A full subscriber queue never blocks the
+*   bus task: the sample is dropped and counted for that subscriber.
+*
+*   Any driver function can be run on the bus task with #FDC_Rtos_Call,
+*   which waits for the result using the task notification of the caller.
+*   The driver and the I2C interface are also protected by two recursive
+*   mutexes (#FDC_Rtos_Lock and #FDC_Rtos_LockBus), so that other tasks can
+*   share the I2C_Master component with the bus task through the
+*   I2C_Peripheral_* functions.
+*
+*   The layer is built when #FDC_RTOS is defined, which also maps #FDC_LOCK
+*   and #I2C_INTERFACE_LOCK to the mutexes. It only uses the FreeRTOS API,
+*   so the same code runs on the target, on the FreeRTOS POSIX port and on
+*   the host stand-in under Host/FreeRTOS.
+*
+*   \author Davide Marzorati
+*/
+
+#ifndef __FDC1004Q_RTOS_H__
+    #define __FDC1004Q_RTOS_H__
+
+    #include "FDC1004Q.h"
+
+    #include "FreeRTOS.h"
+    #include "task.h"
+    #include "queue.h"
+    #include "semphr.h"
+
+    /**
+    *   \brief Maximum number of sample queues.
+    */
+    #ifndef FDC_RTOS_MAX_SUBSCRIBERS
+        #define FDC_RTOS_MAX_SUBSCRIBERS 4
+    #endif
+
+    /**
+    *   \brief Number of requests that can wait for the bus task.
+    */
+    #ifndef FDC_RTOS_REQUEST_DEPTH
+        #define FDC_RTOS_REQUEST_DEPTH 8
+    #endif
+
+    /**
+    *   \brief Clock used to timestamp the samples.
+    *
+    *   Defaults to the tick count. Define it in FreeRTOSConfig.h to a finer
+    *   clock (e.g. a free running timer) to measure the delivery latency.
+    */
+    #ifndef FDC_RTOS_CLOCK
+        #define FDC_RTOS_CLOCK() ((uint32_t)xTaskGetTickCount())
+    #endif
+
+    /**
+    *   \brief Function run on the bus task by #FDC_Rtos_Call.
+    *   \param argument the argument given to #FDC_Rtos_Call.
+    *   \return an FDC_* error code.
+    */
+    typedef uint8_t (*FDC_Rtos_Function)(void* argument);
+
+    /**
+    *   \brief Sample delivered to the subscribers.
+    */
+    typedef struct {
+        /** #FDC_RTOS_CLOCK when the frame was read **/
+        uint32_t timestamp;
+        /** New measurements **/
+        FDC_Frame frame;
+    } FDC_Rtos_Sample;
+
+    /**
+    *   \brief Counters of the bus task.
+    */
+    typedef struct {
+        /** Requests served **/
+        uint32_t requests;
+        /** Frames holding at least one new measurement **/
+        uint32_t frames;
+        /** Frames that could not be read **/
+        uint32_t errors;
+        /** Samples dropped because a subscriber queue was full, all subscribers **/
+        uint32_t dropped;
+    } FDC_Rtos_Stats;
+
+    /**
+    *   \brief Create the mutexes, the request queue and the bus task.
+    *
+    *   Call it once, before the scheduler is started. Until then the mutexes
+    *   are not taken, so the driver can be set up directly.
+    *   \param priority priority of the bus task.
+    *   \param stack_depth stack of the bus task, in words.
+    *   \retval #FDC_OK if the layer was created.
+    *   \retval #FDC_CONF_ERR if the kernel objects could not be allocated.
+    */
+    uint8_t FDC_Rtos_Init(UBaseType_t priority, configSTACK_DEPTH_TYPE stack_depth);
+
+    /**
+    *   \brief Run a function on the bus task and wait for its result.
+    *
+    *   The requests are served in the order they are submitted. Called from
+    *   the bus task itself, the function is run directly.
+    *   \param function the function.
+    *   \param argument passed to the function.
+    *   \return the value returned by the function.
+    */
+    uint8_t FDC_Rtos_Call(FDC_Rtos_Function function, void* argument);
+
+    /**
+    *   \brief Poll the new measurements of a set of channels at a fixed period.
+    *
+    *   The measurements must be started separately, e.g. with
+    *   #FDC_EnableRepeatMeasurement through #FDC_Rtos_Call.
+    *   \param mask channels to read, as #FDC_DONE_CH_1 ... #FDC_DONE_CH_4 flags.
+    *   \param period polling period in ticks, at least 1.
+    *   \return #FDC_OK, or #FDC_CONF_ERR if the period is 0.
+    */
+    uint8_t FDC_Rtos_StartStreaming(uint8_t mask, TickType_t period);
+
+    /**
+    *   \brief Stop polling the measurements.
+    *   \return #FDC_OK.
+    */
+    uint8_t FDC_Rtos_StopStreaming(void);
+
+    /**
+    *   \brief Create a sample queue fed by the bus task.
+    *
+    *   Each item of the queue is an #FDC_Rtos_Sample.
+    *   \param depth number of samples the queue holds.
+    *   \return the queue, or NULL if there are already
+    *       #FDC_RTOS_MAX_SUBSCRIBERS queues or it could not be allocated.
+    */
+    QueueHandle_t FDC_Rtos_Subscribe(UBaseType_t depth);
+
+    /**
+    *   \brief Number of samples dropped for a subscriber.
+    *   \param queue the queue returned by #FDC_Rtos_Subscribe.
+    *   \return the number of samples dropped because the queue was full.
+    */
+    uint32_t FDC_Rtos_GetDropped(QueueHandle_t queue);
+
+    /**
+    *   \brief Read the counters of the bus task.
+    *   \param[out] stats the counters.
+    */
+    void FDC_Rtos_GetStats(FDC_Rtos_Stats* stats);
+
+    /**
+    *   \brief Take the driver mutex (#FDC_LOCK).
+    */
+    void FDC_Rtos_Lock(void);
+
+    /**
+    *   \brief Give the driver mutex (#FDC_UNLOCK).
+    */
+    void FDC_Rtos_Unlock(void);
+
+    /**
+    *   \brief Take the bus mutex (#I2C_INTERFACE_LOCK).
+    */
+    void FDC_Rtos_LockBus(void);
+
+    /**
+    *   \brief Give the bus mutex (#I2C_INTERFACE_UNLOCK).
+    */
+    void FDC_Rtos_UnlockBus(void);
+
+#endif
+/* [] END OF FILE */
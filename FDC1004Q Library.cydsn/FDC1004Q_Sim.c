@@ -0,0 +1,730 @@
+/**
+*   \brief Source file for the FDC1004Q device simulator.
+*/
+
+#include "FDC1004Q_Sim.h"
+#include "FDC1004Q_Defs.h"
+
+#include <stddef.h>
+
+/**
+*   \brief Number of registers in the 0x00-0x14 address range.
+*/
+#define FDC_SIM_REGISTER_COUNT 0x15
+
+/**
+*   \brief Value of CONF_MEASx after reset (CHA = CINx, CHB disabled).
+*/
+#define FDC_SIM_CONF_MEAS_DEFAULT 0x1C00
+
+/**
+*   \brief Value of GAIN_CALx after reset (gain of 1).
+*/
+#define FDC_SIM_GAIN_CAL_DEFAULT 0x4000
+
+/**
+*   \brief Capacitance corresponding to one CAPDAC step (3.125 pF) in aF.
+*/
+#define FDC_SIM_CAPDAC_STEP_AF 3125000L
+
+/**
+*   \brief Largest positive 24-bit result.
+*/
+#define FDC_SIM_CODE_MAX 0x7FFFFFL
+
+/**
+*   \brief Largest negative 24-bit result.
+*/
+#define FDC_SIM_CODE_MIN (-0x800000L)
+
+/**
+*   \brief Bus clocks for a byte and its acknowledge.
+*/
+#define FDC_SIM_CLOCKS_PER_BYTE 9
+
+/**
+*   \brief Bus clocks charged for a start, restart or stop condition.
+*/
+#define FDC_SIM_CLOCKS_PER_CONDITION 1
+
+/**
+*   \brief No conversion in progress.
+*/
+#define FDC_SIM_NO_CHANNEL 0xFF
+
+// FDC_CONF register bits
+#define FDC_SIM_CONF_RESET  0x8000
+#define FDC_SIM_CONF_REPEAT 0x0100
+#define FDC_SIM_CONF_MEAS   0x00F0
+#define FDC_SIM_CONF_DONE   0x000F
+
+/**
+*   \brief State of a simulated device.
+*/
+typedef struct {
+    /** Register file **/
+    uint16_t registers[FDC_SIM_REGISTER_COUNT];
+    /** Register pointer **/
+    uint8_t pointer;
+    /** Channel being converted **/
+    uint8_t active_channel;
+    /** End time of the conversion in progress **/
+    uint64_t conversion_end_ns;
+    /** Constant capacitance at the inputs **/
+    int32_t capacitance_af[FDC_SIM_INPUT_COUNT];
+    /** Capacitance waveform, or NULL **/
+    FDC_Sim_Waveform waveform;
+    /** Noise amplitude and generator state **/
+    int32_t noise_af;
+    uint32_t noise_state;
+    /** Recorded frames, their number and the next one to be replayed **/
+    const FDC_Sim_ReplayFrame* replay_frames;
+    uint32_t replay_count;
+    uint32_t replay_index;
+    /** Frame being replayed **/
+    const FDC_Sim_ReplayFrame* replay_frame;
+} fdc_sim_device;
+
+// Simulated devices
+static fdc_sim_device sim_devices[FDC_SIM_MAX_DEVICES];
+
+// Device being operated on
+static fdc_sim_device* sim_dev = &sim_devices[0];
+
+// Device configured by the FDC_Sim_Set* functions
+static uint8_t sim_selected;
+
+// Devices behind the multiplexer (0 if no multiplexer) and its control register
+static uint8_t sim_mux_devices;
+static uint8_t sim_mux_control;
+
+// Other devices on the bus: addresses and memories
+static uint8_t sim_aux_addresses[FDC_SIM_MAX_AUX_DEVICES];
+static uint8_t sim_aux_memory[FDC_SIM_MAX_AUX_DEVICES][FDC_SIM_AUX_MEMORY_SIZE];
+static uint8_t sim_aux_count;
+
+// Virtual time (ns)
+static uint64_t sim_time_ns;
+
+// Bus model and statistics
+static uint32_t sim_bus_speed_hz;
+static FDC_Sim_Stats sim_stats;
+
+// Bring a device to its power-on state
+static void fdc_sim_init_device(fdc_sim_device* device);
+
+// Device answering to an address, or NULL
+static fdc_sim_device* fdc_sim_addressed(uint8_t device_address);
+
+// Memory of the other device answering to an address, or NULL
+static uint8_t* fdc_sim_aux_addressed(uint8_t device_address);
+
+// Bring the registers to their reset value
+static void fdc_sim_reset_registers(void);
+
+// Conversion time for the current RATE setting (0 if reserved)
+static uint64_t fdc_sim_conversion_time(void);
+
+// Start the next enabled conversion after the given channel
+static void fdc_sim_start_next(uint8_t last_channel);
+
+// Store the result of a channel and set its DONE bit
+static void fdc_sim_store_result(uint8_t channel);
+
+// Complete the conversion in progress
+static void fdc_sim_complete_conversion(void);
+
+// Complete all the enabled measurements with the current replay frame
+static void fdc_sim_complete_replay_frame(void);
+
+// Carry out all the conversions that end up to the given time
+static void fdc_sim_run_until(uint64_t time_ns);
+
+// Carry out the conversions of the current device up to the given time
+static void fdc_sim_run_device_until(uint64_t time_ns);
+
+// Read the capacitance at an input, noise included
+static int32_t fdc_sim_input(uint8_t input);
+
+// Compute the 24-bit result of a measurement channel
+static int32_t fdc_sim_convert(uint8_t channel);
+
+// Charge a transaction to the bus
+static void fdc_sim_charge_bus(uint8_t bytes, uint8_t conditions);
+
+// Read a 16-bit register
+static uint16_t fdc_sim_read_register(uint8_t reg_addr);
+
+// Write a 16-bit register
+static void fdc_sim_write_register(uint8_t reg_addr, uint16_t value);
+
+// ===========================================================
+//                  SIMULATOR CONFIGURATION
+// ===========================================================
+
+void FDC_Sim_Init(void)
+{
+    sim_time_ns = 0;
+    for (uint8_t i = 0; i < FDC_SIM_MAX_DEVICES; i++)
+    {
+        fdc_sim_init_device(&sim_devices[i]);
+    }
+    sim_mux_devices = 0;
+    sim_mux_control = 0;
+    sim_aux_count = 0;
+    sim_selected = 0;
+    sim_dev = &sim_devices[0];
+    sim_bus_speed_hz = FDC_SIM_BUS_400_KHZ;
+    FDC_Sim_ResetStats();
+}
+
+void FDC_Sim_AttachMux(uint8_t device_count)
+{
+    sim_mux_devices = (device_count > FDC_SIM_MAX_DEVICES) ? FDC_SIM_MAX_DEVICES : device_count;
+    sim_mux_control = 0;
+    for (uint8_t i = 0; i < FDC_SIM_MAX_DEVICES; i++)
+    {
+        fdc_sim_init_device(&sim_devices[i]);
+    }
+}
+
+void FDC_Sim_SelectDevice(uint8_t device)
+{
+    if (device < FDC_SIM_MAX_DEVICES)
+    {
+        sim_selected = device;
+    }
+}
+
+I2C_ErrorCode FDC_Sim_AttachAuxDevice(uint8_t device_address)
+{
+    if ((sim_aux_count == FDC_SIM_MAX_AUX_DEVICES) || (device_address == FDC1004Q_I2C_ADDR) ||
+        (device_address == FDC_SIM_MUX_I2C_ADDR) || (fdc_sim_aux_addressed(device_address) != NULL))
+    {
+        return I2C_ERROR;
+    }
+    for (uint16_t i = 0; i < FDC_SIM_AUX_MEMORY_SIZE; i++)
+    {
+        sim_aux_memory[sim_aux_count][i] = 0xFF;
+    }
+    sim_aux_addresses[sim_aux_count++] = device_address;
+    return I2C_NO_ERROR;
+}
+
+void FDC_Sim_SetBusSpeed(uint32_t speed_hz)
+{
+    if (speed_hz > 0)
+    {
+        sim_bus_speed_hz = speed_hz;
+    }
+}
+
+void FDC_Sim_SetCapacitance(uint8_t input, int32_t capacitance_af)
+{
+    sim_dev = &sim_devices[sim_selected];
+    if (input < FDC_SIM_INPUT_COUNT)
+    {
+        sim_dev->capacitance_af[input] = capacitance_af;
+    }
+}
+
+void FDC_Sim_SetWaveform(FDC_Sim_Waveform waveform)
+{
+    sim_dev = &sim_devices[sim_selected];
+    sim_dev->waveform = waveform;
+}
+
+void FDC_Sim_SetNoise(int32_t amplitude_af, uint32_t seed)
+{
+    sim_dev = &sim_devices[sim_selected];
+    sim_dev->noise_af = amplitude_af > 0 ? amplitude_af : 0;
+    sim_dev->noise_state = seed != 0 ? seed : 1;
+}
+
+void FDC_Sim_SetReplay(const FDC_Sim_ReplayFrame* frames, uint32_t count)
+{
+    sim_dev = &sim_devices[sim_selected];
+    sim_dev->replay_frames = frames;
+    sim_dev->replay_count = frames != NULL ? count : 0;
+    sim_dev->replay_index = 0;
+    sim_dev->replay_frame = NULL;
+    sim_dev->active_channel = FDC_SIM_NO_CHANNEL;
+    // Go back to the RATE timing when leaving replay mode
+    if (frames == NULL)
+    {
+        fdc_sim_start_next(FDC_CH_4);
+    }
+}
+
+uint32_t FDC_Sim_GetReplayPosition(void)
+{
+    sim_dev = &sim_devices[sim_selected];
+    return sim_dev->replay_index;
+}
+
+int32_t FDC_Sim_RawToCapacitance(int32_t raw, uint8_t capdac)
+{
+    return (int32_t)(((int64_t)raw * 1000000) / 524288) + capdac * FDC_SIM_CAPDAC_STEP_AF;
+}
+
+// ===========================================================
+//                      VIRTUAL TIME
+// ===========================================================
+
+void FDC_Sim_AdvanceTime(uint64_t time_ns)
+{
+    fdc_sim_run_until(sim_time_ns + time_ns);
+}
+
+uint64_t FDC_Sim_GetTime(void)
+{
+    return sim_time_ns;
+}
+
+// ===========================================================
+//                      STATISTICS
+// ===========================================================
+
+void FDC_Sim_GetStats(FDC_Sim_Stats* stats)
+{
+    *stats = sim_stats;
+}
+
+void FDC_Sim_ResetStats(void)
+{
+    sim_stats.transactions = 0;
+    sim_stats.aux_transactions = 0;
+    sim_stats.bytes = 0;
+    sim_stats.bus_time_ns = 0;
+    sim_stats.conversions = 0;
+    sim_stats.overruns = 0;
+}
+
+// ===========================================================
+//                      BUS ACCESS
+// ===========================================================
+
+I2C_ErrorCode FDC_Sim_Probe(uint8_t device_address)
+{
+    // Address byte between start and stop
+    fdc_sim_charge_bus(1, 2);
+    if (fdc_sim_aux_addressed(device_address) != NULL)
+    {
+        sim_stats.aux_transactions++;
+        return I2C_NO_ERROR;
+    }
+    if ((fdc_sim_addressed(device_address) == NULL) &&
+        ((sim_mux_devices == 0) || (device_address != FDC_SIM_MUX_I2C_ADDR)))
+    {
+        return I2C_ERROR;
+    }
+    sim_stats.transactions++;
+    return I2C_NO_ERROR;
+}
+
+I2C_ErrorCode FDC_Sim_Write(uint8_t device_address,
+                            uint8_t register_address,
+                            uint8_t count,
+                            const uint8_t* data)
+{
+    if ((sim_mux_devices > 0) && (device_address == FDC_SIM_MUX_I2C_ADDR))
+    {
+        // The first byte is the control register of the multiplexer
+        fdc_sim_charge_bus(2 + count, 2);
+        sim_stats.transactions++;
+        sim_mux_control = (count > 0) ? data[count - 1] : register_address;
+        return I2C_NO_ERROR;
+    }
+    uint8_t* memory = fdc_sim_aux_addressed(device_address);
+    if (memory != NULL)
+    {
+        // Start, address, pointer, data, stop
+        fdc_sim_charge_bus(2 + count, 2);
+        sim_stats.aux_transactions++;
+        for (uint8_t i = 0; i < count; i++)
+        {
+            memory[(uint8_t)(register_address + i)] = data[i];
+        }
+        return I2C_NO_ERROR;
+    }
+    fdc_sim_device* device = fdc_sim_addressed(device_address);
+    if (device == NULL)
+    {
+        fdc_sim_charge_bus(1, 2);
+        return I2C_ERROR;
+    }
+    // Start, address, pointer, data, stop
+    fdc_sim_charge_bus(2 + count, 2);
+    sim_stats.transactions++;
+    sim_dev = device;
+    sim_dev->pointer = register_address;
+    // Registers are latched on the LSB, incomplete writes are discarded
+    for (uint8_t i = 0; i + 1 < count; i += 2)
+    {
+        fdc_sim_write_register(sim_dev->pointer, (uint16_t)(data[i] << 8 | data[i + 1]));
+    }
+    return I2C_NO_ERROR;
+}
+
+I2C_ErrorCode FDC_Sim_Read(uint8_t device_address,
+                           uint8_t register_address,
+                           uint8_t count,
+                           uint8_t* data)
+{
+    uint8_t* memory = fdc_sim_aux_addressed(device_address);
+    if (memory != NULL)
+    {
+        // Start, address, pointer, restart, address, data, stop
+        fdc_sim_charge_bus(3 + count, 3);
+        sim_stats.aux_transactions++;
+        for (uint8_t i = 0; i < count; i++)
+        {
+            data[i] = memory[(uint8_t)(register_address + i)];
+        }
+        return I2C_NO_ERROR;
+    }
+    fdc_sim_device* device = fdc_sim_addressed(device_address);
+    if (device == NULL)
+    {
+        fdc_sim_charge_bus(1, 2);
+        return I2C_ERROR;
+    }
+    // Start, address, pointer, restart, address, data, stop
+    fdc_sim_charge_bus(3 + count, 3);
+    sim_stats.transactions++;
+    sim_dev = device;
+    sim_dev->pointer = register_address;
+    uint16_t value = fdc_sim_read_register(sim_dev->pointer);
+    for (uint8_t i = 0; i < count; i++)
+    {
+        data[i] = (i & 0x01) ? (value & 0xFF) : (value >> 8);
+    }
+    return I2C_NO_ERROR;
+}
+
+// ===================================================================
+//                         HELPER FUNCTIONS
+// ===================================================================
+
+void fdc_sim_init_device(fdc_sim_device* device)
+{
+    sim_dev = device;
+    fdc_sim_reset_registers();
+    sim_dev->pointer = 0;
+    for (uint8_t in = 0; in < FDC_SIM_INPUT_COUNT; in++)
+    {
+        sim_dev->capacitance_af[in] = 0;
+    }
+    sim_dev->waveform = NULL;
+    sim_dev->replay_frames = NULL;
+    sim_dev->replay_frame = NULL;
+    sim_dev->replay_count = 0;
+    sim_dev->replay_index = 0;
+    sim_dev->noise_af = 0;
+    sim_dev->noise_state = 1;
+}
+
+fdc_sim_device* fdc_sim_addressed(uint8_t device_address)
+{
+    if (device_address != FDC1004Q_I2C_ADDR)
+    {
+        return NULL;
+    }
+    if (sim_mux_devices == 0)
+    {
+        return &sim_devices[0];
+    }
+    // Exactly one segment holding a device must be connected
+    uint8_t segments = sim_mux_control & (uint8_t)((1 << sim_mux_devices) - 1);
+    if ((segments == 0) || ((segments & (segments - 1)) != 0))
+    {
+        return NULL;
+    }
+    uint8_t device = 0;
+    while ((segments & (1 << device)) == 0)
+    {
+        device++;
+    }
+    return &sim_devices[device];
+}
+
+uint8_t* fdc_sim_aux_addressed(uint8_t device_address)
+{
+    for (uint8_t i = 0; i < sim_aux_count; i++)
+    {
+        if (sim_aux_addresses[i] == device_address)
+        {
+            return sim_aux_memory[i];
+        }
+    }
+    return NULL;
+}
+
+void fdc_sim_reset_registers(void)
+{
+    for (uint8_t reg = 0; reg < FDC_SIM_REGISTER_COUNT; reg++)
+    {
+        sim_dev->registers[reg] = 0x0000;
+    }
+    for (uint8_t ch = FDC_CH_1; ch <= FDC_CH_4; ch++)
+    {
+        sim_dev->registers[FDC1004Q_CONF_MEAS1 + ch] = FDC_SIM_CONF_MEAS_DEFAULT | (ch << 13);
+        sim_dev->registers[FDC1004Q_GAIN_CAL_CIN1 + ch] = FDC_SIM_GAIN_CAL_DEFAULT;
+    }
+    sim_dev->active_channel = FDC_SIM_NO_CHANNEL;
+    sim_dev->conversion_end_ns = 0;
+}
+
+uint64_t fdc_sim_conversion_time(void)
+{
+    switch ((sim_dev->registers[FDC1004Q_FDC_CONF] >> 10) & 0x03)
+    {
+        case FDC_100_Hz:
+            return 10000000;
+        case FDC_200_Hz:
+            return 5000000;
+        case FDC_400_Hz:
+            return 2500000;
+        default:
+            return 0;
+    }
+}
+
+void fdc_sim_start_next(uint8_t last_channel)
+{
+    sim_dev->active_channel = FDC_SIM_NO_CHANNEL;
+    uint64_t conversion_time = fdc_sim_conversion_time();
+    uint16_t conf = sim_dev->registers[FDC1004Q_FDC_CONF];
+    if ((conversion_time == 0) || ((conf & FDC_SIM_CONF_MEAS) == 0))
+    {
+        return;
+    }
+    // Enabled measurements are carried out in round-robin order
+    for (uint8_t i = 1; i <= 4; i++)
+    {
+        uint8_t ch = (last_channel + i) & 0x03;
+        if (conf & (0x80 >> ch))
+        {
+            sim_dev->active_channel = ch;
+            sim_dev->conversion_end_ns = sim_time_ns + conversion_time;
+            return;
+        }
+    }
+}
+
+void fdc_sim_store_result(uint8_t ch)
+{
+    uint32_t code = (uint32_t)fdc_sim_convert(ch) & 0xFFFFFF;
+    sim_dev->registers[FDC1004Q_MEAS1_MSB + 2 * ch] = code >> 8;
+    sim_dev->registers[FDC1004Q_MEAS1_LSB + 2 * ch] = (code & 0xFF) << 8;
+    if (sim_dev->registers[FDC1004Q_FDC_CONF] & (0x08 >> ch))
+    {
+        sim_stats.overruns++;
+    }
+    sim_dev->registers[FDC1004Q_FDC_CONF] |= (0x08 >> ch);
+    // Single measurements clear their MEAS bit once completed
+    if ((sim_dev->registers[FDC1004Q_FDC_CONF] & FDC_SIM_CONF_REPEAT) == 0)
+    {
+        sim_dev->registers[FDC1004Q_FDC_CONF] &= ~(0x80 >> ch);
+    }
+    sim_stats.conversions++;
+}
+
+void fdc_sim_complete_conversion(void)
+{
+    uint8_t ch = sim_dev->active_channel;
+    fdc_sim_store_result(ch);
+    fdc_sim_start_next(ch);
+}
+
+void fdc_sim_complete_replay_frame(void)
+{
+    for (uint8_t ch = FDC_CH_1; ch <= FDC_CH_4; ch++)
+    {
+        if (sim_dev->registers[FDC1004Q_FDC_CONF] & (0x80 >> ch))
+        {
+            fdc_sim_store_result(ch);
+        }
+    }
+}
+
+void fdc_sim_run_until(uint64_t time_ns)
+{
+    // Devices convert independently of each other
+    uint8_t count = (sim_mux_devices > 0) ? sim_mux_devices : 1;
+    fdc_sim_device* current = sim_dev;
+    uint64_t start_ns = sim_time_ns;
+    for (uint8_t i = 0; i < count; i++)
+    {
+        sim_dev = &sim_devices[i];
+        sim_time_ns = start_ns;
+        fdc_sim_run_device_until(time_ns);
+    }
+    sim_dev = current;
+    sim_time_ns = time_ns;
+}
+
+void fdc_sim_run_device_until(uint64_t time_ns)
+{
+    if (sim_dev->replay_frames != NULL)
+    {
+        while ((sim_dev->replay_index < sim_dev->replay_count) &&
+               (sim_dev->replay_frames[sim_dev->replay_index].time_ns <= time_ns))
+        {
+            sim_dev->replay_frame = &sim_dev->replay_frames[sim_dev->replay_index];
+            sim_time_ns = sim_dev->replay_frame->time_ns;
+            fdc_sim_complete_replay_frame();
+            sim_dev->replay_index++;
+        }
+        sim_dev->replay_frame = NULL;
+        sim_time_ns = time_ns;
+        return;
+    }
+    while ((sim_dev->active_channel != FDC_SIM_NO_CHANNEL) &&
+           (sim_dev->conversion_end_ns <= time_ns))
+    {
+        sim_time_ns = sim_dev->conversion_end_ns;
+        fdc_sim_complete_conversion();
+    }
+    sim_time_ns = time_ns;
+}
+
+int32_t fdc_sim_input(uint8_t input)
+{
+    int32_t value;
+    if (sim_dev->replay_frame != NULL)
+    {
+        value = sim_dev->replay_frame->capacitance_af[input];
+    }
+    else if (sim_dev->waveform != NULL)
+    {
+        value = sim_dev->waveform(input, sim_time_ns);
+    }
+    else
+    {
+        value = sim_dev->capacitance_af[input];
+    }
+    if (sim_dev->noise_af > 0)
+    {
+        // xorshift32
+        sim_dev->noise_state ^= sim_dev->noise_state << 13;
+        sim_dev->noise_state ^= sim_dev->noise_state >> 17;
+        sim_dev->noise_state ^= sim_dev->noise_state << 5;
+        value += (int32_t)(sim_dev->noise_state % (2 * (uint32_t)sim_dev->noise_af + 1)) - sim_dev->noise_af;
+    }
+    return value;
+}
+
+int32_t fdc_sim_convert(uint8_t channel)
+{
+    uint16_t conf_meas = sim_dev->registers[FDC1004Q_CONF_MEAS1 + channel];
+    uint8_t pos = (conf_meas >> 13) & 0x07;
+    uint8_t neg = (conf_meas >> 10) & 0x07;
+    uint8_t capdac = (conf_meas >> 5) & 0x1F;
+
+    int64_t delta_af = (pos < FDC_SIM_INPUT_COUNT) ? fdc_sim_input(pos) : 0;
+    if (neg < FDC_SIM_INPUT_COUNT)
+    {
+        delta_af -= fdc_sim_input(neg);
+    }
+    else if (neg == FDC_CAPDAC)
+    {
+        delta_af -= (int64_t)capdac * FDC_SIM_CAPDAC_STEP_AF;
+    }
+    // Input clipped outside the range allowed by the CAPDAC offset
+    if (delta_af > FDC_SIM_INPUT_RANGE_AF)
+    {
+        return FDC_SIM_CODE_MAX;
+    }
+    if (delta_af < -FDC_SIM_INPUT_RANGE_AF)
+    {
+        return FDC_SIM_CODE_MIN;
+    }
+    // Offset calibration (Q5.11 pF) and gain calibration (Q2.14)
+    int16_t offset = (int16_t)sim_dev->registers[FDC1004Q_OFFSET_CAL_CIN1 + channel];
+    delta_af += ((int64_t)offset * 1000000) / 2048;
+    delta_af = (delta_af * sim_dev->registers[FDC1004Q_GAIN_CAL_CIN1 + channel]) / 16384;
+    // 2^19 LSB per pF
+    int64_t code = (delta_af * 524288) / 1000000;
+    if (code > FDC_SIM_CODE_MAX)
+    {
+        code = FDC_SIM_CODE_MAX;
+    }
+    else if (code < FDC_SIM_CODE_MIN)
+    {
+        code = FDC_SIM_CODE_MIN;
+    }
+    return (int32_t)code;
+}
+
+void fdc_sim_charge_bus(uint8_t bytes, uint8_t conditions)
+{
+    uint32_t clocks = bytes * FDC_SIM_CLOCKS_PER_BYTE + conditions * FDC_SIM_CLOCKS_PER_CONDITION;
+    uint64_t time_ns = ((uint64_t)clocks * 1000000000) / sim_bus_speed_hz;
+    sim_stats.bytes += bytes;
+    sim_stats.bus_time_ns += time_ns;
+    fdc_sim_run_until(sim_time_ns + time_ns);
+}
+
+uint16_t fdc_sim_read_register(uint8_t reg_addr)
+{
+    if (reg_addr == FDC1004Q_MANUFACTURER_ID)
+    {
+        return FDC1004Q_MANUFACTURED_ID_VALUE;
+    }
+    if (reg_addr == FDC1004Q_DEVICE_ID)
+    {
+        return FDC1004Q_DEVICE_ID_VALUE;
+    }
+    if (reg_addr >= FDC_SIM_REGISTER_COUNT)
+    {
+        return 0x0000;
+    }
+    uint16_t value = sim_dev->registers[reg_addr];
+    // Reading MEASx clears the corresponding DONE bit
+    if (reg_addr <= FDC1004Q_MEAS4_LSB)
+    {
+        sim_dev->registers[FDC1004Q_FDC_CONF] &= ~(0x08 >> (reg_addr >> 1));
+    }
+    return value;
+}
+
+void fdc_sim_write_register(uint8_t reg_addr, uint16_t value)
+{
+    // Measurement results and ID registers are read only
+    if ((reg_addr < FDC1004Q_CONF_MEAS1) || (reg_addr >= FDC_SIM_REGISTER_COUNT))
+    {
+        return;
+    }
+    if (reg_addr <= FDC1004Q_CONF_MEAS4)
+    {
+        // Reserved bits always read 0
+        value &= 0xFFE0;
+    }
+    if (reg_addr != FDC1004Q_FDC_CONF)
+    {
+        sim_dev->registers[reg_addr] = value;
+        return;
+    }
+    if (value & FDC_SIM_CONF_RESET)
+    {
+        // Reset completes immediately, RST reads back 0
+        fdc_sim_reset_registers();
+        return;
+    }
+    // Reserved bits read 0, DONE bits are read only
+    uint16_t done = sim_dev->registers[FDC1004Q_FDC_CONF] & FDC_SIM_CONF_DONE;
+    sim_dev->registers[FDC1004Q_FDC_CONF] = (value & 0x0DF0) | done;
+    // Abort the conversion in progress if its channel was disabled
+    if ((sim_dev->active_channel != FDC_SIM_NO_CHANNEL) &&
+        ((value & (0x80 >> sim_dev->active_channel)) == 0))
+    {
+        sim_dev->active_channel = FDC_SIM_NO_CHANNEL;
+    }
+    if ((sim_dev->active_channel == FDC_SIM_NO_CHANNEL) && (sim_dev->replay_frames == NULL))
+    {
+        fdc_sim_start_next(FDC_CH_4);
+    }
+}
+
+/* [] END OF FILE */
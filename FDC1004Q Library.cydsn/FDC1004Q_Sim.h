@@ -0,0 +1,318 @@
+/**
+*   \file FDC1004Q_Sim.h
+*   \brief Header file for the FDC1004Q device simulator.
+*
+*   This file contains the declarations of a deterministic register-level
+*   model of the FDC1004Q. The model is driven by a virtual clock and
+*   reproduces the conversion timing set by the RATE bits of
+*   #FDC1004Q_FDC_CONF, the sequencing of repeated measurements, the
+*   DONE bits semantics, the CAPDAC offset and the saturation of the
+*   24-bit result. The I2C bus time spent by each transaction is charged
+*   to the virtual clock according to the configured bus speed.
+*
+*   Recorded captures can be replayed through the model: in replay mode
+*   the inputs follow the recorded frames and conversions complete at the
+*   recorded times, so that the application code sees the same DONE timing
+*   it saw on the hardware while its CAPDAC choices still act on the result.
+*
+*   Several devices can be placed behind a simulated bus multiplexer
+*   (a TCA9548A-like switch, see #FDC_Sim_AttachMux), each on its own
+*   segment, so that the code driving many sensors sharing the same
+*   address can be exercised. All devices share the virtual clock and
+*   the bus, and convert independently of each other.
+*
+*   The simulator is hooked under the I2C interface: when the project is
+*   compiled with #FDC_SIMULATION defined, the I2C_Peripheral_* functions
+*   talk to this model instead of the I2C_Master component, so that the
+*   driver and the application code can run on a host machine.
+*
+*   \author Davide Marzorati
+*/
+
+#ifndef __FDC1004Q_SIM_H__
+    #define __FDC1004Q_SIM_H__
+
+    #include "I2C_Interface.h"
+
+    // =============================================
+    //               SIMULATOR SETTINGS
+    // =============================================
+
+    /**
+    *   \brief I2C standard mode bus speed (Hz).
+    */
+    #define FDC_SIM_BUS_100_KHZ 100000
+
+    /**
+    *   \brief I2C fast mode bus speed (Hz).
+    */
+    #define FDC_SIM_BUS_400_KHZ 400000
+
+    /**
+    *   \brief Number of simulated CINx inputs.
+    */
+    #define FDC_SIM_INPUT_COUNT 4
+    
+    /**
+    *   \brief Maximum number of simulated devices.
+    */
+    #define FDC_SIM_MAX_DEVICES 8
+    
+    /**
+    *   \brief I2C address of the simulated bus multiplexer.
+    */
+    #define FDC_SIM_MUX_I2C_ADDR 0x70
+    
+    /**
+    *   \brief Maximum number of other devices on the simulated bus.
+    */
+    #define FDC_SIM_MAX_AUX_DEVICES 4
+    
+    /**
+    *   \brief Memory of each of the other devices (bytes).
+    */
+    #define FDC_SIM_AUX_MEMORY_SIZE 256
+
+    /**
+    *   \brief Input range around the CAPDAC offset in aF (+/- 15 pF).
+    *
+    *   Differences between the positive and negative input larger than
+    *   this value clip, and the result saturates at the 24-bit extremes.
+    */
+    #define FDC_SIM_INPUT_RANGE_AF 15000000L
+
+    /**
+    *   \brief Capacitance waveform callback.
+    *
+    *   The callback returns the capacitance, in aF, seen at the
+    *   CINx input at the given virtual time, in ns.
+    */
+    typedef int32_t (*FDC_Sim_Waveform)(uint8_t input, uint64_t time_ns);
+
+    /**
+    *   \brief Recorded frame used in replay mode.
+    */
+    typedef struct {
+        /** Time at which the frame was completed (ns) **/
+        uint64_t time_ns;
+        /** Capacitance at the CINx inputs (aF), see #FDC_Sim_RawToCapacitance **/
+        int32_t capacitance_af[FDC_SIM_INPUT_COUNT];
+    } FDC_Sim_ReplayFrame;
+
+    /**
+    *   \brief Statistics collected by the simulator.
+    */
+    typedef struct {
+        /** Number of I2C transactions addressed to the device **/
+        uint32_t transactions;
+        /** Number of I2C transactions addressed to the other devices (see #FDC_Sim_AttachAuxDevice) **/
+        uint32_t aux_transactions;
+        /** Number of bytes transferred, address bytes included **/
+        uint32_t bytes;
+        /** Virtual time spent on the I2C bus (ns) **/
+        uint64_t bus_time_ns;
+        /** Number of completed conversions **/
+        uint32_t conversions;
+        /** Conversions completed while the previous result was still unread **/
+        uint32_t overruns;
+    } FDC_Sim_Stats;
+
+    // ===========================================================
+    //                  SIMULATOR CONFIGURATION
+    // ===========================================================
+
+    /**
+    *   \brief Initialize the simulator.
+    *
+    *   This function brings the simulated device to its power-on state,
+    *   resets the virtual clock and the statistics, sets all inputs to 0 pF,
+    *   removes any waveform and noise and sets the bus speed to
+    *   #FDC_SIM_BUS_400_KHZ.
+    */
+    void FDC_Sim_Init(void);
+    
+    /**
+    *   \brief Place several devices behind a bus multiplexer.
+    *
+    *   Device n is connected to segment n of the multiplexer, which
+    *   answers at #FDC_SIM_MUX_I2C_ADDR: the byte written to it is its
+    *   control register, with bit n connecting segment n. A device answers
+    *   when its segment is the only connected one holding a device.
+    *   All devices are brought to their power-on state, and no segment
+    *   is connected.
+    *   \param device_count the number of devices, up to #FDC_SIM_MAX_DEVICES,
+    *       or 0 to remove the multiplexer and go back to a single device
+    *       connected directly to the bus.
+    */
+    void FDC_Sim_AttachMux(uint8_t device_count);
+    
+    /**
+    *   \brief Select the device configured by the following calls.
+    *
+    *   The inputs, waveform, noise and replay set with the FDC_Sim_Set*
+    *   functions apply to the selected device, which is device 0 after
+    *   #FDC_Sim_Init.
+    *   \param device the device, from 0 to #FDC_SIM_MAX_DEVICES - 1.
+    */
+    void FDC_Sim_SelectDevice(uint8_t device);
+    
+    /**
+    *   \brief Add another device to the bus.
+    *
+    *   The device acknowledges its address and behaves as a memory with an
+    *   auto-incrementing byte pointer, like an EEPROM or the register file
+    *   of an IMU, so that the traffic of the drivers sharing the bus with
+    *   the FDC1004Q is charged to the virtual clock. #FDC_Sim_Init removes
+    *   the devices.
+    *   \param device_address the I2C address, other than the ones of the
+    *       FDC1004Q and of the multiplexer.
+    *   \return #I2C_NO_ERROR, or #I2C_ERROR if the address is taken or there
+    *       are already #FDC_SIM_MAX_AUX_DEVICES devices.
+    */
+    I2C_ErrorCode FDC_Sim_AttachAuxDevice(uint8_t device_address);
+
+    /**
+    *   \brief Set the I2C bus speed used to charge transactions to the clock.
+    *   \param speed_hz the bus speed in Hz, e.g. #FDC_SIM_BUS_100_KHZ
+    *       or #FDC_SIM_BUS_400_KHZ.
+    */
+    void FDC_Sim_SetBusSpeed(uint32_t speed_hz);
+
+    /**
+    *   \brief Set a constant capacitance on an input.
+    *
+    *   The value is used when no waveform is installed.
+    *   \param input the input, from #FDC_IN_1 to #FDC_IN_4.
+    *   \param capacitance_af the capacitance in aF.
+    */
+    void FDC_Sim_SetCapacitance(uint8_t input, int32_t capacitance_af);
+
+    /**
+    *   \brief Install a capacitance waveform.
+    *   \param waveform the callback sampled at the end of every conversion,
+    *       or NULL to go back to constant capacitances.
+    */
+    void FDC_Sim_SetWaveform(FDC_Sim_Waveform waveform);
+
+    /**
+    *   \brief Add uniform pseudo-random noise to the inputs.
+    *
+    *   The noise is generated by a seeded xorshift generator, so that
+    *   runs are reproducible.
+    *   \param amplitude_af the noise amplitude in aF (0 disables noise).
+    *   \param seed the seed of the generator (must be different from 0).
+    */
+    void FDC_Sim_SetNoise(int32_t amplitude_af, uint32_t seed);
+
+    /**
+    *   \brief Replay recorded frames.
+    *
+    *   While frames are left, the conversion timing set by the RATE bits is
+    *   suspended: at the time of each frame all the enabled measurements
+    *   complete at once, with the inputs set to the recorded values.
+    *   Once the frames are over, no more conversions complete.
+    *   \param[in] frames the recorded frames, sorted by time, or NULL to
+    *       leave replay mode. The array must stay valid during the replay.
+    *   \param count the number of frames.
+    */
+    void FDC_Sim_SetReplay(const FDC_Sim_ReplayFrame* frames, uint32_t count);
+
+    /**
+    *   \brief Number of recorded frames replayed so far.
+    *   \return the number of frames whose time has elapsed.
+    */
+    uint32_t FDC_Sim_GetReplayPosition(void);
+
+    /**
+    *   \brief Input capacitance of a recorded sample.
+    *
+    *   This function rebuilds the capacitance at the input from a sample
+    *   measured against the CAPDAC, as stored in a capture block.
+    *   \param raw the sign extended 24-bit measurement.
+    *   \param capdac the CAPDAC setting the sample was measured with.
+    *   \return the capacitance in aF.
+    */
+    int32_t FDC_Sim_RawToCapacitance(int32_t raw, uint8_t capdac);
+
+    // ===========================================================
+    //                      VIRTUAL TIME
+    // ===========================================================
+
+    /**
+    *   \brief Advance the virtual clock.
+    *
+    *   All the conversions that complete in the elapsed interval are
+    *   carried out in order.
+    *   \param time_ns the time to be elapsed, in ns.
+    */
+    void FDC_Sim_AdvanceTime(uint64_t time_ns);
+
+    /**
+    *   \brief Read the virtual clock.
+    *   \return the virtual time elapsed since #FDC_Sim_Init, in ns.
+    */
+    uint64_t FDC_Sim_GetTime(void);
+
+    // ===========================================================
+    //                      STATISTICS
+    // ===========================================================
+
+    /**
+    *   \brief Read the statistics collected by the simulator.
+    *   \param[out] stats pointer to the structure to be filled.
+    */
+    void FDC_Sim_GetStats(FDC_Sim_Stats* stats);
+
+    /**
+    *   \brief Clear the statistics collected by the simulator.
+    */
+    void FDC_Sim_ResetStats(void);
+
+    // ===========================================================
+    //                      BUS ACCESS
+    // ===========================================================
+
+    /**
+    *   \brief Address the device with a start and stop condition.
+    *   \param device_address I2C address of the device.
+    *   \retval #I2C_NO_ERROR if the address was acknowledged.
+    *   \retval #I2C_ERROR if the address was not acknowledged.
+    */
+    I2C_ErrorCode FDC_Sim_Probe(uint8_t device_address);
+
+    /**
+    *   \brief Write transaction: register pointer followed by data bytes.
+    *
+    *   The register pointer is always updated. Data bytes are latched
+    *   in pairs, MSB first; the register pointer does not auto-increment.
+    *   \param device_address I2C address of the device.
+    *   \param register_address the register pointer.
+    *   \param count number of data bytes (0 for a pointer-only write).
+    *   \param data the data bytes.
+    *   \retval #I2C_NO_ERROR if the transaction was acknowledged.
+    *   \retval #I2C_ERROR if the address was not acknowledged.
+    */
+    I2C_ErrorCode FDC_Sim_Write(uint8_t device_address,
+                                uint8_t register_address,
+                                uint8_t count,
+                                const uint8_t* data);
+
+    /**
+    *   \brief Combined transaction: pointer write, repeated start and read.
+    *
+    *   The register pointer does not auto-increment, so bytes past the
+    *   second repeat the content of the same register.
+    *   \param device_address I2C address of the device.
+    *   \param register_address the register pointer.
+    *   \param count number of bytes to be read.
+    *   \param data buffer where the bytes will be stored.
+    *   \retval #I2C_NO_ERROR if the transaction was acknowledged.
+    *   \retval #I2C_ERROR if the address was not acknowledged.
+    */
+    I2C_ErrorCode FDC_Sim_Read(uint8_t device_address,
+                               uint8_t register_address,
+                               uint8_t count,
+                               uint8_t* data);
+
+#endif
+/* [] END OF FILE */
@@ -0,0 +1,74 @@
+/**
+*   \brief Source file for the FDC1004Q register trace.
+*/
+
+#include "FDC1004Q_Trace.h"
+
+// Circular buffer of events
+static FDC_TraceEvent trace_events[FDC_TRACE_SIZE];
+
+// Number of events recorded since start
+static uint32_t trace_total;
+
+// Clock used for timestamps
+static FDC_Trace_Clock trace_clock;
+
+// Recording enabled flag
+static uint8_t trace_enabled;
+
+void FDC_Trace_Start(FDC_Trace_Clock clock)
+{
+    trace_clock = clock;
+    trace_total = 0;
+    trace_enabled = 1;
+}
+
+void FDC_Trace_Stop(void)
+{
+    trace_enabled = 0;
+}
+
+uint32_t FDC_Trace_Now(void)
+{
+    return trace_clock != NULL ? trace_clock() : trace_total;
+}
+
+void FDC_Trace_Record(uint32_t start, uint8_t op, uint8_t reg_addr, 
+                      const uint8_t* data, uint8_t error)
+{
+    if (!trace_enabled)
+    {
+        return;
+    }
+    uint32_t duration = FDC_Trace_Now() - start;
+    FDC_TraceEvent* event = &trace_events[trace_total & (FDC_TRACE_SIZE - 1)];
+    event->timestamp = start;
+    event->duration = duration > 0xFFFF ? 0xFFFF : duration;
+    event->value = data[0] << 8 | data[1];
+    event->reg = reg_addr;
+    event->op = (error == FDC_OK) ? op : (op | FDC_TRACE_ERROR);
+    event->sequence = trace_total;
+    trace_total++;
+}
+
+void FDC_Trace_Dump(FDC_Trace_Write write)
+{
+    uint8_t enabled = trace_enabled;
+    trace_enabled = 0;
+    
+    FDC_TraceHeader header;
+    header.magic = FDC_TRACE_MAGIC;
+    header.version = FDC_TRACE_VERSION;
+    header.event_count = trace_total < FDC_TRACE_SIZE ? trace_total : FDC_TRACE_SIZE;
+    header.total_events = trace_total;
+    write((const uint8_t*)&header, sizeof(header));
+    
+    // Oldest event first
+    for (uint32_t i = trace_total - header.event_count; i != trace_total; i++)
+    {
+        write((const uint8_t*)&trace_events[i & (FDC_TRACE_SIZE - 1)], sizeof(FDC_TraceEvent));
+    }
+    trace_enabled = enabled;
+}
+
+/* [] END OF FILE */
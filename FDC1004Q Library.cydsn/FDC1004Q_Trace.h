@@ -0,0 +1,157 @@
+/**
+*   \file FDC1004Q_Trace.h
+*   \brief Header file for the FDC1004Q register trace.
+*
+*   The trace keeps the last register operations carried out by the driver
+*   in a circular buffer in RAM. Each operation is stored as a compact
+*   #FDC_TraceEvent with the time it started, how long it took, the
+*   register, the 16-bit value and whether an error occurred.
+*
+*   The trace is compiled in only if #FDC_TRACE_ENABLED is defined, so
+*   that it has no cost otherwise. The buffer can be dumped at any time
+*   with #FDC_Trace_Dump: the dump starts with a #FDC_TraceHeader followed
+*   by the events from the oldest to the newest, all fields little-endian.
+*   A gap in the sequence numbers of the events means that older events
+*   were overwritten.
+*
+*   \author Davide Marzorati
+*/
+
+#ifndef __FDC1004Q_TRACE_H__
+    #define __FDC1004Q_TRACE_H__
+
+    #include "FDC1004Q.h"
+
+    /**
+    *   \brief Number of events kept in the trace, must be a power of 2.
+    */
+    #ifndef FDC_TRACE_SIZE
+        #define FDC_TRACE_SIZE 64
+    #endif
+
+    #if (FDC_TRACE_SIZE & (FDC_TRACE_SIZE - 1)) != 0
+        #error "FDC_TRACE_SIZE must be a power of 2"
+    #endif
+
+    /**
+    *   \brief Magic number at the start of a dump ("FDCT").
+    */
+    #define FDC_TRACE_MAGIC 0x54434446UL
+
+    /**
+    *   \brief Version of the dump format.
+    */
+    #define FDC_TRACE_VERSION 1
+
+    /**
+    *   \brief Register read operation.
+    */
+    #define FDC_TRACE_OP_READ  0x01
+
+    /**
+    *   \brief Register write operation.
+    */
+    #define FDC_TRACE_OP_WRITE 0x02
+
+    /**
+    *   \brief Flag set in the op field if the operation failed.
+    */
+    #define FDC_TRACE_ERROR    0x80
+
+    /**
+    *   \brief Trace event.
+    */
+    typedef struct {
+        /** Clock value when the operation started **/
+        uint32_t timestamp;
+        /** Duration of the operation in clock ticks, saturated at 0xFFFF **/
+        uint16_t duration;
+        /** Register value read or written **/
+        uint16_t value;
+        /** Register address **/
+        uint8_t reg;
+        /** #FDC_TRACE_OP_READ or #FDC_TRACE_OP_WRITE, ORed with #FDC_TRACE_ERROR **/
+        uint8_t op;
+        /** Lower 16 bits of the event number **/
+        uint16_t sequence;
+    } FDC_TraceEvent;
+
+    /**
+    *   \brief Header of a trace dump.
+    */
+    typedef struct {
+        /** Magic number, #FDC_TRACE_MAGIC **/
+        uint32_t magic;
+        /** Dump format version, #FDC_TRACE_VERSION **/
+        uint16_t version;
+        /** Number of events following the header **/
+        uint16_t event_count;
+        /** Number of events recorded since the trace was started **/
+        uint32_t total_events;
+    } FDC_TraceHeader;
+
+    /**
+    *   \brief Clock used to timestamp the events.
+    */
+    typedef uint32_t (*FDC_Trace_Clock)(void);
+
+    /**
+    *   \brief Callback used to output the dump.
+    */
+    typedef void (*FDC_Trace_Write)(const uint8_t* data, uint16_t length);
+
+    /**
+    *   \brief Clear the trace and start recording.
+    *   \param clock the clock used to timestamp events, e.g. a cycle counter.
+    *       If NULL, events are timestamped with their event number.
+    */
+    void FDC_Trace_Start(FDC_Trace_Clock clock);
+
+    /**
+    *   \brief Stop recording, keeping the events in the buffer.
+    */
+    void FDC_Trace_Stop(void);
+
+    /**
+    *   \brief Read the trace clock.
+    *   \return the current clock value.
+    */
+    uint32_t FDC_Trace_Now(void);
+
+    /**
+    *   \brief Record a register operation.
+    *   \param start the clock value when the operation started.
+    *   \param op #FDC_TRACE_OP_READ or #FDC_TRACE_OP_WRITE.
+    *   \param reg_addr the register address.
+    *   \param[in] data the two bytes of the register, MSB first.
+    *   \param error the error code of the operation.
+    */
+    void FDC_Trace_Record(uint32_t start, uint8_t op, uint8_t reg_addr, 
+                          const uint8_t* data, uint8_t error);
+
+    /**
+    *   \brief Dump the trace.
+    *
+    *   Recording is suspended during the dump.
+    *   \param write the callback used to output the dump.
+    */
+    void FDC_Trace_Dump(FDC_Trace_Write write);
+
+    #ifdef FDC_TRACE_ENABLED
+        /**
+        *   \brief Mark the start of a traced operation.
+        */
+        #define FDC_TRACE_BEGIN() uint32_t fdc_trace_start = FDC_Trace_Now()
+        
+        /**
+        *   \brief Record the end of a traced operation.
+        */
+        #define FDC_TRACE_END(op, reg_addr, data, error) \
+            FDC_Trace_Record(fdc_trace_start, (op), (reg_addr), (data), (error))
+    #else
+        #define FDC_TRACE_BEGIN()
+        #define FDC_TRACE_END(op, reg_addr, data, error)
+    #endif
+
+#endif
+/* [] END OF FILE */
@@ -0,0 +1,31 @@
+/**
+*   \brief Source file for the integer math shared by the processing stages.
+*/
+
+#include "Fixed.h"
+
+uint32_t Fixed_Sqrt(uint64_t value)
+{
+    uint64_t result = 0;
+    uint64_t bit = (uint64_t)1 << 62;
+    while (bit > value)
+    {
+        bit >>= 2;
+    }
+    while (bit != 0)
+    {
+        if (value >= result + bit)
+        {
+            value -= result + bit;
+            result = (result >> 1) + bit;
+        }
+        else
+        {
+            result >>= 1;
+        }
+        bit >>= 2;
+    }
+    return (uint32_t)result;
+}
+
+/* [] END OF FILE */
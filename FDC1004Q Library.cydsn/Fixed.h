@@ -0,0 +1,31 @@
+/**
+*   \file Fixed.h
+*   \brief Integer math shared by the processing stages.
+*
+*   This file contains the fixed-point helpers used by more than one
+*   processing stage, so that each of them is linked once.
+*
+*   \author Davide Marzorati
+*/
+
+#ifndef __FIXED_H__
+    #define __FIXED_H__
+
+    #if defined(FDC_SIMULATION) || defined(I2C_INTERFACE_LINUX)
+        #include <stdint.h>
+    #else
+        #include "cytypes.h"
+    #endif
+
+    /**
+    *   \brief Integer square root.
+    *
+    *   The bitwise method is used, one result bit per iteration, with
+    *   no multiplication and no division.
+    *   \param value the value.
+    *   \return the square root, rounded down.
+    */
+    uint32_t Fixed_Sqrt(uint64_t value);
+
+#endif
+/* [] END OF FILE */
@@ -0,0 +1,101 @@
+/**
+*   \brief Source file for the integer text formatting.
+*/
+
+#include "Format.h"
+
+// Write the digits of an unsigned value in the given base
+static char* format_unsigned(char* out, uint32_t value, uint8_t base,
+                             uint8_t width, char pad);
+
+char* Format_String(char* out, const char* s)
+{
+    while (*s != '\0')
+    {
+        *out++ = *s++;
+    }
+    *out = '\0';
+    return out;
+}
+
+char* Format_Hex(char* out, uint32_t value, uint8_t digits)
+{
+    return format_unsigned(out, value, 16, digits, '0');
+}
+
+char* Format_Decimal(char* out, int32_t value, uint8_t width)
+{
+    return Format_Fixed(out, value, 0, width, 0);
+}
+
+char* Format_Fixed(char* out, int32_t value, uint8_t fract_bits,
+                   uint8_t width, uint8_t decimals)
+{
+    uint32_t magnitude = value < 0 ? -(uint32_t)value : (uint32_t)value;
+    uint32_t integer = magnitude >> fract_bits;
+    uint32_t fraction = magnitude & ((1UL << fract_bits) - 1);
+    uint32_t scale = 1;
+    for (uint8_t i = 0; i < decimals; i++)
+    {
+        scale *= 10;
+    }
+    // Shift instead of dividing, so that the result is truncated
+    fraction = (uint32_t)(((uint64_t)fraction * scale) >> fract_bits);
+    
+    if (value < 0)
+    {
+        // Pad before the sign, as printf does
+        uint8_t length = 1;
+        for (uint32_t rest = integer / 10; rest > 0; rest /= 10)
+        {
+            length++;
+        }
+        while (width > length + 1)
+        {
+            *out++ = ' ';
+            width--;
+        }
+        *out++ = '-';
+        out = format_unsigned(out, integer, 10, 0, ' ');
+    }
+    else
+    {
+        out = format_unsigned(out, integer, 10, width, ' ');
+    }
+    if (decimals > 0)
+    {
+        *out++ = '.';
+        out = format_unsigned(out, fraction, 10, decimals, '0');
+    }
+    return out;
+}
+
+// ===================================================================
+//                         HELPER FUNCTIONS
+// ===================================================================
+
+char* format_unsigned(char* out, uint32_t value, uint8_t base,
+                      uint8_t width, char pad)
+{
+    static const char digits[] = "0123456789ABCDEF";
+    char buffer[10];
+    uint8_t length = 0;
+    do
+    {
+        buffer[length++] = digits[value % base];
+        value /= base;
+    } while (value > 0);
+    while (width > length)
+    {
+        *out++ = pad;
+        width--;
+    }
+    while (length > 0)
+    {
+        *out++ = buffer[--length];
+    }
+    *out = '\0';
+    return out;
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,68 @@
+/**
+*   \file Format.h
+*   \brief Integer text formatting.
+*
+*   This file contains a small replacement for sprintf, used to print
+*   diagnostic messages without linking the C library formatter and the
+*   soft-float support it pulls in. Each function writes its field at the
+*   given position, terminates the string and returns the position of the
+*   terminator, so that the calls can be chained to build a message.
+*
+*   \author Davide Marzorati
+*/
+
+#ifndef __FORMAT_H__
+    #define __FORMAT_H__
+
+    #if defined(FDC_SIMULATION) || defined(I2C_INTERFACE_LINUX)
+        #include <stdint.h>
+    #else
+        #include "cytypes.h"
+    #endif
+
+    /**
+    *   \brief Copy a string.
+    *   \param[out] out where the string will be written.
+    *   \param[in] s the string to be copied.
+    *   \return the position of the terminator.
+    */
+    char* Format_String(char* out, const char* s);
+
+    /**
+    *   \brief Write an unsigned value in hexadecimal format.
+    *
+    *   Same as the "%0*X" conversion of printf.
+    *   \param[out] out where the value will be written.
+    *   \param value the value.
+    *   \param digits the minimum number of digits, padded with zeros.
+    *   \return the position of the terminator.
+    */
+    char* Format_Hex(char* out, uint32_t value, uint8_t digits);
+
+    /**
+    *   \brief Write a signed value in decimal format.
+    *
+    *   Same as the "%*d" conversion of printf.
+    *   \param[out] out where the value will be written.
+    *   \param value the value.
+    *   \param width the minimum field width, padded with spaces.
+    *   \return the position of the terminator.
+    */
+    char* Format_Decimal(char* out, int32_t value, uint8_t width);
+
+    /**
+    *   \brief Write a signed fixed point value in decimal format.
+    *
+    *   The value is truncated toward zero to the given number of decimals.
+    *   \param[out] out where the value will be written.
+    *   \param value the value.
+    *   \param fract_bits the number of fractional bits of the value.
+    *   \param width the minimum width of the integer part, padded with spaces.
+    *   \param decimals the number of decimals, up to 6.
+    *   \return the position of the terminator.
+    */
+    char* Format_Fixed(char* out, int32_t value, uint8_t fract_bits,
+                       uint8_t width, uint8_t decimals);
+
+#endif
+/* [] END OF FILE */
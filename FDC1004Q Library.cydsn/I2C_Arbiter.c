@@ -0,0 +1,194 @@
+/*
+* This file includes the source code of the I2C bus arbiter.
+*/
+
+#include "I2C_Arbiter.h"
+
+#include <stddef.h>
+
+// Pending transactions, in submission order
+static I2C_Transaction* arbiter_queue[I2C_ARBITER_QUEUE_SIZE];
+static uint8_t arbiter_count;
+
+// Deadline clock
+static I2C_Arbiter_Clock arbiter_clock;
+
+// Bus segment selection, and segment selected last
+static I2C_Arbiter_BusSelect arbiter_bus_select;
+static uint8_t arbiter_bus = I2C_ARBITER_BUS_UNKNOWN;
+
+// Statistics
+static I2C_ArbiterStats arbiter_stats;
+
+// Check if transaction a must run before transaction b
+static uint8_t arbiter_precedes(const I2C_Transaction* a, const I2C_Transaction* b);
+
+    void I2C_Arbiter_Init(I2C_Arbiter_Clock clock)
+    {
+        arbiter_clock = clock;
+        arbiter_count = 0;
+        for (uint8_t level = 0; level < I2C_ARBITER_PRIORITY_LEVELS; level++)
+        {
+            arbiter_stats.completed[level] = 0;
+            arbiter_stats.deadline_misses[level] = 0;
+        }
+        arbiter_stats.errors = 0;
+        arbiter_stats.rejected = 0;
+        arbiter_stats.bus_switches = 0;
+        arbiter_stats.max_queue_depth = 0;
+        arbiter_bus_select = NULL;
+        arbiter_bus = I2C_ARBITER_BUS_UNKNOWN;
+    }
+    
+    void I2C_Arbiter_SetBusSelect(I2C_Arbiter_BusSelect select)
+    {
+        arbiter_bus_select = select;
+        arbiter_bus = I2C_ARBITER_BUS_UNKNOWN;
+    }
+    
+    I2C_ErrorCode I2C_Arbiter_Submit(I2C_Transaction* transaction)
+    {
+        I2C_INTERFACE_LOCK();
+        if (arbiter_count == I2C_ARBITER_QUEUE_SIZE)
+        {
+            arbiter_stats.rejected++;
+            I2C_INTERFACE_UNLOCK();
+            return I2C_ERROR;
+        }
+        if (transaction->priority >= I2C_ARBITER_PRIORITY_LEVELS)
+        {
+            transaction->priority = I2C_ARBITER_PRIORITY_LEVELS - 1;
+        }
+        transaction->status = I2C_ARBITER_PENDING;
+        arbiter_queue[arbiter_count++] = transaction;
+        if (arbiter_count > arbiter_stats.max_queue_depth)
+        {
+            arbiter_stats.max_queue_depth = arbiter_count;
+        }
+        I2C_INTERFACE_UNLOCK();
+        return I2C_NO_ERROR;
+    }
+    
+    uint8_t I2C_Arbiter_Process(void)
+    {
+        // Pick the next transaction and remove it from the queue
+        I2C_INTERFACE_LOCK();
+        if (arbiter_count == 0)
+        {
+            I2C_INTERFACE_UNLOCK();
+            return 0;
+        }
+        uint8_t next = 0;
+        for (uint8_t i = 1; i < arbiter_count; i++)
+        {
+            if (arbiter_precedes(arbiter_queue[i], arbiter_queue[next]))
+            {
+                next = i;
+            }
+        }
+        I2C_Transaction* transaction = arbiter_queue[next];
+        // Keep submission order among the remaining transactions
+        for (uint8_t i = next; i + 1 < arbiter_count; i++)
+        {
+            arbiter_queue[i] = arbiter_queue[i + 1];
+        }
+        arbiter_count--;
+        I2C_INTERFACE_UNLOCK();
+        
+        // Select its bus segment
+        I2C_ErrorCode error = I2C_NO_ERROR;
+        if ((arbiter_bus_select != NULL) && (transaction->bus != arbiter_bus))
+        {
+            error = arbiter_bus_select(transaction->bus);
+            arbiter_bus = (error == I2C_NO_ERROR) ? transaction->bus : I2C_ARBITER_BUS_UNKNOWN;
+            arbiter_stats.bus_switches++;
+        }
+        
+        // Run it
+        if (error == I2C_NO_ERROR)
+        {
+            if (transaction->op == I2C_ARBITER_READ)
+            {
+                error = I2C_Peripheral_ReadRegisterMulti(transaction->device_address,
+                                                        transaction->register_address,
+                                                        transaction->register_count,
+                                                        transaction->data);
+            }
+            else
+            {
+                error = I2C_Peripheral_WriteRegisterMulti(transaction->device_address,
+                                                        transaction->register_address,
+                                                        transaction->register_count,
+                                                        transaction->data);
+            }
+        }
+        
+        // Account for it
+        arbiter_stats.completed[transaction->priority]++;
+        if (error != I2C_NO_ERROR)
+        {
+            arbiter_stats.errors++;
+        }
+        if ((arbiter_clock != NULL) && transaction->has_deadline)
+        {
+            if ((int32_t)(arbiter_clock() - transaction->deadline) > 0)
+            {
+                arbiter_stats.deadline_misses[transaction->priority]++;
+            }
+        }
+        transaction->status = (error == I2C_NO_ERROR) ? I2C_ARBITER_DONE : I2C_ARBITER_FAILED;
+        if (transaction->callback != NULL)
+        {
+            transaction->callback(transaction);
+        }
+        return 1;
+    }
+    
+    I2C_ErrorCode I2C_Arbiter_Transfer(I2C_Transaction* transaction)
+    {
+        I2C_ErrorCode error = I2C_Arbiter_Submit(transaction);
+        if (error != I2C_NO_ERROR)
+        {
+            return error;
+        }
+        while (transaction->status == I2C_ARBITER_PENDING)
+        {
+            I2C_Arbiter_Process();
+        }
+        return (transaction->status == I2C_ARBITER_DONE) ? I2C_NO_ERROR : I2C_ERROR;
+    }
+    
+    uint8_t I2C_Arbiter_Pending(void)
+    {
+        return arbiter_count;
+    }
+    
+    void I2C_Arbiter_GetStats(I2C_ArbiterStats* stats)
+    {
+        *stats = arbiter_stats;
+    }
+
+    uint8_t arbiter_precedes(const I2C_Transaction* a, const I2C_Transaction* b)
+    {
+        if (a->priority != b->priority)
+        {
+            return a->priority < b->priority;
+        }
+        // Earliest deadline first, transactions without deadline last,
+        // starting from those on the bus segment already selected
+        if (!a->has_deadline && !b->has_deadline)
+        {
+            return (a->bus == arbiter_bus) && (b->bus != arbiter_bus);
+        }
+        if (!a->has_deadline)
+        {
+            return 0;
+        }
+        if (!b->has_deadline)
+        {
+            return 1;
+        }
+        return (int32_t)(a->deadline - b->deadline) < 0;
+    }
+
+/* [] END OF FILE */
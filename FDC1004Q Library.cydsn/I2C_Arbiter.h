@@ -0,0 +1,214 @@
+/** 
+ * \file I2C_Arbiter.h
+ * \brief Priority-aware arbiter for a shared I2C bus.
+ *
+ * The arbiter lets several drivers share the I2C peripheral without
+ * holding the bus for long sequences of operations. Clients submit
+ * transactions to a queue, and #I2C_Arbiter_Process runs them one at a
+ * time using the I2C interface. After each transaction the next one is
+ * chosen by priority and, among transactions with the same priority,
+ * by earliest deadline, so that time-critical reads (e.g. the FDC1004Q
+ * measurement registers) overtake bulk traffic (e.g. EEPROM writes)
+ * at transaction boundaries. Long transfers should be split in several
+ * transactions by their clients for this to be effective. The blocking
+ * API of the FDC1004Q driver is routed through the arbiter with
+ * #FDC_SetBusPriority, the asynchronous one always goes through it.
+ *
+ * Devices sharing the same address (e.g. several FDC1004Q) can be placed
+ * on separate segments of a bus multiplexer. Each transaction then names
+ * its segment, and the arbiter switches segment through the function set
+ * with #I2C_Arbiter_SetBusSelect only when needed, preferring, among
+ * transactions without deadline, those on the segment already selected.
+ *
+ * \author Davide Marzorati
+*/
+
+#ifndef I2C_Arbiter_H
+    #define I2C_Arbiter_H
+    
+    #include "I2C_Interface.h"
+    
+    /**
+    *   \brief Maximum number of pending transactions.
+    */
+    #ifndef I2C_ARBITER_QUEUE_SIZE
+        #define I2C_ARBITER_QUEUE_SIZE 16
+    #endif
+    
+    /**
+    *   \brief Highest priority, for time-critical sensor reads.
+    */
+    #define I2C_ARBITER_PRIORITY_HIGH   0
+    
+    /**
+    *   \brief Priority for ordinary traffic.
+    */
+    #define I2C_ARBITER_PRIORITY_NORMAL 1
+    
+    /**
+    *   \brief Lowest priority, for bulk transfers.
+    */
+    #define I2C_ARBITER_PRIORITY_BULK   2
+    
+    /**
+    *   \brief Number of priority levels.
+    */
+    #define I2C_ARBITER_PRIORITY_LEVELS 3
+    
+    /**
+    *   \brief Bus segment value meaning that no segment is known to be selected.
+    */
+    #define I2C_ARBITER_BUS_UNKNOWN 0xFF
+    
+    /**
+    *   \typedef I2C_ArbiterOp
+    *   \brief Operations carried out by a transaction.
+    */
+    typedef enum {
+        /** Register read, see #I2C_Peripheral_ReadRegisterMulti **/
+        I2C_ARBITER_READ,
+        /** Register write, see #I2C_Peripheral_WriteRegisterMulti **/
+        I2C_ARBITER_WRITE
+    } I2C_ArbiterOp;
+    
+    /**
+    *   \typedef I2C_ArbiterStatus
+    *   \brief Status of a transaction.
+    */
+    typedef enum {
+        /** Transaction waiting in the queue **/
+        I2C_ARBITER_PENDING,
+        /** Transaction completed without errors **/
+        I2C_ARBITER_DONE,
+        /** Transaction completed with an error **/
+        I2C_ARBITER_FAILED
+    } I2C_ArbiterStatus;
+    
+    typedef struct I2C_Transaction I2C_Transaction;
+    
+    /**
+    *   \brief Callback invoked when a transaction completes.
+    */
+    typedef void (*I2C_Arbiter_Callback)(I2C_Transaction* transaction);
+    
+    /**
+    *   \brief Transaction descriptor.
+    *
+    *   The descriptor is owned by the client and must stay valid until
+    *   the transaction completes.
+    */
+    struct I2C_Transaction {
+        /** I2C address of the device **/
+        uint8_t device_address;
+        /** Address of the first register **/
+        uint8_t register_address;
+        /** Number of bytes to be read or written **/
+        uint8_t register_count;
+        /** Operation, see #I2C_ArbiterOp **/
+        uint8_t op;
+        /** Priority, from #I2C_ARBITER_PRIORITY_HIGH to #I2C_ARBITER_PRIORITY_BULK **/
+        uint8_t priority;
+        /** Status, see #I2C_ArbiterStatus **/
+        volatile uint8_t status;
+        /** Data buffer **/
+        uint8_t* data;
+        /** Arbiter clock value by which the transaction must complete, if #has_deadline is set **/
+        uint32_t deadline;
+        /** Nonzero if the transaction has a deadline; any clock value, 0 included, is a valid deadline **/
+        uint8_t has_deadline;
+        /** Completion callback, may be NULL **/
+        I2C_Arbiter_Callback callback;
+        /** Context pointer for the client **/
+        void* context;
+        /** Bus segment of the device, 0 when the bus has a single segment **/
+        uint8_t bus;
+    };
+    
+    /**
+    *   \brief Statistics collected by the arbiter.
+    */
+    typedef struct {
+        /** Transactions completed, per priority level **/
+        uint32_t completed[I2C_ARBITER_PRIORITY_LEVELS];
+        /** Transactions completed after their deadline, per priority level **/
+        uint32_t deadline_misses[I2C_ARBITER_PRIORITY_LEVELS];
+        /** Transactions completed with an error **/
+        uint32_t errors;
+        /** Transactions rejected because the queue was full **/
+        uint32_t rejected;
+        /** Bus segment switches carried out **/
+        uint32_t bus_switches;
+        /** Maximum number of pending transactions observed **/
+        uint8_t max_queue_depth;
+    } I2C_ArbiterStats;
+    
+    /**
+    *   \brief Clock used for deadlines.
+    */
+    typedef uint32_t (*I2C_Arbiter_Clock)(void);
+    
+    /**
+    *   \brief Function selecting a bus segment.
+    *
+    *   It returns #I2C_NO_ERROR once the segment is connected to the bus.
+    */
+    typedef I2C_ErrorCode (*I2C_Arbiter_BusSelect)(uint8_t bus);
+    
+    /**
+    *   \brief Initialize the arbiter.
+    *
+    *   This function empties the queue and clears the statistics.
+    *   \param clock the clock used to check deadlines, or NULL if
+    *       deadlines are not used.
+    */
+    void I2C_Arbiter_Init(I2C_Arbiter_Clock clock);
+    
+    /**
+    *   \brief Set the function used to switch bus segment.
+    *
+    *   The function is called before running a transaction whose segment
+    *   is not the one selected last. If it fails, the transaction fails
+    *   and the segment is selected again for the next one.
+    *   \param select the function, or NULL if the bus has a single segment.
+    */
+    void I2C_Arbiter_SetBusSelect(I2C_Arbiter_BusSelect select);
+    
+    /**
+    *   \brief Submit a transaction.
+    *   \param transaction the transaction to be queued.
+    *   \return #I2C_NO_ERROR if queued, #I2C_ERROR if the queue is full.
+    */
+    I2C_ErrorCode I2C_Arbiter_Submit(I2C_Transaction* transaction);
+    
+    /**
+    *   \brief Run the next transaction.
+    *
+    *   This function runs the pending transaction with the highest priority
+    *   and earliest deadline, then invokes its callback.
+    *   \return 1 if a transaction was run, 0 if the queue was empty.
+    */
+    uint8_t I2C_Arbiter_Process(void);
+    
+    /**
+    *   \brief Run transactions until the given one completes.
+    *
+    *   Pending transactions that take precedence are run first.
+    *   \param transaction the transaction to be submitted and waited for.
+    *   \return #I2C_NO_ERROR if the transaction completed without errors.
+    */
+    I2C_ErrorCode I2C_Arbiter_Transfer(I2C_Transaction* transaction);
+    
+    /**
+    *   \brief Number of pending transactions.
+    *   \return the number of transactions in the queue.
+    */
+    uint8_t I2C_Arbiter_Pending(void);
+    
+    /**
+    *   \brief Read the statistics collected by the arbiter.
+    *   \param[out] stats pointer to the structure to be filled.
+    */
+    void I2C_Arbiter_GetStats(I2C_ArbiterStats* stats);
+    
+#endif // I2C_Arbiter_H
+/* [] END OF FILE */
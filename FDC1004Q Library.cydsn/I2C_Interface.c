@@ -18,8 +18,263 @@
 #endif
 
 #include "I2C_Interface.h" 
+
+#if defined(I2C_INTERFACE_LINUX)
+
+#include <stddef.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <linux/i2c.h>
+#include <linux/i2c-dev.h>
+
+// Path of the adapter
+static const char* i2c_linux_device = I2C_LINUX_DEFAULT_DEVICE;
+
+// File descriptor of the adapter, -1 when closed
+static int i2c_linux_fd = -1;
+
+// Issue an ioctl request through ioctl(2)
+static int i2c_linux_sys_ioctl(int fd, unsigned long request, void* arg);
+
+// Function used to issue ioctl requests
+static I2C_Linux_Ioctl i2c_linux_ioctl = i2c_linux_sys_ioctl;
+
+// Issue a combined transaction
+static I2C_ErrorCode i2c_linux_transfer(struct i2c_msg* messages, uint8_t count);
+
+    void I2C_Linux_SetDevice(const char* path)
+    {
+        i2c_linux_device = path;
+    }
+    
+    void I2C_Linux_SetIoctl(I2C_Linux_Ioctl function)
+    {
+        i2c_linux_ioctl = (function != NULL) ? function : i2c_linux_sys_ioctl;
+    }
+
+    I2C_ErrorCode I2C_Peripheral_Start(void) 
+    {
+        if (i2c_linux_fd < 0)
+        {
+            i2c_linux_fd = open(i2c_linux_device, O_RDWR);
+        }
+        return (i2c_linux_fd < 0) ? I2C_ERROR : I2C_NO_ERROR;
+    }
+    
+    I2C_ErrorCode I2C_Peripheral_Stop(void)
+    {
+        if (i2c_linux_fd >= 0)
+        {
+            close(i2c_linux_fd);
+            i2c_linux_fd = -1;
+        }
+        return I2C_NO_ERROR;
+    }
+
+    I2C_ErrorCode I2C_Peripheral_ReadRegister(uint8_t device_address, 
+                                            uint8_t register_address,
+                                            uint8_t* data)
+    {
+        return I2C_Peripheral_ReadRegisterMulti(device_address, register_address, 1, data);
+    }
+    
+    I2C_ErrorCode I2C_Peripheral_ReadRegisterMulti(uint8_t device_address,
+                                                uint8_t register_address,
+                                                uint8_t register_count,
+                                                uint8_t* data)
+    {
+        I2C_RegisterRead read = { register_address, register_count, data };
+        return I2C_Peripheral_ReadRegisterBatch(device_address, &read, 1);
+    }
+    
+    I2C_ErrorCode I2C_Peripheral_ReadRegisterBatch(uint8_t device_address,
+                                                const I2C_RegisterRead* reads,
+                                                uint8_t count)
+    {
+        struct i2c_msg messages[2 * I2C_BATCH_MAX_READS];
+        uint8_t pointers[I2C_BATCH_MAX_READS];
+        if (count > I2C_BATCH_MAX_READS)
+        {
+            return I2C_ERROR;
+        }
+        // Pointer write and read of each register, separated by repeated starts
+        for (uint8_t i = 0; i < count; i++)
+        {
+            pointers[i] = reads[i].register_address;
+            messages[2*i].addr = device_address;
+            messages[2*i].flags = 0;
+            messages[2*i].len = 1;
+            messages[2*i].buf = &pointers[i];
+            messages[2*i+1].addr = device_address;
+            messages[2*i+1].flags = I2C_M_RD;
+            messages[2*i+1].len = reads[i].register_count;
+            messages[2*i+1].buf = reads[i].data;
+        }
+        I2C_INTERFACE_LOCK();
+        I2C_ErrorCode error = i2c_linux_transfer(messages, 2 * count);
+        I2C_INTERFACE_UNLOCK();
+        return error;
+    }
+    
+    I2C_ErrorCode I2C_Peripheral_WriteRegister(uint8_t device_address,
+                                            uint8_t register_address,
+                                            uint8_t data)
+    {
+        return I2C_Peripheral_WriteRegisterMulti(device_address, register_address, 1, &data);
+    }
+    
+    I2C_ErrorCode I2C_Peripheral_WriteRegisterNoData(uint8_t device_address,
+                                            uint8_t register_address)
+    {
+        return I2C_Peripheral_WriteRegisterMulti(device_address, register_address, 0, NULL);
+    }
+    
+    I2C_ErrorCode I2C_Peripheral_WriteRegisterMulti(uint8_t device_address,
+                                            uint8_t register_address,
+                                            uint8_t register_count,
+                                            uint8_t* data)
+    {
+        // Register pointer followed by the data, in a single message
+        uint8_t buffer[1 + 255];
+        buffer[0] = register_address;
+        for (uint16_t i = 0; i < register_count; i++)
+        {
+            buffer[1 + i] = data[i];
+        }
+        struct i2c_msg message = { device_address, 0, 1 + register_count, buffer };
+        I2C_INTERFACE_LOCK();
+        I2C_ErrorCode error = i2c_linux_transfer(&message, 1);
+        I2C_INTERFACE_UNLOCK();
+        return error;
+    }
+    
+    I2C_ErrorCode I2C_Peripheral_IsDeviceConnected(uint8_t device_address, I2C_Connection* connection)
+    {
+        // Address the device with a zero-length write
+        struct i2c_msg message = { device_address, 0, 0, NULL };
+        I2C_INTERFACE_LOCK();
+        I2C_ErrorCode error = i2c_linux_transfer(&message, 1);
+        I2C_INTERFACE_UNLOCK();
+        *connection = (error == I2C_NO_ERROR) ? I2C_DEV_CONNECTED : I2C_DEV_UNCONNECTED;
+        return error;
+    }
+    
+    int i2c_linux_sys_ioctl(int fd, unsigned long request, void* arg)
+    {
+        return ioctl(fd, request, arg);
+    }
+    
+    I2C_ErrorCode i2c_linux_transfer(struct i2c_msg* messages, uint8_t count)
+    {
+        struct i2c_rdwr_ioctl_data transfer = { messages, count };
+        if (i2c_linux_fd < 0)
+        {
+            return I2C_ERROR;
+        }
+        return (i2c_linux_ioctl(i2c_linux_fd, I2C_RDWR, &transfer) < 0) ? I2C_ERROR : I2C_NO_ERROR;
+    }
+
+#elif defined(FDC_SIMULATION)
+
+#include "FDC1004Q_Sim.h"
+
+    I2C_ErrorCode I2C_Peripheral_Start(void) 
+    {
+        // The simulator is initialized by the host application
+        return I2C_NO_ERROR;
+    }
+    
+    I2C_ErrorCode I2C_Peripheral_Stop(void)
+    {
+        return I2C_NO_ERROR;
+    }
+
+    I2C_ErrorCode I2C_Peripheral_ReadRegister(uint8_t device_address, 
+                                            uint8_t register_address,
+                                            uint8_t* data)
+    {
+        I2C_INTERFACE_LOCK();
+        I2C_ErrorCode error = FDC_Sim_Read(device_address, register_address, 1, data);
+        I2C_INTERFACE_UNLOCK();
+        return error;
+    }
+    
+    I2C_ErrorCode I2C_Peripheral_ReadRegisterMulti(uint8_t device_address,
+                                                uint8_t register_address,
+                                                uint8_t register_count,
+                                                uint8_t* data)
+    {
+        I2C_INTERFACE_LOCK();
+        I2C_ErrorCode error = FDC_Sim_Read(device_address, register_address, register_count, data);
+        I2C_INTERFACE_UNLOCK();
+        return error;
+    }
+    
+    I2C_ErrorCode I2C_Peripheral_WriteRegister(uint8_t device_address,
+                                            uint8_t register_address,
+                                            uint8_t data)
+    {
+        I2C_INTERFACE_LOCK();
+        I2C_ErrorCode error = FDC_Sim_Write(device_address, register_address, 1, &data);
+        I2C_INTERFACE_UNLOCK();
+        return error;
+    }
+    
+    I2C_ErrorCode I2C_Peripheral_WriteRegisterNoData(uint8_t device_address,
+                                            uint8_t register_address)
+    {
+        I2C_INTERFACE_LOCK();
+        I2C_ErrorCode error = FDC_Sim_Write(device_address, register_address, 0, 0);
+        I2C_INTERFACE_UNLOCK();
+        return error;
+    }
+    
+    I2C_ErrorCode I2C_Peripheral_WriteRegisterMulti(uint8_t device_address,
+                                            uint8_t register_address,
+                                            uint8_t register_count,
+                                            uint8_t* data)
+    {
+        I2C_INTERFACE_LOCK();
+        I2C_ErrorCode error = FDC_Sim_Write(device_address, register_address, register_count, data);
+        I2C_INTERFACE_UNLOCK();
+        return error;
+    }
+    
+    I2C_ErrorCode I2C_Peripheral_IsDeviceConnected(uint8_t device_address, I2C_Connection* connection)
+    {
+        I2C_INTERFACE_LOCK();
+        I2C_ErrorCode error = FDC_Sim_Probe(device_address);
+        I2C_INTERFACE_UNLOCK();
+        *connection = (error == I2C_NO_ERROR) ? I2C_DEV_CONNECTED : I2C_DEV_UNCONNECTED;
+        return error;
+    }
+    
+    I2C_ErrorCode I2C_Peripheral_ReadRegisterBatch(uint8_t device_address,
+                                                const I2C_RegisterRead* reads,
+                                                uint8_t count)
+    {
+        I2C_ErrorCode error = I2C_NO_ERROR;
+        I2C_INTERFACE_LOCK();
+        for (uint8_t i = 0; (i < count) && (error == I2C_NO_ERROR); i++)
+        {
+            error = FDC_Sim_Read(device_address, reads[i].register_address,
+                                    reads[i].register_count, reads[i].data);
+        }
+        I2C_INTERFACE_UNLOCK();
+        return error;
+    }
+
+#else
+
 #include "I2C_Master.h"
 
+// Read multiple bytes, without taking the bus lock
+static I2C_ErrorCode i2c_master_read(uint8_t device_address,
+                                     uint8_t register_address,
+                                     uint8_t register_count,
+                                     uint8_t* data);
+
     I2C_ErrorCode I2C_Peripheral_Start(void) 
     {
         // Start I2C peripheral
@@ -42,6 +297,8 @@
                                             uint8_t register_address,
                                             uint8_t* data)
     {
+        I2C_ErrorCode result = I2C_ERROR;
+        I2C_INTERFACE_LOCK();
         // Send start condition
         uint8_t error = I2C_Master_MasterSendStart(device_address,I2C_Master_WRITE_XFER_MODE);
         if (error == I2C_Master_MSTR_NO_ERROR)
@@ -56,16 +313,14 @@
                 {
                     // Read data without acknowledgement
                     *data = I2C_Master_MasterReadByte(I2C_Master_ACK_DATA);
-                    // Send stop condition and return no error
-                    I2C_Master_MasterSendStop();
-                    return I2C_NO_ERROR;
+                    result = I2C_NO_ERROR;
                 }
             }
         }
-        // Send stop condition if something went wrong
+        // Send stop condition
         I2C_Master_MasterSendStop();
-        // Return error code
-        return I2C_ERROR;
+        I2C_INTERFACE_UNLOCK();
+        return result;
     }
     
     I2C_ErrorCode I2C_Peripheral_ReadRegisterMulti(uint8_t device_address,
@@ -73,6 +328,33 @@
                                                 uint8_t register_count,
                                                 uint8_t* data)
     {
+        I2C_INTERFACE_LOCK();
+        I2C_ErrorCode result = i2c_master_read(device_address, register_address, register_count, data);
+        I2C_INTERFACE_UNLOCK();
+        return result;
+    }
+    
+    I2C_ErrorCode I2C_Peripheral_ReadRegisterBatch(uint8_t device_address,
+                                                const I2C_RegisterRead* reads,
+                                                uint8_t count)
+    {
+        I2C_ErrorCode result = I2C_NO_ERROR;
+        I2C_INTERFACE_LOCK();
+        for (uint8_t i = 0; (i < count) && (result == I2C_NO_ERROR); i++)
+        {
+            result = i2c_master_read(device_address, reads[i].register_address,
+                                     reads[i].register_count, reads[i].data);
+        }
+        I2C_INTERFACE_UNLOCK();
+        return result;
+    }
+    
+    I2C_ErrorCode i2c_master_read(uint8_t device_address,
+                                  uint8_t register_address,
+                                  uint8_t register_count,
+                                  uint8_t* data)
+    {
+        I2C_ErrorCode result = I2C_ERROR;
         // Send start condition
         uint8_t error = I2C_Master_MasterSendStart(device_address,I2C_Master_WRITE_XFER_MODE);
         if (error == I2C_Master_MSTR_NO_ERROR)
@@ -97,22 +379,21 @@
                     // Read last data without acknowledgement
                     data[register_count-1]
                         = I2C_Master_MasterReadByte(I2C_Master_NAK_DATA);
-                    // Send stop condition and return no error
-                    I2C_Master_MasterSendStop();
-                    return I2C_NO_ERROR;
+                    result = I2C_NO_ERROR;
                 }
             }
         }
-        // Send stop condition if something went wrong
+        // Send stop condition
         I2C_Master_MasterSendStop();
-        // Return error code
-        return I2C_ERROR;
+        return result;
     }
     
     I2C_ErrorCode I2C_Peripheral_WriteRegister(uint8_t device_address,
                                             uint8_t register_address,
                                             uint8_t data)
     {
+        I2C_ErrorCode result = I2C_ERROR;
+        I2C_INTERFACE_LOCK();
         // Send start condition
         uint8_t error = I2C_Master_MasterSendStart(device_address, I2C_Master_WRITE_XFER_MODE);
         if (error == I2C_Master_MSTR_NO_ERROR)
@@ -125,22 +406,21 @@
                 error = I2C_Master_MasterWriteByte(data);
                 if (error == I2C_Master_MSTR_NO_ERROR)
                 {
-                    // Send stop condition
-                    I2C_Master_MasterSendStop();
-                    // Return with no error
-                    return I2C_NO_ERROR;
+                    result = I2C_NO_ERROR;
                 }
             }
         }
-        // Send stop condition in case something didn't work out correctly
+        // Send stop condition
         I2C_Master_MasterSendStop();
-        // Return error code
-        return I2C_ERROR;
+        I2C_INTERFACE_UNLOCK();
+        return result;
     }
     
     I2C_ErrorCode I2C_Peripheral_WriteRegisterNoData(uint8_t device_address,
                                             uint8_t register_address)
     {
+        I2C_ErrorCode result = I2C_ERROR;
+        I2C_INTERFACE_LOCK();
         // Send start condition
         uint8_t error = I2C_Master_MasterSendStart(device_address, I2C_Master_WRITE_XFER_MODE);
         if (error == I2C_Master_MSTR_NO_ERROR)
@@ -149,17 +429,13 @@
             error = I2C_Master_MasterWriteByte(register_address);
             if (error == I2C_Master_MSTR_NO_ERROR)
             {
-                // Send stop condition
-                I2C_Master_MasterSendStop();
-                // Return with no error
-                return I2C_NO_ERROR;
-                
+                result = I2C_NO_ERROR;
             }
         }
-        // Send stop condition in case something didn't work out correctly
+        // Send stop condition
         I2C_Master_MasterSendStop();
-        // Return error code
-        return I2C_ERROR;
+        I2C_INTERFACE_UNLOCK();
+        return result;
     }
     
     I2C_ErrorCode I2C_Peripheral_WriteRegisterMulti(uint8_t device_address,
@@ -167,45 +443,40 @@
                                             uint8_t register_count,
                                             uint8_t* data)
     {
+        I2C_ErrorCode result = I2C_ERROR;
+        I2C_INTERFACE_LOCK();
         // Send start condition
         uint8_t error = I2C_Master_MasterSendStart(device_address, I2C_Master_WRITE_XFER_MODE);
         if (error == I2C_Master_MSTR_NO_ERROR)
         {
             // Write register address
             error = I2C_Master_MasterWriteByte(register_address);
+            // Continue writing until we have data to write
+            uint8_t counter = register_count;
+            while((counter > 0) && (error == I2C_Master_MSTR_NO_ERROR))
+            {
+                error = I2C_Master_MasterWriteByte(data[register_count-counter]);
+                counter--;
+            }
             if (error == I2C_Master_MSTR_NO_ERROR)
             {
-                // Continue writing until we have data to write
-                uint8_t counter = register_count;
-                while(counter > 0)
-                {
-                    error = I2C_Master_MasterWriteByte(data[register_count-counter]);
-                    if (error != I2C_Master_MSTR_NO_ERROR)
-                    {
-                        // Send stop condition
-                        I2C_Master_MasterSendStop();
-                        // Return error code
-                        return I2C_ERROR;
-                    }
-                    counter--;
-                }
-                // Send stop condition and return no error
-                I2C_Master_MasterSendStop();
-                return I2C_NO_ERROR;
+                result = I2C_NO_ERROR;
             }
         }
-        // Send stop condition in case something didn't work out correctly
+        // Send stop condition
         I2C_Master_MasterSendStop();
-        // Return error code
-        return I2C_ERROR;
+        I2C_INTERFACE_UNLOCK();
+        return result;
     }
     
     
     I2C_ErrorCode I2C_Peripheral_IsDeviceConnected(uint8_t device_address, I2C_Connection* connection)
     {
+        I2C_INTERFACE_LOCK();
         // Send a start condition followed by a stop condition
         uint8_t error = I2C_Master_MasterSendStart(device_address, I2C_Master_WRITE_XFER_MODE);
         I2C_Master_MasterSendStop();
+        I2C_INTERFACE_UNLOCK();
         // If no error generated during stop, device is connected
         if (error == I2C_Master_MSTR_NO_ERROR)
         {
@@ -220,4 +491,6 @@
         
     }
 
+#endif // I2C_INTERFACE_LINUX
+
 /* [] END OF FILE */
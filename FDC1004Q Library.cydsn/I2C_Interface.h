@@ -6,6 +6,18 @@
  * this C-code to another platform, you could simply replace this
  * interface and still use the code.
  *
+ * When the project is compiled with FDC_SIMULATION defined, the
+ * interface is implemented on top of the FDC1004Q simulator
+ * (see FDC1004Q_Sim.h) so that the code can run on a host machine.
+ *
+ * When the project is compiled with I2C_INTERFACE_LINUX defined, the
+ * interface talks to a Linux i2c-dev adapter (/dev/i2c-N), so that the
+ * driver can run on a single board computer. Each register access is
+ * carried out as a single I2C_RDWR ioctl with a repeated start between
+ * the register pointer and the data. This backend takes precedence
+ * over the simulator, which can still be linked to answer the injected
+ * ioctl calls (see #I2C_Linux_SetIoctl).
+ *
  * \author Davide Marzorati
  * \date September 12, 2019
 */
@@ -13,7 +25,51 @@
 #ifndef I2C_Interface_H
     #define I2C_Interface_H
     
-    #include "cytypes.h"
+    #if defined(FDC_SIMULATION) || defined(I2C_INTERFACE_LINUX)
+        #include <stdint.h>
+    #else
+        #include "cytypes.h"
+        #include "cyapicallbacks.h"
+    #endif
+    
+    /**
+    *   \brief Acquire exclusive access to the I2C bus.
+    *
+    *   Each I2C_Peripheral_* function holds the bus between this macro and
+    *   #I2C_INTERFACE_UNLOCK, so that a complete transaction is never
+    *   interleaved with the ones issued by other tasks. When the bus is shared
+    *   under an RTOS, define both macros in cyapicallbacks.h to take and give
+    *   a mutex. By default they expand to nothing. When FDC_RTOS is defined
+    *   they take and give the bus mutex of the FreeRTOS layer of the driver
+    *   (see FDC1004Q_Rtos.h).
+    */
+    #if defined(FDC_RTOS) && !defined(I2C_INTERFACE_LOCK)
+        void FDC_Rtos_LockBus(void);
+        void FDC_Rtos_UnlockBus(void);
+        #define I2C_INTERFACE_LOCK() FDC_Rtos_LockBus()
+        #define I2C_INTERFACE_UNLOCK() FDC_Rtos_UnlockBus()
+    #endif
+    
+    #ifndef I2C_INTERFACE_LOCK
+        #define I2C_INTERFACE_LOCK()
+    #endif
+    
+    /**
+    *   \brief Release exclusive access to the I2C bus.
+    */
+    #ifndef I2C_INTERFACE_UNLOCK
+        #define I2C_INTERFACE_UNLOCK()
+    #endif
+    
+    /**
+    *   \brief Maximum number of reads in a batch.
+    *
+    *   Each read takes two messages of an I2C_RDWR ioctl, whose
+    *   limit is 42 messages on Linux.
+    */
+    #ifndef I2C_BATCH_MAX_READS
+        #define I2C_BATCH_MAX_READS 8
+    #endif
     
     /**
     *   \typedef I2C_ErrorCode
@@ -37,6 +93,18 @@
         I2C_DEV_UNCONNECTED         
     } I2C_Connection;
     
+    /**
+    *   \brief Register read carried out as part of a batch.
+    */
+    typedef struct {
+        /** Address of the first register to be read **/
+        uint8_t register_address;
+        /** Number of bytes to be read **/
+        uint8_t register_count;
+        /** Array where data will be saved **/
+        uint8_t* data;
+    } I2C_RegisterRead;
+    
     /** \brief Start the I2C peripheral.
     *   
     *   This function starts the I2C peripheral so that it is ready to work.
@@ -132,5 +200,58 @@
     */
     I2C_ErrorCode I2C_Peripheral_IsDeviceConnected(uint8_t device_address, I2C_Connection* connection);
     
+    /**
+    *   \brief Read several registers in a row.
+    *
+    *   This function performs the reads in order, holding the bus for
+    *   the whole batch. Each read is a pointer write followed by a
+    *   repeated start and the data. On Linux the whole batch is issued
+    *   with a single I2C_RDWR ioctl, which saves a system call and a
+    *   scheduler round trip per register.
+    *   \param device_address I2C address of the device to talk to.
+    *   \param reads the reads to be performed.
+    *   \param count the number of reads, up to #I2C_BATCH_MAX_READS.
+    *   \return #I2C_ErrorCode error code value
+    */
+    I2C_ErrorCode I2C_Peripheral_ReadRegisterBatch(uint8_t device_address,
+                                                const I2C_RegisterRead* reads,
+                                                uint8_t count);
+    
+    #ifdef I2C_INTERFACE_LINUX
+        
+        /**
+        *   \brief Adapter opened by #I2C_Peripheral_Start.
+        */
+        #ifndef I2C_LINUX_DEFAULT_DEVICE
+            #define I2C_LINUX_DEFAULT_DEVICE "/dev/i2c-1"
+        #endif
+        
+        /**
+        *   \brief Function used to issue ioctl requests to the adapter.
+        *
+        *   It has the semantics of ioctl(2): it returns a negative
+        *   value on error.
+        */
+        typedef int (*I2C_Linux_Ioctl)(int fd, unsigned long request, void* arg);
+        
+        /**
+        *   \brief Select the adapter opened by #I2C_Peripheral_Start.
+        *   \param path the path of the adapter, e.g. "/dev/i2c-1". The
+        *       string must stay valid until the peripheral is started.
+        */
+        void I2C_Linux_SetDevice(const char* path);
+        
+        /**
+        *   \brief Replace the function used to issue ioctl requests.
+        *
+        *   Tests and benchmarks install a function that emulates the adapter,
+        *   so that the backend runs without hardware (any file that can be
+        *   opened, e.g. /dev/null, can then be used as device).
+        *   \param function the replacement, or NULL to go back to ioctl(2).
+        */
+        void I2C_Linux_SetIoctl(I2C_Linux_Ioctl function);
+        
+    #endif
+    
 #endif // I2C_Interface_H
 /* [] END OF FILE */
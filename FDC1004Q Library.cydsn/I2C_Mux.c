@@ -0,0 +1,14 @@
+/*
+* This file includes the source code of the I2C bus multiplexer driver.
+*/
+
+#include "I2C_Mux.h"
+
+    I2C_ErrorCode I2C_Mux_Select(uint8_t segment)
+    {
+        // The control register is the only byte written after the address
+        uint8_t control = (segment < I2C_MUX_SEGMENTS) ? (1 << segment) : 0;
+        return I2C_Peripheral_WriteRegisterNoData(I2C_MUX_ADDR, control);
+    }
+
+/* [] END OF FILE */
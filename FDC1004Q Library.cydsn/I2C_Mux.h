@@ -0,0 +1,43 @@
+/** 
+ * \file I2C_Mux.h
+ * \brief Driver for a TCA9548A-like I2C bus multiplexer.
+ *
+ * The multiplexer connects the bus to one of up to eight downstream
+ * segments, so that devices sharing the same address (e.g. several
+ * FDC1004Q) can sit on the same bus. #I2C_Mux_Select has the signature
+ * of #I2C_Arbiter_BusSelect and can be handed to the arbiter, which then
+ * switches segment only when a transaction needs it.
+ *
+ * \author Davide Marzorati
+*/
+
+#ifndef I2C_Mux_H
+    #define I2C_Mux_H
+    
+    #include "I2C_Interface.h"
+    
+    /**
+    *   \brief I2C address of the multiplexer (A2..A0 tied low).
+    */
+    #ifndef I2C_MUX_ADDR
+        #define I2C_MUX_ADDR 0x70
+    #endif
+    
+    /**
+    *   \brief Number of downstream segments.
+    */
+    #define I2C_MUX_SEGMENTS 8
+    
+    /**
+    *   \brief Connect a segment to the bus.
+    *
+    *   The control register of the multiplexer is written with the bit
+    *   of the segment set, so that all the other segments are disconnected.
+    *   \param segment the segment, from 0 to #I2C_MUX_SEGMENTS - 1; any
+    *       other value disconnects all segments.
+    *   \return #I2C_ErrorCode error code value
+    */
+    I2C_ErrorCode I2C_Mux_Select(uint8_t segment);
+    
+#endif // I2C_Mux_H
+/* [] END OF FILE */
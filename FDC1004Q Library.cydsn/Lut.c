@@ -0,0 +1,187 @@
+/**
+*   \brief Source file for the conversion of capacitance to physical units.
+*/
+
+#include "Lut.h"
+
+/**
+*   \brief Value of the step shift when the breakpoints are not evenly spaced.
+*/
+#define LUT_NOT_UNIFORM 0xFF
+
+/**
+*   \brief Maximum number of fractional bits of the segment slopes.
+*/
+#define LUT_SLOPE_MAX_FRACT_BITS 30
+
+// Table of a channel
+typedef struct {
+    // Input value of each breakpoint
+    int32_t input[LUT_MAX_POINTS];
+    // Output value of each breakpoint
+    int32_t output[LUT_MAX_POINTS];
+    // Slope of the segment starting at each breakpoint
+    int32_t slope[LUT_MAX_POINTS];
+    // Fractional bits of each slope
+    uint8_t slope_shift[LUT_MAX_POINTS];
+    // Number of breakpoints, 0 if no table is loaded
+    uint8_t count;
+    // Log2 of the breakpoint spacing, or LUT_NOT_UNIFORM
+    uint8_t step_shift;
+} Lut_Table;
+
+// Tables of the channels
+static Lut_Table lut_tables[LUT_CHANNELS];
+
+// Find the segment the value belongs to
+static uint8_t lut_find_segment(const Lut_Table* table, int32_t value);
+
+// Compute the slope of a segment with the most fractional bits that fit
+static uint8_t lut_slope(int32_t dx, int32_t dy, int32_t* slope, uint8_t* shift);
+
+uint8_t Lut_Load(uint8_t channel, const int32_t* input,
+                 const int32_t* output, uint8_t count)
+{
+    if ((channel > FDC_CH_4) || (count < 2) || (count > LUT_MAX_POINTS))
+    {
+        return FDC_CONF_ERR;
+    }
+    // Check the table before touching the current one
+    int8_t direction = 0;
+    for (uint8_t i = 1; i < count; i++)
+    {
+        if (input[i] <= input[i-1])
+        {
+            return FDC_CONF_ERR;
+        }
+        int32_t slope;
+        uint8_t shift;
+        if (lut_slope(input[i] - input[i-1], output[i] - output[i-1], &slope, &shift) != FDC_OK)
+        {
+            return FDC_CONF_ERR;
+        }
+        int8_t segment_direction = (output[i] > output[i-1]) - (output[i] < output[i-1]);
+        if ((segment_direction != 0) && (direction != 0) && (segment_direction != direction))
+        {
+            return FDC_CONF_ERR;
+        }
+        if (segment_direction != 0)
+        {
+            direction = segment_direction;
+        }
+    }
+    
+    Lut_Table* table = &lut_tables[channel];
+    uint32_t step = (uint32_t)(input[1] - input[0]);
+    table->step_shift = LUT_NOT_UNIFORM;
+    if ((step & (step - 1)) == 0)
+    {
+        uint8_t shift = 0;
+        while ((1UL << shift) != step)
+        {
+            shift++;
+        }
+        table->step_shift = shift;
+    }
+    for (uint8_t i = 0; i < count; i++)
+    {
+        table->input[i] = input[i];
+        table->output[i] = output[i];
+        if (i + 1 < count)
+        {
+            lut_slope(input[i+1] - input[i], output[i+1] - output[i],
+                      &table->slope[i], &table->slope_shift[i]);
+            if ((uint32_t)(input[i+1] - input[i]) != step)
+            {
+                table->step_shift = LUT_NOT_UNIFORM;
+            }
+        }
+    }
+    table->slope[count-1] = 0;
+    table->slope_shift[count-1] = 0;
+    table->count = count;
+    return FDC_OK;
+}
+
+void Lut_Clear(uint8_t channel)
+{
+    if (channel <= FDC_CH_4)
+    {
+        lut_tables[channel].count = 0;
+    }
+}
+
+int32_t Lut_Convert(uint8_t channel, int32_t value)
+{
+    const Lut_Table* table = &lut_tables[channel];
+    if (table->count == 0)
+    {
+        return value;
+    }
+    if (value <= table->input[0])
+    {
+        return table->output[0];
+    }
+    if (value >= table->input[table->count - 1])
+    {
+        return table->output[table->count - 1];
+    }
+    uint8_t i = lut_find_segment(table, value);
+    // 32x32 -> 64 bit product, no division
+    int64_t delta = (int64_t)(value - table->input[i]) * table->slope[i];
+    return table->output[i] + (int32_t)(delta >> table->slope_shift[i]);
+}
+
+void Lut_ConvertFrame(const int32_t* capacitance, int32_t* result)
+{
+    for (uint8_t ch = 0; ch < LUT_CHANNELS; ch++)
+    {
+        result[ch] = Lut_Convert(ch, capacitance[ch]);
+    }
+}
+
+// ===================================================================
+//                         HELPER FUNCTIONS
+// ===================================================================
+
+uint8_t lut_find_segment(const Lut_Table* table, int32_t value)
+{
+    if (table->step_shift != LUT_NOT_UNIFORM)
+    {
+        return (uint32_t)(value - table->input[0]) >> table->step_shift;
+    }
+    // Last breakpoint not above the value
+    uint8_t low = 0;
+    uint8_t high = table->count - 1;
+    while (high - low > 1)
+    {
+        uint8_t middle = (low + high) / 2;
+        if (table->input[middle] <= value)
+        {
+            low = middle;
+        }
+        else
+        {
+            high = middle;
+        }
+    }
+    return low;
+}
+
+uint8_t lut_slope(int32_t dx, int32_t dy, int32_t* slope, uint8_t* shift)
+{
+    // The product with an offset below dx always fits in 64 bits
+    for (int8_t bits = LUT_SLOPE_MAX_FRACT_BITS; bits >= 0; bits--)
+    {
+        int64_t value = ((int64_t)dy * ((int64_t)1 << bits)) / dx;
+        if ((value <= INT32_MAX) && (value >= -INT32_MAX))
+        {
+            *slope = (int32_t)value;
+            *shift = bits;
+            return FDC_OK;
+        }
+    }
+    return FDC_CONF_ERR;
+}
+
+/* [] END OF FILE */
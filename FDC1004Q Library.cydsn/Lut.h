@@ -0,0 +1,84 @@
+/**
+*   \file Lut.h
+*   \brief Conversion of capacitance to physical units.
+*
+*   This file contains a per-channel lookup table that maps the capacitance,
+*   as computed by #FDC_ConvertRawMeasurementsFixed, to the unit required
+*   by the application (e.g. um, mg or percent fill) with piecewise-linear
+*   interpolation between breakpoints. Tables are loaded at runtime, and
+*   only integer operations are used when a sample is converted.
+*
+*   The segment of a sample is found with a binary search over the
+*   breakpoints, or with a single shift when the breakpoints are evenly
+*   spaced by a power of two, so that the cost of a conversion is bounded
+*   by log2(#LUT_MAX_POINTS) comparisons and one 32x32 multiplication.
+*
+*   \author Davide Marzorati
+*/
+
+#ifndef __LUT_H__
+    #define __LUT_H__
+
+    #include "FDC1004Q.h"
+
+    /**
+    *   \brief Number of channels with a lookup table.
+    */
+    #define LUT_CHANNELS 4
+
+    /**
+    *   \brief Maximum number of breakpoints in each table.
+    */
+    #ifndef LUT_MAX_POINTS
+        #define LUT_MAX_POINTS 16
+    #endif
+
+    /**
+    *   \brief Load the table of a channel.
+    *
+    *   The breakpoints are copied, so the arrays can be released after the
+    *   call. The input values must be strictly increasing and the output
+    *   values must be monotonic (either non-decreasing or non-increasing).
+    *   The slope of each segment must be below 2^31 output units per
+    *   input unit.
+    *   \param channel the channel, from #FDC_CH_1 to #FDC_CH_4.
+    *   \param[in] input the input value of each breakpoint, in units of the
+    *       measurement LSB (see #FDC_ConvertRawMeasurementsFixed).
+    *   \param[in] output the output value of each breakpoint.
+    *   \param count the number of breakpoints, from 2 to #LUT_MAX_POINTS.
+    *   \retval #FDC_OK if the table was loaded.
+    *   \retval #FDC_CONF_ERR if the table is not valid. The previous table
+    *       of the channel is kept.
+    */
+    uint8_t Lut_Load(uint8_t channel, const int32_t* input,
+                     const int32_t* output, uint8_t count);
+
+    /**
+    *   \brief Remove the table of a channel.
+    *
+    *   Channels without a table return their input unchanged.
+    *   \param channel the channel, from #FDC_CH_1 to #FDC_CH_4.
+    */
+    void Lut_Clear(uint8_t channel);
+
+    /**
+    *   \brief Convert a sample.
+    *
+    *   Samples outside the table range are clamped to the first
+    *   or last output value.
+    *   \param channel the channel, from #FDC_CH_1 to #FDC_CH_4.
+    *   \param value the capacitance in units of the measurement LSB.
+    *   \return the converted value.
+    */
+    int32_t Lut_Convert(uint8_t channel, int32_t value);
+
+    /**
+    *   \brief Convert the samples of a frame.
+    *   \param[in] capacitance the capacitance of the four channels,
+    *       as computed by #Sensors_TuneCapdac.
+    *   \param[out] result the converted values of the four channels.
+    */
+    void Lut_ConvertFrame(const int32_t* capacitance, int32_t* result);
+
+#endif
+/* [] END OF FILE */
@@ -0,0 +1,400 @@
+/**
+*   \brief Source file for the mains interference monitor and notch filter.
+*/
+
+#include "Mains.h"
+#include "Fixed.h"
+
+/**
+*   \brief Number of fractional bits of the trigonometric values.
+*/
+#define MAINS_TRIG_FRACT_BITS 30
+
+/**
+*   \brief Unity, with #MAINS_TRIG_FRACT_BITS fractional bits.
+*/
+#define MAINS_ONE ((int64_t)1 << MAINS_TRIG_FRACT_BITS)
+
+/**
+*   \brief Pi, with #MAINS_TRIG_FRACT_BITS fractional bits.
+*/
+#define MAINS_PI 3373259426LL
+
+/**
+*   \brief Number of fractional bits of the Goertzel coefficients.
+*/
+#define MAINS_GOERTZEL_FRACT_BITS 20
+
+/**
+*   \brief Number of fractional bits of the notch coefficients.
+*/
+#define MAINS_NOTCH_FRACT_BITS 24
+
+/**
+*   \brief Largest Goertzel state used to compute the power.
+*/
+#define MAINS_POWER_LIMIT ((int64_t)1 << 30)
+
+// Tone shared by all the channels
+typedef struct {
+    // Aliased frequency (Hz)
+    uint16_t frequency;
+    // Block length
+    uint16_t length;
+    // Goertzel coefficient 2 cos(w), Q20
+    int32_t coefficient;
+    // Notch coefficients, Q24
+    int32_t b0;
+    int32_t b1;
+    int32_t a1;
+    int32_t a2;
+    // Set if the tone is at half the sample rate
+    uint8_t nyquist;
+} Mains_ToneConfig;
+
+// State of a tone in a channel
+typedef struct {
+    // Goertzel state
+    int64_t s1;
+    int64_t s2;
+    // Reference sample of the block
+    int32_t reference;
+    // Samples in the current block
+    uint16_t count;
+    // Completed blocks
+    uint32_t blocks;
+    // Amplitude over the last block, Q8 LSB
+    uint32_t amplitude;
+    // Notch inputs and outputs, Q8 LSB from the notch reference
+    int64_t x1;
+    int64_t x2;
+    int64_t y1;
+    int64_t y2;
+    // Set while the notch is applied in MAINS_AUTO mode
+    uint8_t notch;
+} Mains_ToneState;
+
+// State of a channel
+typedef struct {
+    Mains_ToneState tones[MAINS_HARMONICS];
+    // Reference of the notch filters
+    int32_t reference;
+    // Set when the next sample must initialize the notch filters
+    uint8_t reset;
+} Mains_Channel;
+
+// Current mode
+static uint8_t mains_mode = MAINS_OFF;
+// Configuration
+static Mains_Config mains_config;
+// Tones, indexed by harmonic
+static Mains_ToneConfig mains_tones[MAINS_HARMONICS];
+// Harmonics being monitored, bit n for harmonic n
+static uint8_t mains_monitored = 0;
+// State of the channels
+static Mains_Channel mains_channels[MAINS_CHANNELS];
+
+// Cosine of pi * numerator / denominator, with numerator up to denominator, Q30
+static int64_t mains_cos(int64_t numerator, int64_t denominator);
+
+// Greatest common divisor
+static uint32_t mains_gcd(uint32_t a, uint32_t b);
+
+// Update the Goertzel filter of a tone with a sample
+static void mains_goertzel(const Mains_ToneConfig* config, Mains_ToneState* state, int32_t sample);
+
+uint8_t Mains_Configure(const Mains_Config* config)
+{
+    if (((config->mains_frequency != 50) && (config->mains_frequency != 60)) ||
+        (config->harmonics == 0) || (config->harmonics > MAINS_HARMONICS) ||
+        (config->block_length < 8) || (config->block_length > MAINS_MAX_BLOCK) ||
+        (config->notch_bandwidth == 0) || 
+        (4 * (uint32_t)config->notch_bandwidth > config->sample_rate))
+    {
+        return FDC_CONF_ERR;
+    }
+    mains_config = *config;
+    mains_monitored = 0;
+    uint32_t rate = config->sample_rate;
+    for (uint8_t h = 0; h < config->harmonics; h++)
+    {
+        // Fold the harmonic into [0, rate / 2]
+        uint32_t frequency = ((uint32_t)(h + 1) * config->mains_frequency) % rate;
+        if (2 * frequency > rate)
+        {
+            frequency = rate - frequency;
+        }
+        uint8_t duplicate = 0;
+        for (uint8_t k = 0; k < h; k++)
+        {
+            if ((mains_monitored & (1 << k)) && (mains_tones[k].frequency == frequency))
+            {
+                duplicate = 1;
+            }
+        }
+        if ((frequency == 0) || duplicate)
+        {
+            continue;
+        }
+        Mains_ToneConfig* tone = &mains_tones[h];
+        tone->frequency = (uint16_t)frequency;
+        tone->nyquist = (2 * frequency == rate);
+        
+        // Whole number of periods of the tone in each block
+        uint32_t period = rate / mains_gcd(frequency, rate);
+        uint32_t length = ((config->block_length + period / 2) / period) * period;
+        if (length == 0)
+        {
+            length = period;
+        }
+        if (length > MAINS_MAX_BLOCK)
+        {
+            length = config->block_length;
+        }
+        tone->length = (uint16_t)length;
+        
+        // w = 2 pi f / rate
+        int64_t c = mains_cos(2 * (int64_t)frequency, rate);
+        tone->coefficient = (int32_t)((2 * c + ((int64_t)1 << (MAINS_TRIG_FRACT_BITS - MAINS_GOERTZEL_FRACT_BITS - 1))) >> 
+                                      (MAINS_TRIG_FRACT_BITS - MAINS_GOERTZEL_FRACT_BITS));
+        
+        // Pole radius r = 1 - pi bandwidth / rate, unity gain at DC
+        int64_t r = MAINS_ONE - (MAINS_PI * config->notch_bandwidth) / (int64_t)rate;
+        int64_t rc = (r * c) >> MAINS_TRIG_FRACT_BITS;
+        int64_t r2 = (r * r) >> MAINS_TRIG_FRACT_BITS;
+        int64_t gain = ((MAINS_ONE - 2 * rc + r2) << MAINS_TRIG_FRACT_BITS) / (2 * MAINS_ONE - 2 * c);
+        uint8_t shift = MAINS_TRIG_FRACT_BITS - MAINS_NOTCH_FRACT_BITS;
+        int64_t half = (int64_t)1 << (shift - 1);
+        tone->b0 = (int32_t)((gain + half) >> shift);
+        tone->b1 = (int32_t)((-2 * ((c * gain) >> MAINS_TRIG_FRACT_BITS) + half) >> shift);
+        tone->a1 = (int32_t)((-2 * rc + half) >> shift);
+        tone->a2 = (int32_t)((r2 + half) >> shift);
+        mains_monitored |= 1 << h;
+    }
+    for (uint8_t ch = 0; ch < MAINS_CHANNELS; ch++)
+    {
+        for (uint8_t h = 0; h < MAINS_HARMONICS; h++)
+        {
+            Mains_ToneState* state = &mains_channels[ch].tones[h];
+            state->count = 0;
+            state->blocks = 0;
+            state->amplitude = 0;
+            state->notch = 0;
+        }
+        mains_channels[ch].reset = 1;
+    }
+    return FDC_OK;
+}
+
+uint8_t Mains_SetMode(uint8_t mode)
+{
+    if (mode > MAINS_AUTO)
+    {
+        return FDC_CONF_ERR;
+    }
+    if ((mains_mode < MAINS_NOTCH) && (mode >= MAINS_NOTCH))
+    {
+        // Notch filters start from the next sample
+        for (uint8_t ch = 0; ch < MAINS_CHANNELS; ch++)
+        {
+            mains_channels[ch].reset = 1;
+        }
+    }
+    mains_mode = mode;
+    return FDC_OK;
+}
+
+uint8_t Mains_GetMode(void)
+{
+    return mains_mode;
+}
+
+int32_t Mains_Process(uint8_t channel, int32_t capacitance)
+{
+    if ((mains_mode == MAINS_OFF) || (mains_monitored == 0))
+    {
+        return capacitance;
+    }
+    Mains_Channel* state = &mains_channels[channel];
+    for (uint8_t h = 0; h < MAINS_HARMONICS; h++)
+    {
+        if (mains_monitored & (1 << h))
+        {
+            mains_goertzel(&mains_tones[h], &state->tones[h], capacitance);
+        }
+    }
+    if (mains_mode == MAINS_MONITOR)
+    {
+        return capacitance;
+    }
+    
+    if (state->reset)
+    {
+        // Start from the steady state for the current sample
+        state->reference = capacitance;
+        for (uint8_t h = 0; h < MAINS_HARMONICS; h++)
+        {
+            state->tones[h].x1 = 0;
+            state->tones[h].x2 = 0;
+            state->tones[h].y1 = 0;
+            state->tones[h].y2 = 0;
+        }
+        state->reset = 0;
+    }
+    
+    // Cascade of the notch filters, Q8 from the reference
+    int64_t value = ((int64_t)capacitance - state->reference) * (1L << MAINS_FRACT_BITS);
+    for (uint8_t h = 0; h < MAINS_HARMONICS; h++)
+    {
+        if (!(mains_monitored & (1 << h)))
+        {
+            continue;
+        }
+        const Mains_ToneConfig* tone = &mains_tones[h];
+        Mains_ToneState* filter = &state->tones[h];
+        int64_t accumulator = (int64_t)tone->b0 * (value + filter->x2) + 
+                              (int64_t)tone->b1 * filter->x1 - 
+                              (int64_t)tone->a1 * filter->y1 - 
+                              (int64_t)tone->a2 * filter->y2;
+        int64_t output = (accumulator + ((int64_t)1 << (MAINS_NOTCH_FRACT_BITS - 1))) >> MAINS_NOTCH_FRACT_BITS;
+        filter->x2 = filter->x1;
+        filter->x1 = value;
+        filter->y2 = filter->y1;
+        filter->y1 = output;
+        if ((mains_mode == MAINS_NOTCH) || filter->notch)
+        {
+            value = output;
+        }
+    }
+    return state->reference + (int32_t)((value + (1L << (MAINS_FRACT_BITS - 1))) >> MAINS_FRACT_BITS);
+}
+
+void Mains_ProcessFrame(const int32_t* capacitance, int32_t* result)
+{
+    for (uint8_t ch = 0; ch < MAINS_CHANNELS; ch++)
+    {
+        result[ch] = Mains_Process(ch, capacitance[ch]);
+    }
+}
+
+uint8_t Mains_GetTone(uint8_t channel, uint8_t harmonic, Mains_Tone* tone)
+{
+    if ((channel > FDC_CH_4) || (harmonic >= MAINS_HARMONICS) || 
+        !(mains_monitored & (1 << harmonic)))
+    {
+        return FDC_CONF_ERR;
+    }
+    const Mains_ToneState* state = &mains_channels[channel].tones[harmonic];
+    if (state->blocks == 0)
+    {
+        return FDC_MEAS_NOT_DONE;
+    }
+    tone->frequency = mains_tones[harmonic].frequency;
+    tone->amplitude = state->amplitude;
+    tone->blocks = state->blocks;
+    tone->notch = (mains_mode == MAINS_NOTCH) || ((mains_mode == MAINS_AUTO) && state->notch);
+    return FDC_OK;
+}
+
+uint32_t Mains_GetLevel(uint8_t channel)
+{
+    uint32_t level = 0;
+    if (channel <= FDC_CH_4)
+    {
+        for (uint8_t h = 0; h < MAINS_HARMONICS; h++)
+        {
+            if ((mains_monitored & (1 << h)) && (mains_channels[channel].tones[h].amplitude > level))
+            {
+                level = mains_channels[channel].tones[h].amplitude;
+            }
+        }
+    }
+    return level;
+}
+
+// ===================================================================
+//                         HELPER FUNCTIONS
+// ===================================================================
+
+int64_t mains_cos(int64_t numerator, int64_t denominator)
+{
+    // Reduce to the first quadrant, cos(pi - x) = -cos(x)
+    int64_t sign = 1;
+    if (2 * numerator > denominator)
+    {
+        numerator = denominator - numerator;
+        sign = -1;
+    }
+    int64_t x = (MAINS_PI * numerator) / denominator;
+    int64_t x2 = (x * x) >> MAINS_TRIG_FRACT_BITS;
+    // Taylor series up to x^10, Horner form
+    int64_t t = MAINS_ONE - x2 / 90;
+    t = MAINS_ONE - ((x2 * t) >> MAINS_TRIG_FRACT_BITS) / 56;
+    t = MAINS_ONE - ((x2 * t) >> MAINS_TRIG_FRACT_BITS) / 30;
+    t = MAINS_ONE - ((x2 * t) >> MAINS_TRIG_FRACT_BITS) / 12;
+    t = MAINS_ONE - ((x2 * t) >> MAINS_TRIG_FRACT_BITS) / 2;
+    return sign * t;
+}
+
+uint32_t mains_gcd(uint32_t a, uint32_t b)
+{
+    while (b != 0)
+    {
+        uint32_t r = a % b;
+        a = b;
+        b = r;
+    }
+    return a;
+}
+
+void mains_goertzel(const Mains_ToneConfig* config, Mains_ToneState* state, int32_t sample)
+{
+    if (state->count == 0)
+    {
+        state->reference = sample;
+        state->s1 = 0;
+        state->s2 = 0;
+    }
+    int64_t s = ((int64_t)sample - state->reference) + 
+                (((int64_t)config->coefficient * state->s1) >> MAINS_GOERTZEL_FRACT_BITS) - state->s2;
+    state->s2 = state->s1;
+    state->s1 = s;
+    state->count++;
+    if (state->count < config->length)
+    {
+        return;
+    }
+    
+    // Power of the block, scaled down to fit the products
+    int64_t s1 = state->s1;
+    int64_t s2 = state->s2;
+    uint8_t shift = 0;
+    while ((s1 >= MAINS_POWER_LIMIT) || (s1 <= -MAINS_POWER_LIMIT) ||
+           (s2 >= MAINS_POWER_LIMIT) || (s2 <= -MAINS_POWER_LIMIT))
+    {
+        s1 /= 2;
+        s2 /= 2;
+        shift++;
+    }
+    int64_t power = s1 * s1 + s2 * s2 - 
+                    ((((int64_t)config->coefficient * s1) >> MAINS_GOERTZEL_FRACT_BITS) * s2);
+    uint64_t magnitude = Fixed_Sqrt((power > 0) ? (uint64_t)power : 0);
+    // A tone of amplitude A gives a magnitude of A N / 2, or A N at half the sample rate
+    uint8_t scale = MAINS_FRACT_BITS + shift + (config->nyquist ? 0 : 1);
+    uint64_t amplitude = (magnitude << scale) / config->length;
+    state->amplitude = (amplitude > UINT32_MAX) ? UINT32_MAX : (uint32_t)amplitude;
+    state->blocks++;
+    state->count = 0;
+    
+    // Notch hysteresis for MAINS_AUTO
+    if (state->amplitude >= mains_config.threshold)
+    {
+        state->notch = 1;
+    }
+    else if (state->amplitude < mains_config.threshold / 2)
+    {
+        state->notch = 0;
+    }
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,176 @@
+/**
+*   \file Mains.h
+*   \brief Mains interference monitor and notch filter.
+*
+*   This file contains a per-channel stage that measures the interference
+*   picked up from the mains by long electrodes and can remove it. The
+*   mains frequency and its harmonics are aliased by the sample rate of
+*   each channel (e.g. 60 Hz appears at 40 Hz when sampling at 100 Hz),
+*   so the stage works at the aliased frequencies computed for the
+*   configured sample rate. Harmonics aliased to DC, or to the same
+*   frequency as a lower harmonic, are not monitored.
+*
+*   For each monitored frequency a Goertzel filter computes the amplitude
+*   of the tone over blocks of samples. The length of each block is
+*   rounded to a whole number of periods of the aliased tone, so that the
+*   DC level of the signal does not leak into the result. When selected, a
+*   second-order IIR notch at each monitored frequency removes the tone,
+*   with unity gain at DC. In #MAINS_AUTO mode the notch of a tone is only
+*   applied while the amplitude of the tone is above a threshold; the
+*   notch filters keep running while bypassed, so enabling them does not
+*   cause a transient.
+*
+*   Each sample takes at most one multiplication per tone for the
+*   monitor and five per tone for the notch, with no division, so the cost
+*   is bounded by #MAINS_HARMONICS. All the processing is done with
+*   integer operations.
+*
+*   \author Davide Marzorati
+*/
+
+#ifndef __MAINS_H__
+    #define __MAINS_H__
+
+    #include "FDC1004Q.h"
+
+    /**
+    *   \brief Number of channels.
+    */
+    #define MAINS_CHANNELS 4
+
+    /**
+    *   \brief Maximum number of monitored harmonics, the fundamental included.
+    */
+    #ifndef MAINS_HARMONICS
+        #define MAINS_HARMONICS 3
+    #endif
+
+    /**
+    *   \brief Maximum length of a Goertzel block.
+    */
+    #define MAINS_MAX_BLOCK 512
+
+    /**
+    *   \brief Number of fractional bits of the amplitudes.
+    */
+    #define MAINS_FRACT_BITS 8
+
+    /**
+    *   \brief Processing disabled, samples are passed through.
+    */
+    #define MAINS_OFF     0
+
+    /**
+    *   \brief Interference monitored, samples are passed through.
+    */
+    #define MAINS_MONITOR 1
+
+    /**
+    *   \brief Interference monitored and removed with the notch filters.
+    */
+    #define MAINS_NOTCH   2
+
+    /**
+    *   \brief Interference monitored, each tone removed while above the threshold.
+    */
+    #define MAINS_AUTO    3
+
+    /**
+    *   \brief Configuration of the stage.
+    */
+    typedef struct {
+        /** Mains frequency, 50 or 60 Hz **/
+        uint8_t mains_frequency;
+        /** Sample rate of each channel (Hz) **/
+        uint16_t sample_rate;
+        /** Number of harmonics, the fundamental included, from 1 to #MAINS_HARMONICS **/
+        uint8_t harmonics;
+        /** Approximate length of the Goertzel blocks, in samples **/
+        uint16_t block_length;
+        /** -3 dB bandwidth of the notch filters (Hz) **/
+        uint8_t notch_bandwidth;
+        /** Amplitude above which a tone is removed in #MAINS_AUTO mode, in LSB with #MAINS_FRACT_BITS fractional bits **/
+        uint32_t threshold;
+    } Mains_Config;
+
+    /**
+    *   \brief Measurement of a tone.
+    */
+    typedef struct {
+        /** Aliased frequency (Hz) **/
+        uint16_t frequency;
+        /** Amplitude over the last block, in LSB with #MAINS_FRACT_BITS fractional bits **/
+        uint32_t amplitude;
+        /** Number of completed blocks **/
+        uint32_t blocks;
+        /** Set if the notch of the tone is applied **/
+        uint8_t notch;
+    } Mains_Tone;
+
+    /**
+    *   \brief Configure the stage.
+    *
+    *   The state of all the channels is reset. The mode is not changed.
+    *   \param[in] config the configuration.
+    *   \retval #FDC_OK if the stage was configured.
+    *   \retval #FDC_CONF_ERR if the configuration is not valid: the mains
+    *       frequency must be 50 or 60 Hz, the number of harmonics from 1
+    *       to #MAINS_HARMONICS, the block length from 8 to #MAINS_MAX_BLOCK
+    *       samples, and the bandwidth between 1 Hz and a quarter of the
+    *       sample rate.
+    */
+    uint8_t Mains_Configure(const Mains_Config* config);
+
+    /**
+    *   \brief Select the mode.
+    *   \param mode #MAINS_OFF, #MAINS_MONITOR, #MAINS_NOTCH or #MAINS_AUTO.
+    *   \retval #FDC_OK if the mode was selected.
+    *   \retval #FDC_CONF_ERR if the mode is not valid.
+    */
+    uint8_t Mains_SetMode(uint8_t mode);
+
+    /**
+    *   \brief Get the mode.
+    *   \return the current mode.
+    */
+    uint8_t Mains_GetMode(void);
+
+    /**
+    *   \brief Process a sample.
+    *   \param channel the channel, from #FDC_CH_1 to #FDC_CH_4.
+    *   \param capacitance the capacitance in units of the measurement LSB,
+    *       as computed by #FDC_ConvertRawMeasurementsFixed.
+    *   \return the sample with the selected tones removed.
+    */
+    int32_t Mains_Process(uint8_t channel, int32_t capacitance);
+
+    /**
+    *   \brief Process the samples of a frame.
+    *   \param[in] capacitance the capacitance of the four channels.
+    *   \param[out] result the samples with the selected tones removed,
+    *       can be the same array as the input.
+    */
+    void Mains_ProcessFrame(const int32_t* capacitance, int32_t* result);
+
+    /**
+    *   \brief Get the measurement of a tone.
+    *   \param channel the channel, from #FDC_CH_1 to #FDC_CH_4.
+    *   \param harmonic the harmonic, 0 being the fundamental.
+    *   \param[out] tone the measurement.
+    *   \retval #FDC_OK if the measurement was read.
+    *   \retval #FDC_CONF_ERR if the channel is not valid or the harmonic
+    *       is not monitored.
+    *   \retval #FDC_MEAS_NOT_DONE if no block was completed yet.
+    */
+    uint8_t Mains_GetTone(uint8_t channel, uint8_t harmonic, Mains_Tone* tone);
+
+    /**
+    *   \brief Get the interference level of a channel.
+    *   \param channel the channel, from #FDC_CH_1 to #FDC_CH_4.
+    *   \return the largest amplitude of the monitored tones over their
+    *       last block, in LSB with #MAINS_FRACT_BITS fractional bits.
+    */
+    uint32_t Mains_GetLevel(uint8_t channel);
+
+#endif
+/* [] END OF FILE */
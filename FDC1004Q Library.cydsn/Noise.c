@@ -0,0 +1,204 @@
+/**
+*   \brief Source file for the streaming noise characterisation.
+*/
+
+#include "Noise.h"
+#include "Fixed.h"
+
+/**
+*   \brief Unity, with #NOISE_FRACT_BITS fractional bits.
+*/
+#define NOISE_ONE (1L << NOISE_FRACT_BITS)
+
+// Add a squared difference to a sum, saturating both
+static uint64_t noise_add_square(uint64_t sum, int64_t difference);
+
+// Base 2 logarithm, with NOISE_FRACT_BITS fractional bits
+static uint32_t noise_log2(uint64_t value);
+
+void Noise_Init(Noise_State* state)
+{
+    for (uint8_t k = 0; k < NOISE_OCTAVES; k++)
+    {
+        state->octaves[k].pending = 0;
+        state->octaves[k].previous = 0;
+        state->octaves[k].sum_squares = 0;
+        state->octaves[k].pairs = 0;
+        state->octaves[k].has_pending = 0;
+        state->octaves[k].has_previous = 0;
+    }
+    state->mean = 0;
+    state->m2 = 0;
+    state->count = 0;
+    state->capdac = 0;
+}
+
+void Noise_AddSample(Noise_State* state, int32_t capacitance, uint8_t capdac)
+{
+    if ((state->count != 0) && (state->capdac != capdac))
+    {
+        // Start again from the current sample
+        Noise_Init(state);
+    }
+    state->capdac = capdac;
+    
+    // Welford update of mean and variance
+    if (state->count < UINT32_MAX)
+    {
+        state->count++;
+        int64_t sample = (int64_t)capacitance * NOISE_ONE;
+        int64_t delta = sample - state->mean;
+        int64_t step = (delta >= 0) ? 
+            (delta + state->count / 2) / (int64_t)state->count :
+            -((-delta + state->count / 2) / (int64_t)state->count);
+        state->mean += step;
+        int64_t delta_new = sample - state->mean;
+        if ((delta > -INT32_MAX) && (delta < INT32_MAX) && 
+            (delta_new > -INT32_MAX) && (delta_new < INT32_MAX))
+        {
+            int64_t product = delta * delta_new;
+            if ((product > 0) && (state->m2 <= UINT64_MAX - (uint64_t)product))
+            {
+                state->m2 += (uint64_t)product;
+            }
+            else if (product > 0)
+            {
+                state->m2 = UINT64_MAX;
+            }
+        }
+        else
+        {
+            state->m2 = UINT64_MAX;
+        }
+    }
+    
+    // Allan variance, octave by octave
+    int64_t block = capacitance;
+    for (uint8_t k = 0; k < NOISE_OCTAVES; k++)
+    {
+        Noise_Octave* octave = &state->octaves[k];
+        if (octave->has_previous)
+        {
+            // Difference of the block means, blocks of 2^k samples, rounded
+            int64_t difference = ((block - octave->previous) * NOISE_ONE + 
+                                  (((int64_t)1 << k) >> 1)) >> k;
+            octave->sum_squares = noise_add_square(octave->sum_squares, difference);
+            if (octave->pairs < UINT32_MAX)
+            {
+                octave->pairs++;
+            }
+        }
+        octave->previous = block;
+        octave->has_previous = 1;
+        if (!octave->has_pending)
+        {
+            // First block of a pair, wait for the second one
+            octave->pending = block;
+            octave->has_pending = 1;
+            break;
+        }
+        // Pass the pair to the next octave as a single block
+        block += octave->pending;
+        octave->has_pending = 0;
+    }
+}
+
+void Noise_AddCaptureBlock(Noise_State* states, const FDC_CaptureBlock* block)
+{
+    for (uint8_t ch = 0; ch < FDC_CAPTURE_CHANNELS; ch++)
+    {
+        if (block->header.channel_mask & (FDC_RP_CH_1 >> ch))
+        {
+            for (uint8_t i = 0; i < block->header.sample_count; i++)
+            {
+                Noise_AddSample(&states[ch], block->raw[ch][i], block->capdac[ch][i]);
+            }
+        }
+    }
+}
+
+uint8_t Noise_GetAllanDeviation(const Noise_State* state, uint8_t octave, uint32_t* deviation)
+{
+    if (octave >= NOISE_OCTAVES)
+    {
+        return FDC_CONF_ERR;
+    }
+    const Noise_Octave* data = &state->octaves[octave];
+    if (data->pairs == 0)
+    {
+        return FDC_MEAS_NOT_DONE;
+    }
+    // Allan variance is half the mean squared difference
+    *deviation = Fixed_Sqrt(data->sum_squares / (2 * (uint64_t)data->pairs));
+    return FDC_OK;
+}
+
+uint8_t Noise_GetSummary(const Noise_State* state, Noise_Summary* summary)
+{
+    if (state->count < 2)
+    {
+        return FDC_MEAS_NOT_DONE;
+    }
+    summary->count = state->count;
+    int64_t mean = (state->mean >= 0) ? 
+        (state->mean + NOISE_ONE / 2) >> NOISE_FRACT_BITS : 
+        -((-state->mean + NOISE_ONE / 2) >> NOISE_FRACT_BITS);
+    summary->mean = (int32_t)mean;
+    summary->rms = Fixed_Sqrt(state->m2 / (state->count - 1));
+    
+    // Noise below the resolution of the result is taken as 1 fractional LSB
+    uint32_t full_scale = noise_log2((uint64_t)NOISE_FULL_SCALE << NOISE_FRACT_BITS);
+    uint32_t noise = noise_log2((summary->rms != 0) ? summary->rms : 1);
+    summary->effective_bits = (full_scale > noise) ? full_scale - noise : 0;
+    
+    summary->octaves = 0;
+    for (uint8_t k = 0; k < NOISE_OCTAVES; k++)
+    {
+        if (state->octaves[k].pairs != 0)
+        {
+            summary->octaves++;
+        }
+    }
+    return FDC_OK;
+}
+
+// ===================================================================
+//                         HELPER FUNCTIONS
+// ===================================================================
+
+uint64_t noise_add_square(uint64_t sum, int64_t difference)
+{
+    uint64_t magnitude = (difference >= 0) ? (uint64_t)difference : (uint64_t)(-difference);
+    if (magnitude > UINT32_MAX)
+    {
+        return UINT64_MAX;
+    }
+    uint64_t square = magnitude * magnitude;
+    return (sum <= UINT64_MAX - square) ? sum + square : UINT64_MAX;
+}
+
+uint32_t noise_log2(uint64_t value)
+{
+    // Integer part from the position of the most significant bit
+    uint32_t result = 0;
+    while ((value >> result) > 1)
+    {
+        result++;
+    }
+    // Normalize to [1, 2) with 30 fractional bits
+    uint64_t x = (result > 30) ? value >> (result - 30) : value << (30 - result);
+    result <<= NOISE_FRACT_BITS;
+    // Fractional part by repeated squaring, one bit per iteration
+    for (uint32_t bit = NOISE_ONE >> 1; bit != 0; bit >>= 1)
+    {
+        x = (x * x) >> 30;
+        if (x >= ((uint64_t)2 << 30))
+        {
+            x >>= 1;
+            result |= bit;
+        }
+    }
+    return result;
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,158 @@
+/**
+*   \file Noise.h
+*   \brief Streaming noise characterisation.
+*
+*   This file contains an accumulator that characterises the noise of a
+*   channel over an arbitrarily long stream of samples, e.g. to choose the
+*   sample rate and the filtering stages. It computes:
+*       - the Allan deviation at averaging times of 1, 2, 4, ...
+*         2^(#NOISE_OCTAVES - 1) samples;
+*       - the RMS noise, i.e. the standard deviation of the samples;
+*       - the effective number of bits over the full-scale input range.
+*
+*   The Allan deviation is accumulated octave by octave: each octave keeps
+*   the sum of the current block of samples and of the previous one, and
+*   passes the sum of each pair of blocks to the next octave. The memory
+*   used is therefore fixed and logarithmic in the longest averaging time,
+*   and no sample is stored. Since the blocks do not overlap, the result is
+*   the non-overlapping Allan deviation, which has a larger confidence
+*   interval than the overlapping estimator at the longest averaging times.
+*
+*   The state is kept in a #Noise_State structure owned by the caller, so
+*   that any number of channels, of live streams or of capture files can be
+*   analysed independently (also from different threads on a host).
+*   Changing the CAPDAC of a channel shifts the measured value, so the
+*   state is reset whenever a sample is measured with a different CAPDAC
+*   setting. All the processing is done with integer operations.
+*
+*   \author Davide Marzorati
+*/
+
+#ifndef __NOISE_H__
+    #define __NOISE_H__
+
+    #include "FDC1004Q.h"
+    #include "FDC1004Q_Capture.h"
+
+    /**
+    *   \brief Number of octaves of averaging time.
+    */
+    #ifndef NOISE_OCTAVES
+        #define NOISE_OCTAVES 16
+    #endif
+
+    #if (NOISE_OCTAVES < 1) || (NOISE_OCTAVES > 32)
+        #error "NOISE_OCTAVES must be between 1 and 32"
+    #endif
+
+    /**
+    *   \brief Number of fractional bits of the results.
+    */
+    #define NOISE_FRACT_BITS 8
+
+    /**
+    *   \brief Full-scale input range, in units of the measurement LSB (30 pF).
+    */
+    #define NOISE_FULL_SCALE (30UL << 19)
+
+    /**
+    *   \brief State of an octave.
+    */
+    typedef struct {
+        /** Sum of the current block, in LSB **/
+        int64_t pending;
+        /** Sum of the previous block, in LSB **/
+        int64_t previous;
+        /** Sum of the squared differences between consecutive block means, in LSB^2 with 2 * #NOISE_FRACT_BITS fractional bits **/
+        uint64_t sum_squares;
+        /** Number of differences in the sum **/
+        uint32_t pairs;
+        /** Set when #pending holds the first block of a pair **/
+        uint8_t has_pending;
+        /** Set when #previous is valid **/
+        uint8_t has_previous;
+    } Noise_Octave;
+
+    /**
+    *   \brief State of the noise accumulator of a channel.
+    */
+    typedef struct {
+        /** Octaves, from an averaging time of 1 sample **/
+        Noise_Octave octaves[NOISE_OCTAVES];
+        /** Running mean, in LSB with #NOISE_FRACT_BITS fractional bits **/
+        int64_t mean;
+        /** Sum of the squared deviations from the mean, in LSB^2 with 2 * #NOISE_FRACT_BITS fractional bits **/
+        uint64_t m2;
+        /** Number of samples **/
+        uint32_t count;
+        /** CAPDAC of the last sample **/
+        uint8_t capdac;
+    } Noise_State;
+
+    /**
+    *   \brief Summary of the noise of a channel.
+    */
+    typedef struct {
+        /** Number of samples **/
+        uint32_t count;
+        /** Mean, rounded to the nearest LSB **/
+        int32_t mean;
+        /** RMS noise, in LSB with #NOISE_FRACT_BITS fractional bits **/
+        uint32_t rms;
+        /** Effective number of bits, with #NOISE_FRACT_BITS fractional bits **/
+        uint32_t effective_bits;
+        /** Number of octaves with a valid Allan deviation **/
+        uint8_t octaves;
+    } Noise_Summary;
+
+    /**
+    *   \brief Reset the accumulator of a channel.
+    *   \param[out] state the state of the accumulator.
+    */
+    void Noise_Init(Noise_State* state);
+
+    /**
+    *   \brief Add a sample.
+    *   \param[in,out] state the state of the accumulator.
+    *   \param capacitance the capacitance in units of the measurement LSB,
+    *       either raw or as computed by #FDC_ConvertRawMeasurementsFixed.
+    *   \param capdac the CAPDAC setting the sample was measured with.
+    */
+    void Noise_AddSample(Noise_State* state, int32_t capacitance, uint8_t capdac);
+
+    /**
+    *   \brief Add the samples of a capture block.
+    *
+    *   The samples of each channel recorded in the block are added to the
+    *   accumulator of that channel.
+    *   \param[in,out] states the accumulators of the four channels.
+    *   \param[in] block the capture block.
+    */
+    void Noise_AddCaptureBlock(Noise_State* states, const FDC_CaptureBlock* block);
+
+    /**
+    *   \brief Get the Allan deviation at an averaging time.
+    *   \param[in] state the state of the accumulator.
+    *   \param octave the octave, for an averaging time of 2^octave samples.
+    *   \param[out] deviation the Allan deviation, in LSB with
+    *       #NOISE_FRACT_BITS fractional bits.
+    *   \retval #FDC_OK if the deviation was computed.
+    *   \retval #FDC_CONF_ERR if the octave is not valid.
+    *   \retval #FDC_MEAS_NOT_DONE if there are not enough samples for the octave.
+    */
+    uint8_t Noise_GetAllanDeviation(const Noise_State* state, uint8_t octave, uint32_t* deviation);
+
+    /**
+    *   \brief Get the summary of the noise.
+    *
+    *   The effective number of bits is \f$ \log_2(FS / \sigma) \f$, with
+    *   FS the full-scale range #NOISE_FULL_SCALE and \f$ \sigma \f$ the RMS noise.
+    *   \param[in] state the state of the accumulator.
+    *   \param[out] summary the summary.
+    *   \retval #FDC_OK if the summary was computed.
+    *   \retval #FDC_MEAS_NOT_DONE if less than two samples were added.
+    */
+    uint8_t Noise_GetSummary(const Noise_State* state, Noise_Summary* summary);
+
+#endif
+/* [] END OF FILE */
@@ -0,0 +1,244 @@
+/**
+*   \brief Source file for the activity-adaptive sample rate.
+*/
+
+#include "RateControl.h"
+
+/**
+*   \brief Number of channels in each frame.
+*/
+#define RATE_CONTROL_CHANNELS 4
+
+/**
+*   \brief Number of fractional bits of the baseline.
+*/
+#define RATE_CONTROL_FRACT_BITS 8
+
+// Configuration
+static RateControl_Config rate_control_config;
+// Current tier
+static uint8_t rate_control_tier;
+// Baseline of each channel, in LSB with RATE_CONTROL_FRACT_BITS fractional bits
+static int64_t rate_control_baseline[RATE_CONTROL_CHANNELS];
+// CAPDAC of the last sample of each channel
+static uint8_t rate_control_capdac[RATE_CONTROL_CHANNELS];
+// Channels with a valid baseline, as FDC_RP_CH_x flags
+static uint8_t rate_control_valid;
+// Time spent below the exit threshold of the current tier (us)
+static uint32_t rate_control_quiet;
+// Sample clock (us)
+static uint64_t rate_control_time;
+// Number of processed frames
+static uint32_t rate_control_frames;
+// Switch log, circular buffer
+static RateControl_Switch rate_control_log[RATE_CONTROL_LOG_SIZE];
+// Number of switches since initialization
+static uint32_t rate_control_switches;
+
+// Frame period of a tier (us)
+static uint32_t rate_control_period(const RateControl_Tier* tier);
+
+// Select a tier and record the switch
+static void rate_control_switch(uint8_t tier, int32_t activity);
+
+uint8_t RateControl_Init(const RateControl_Config* config)
+{
+    if ((config->tier_count == 0) || (config->tier_count > RATE_CONTROL_MAX_TIERS) ||
+        (config->baseline_shift > 24))
+    {
+        return FDC_CONF_ERR;
+    }
+    for (uint8_t t = 0; t < config->tier_count; t++)
+    {
+        const RateControl_Tier* tier = &config->tiers[t];
+        if ((tier->rate < FDC_100_Hz) || (tier->rate > FDC_400_Hz) ||
+            ((tier->channels & (FDC_RP_CH_1 | FDC_RP_CH_2 | FDC_RP_CH_3 | FDC_RP_CH_4)) == 0) ||
+            ((tier->channels & ~(FDC_RP_CH_1 | FDC_RP_CH_2 | FDC_RP_CH_3 | FDC_RP_CH_4)) != 0))
+        {
+            return FDC_CONF_ERR;
+        }
+        if ((t > 0) && (tier->exit_threshold > tier->enter_threshold))
+        {
+            return FDC_CONF_ERR;
+        }
+        if ((t > 1) && (tier->enter_threshold <= config->tiers[t - 1].enter_threshold))
+        {
+            return FDC_CONF_ERR;
+        }
+    }
+    rate_control_config = *config;
+    rate_control_tier = config->tier_count - 1;
+    rate_control_valid = 0;
+    rate_control_quiet = 0;
+    rate_control_time = 0;
+    rate_control_frames = 0;
+    rate_control_switches = 0;
+    return FDC_OK;
+}
+
+uint8_t RateControl_Update(const int32_t* capacitance, const uint8_t* capdac)
+{
+    const RateControl_Tier* tier = &rate_control_config.tiers[rate_control_tier];
+    uint32_t period = rate_control_period(tier);
+    rate_control_time += period;
+    rate_control_frames++;
+    
+    // Same baseline time constant at all the rates
+    uint8_t shift = rate_control_config.baseline_shift + (tier->rate - FDC_100_Hz);
+    int32_t activity = 0;
+    for (uint8_t ch = 0; ch < RATE_CONTROL_CHANNELS; ch++)
+    {
+        uint8_t flag = FDC_RP_CH_1 >> ch;
+        if (!(tier->channels & flag))
+        {
+            continue;
+        }
+        int64_t sample = (int64_t)capacitance[ch] * (1L << RATE_CONTROL_FRACT_BITS);
+        if (!(rate_control_valid & flag) || (rate_control_capdac[ch] != capdac[ch]))
+        {
+            // Start again from the current sample
+            rate_control_baseline[ch] = sample;
+            rate_control_capdac[ch] = capdac[ch];
+            rate_control_valid |= flag;
+            continue;
+        }
+        int64_t deviation = sample - rate_control_baseline[ch];
+        int64_t magnitude = ((deviation >= 0) ? deviation : -deviation) >> RATE_CONTROL_FRACT_BITS;
+        if (magnitude > activity)
+        {
+            activity = (magnitude > INT32_MAX) ? INT32_MAX : (int32_t)magnitude;
+        }
+        rate_control_baseline[ch] += deviation >> shift;
+    }
+    
+    // Enter a more active tier at once
+    for (uint8_t t = rate_control_config.tier_count - 1; t > rate_control_tier; t--)
+    {
+        if (activity >= rate_control_config.tiers[t].enter_threshold)
+        {
+            rate_control_switch(t, activity);
+            return 1;
+        }
+    }
+    if (rate_control_tier == 0)
+    {
+        return 0;
+    }
+    
+    // Leave for a less active tier after the hold time
+    if (activity >= tier->exit_threshold)
+    {
+        rate_control_quiet = 0;
+        return 0;
+    }
+    rate_control_quiet += period;
+    if (rate_control_quiet < (uint32_t)rate_control_config.hold_time * 1000)
+    {
+        return 0;
+    }
+    uint8_t target = rate_control_tier - 1;
+    while ((target > 0) && (activity < rate_control_config.tiers[target].enter_threshold))
+    {
+        target--;
+    }
+    rate_control_switch(target, activity);
+    return 1;
+}
+
+uint8_t RateControl_Apply(void)
+{
+    const RateControl_Tier* tier = &rate_control_config.tiers[rate_control_tier];
+    uint8_t error = FDC_SetSampleRate(tier->rate);
+    if (error == FDC_OK)
+    {
+        error = FDC_EnableRepeatMeasurement(tier->channels);
+    }
+    return error;
+}
+
+uint8_t RateControl_GetTier(void)
+{
+    return rate_control_tier;
+}
+
+uint8_t RateControl_GetDoneMask(void)
+{
+    // Repeat flags are the done flags shifted by 4
+    return rate_control_config.tiers[rate_control_tier].channels >> 4;
+}
+
+uint32_t RateControl_GetFramePeriod(void)
+{
+    return rate_control_period(&rate_control_config.tiers[rate_control_tier]);
+}
+
+uint64_t RateControl_GetTimestamp(void)
+{
+    return rate_control_time;
+}
+
+uint32_t RateControl_GetSwitchCount(void)
+{
+    return rate_control_switches;
+}
+
+uint8_t RateControl_GetSwitch(uint8_t index, RateControl_Switch* entry)
+{
+    uint32_t kept = (rate_control_switches < RATE_CONTROL_LOG_SIZE) ? 
+        rate_control_switches : RATE_CONTROL_LOG_SIZE;
+    if (index >= kept)
+    {
+        return FDC_CONF_ERR;
+    }
+    *entry = rate_control_log[(rate_control_switches - kept + index) & (RATE_CONTROL_LOG_SIZE - 1)];
+    return FDC_OK;
+}
+
+// ===================================================================
+//                         HELPER FUNCTIONS
+// ===================================================================
+
+uint32_t rate_control_period(const RateControl_Tier* tier)
+{
+    uint32_t period;
+    switch (tier->rate)
+    {
+        case FDC_100_Hz:
+            period = 10000;
+            break;
+        case FDC_200_Hz:
+            period = 5000;
+            break;
+        default:
+            period = 2500;
+            break;
+    }
+    // The measurements of a frame are carried out one after the other
+    uint32_t frame = 0;
+    for (uint8_t ch = 0; ch < RATE_CONTROL_CHANNELS; ch++)
+    {
+        if (tier->channels & (FDC_RP_CH_1 >> ch))
+        {
+            frame += period;
+        }
+    }
+    return frame;
+}
+
+void rate_control_switch(uint8_t tier, int32_t activity)
+{
+    RateControl_Switch* entry = &rate_control_log[rate_control_switches & (RATE_CONTROL_LOG_SIZE - 1)];
+    entry->timestamp = (uint32_t)(rate_control_time / 1000);
+    entry->frame = rate_control_frames;
+    entry->activity = activity;
+    entry->from = rate_control_tier;
+    entry->to = tier;
+    rate_control_switches++;
+    
+    rate_control_tier = tier;
+    rate_control_quiet = 0;
+    // Baselines of the channels no longer measured go stale
+    rate_control_valid &= rate_control_config.tiers[tier].channels;
+}
+
+/* [] END OF FILE */
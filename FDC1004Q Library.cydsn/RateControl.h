@@ -0,0 +1,174 @@
+/**
+*   \file RateControl.h
+*   \brief Activity-adaptive sample rate.
+*
+*   This file contains a controller that selects the sample rate and the
+*   measured channels from the activity of the signal, so that the device
+*   is sampled at the highest rate only while something is changing and
+*   the bus is left idle for the rest of the time.
+*
+*   The configuration lists up to #RATE_CONTROL_MAX_TIERS tiers, from the
+*   least to the most active, each with a sample rate, a repeat
+*   measurement mask and two thresholds. The activity of a frame is the
+*   largest deviation of the measured channels from a slow baseline. A
+*   tier is entered as soon as the activity reaches its enter threshold,
+*   and left towards the lower tiers only after the activity stays below
+*   its exit threshold for the hold time. The baseline time constant is
+*   scaled with the sample rate, so that the thresholds mean the same at
+*   all the rates.
+*
+*   The controller keeps its own sample clock, advanced at each frame by
+*   the frame period of the tier the frame was measured in, so that
+*   timestamps computed from it stay consistent across switches. Since the
+*   measurements of a frame are carried out one after the other, the frame
+*   period is the sample period times the number of measured channels. Every switch is
+*   recorded in a log of the last #RATE_CONTROL_LOG_SIZE switches.
+*
+*   #RateControl_Update only works on the values passed in, so it can be
+*   fed with recorded captures; #RateControl_Apply programs the device.
+*
+*   \author Davide Marzorati
+*/
+
+#ifndef __RATE_CONTROL_H__
+    #define __RATE_CONTROL_H__
+
+    #include "FDC1004Q.h"
+
+    /**
+    *   \brief Maximum number of tiers.
+    */
+    #define RATE_CONTROL_MAX_TIERS 3
+
+    /**
+    *   \brief Number of switches kept in the log, must be a power of 2.
+    */
+    #ifndef RATE_CONTROL_LOG_SIZE
+        #define RATE_CONTROL_LOG_SIZE 16
+    #endif
+
+    #if (RATE_CONTROL_LOG_SIZE & (RATE_CONTROL_LOG_SIZE - 1)) != 0
+        #error "RATE_CONTROL_LOG_SIZE must be a power of 2"
+    #endif
+
+    /**
+    *   \brief Tier of the controller.
+    */
+    typedef struct {
+        /** Sample rate, #FDC_100_Hz, #FDC_200_Hz or #FDC_400_Hz **/
+        uint8_t rate;
+        /** Measured channels, as #FDC_RP_CH_1 ... #FDC_RP_CH_4 flags **/
+        uint8_t channels;
+        /** Activity that enters the tier from a lower one, in LSB **/
+        int32_t enter_threshold;
+        /** Activity below which the tier is left for a lower one, in LSB **/
+        int32_t exit_threshold;
+    } RateControl_Tier;
+
+    /**
+    *   \brief Configuration of the controller.
+    */
+    typedef struct {
+        /** Tiers, from the least to the most active **/
+        RateControl_Tier tiers[RATE_CONTROL_MAX_TIERS];
+        /** Number of tiers **/
+        uint8_t tier_count;
+        /** Time the activity must stay below the exit threshold before a lower tier is selected (ms) **/
+        uint16_t hold_time;
+        /** Time constant of the baseline, as a power of 2 of the frames at #FDC_100_Hz **/
+        uint8_t baseline_shift;
+    } RateControl_Config;
+
+    /**
+    *   \brief Entry of the switch log.
+    */
+    typedef struct {
+        /** Sample clock at the switch (ms) **/
+        uint32_t timestamp;
+        /** Number of frames processed before the switch **/
+        uint32_t frame;
+        /** Activity that caused the switch, in LSB **/
+        int32_t activity;
+        /** Previous tier **/
+        uint8_t from;
+        /** New tier **/
+        uint8_t to;
+    } RateControl_Switch;
+
+    /**
+    *   \brief Initialize the controller.
+    *
+    *   The most active tier is selected, the sample clock and the log are
+    *   cleared. The device is not programmed until #RateControl_Apply is
+    *   called.
+    *   \param[in] config the configuration, copied.
+    *   \retval #FDC_OK if the controller was initialized.
+    *   \retval #FDC_CONF_ERR if the configuration is not valid: there must
+    *       be at least one tier, each with a valid rate and at least one
+    *       channel, with the enter thresholds increasing from a tier to the
+    *       next and each exit threshold not above the enter threshold.
+    */
+    uint8_t RateControl_Init(const RateControl_Config* config);
+
+    /**
+    *   \brief Process a frame.
+    *
+    *   Only the channels measured in the current tier are used.
+    *   \param[in] capacitance the capacitance of the four channels, in
+    *       units of the measurement LSB.
+    *   \param[in] capdac the CAPDAC settings the samples were measured with.
+    *   \return 1 if the tier changed and the device must be reprogrammed
+    *       with #RateControl_Apply, 0 otherwise.
+    */
+    uint8_t RateControl_Update(const int32_t* capacitance, const uint8_t* capdac);
+
+    /**
+    *   \brief Program the sample rate and the repeat mask of the current tier.
+    *   \retval #FDC_OK if the device was programmed.
+    *   \retval #FDC_COMM_ERR if error occurred during communication.
+    */
+    uint8_t RateControl_Apply(void);
+
+    /**
+    *   \brief Get the current tier.
+    *   \return the index of the tier in the configuration.
+    */
+    uint8_t RateControl_GetTier(void);
+
+    /**
+    *   \brief Get the channels measured in the current tier.
+    *   \return the channels, as #FDC_DONE_CH_1 ... #FDC_DONE_CH_4 flags.
+    */
+    uint8_t RateControl_GetDoneMask(void);
+
+    /**
+    *   \brief Get the frame period of the current tier.
+    *
+    *   The sample period of the tier times the number of measured channels.
+    *   \return the frame period (us).
+    */
+    uint32_t RateControl_GetFramePeriod(void);
+
+    /**
+    *   \brief Get the sample clock.
+    *   \return the time of the last processed frame (us).
+    */
+    uint64_t RateControl_GetTimestamp(void);
+
+    /**
+    *   \brief Get the number of switches since #RateControl_Init.
+    *   \return the number of switches, including the ones no longer in the log.
+    */
+    uint32_t RateControl_GetSwitchCount(void);
+
+    /**
+    *   \brief Read an entry of the switch log.
+    *   \param index the entry, 0 being the oldest one still in the log.
+    *   \param[out] entry the entry.
+    *   \retval #FDC_OK if the entry was read.
+    *   \retval #FDC_CONF_ERR if the log holds fewer entries.
+    */
+    uint8_t RateControl_GetSwitch(uint8_t index, RateControl_Switch* entry);
+
+#endif
+/* [] END OF FILE */
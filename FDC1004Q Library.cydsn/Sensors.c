@@ -0,0 +1,32 @@
+/**
+*   \brief Source file for the processing of the capacitance samples.
+*/
+
+#include "Sensors.h"
+
+/**
+*   \brief Margin above the CAPDAC offset in LSB units.
+*/
+#define SENSORS_CAPDAC_MARGIN_FIXED ((int32_t)SENSORS_CAPDAC_MARGIN << 19)
+
+uint8_t Sensors_TuneCapdac(const uint32_t* raw, const uint8_t* measured_capdac,
+                           uint8_t* capdac, int32_t* capacitance)
+{
+    uint8_t changed = 0;
+    FDC_ConvertRawMeasurementsFixed(raw, measured_capdac, capacitance, SENSORS_CHANNELS);
+    for (uint8_t ch = 0; ch < SENSORS_CHANNELS; ch++)
+    {
+        if ( capacitance[ch] > (SENSORS_CAPDAC_MARGIN_FIXED + (capdac[ch] * FDC_CAPDAC_FIXED_FACTOR)))
+        {
+            // Increase CAPDAC
+            if (capdac[ch] < FDC_CAPDAC_MAX)
+            {
+                capdac[ch] += 1;
+                changed |= 1 << ch;
+            }
+        }
+    }
+    return changed;
+}
+
+/* [] END OF FILE */
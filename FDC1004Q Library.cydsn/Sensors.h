@@ -0,0 +1,54 @@
+/**
+*   \file Sensors.h
+*   \brief Processing of the capacitance samples.
+*
+*   This file contains the processing applied to each sample frame by
+*   the application. The functions only work on the values passed in and
+*   never access the bus, so that they can be compiled for a host and fed
+*   with recorded captures.
+*
+*   \author Davide Marzorati
+*/
+
+#ifndef __SENSORS_H__
+    #define __SENSORS_H__
+
+    #include "FDC1004Q.h"
+
+    /**
+    *   \brief Number of channels processed in each frame.
+    */
+    #define SENSORS_CHANNELS 4
+
+    /**
+    *   \brief Upper limit of the capacitance above the CAPDAC offset (pF).
+    *
+    *   When the measurement exceeds the CAPDAC offset by more than this
+    *   value, the CAPDAC is increased by one step.
+    */
+    #define SENSORS_CAPDAC_MARGIN 15
+
+    /**
+    *   \brief Convert a frame and compute the next CAPDAC settings.
+    *
+    *   This function converts the raw measurements of a frame to fixed point,
+    *   adding the offset of the CAPDAC setting they were measured with, and
+    *   increases the CAPDAC of the channels that are getting close to
+    *   the upper end of the input range. Only integer operations are used.
+    *
+    *   The setting a frame was measured with can differ from the current
+    *   setting, for instance right after a saturation re-range, so both are
+    *   passed: the first for the conversion, the second for the tuning.
+    *   \param[in] raw the raw measurements of the four channels.
+    *   \param[in] measured_capdac the CAPDAC settings the measurements were taken with.
+    *   \param[in,out] capdac the current CAPDAC settings of the four channels,
+    *       updated with the new settings.
+    *   \param[out] capacitance the converted capacitance of the four channels,
+    *       in units of the measurement LSB (see #FDC_ConvertRawMeasurementsFixed).
+    *   \return mask of the channels whose CAPDAC changed (bit n for channel n).
+    */
+    uint8_t Sensors_TuneCapdac(const uint32_t* raw, const uint8_t* measured_capdac,
+                               uint8_t* capdac, int32_t* capacitance);
+
+#endif
+/* [] END OF FILE */
@@ -0,0 +1,147 @@
+/**
+*   \brief Source file for the slider and wheel position.
+*/
+
+#include "Slider.h"
+
+/**
+*   \brief Electrode pitch, with #SLIDER_FRACT_BITS fractional bits.
+*/
+#define SLIDER_PITCH (1L << SLIDER_FRACT_BITS)
+
+/**
+*   \brief Length of a full turn of the wheel.
+*/
+#define SLIDER_TURN (SLIDER_ELECTRODES * SLIDER_PITCH)
+
+// Wrap a change of position on the wheel to the shortest path
+static int32_t slider_wrap_delta(const Slider_State* state, int32_t delta);
+
+uint8_t Slider_Init(Slider_State* state, const Slider_Config* config)
+{
+    if (((config->type != SLIDER_LINEAR) && (config->type != SLIDER_WHEEL)) ||
+        (config->release_threshold > config->touch_threshold) ||
+        (config->noise_threshold < 0) || (config->filter_shift > 16))
+    {
+        return FDC_CONF_ERR;
+    }
+    state->config = *config;
+    state->position = 0;
+    state->touched = 0;
+    return FDC_OK;
+}
+
+void Slider_Process(Slider_State* state, const int32_t* delta, Slider_Output* output)
+{
+    // Changes above the noise threshold, and strongest electrode
+    int32_t signal[SLIDER_ELECTRODES];
+    uint8_t peak = 0;
+    output->strength = 0;
+    for (uint8_t i = 0; i < SLIDER_ELECTRODES; i++)
+    {
+        signal[i] = (delta[i] > state->config.noise_threshold) ? 
+            delta[i] - state->config.noise_threshold : 0;
+        output->strength += signal[i];
+        if (delta[i] > delta[peak])
+        {
+            peak = i;
+        }
+    }
+    
+    // Touch with hysteresis
+    uint8_t touch_start = 0;
+    if (!state->touched && (delta[peak] >= state->config.touch_threshold))
+    {
+        state->touched = 1;
+        touch_start = 1;
+    }
+    else if (state->touched && (delta[peak] < state->config.release_threshold))
+    {
+        state->touched = 0;
+    }
+    output->touched = state->touched;
+    output->velocity = 0;
+    if (!state->touched)
+    {
+        output->position = state->position;
+        return;
+    }
+    
+    // Centroid of the strongest electrode and of its neighbours
+    int32_t previous;
+    int32_t next;
+    if (state->config.type == SLIDER_WHEEL)
+    {
+        previous = signal[(peak + SLIDER_ELECTRODES - 1) % SLIDER_ELECTRODES];
+        next = signal[(peak + 1) % SLIDER_ELECTRODES];
+    }
+    else
+    {
+        previous = (peak > 0) ? signal[peak - 1] : 0;
+        next = (peak < SLIDER_ELECTRODES - 1) ? signal[peak + 1] : 0;
+    }
+    int64_t sum = (int64_t)previous + signal[peak] + next;
+    int32_t position = peak * SLIDER_PITCH;
+    if (sum > 0)
+    {
+        position += (int32_t)(((int64_t)(next - previous) * SLIDER_PITCH) / sum);
+    }
+    if (state->config.type == SLIDER_WHEEL)
+    {
+        position = (position + SLIDER_TURN) % SLIDER_TURN;
+    }
+    else if (position < 0)
+    {
+        position = 0;
+    }
+    else if (position > (SLIDER_ELECTRODES - 1) * SLIDER_PITCH)
+    {
+        position = (SLIDER_ELECTRODES - 1) * SLIDER_PITCH;
+    }
+    
+    if (touch_start)
+    {
+        state->position = position;
+    }
+    else
+    {
+        // Smooth, rounding to nearest
+        int32_t change = slider_wrap_delta(state, position - state->position);
+        if (state->config.filter_shift > 0)
+        {
+            int32_t half = 1L << (state->config.filter_shift - 1);
+            change = (change >= 0) ? (change + half) >> state->config.filter_shift : 
+                                     -((-change + half) >> state->config.filter_shift);
+        }
+        output->velocity = change;
+        position = state->position + change;
+        if (state->config.type == SLIDER_WHEEL)
+        {
+            position = (position + SLIDER_TURN) % SLIDER_TURN;
+        }
+        state->position = position;
+    }
+    output->position = state->position;
+}
+
+// ===================================================================
+//                         HELPER FUNCTIONS
+// ===================================================================
+
+int32_t slider_wrap_delta(const Slider_State* state, int32_t delta)
+{
+    if (state->config.type == SLIDER_WHEEL)
+    {
+        if (delta >= SLIDER_TURN / 2)
+        {
+            delta -= SLIDER_TURN;
+        }
+        else if (delta < -SLIDER_TURN / 2)
+        {
+            delta += SLIDER_TURN;
+        }
+    }
+    return delta;
+}
+
+/* [] END OF FILE */
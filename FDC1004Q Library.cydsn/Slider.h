@@ -0,0 +1,116 @@
+/**
+*   \file Slider.h
+*   \brief Position of a finger on a capacitive slider or wheel.
+*
+*   This file contains a processing stage for the common application of the
+*   four inputs as the electrodes of a linear slider or of a rotary wheel.
+*   From the baseline-compensated change of capacitance of the four
+*   channels in a frame, the stage detects the touch with a hysteresis on
+*   the strongest channel and interpolates the position of the finger with
+*   the centroid of the strongest electrode and of its two neighbours,
+*   giving a resolution finer than the electrode pitch. On a wheel the
+*   first and last electrodes are neighbours; on a slider the outer
+*   neighbour of the end electrodes is missing, so the position is pulled
+*   towards the centre when the finger is near the ends.
+*
+*   The position is expressed in electrode pitches with #SLIDER_FRACT_BITS
+*   fractional bits, 0 being the centre of the electrode of channel
+*   #FDC_CH_1: it ranges from 0 to 3 on a slider, and from 0 up to 4
+*   (excluded) on a wheel, where it wraps around. The velocity is the
+*   change of position between consecutive frames, along the shortest path
+*   on a wheel.
+*
+*   Each frame takes a fixed number of integer operations and a single
+*   division, independently of the input.
+*
+*   \author Davide Marzorati
+*/
+
+#ifndef __SLIDER_H__
+    #define __SLIDER_H__
+
+    #include "FDC1004Q.h"
+
+    /**
+    *   \brief Number of electrodes.
+    */
+    #define SLIDER_ELECTRODES 4
+
+    /**
+    *   \brief Number of fractional bits of the position and of the velocity.
+    */
+    #define SLIDER_FRACT_BITS 8
+
+    /**
+    *   \brief Linear slider, from the electrode of #FDC_CH_1 to the one of #FDC_CH_4.
+    */
+    #define SLIDER_LINEAR 0
+
+    /**
+    *   \brief Rotary wheel, the electrode of #FDC_CH_4 is next to the one of #FDC_CH_1.
+    */
+    #define SLIDER_WHEEL 1
+
+    /**
+    *   \brief Configuration of the slider.
+    */
+    typedef struct {
+        /** Layout, #SLIDER_LINEAR or #SLIDER_WHEEL **/
+        uint8_t type;
+        /** Change of capacitance that starts a touch, in LSB **/
+        int32_t touch_threshold;
+        /** Change of capacitance that ends a touch, in LSB **/
+        int32_t release_threshold;
+        /** Change of capacitance ignored on each electrode, in LSB **/
+        int32_t noise_threshold;
+        /** Smoothing of the position, as a power of 2 of the time constant in frames (0 for none) **/
+        uint8_t filter_shift;
+    } Slider_Config;
+
+    /**
+    *   \brief State of the slider.
+    */
+    typedef struct {
+        /** Configuration **/
+        Slider_Config config;
+        /** Smoothed position, with #SLIDER_FRACT_BITS fractional bits **/
+        int32_t position;
+        /** Set while touched **/
+        uint8_t touched;
+    } Slider_State;
+
+    /**
+    *   \brief Output of the slider.
+    */
+    typedef struct {
+        /** Position, with #SLIDER_FRACT_BITS fractional bits, valid when touched **/
+        int32_t position;
+        /** Change of position from the previous frame, 0 at the start of a touch **/
+        int32_t velocity;
+        /** Sum of the changes of capacitance above the noise threshold, in LSB **/
+        int32_t strength;
+        /** Set while touched **/
+        uint8_t touched;
+    } Slider_Output;
+
+    /**
+    *   \brief Initialize the slider.
+    *   \param[out] state the state of the slider.
+    *   \param[in] config the configuration, copied into the state.
+    *   \retval #FDC_OK if the slider was initialized.
+    *   \retval #FDC_CONF_ERR if the type is not valid, the release threshold
+    *       is above the touch threshold, or the noise threshold is negative.
+    */
+    uint8_t Slider_Init(Slider_State* state, const Slider_Config* config);
+
+    /**
+    *   \brief Process a frame.
+    *   \param[in,out] state the state of the slider.
+    *   \param[in] delta the change of capacitance of the four channels from
+    *       their baseline, in units of the measurement LSB.
+    *   \param[out] output the touch state and the position.
+    */
+    void Slider_Process(Slider_State* state, const int32_t* delta, Slider_Output* output);
+
+#endif
+/* [] END OF FILE */
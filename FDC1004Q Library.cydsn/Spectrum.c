@@ -0,0 +1,327 @@
+/**
+*   \brief Source file for the Welch power spectrum estimation.
+*/
+
+#include "Spectrum.h"
+
+/**
+*   \brief Number of steps of the sine table over a full period.
+*/
+#define SPECTRUM_SINE_PERIOD 512
+
+/**
+*   \brief Bound of the FFT input, so that the output fits 31 bits.
+*/
+#define SPECTRUM_INPUT_BITS (30 - SPECTRUM_FFT_BITS)
+
+/**
+*   \brief Number of fractional bits of the accumulated power.
+*/
+#define SPECTRUM_SUM_FRACT_BITS 16
+
+/**
+*   \brief First quarter of the sine, sin(2 pi i / 512) in Q15.
+*/
+static const int16_t spectrum_sine[SPECTRUM_SINE_PERIOD / 4 + 1] = {
+        0,   402,   804,  1206,  1608,  2009,  2410,  2811,
+     3212,  3612,  4011,  4410,  4808,  5205,  5602,  5998,
+     6393,  6786,  7179,  7571,  7962,  8351,  8739,  9126,
+     9512,  9896, 10278, 10659, 11039, 11417, 11793, 12167,
+    12539, 12910, 13279, 13645, 14010, 14372, 14732, 15090,
+    15446, 15800, 16151, 16499, 16846, 17189, 17530, 17869,
+    18204, 18537, 18868, 19195, 19519, 19841, 20159, 20475,
+    20787, 21096, 21403, 21705, 22005, 22301, 22594, 22884,
+    23170, 23452, 23731, 24007, 24279, 24547, 24811, 25072,
+    25329, 25582, 25832, 26077, 26319, 26556, 26790, 27019,
+    27245, 27466, 27683, 27896, 28105, 28310, 28510, 28706,
+    28898, 29085, 29268, 29447, 29621, 29791, 29956, 30117,
+    30273, 30424, 30571, 30714, 30852, 30985, 31113, 31237,
+    31356, 31470, 31580, 31685, 31785, 31880, 31971, 32057,
+    32137, 32213, 32285, 32351, 32412, 32469, 32521, 32567,
+    32609, 32646, 32678, 32705, 32728, 32745, 32757, 32765,
+    32767
+};
+
+// Sine of an angle in steps of 2 pi / SPECTRUM_SINE_PERIOD, Q15
+static int32_t spectrum_sin(uint16_t angle);
+
+// Hann window, Q15
+static int32_t spectrum_window(uint16_t i);
+
+// Process the segment in the buffer
+static void spectrum_process(Spectrum_State* state);
+
+// N times the energy of the window, Q16
+static uint64_t spectrum_divisor(void);
+
+// Power of a bin of the last segment, in LSB^2 with SPECTRUM_SUM_FRACT_BITS fractional bits
+static uint64_t spectrum_bin_power(const Spectrum_State* state, uint16_t bin, uint64_t divisor);
+
+// Round a power to SPECTRUM_FRACT_BITS fractional bits
+static uint64_t spectrum_round(uint64_t power);
+
+void Spectrum_Init(Spectrum_State* state, Spectrum_SegmentCallback callback)
+{
+    for (uint16_t i = 0; i < SPECTRUM_FFT_SIZE; i++)
+    {
+        state->samples[i] = 0;
+        state->re[i] = 0;
+        state->im[i] = 0;
+    }
+    for (uint16_t k = 0; k < SPECTRUM_BINS; k++)
+    {
+        state->power[k] = 0;
+    }
+    state->callback = callback;
+    state->segments = 0;
+    state->index = 0;
+    state->fill = 0;
+    state->shift = 0;
+    state->capdac = 0;
+}
+
+void Spectrum_AddSample(Spectrum_State* state, int32_t capacitance, uint8_t capdac)
+{
+    if (state->capdac != capdac)
+    {
+        // Discard the current segment
+        state->capdac = capdac;
+        state->fill = 0;
+    }
+    state->samples[state->index] = capacitance;
+    state->index = (state->index + 1) & (SPECTRUM_FFT_SIZE - 1);
+    state->fill++;
+    if (state->fill == SPECTRUM_FFT_SIZE)
+    {
+        spectrum_process(state);
+        // Next segment overlaps by half
+        state->fill = SPECTRUM_FFT_SIZE / 2;
+        if (state->callback != NULL)
+        {
+            state->callback(state);
+        }
+    }
+}
+
+void Spectrum_AddCaptureBlock(Spectrum_State* states, const FDC_CaptureBlock* block)
+{
+    for (uint8_t ch = 0; ch < FDC_CAPTURE_CHANNELS; ch++)
+    {
+        if (block->header.channel_mask & (FDC_RP_CH_1 >> ch))
+        {
+            for (uint8_t i = 0; i < block->header.sample_count; i++)
+            {
+                Spectrum_AddSample(&states[ch], block->raw[ch][i], block->capdac[ch][i]);
+            }
+        }
+    }
+}
+
+uint8_t Spectrum_GetPsd(const Spectrum_State* state, uint64_t* power)
+{
+    if (state->segments == 0)
+    {
+        return FDC_MEAS_NOT_DONE;
+    }
+    for (uint16_t k = 0; k < SPECTRUM_BINS; k++)
+    {
+        power[k] = spectrum_round(state->power[k] / state->segments);
+    }
+    return FDC_OK;
+}
+
+uint8_t Spectrum_GetSegment(const Spectrum_State* state, uint64_t* power)
+{
+    if (state->segments == 0)
+    {
+        return FDC_MEAS_NOT_DONE;
+    }
+    uint64_t divisor = spectrum_divisor();
+    for (uint16_t k = 0; k < SPECTRUM_BINS; k++)
+    {
+        power[k] = spectrum_round(spectrum_bin_power(state, k, divisor));
+    }
+    return FDC_OK;
+}
+
+// ===================================================================
+//                         HELPER FUNCTIONS
+// ===================================================================
+
+int32_t spectrum_sin(uint16_t angle)
+{
+    angle &= SPECTRUM_SINE_PERIOD - 1;
+    if (angle <= SPECTRUM_SINE_PERIOD / 4)
+    {
+        return spectrum_sine[angle];
+    }
+    if (angle <= SPECTRUM_SINE_PERIOD / 2)
+    {
+        return spectrum_sine[SPECTRUM_SINE_PERIOD / 2 - angle];
+    }
+    return -spectrum_sin(angle - SPECTRUM_SINE_PERIOD / 2);
+}
+
+int32_t spectrum_window(uint16_t i)
+{
+    // sin^2(pi i / N)
+    int32_t sine = spectrum_sin(i * (SPECTRUM_SINE_PERIOD / 2 / SPECTRUM_FFT_SIZE));
+    return (sine * sine) >> 15;
+}
+
+void spectrum_process(Spectrum_State* state)
+{
+    // Remove the mean, oldest sample first
+    int64_t sum = 0;
+    for (uint16_t i = 0; i < SPECTRUM_FFT_SIZE; i++)
+    {
+        sum += state->samples[i];
+    }
+    int32_t mean = (int32_t)(sum / SPECTRUM_FFT_SIZE);
+    int32_t remainder = (int32_t)(sum - (int64_t)mean * SPECTRUM_FFT_SIZE);
+    // Margin for the fractional part of the mean
+    uint32_t peak = 1;
+    for (uint16_t i = 0; i < SPECTRUM_FFT_SIZE; i++)
+    {
+        state->re[i] = state->samples[(state->index + i) & (SPECTRUM_FFT_SIZE - 1)] - mean;
+        state->im[i] = 0;
+        uint32_t magnitude = (state->re[i] >= 0) ? (uint32_t)state->re[i] : -(uint32_t)state->re[i];
+        if (magnitude > peak)
+        {
+            peak = magnitude;
+        }
+    }
+    
+    // Scale to the largest input that cannot overflow
+    int8_t shift = 0;
+    while (peak >= (1UL << (SPECTRUM_INPUT_BITS - 1)))
+    {
+        peak >>= 1;
+        shift--;
+    }
+    while (peak < (1UL << (SPECTRUM_INPUT_BITS - 2)))
+    {
+        peak <<= 1;
+        shift++;
+    }
+    state->shift = shift;
+    for (uint16_t i = 0; i < SPECTRUM_FFT_SIZE; i++)
+    {
+        int64_t value = (shift >= 0) ? 
+            (int64_t)state->re[i] * ((int64_t)1 << shift) - 
+                (int64_t)remainder * ((int64_t)1 << shift) / SPECTRUM_FFT_SIZE : 
+            (int64_t)(state->re[i] >> -shift);
+        state->re[i] = (int32_t)((value * spectrum_window(i)) >> 15);
+    }
+    
+    // Bit-reversed order
+    for (uint16_t i = 0; i < SPECTRUM_FFT_SIZE; i++)
+    {
+        uint16_t reversed = 0;
+        for (uint8_t b = 0; b < SPECTRUM_FFT_BITS; b++)
+        {
+            reversed |= ((i >> b) & 1) << (SPECTRUM_FFT_BITS - 1 - b);
+        }
+        if (reversed > i)
+        {
+            int32_t value = state->re[i];
+            state->re[i] = state->re[reversed];
+            state->re[reversed] = value;
+        }
+    }
+    
+    // Radix-2 decimation in time
+    for (uint16_t size = 2; size <= SPECTRUM_FFT_SIZE; size <<= 1)
+    {
+        uint16_t half = size / 2;
+        uint16_t step = SPECTRUM_SINE_PERIOD / size;
+        for (uint16_t start = 0; start < SPECTRUM_FFT_SIZE; start += size)
+        {
+            for (uint16_t j = 0; j < half; j++)
+            {
+                int64_t wr = spectrum_sin(j * step + SPECTRUM_SINE_PERIOD / 4);
+                int64_t wi = -spectrum_sin(j * step);
+                uint16_t a = start + j;
+                uint16_t b = a + half;
+                int32_t tr = (int32_t)((state->re[b] * wr - state->im[b] * wi) >> 15);
+                int32_t ti = (int32_t)((state->re[b] * wi + state->im[b] * wr) >> 15);
+                state->re[b] = state->re[a] - tr;
+                state->im[b] = state->im[a] - ti;
+                state->re[a] += tr;
+                state->im[a] += ti;
+            }
+        }
+    }
+    
+    // Add to the average
+    uint64_t divisor = spectrum_divisor();
+    for (uint16_t k = 0; k < SPECTRUM_BINS; k++)
+    {
+        uint64_t power = spectrum_bin_power(state, k, divisor);
+        state->power[k] = (state->power[k] <= UINT64_MAX - power) ? state->power[k] + power : UINT64_MAX;
+    }
+    if (state->segments < UINT32_MAX)
+    {
+        state->segments++;
+    }
+}
+
+uint64_t spectrum_divisor(void)
+{
+    uint64_t energy = 0;
+    for (uint16_t i = 0; i < SPECTRUM_FFT_SIZE; i++)
+    {
+        int64_t w = spectrum_window(i);
+        energy += (uint64_t)(w * w);
+    }
+    // Energy is Q30
+    return (energy * SPECTRUM_FFT_SIZE) >> 14;
+}
+
+uint64_t spectrum_bin_power(const Spectrum_State* state, uint16_t bin, uint64_t divisor)
+{
+    int64_t re = state->re[bin];
+    int64_t im = state->im[bin];
+    uint64_t power = (uint64_t)(re * re) + (uint64_t)(im * im);
+    
+    // Remove the input scale 2^(2 shift) and the Q16 divisor
+    int8_t scale = (int8_t)(2 * SPECTRUM_SUM_FRACT_BITS - 2 * state->shift);
+    uint8_t extra = 0;
+    if (scale > 2 * SPECTRUM_SUM_FRACT_BITS)
+    {
+        extra = (uint8_t)(scale - 2 * SPECTRUM_SUM_FRACT_BITS);
+        scale = 2 * SPECTRUM_SUM_FRACT_BITS;
+    }
+    else if (scale < 0)
+    {
+        power = (power + ((uint64_t)1 << (-scale - 1))) >> -scale;
+        scale = 0;
+    }
+    uint64_t quotient = power / divisor;
+    if ((quotient >> (62 - scale - extra)) != 0)
+    {
+        return UINT64_MAX;
+    }
+    uint64_t result = (quotient << scale) + 
+        (((power % divisor) << scale) + divisor / 2) / divisor;
+    result <<= extra;
+    
+    // One-sided spectrum, bins between DC and Nyquist count twice
+    if ((bin != 0) && (bin != SPECTRUM_FFT_SIZE / 2))
+    {
+        result *= 2;
+    }
+    return result;
+}
+
+uint64_t spectrum_round(uint64_t power)
+{
+    uint8_t shift = SPECTRUM_SUM_FRACT_BITS - SPECTRUM_FRACT_BITS;
+    if (power > UINT64_MAX - ((uint64_t)1 << (shift - 1)))
+    {
+        return UINT64_MAX >> shift;
+    }
+    return (power + ((uint64_t)1 << (shift - 1))) >> shift;
+}
+
+/* [] END OF FILE */
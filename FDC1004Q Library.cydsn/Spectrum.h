@@ -0,0 +1,157 @@
+/**
+*   \file Spectrum.h
+*   \brief Welch power spectrum estimation.
+*
+*   This file contains a spectrum analyser used to find tones in the
+*   capacitance samples, such as mains pickup and mechanical vibrations.
+*   The samples of a channel are split into segments of #SPECTRUM_FFT_SIZE
+*   samples overlapping by half. The mean of each segment is removed, a
+*   Hann window is applied and the power of each bin of the FFT is added to
+*   an average (Welch's method). The power of each single segment can also
+*   be read while the segment is processed, giving a spectrogram.
+*
+*   Power is given per bin, one-sided, so that the sum of all the bins is
+*   the variance of the samples. The power spectral density is obtained
+*   dividing by the bin width, i.e. the sample rate over #SPECTRUM_FFT_SIZE.
+*
+*   The FFT uses 32-bit integers and a constant twiddle table, with the
+*   input scaled to use the full range of each segment, so no floating
+*   point and no allocation is needed. The state is kept in a
+*   #Spectrum_State structure owned by the caller, so that any number of
+*   channels or capture files can be analysed independently. A segment is
+*   processed when its last sample is added, every #SPECTRUM_FFT_SIZE / 2
+*   samples.
+*
+*   Changing the CAPDAC of a channel shifts the measured value, so the
+*   current segment is discarded whenever a sample is measured with a
+*   different CAPDAC setting. The average is kept.
+*
+*   \author Davide Marzorati
+*/
+
+#ifndef __SPECTRUM_H__
+    #define __SPECTRUM_H__
+
+    #include "FDC1004Q.h"
+    #include "FDC1004Q_Capture.h"
+
+    /**
+    *   \brief Number of samples in each segment.
+    *
+    *   Must be a power of 2, from 16 to 256.
+    */
+    #ifndef SPECTRUM_FFT_SIZE
+        #define SPECTRUM_FFT_SIZE 128
+    #endif
+
+    #if (SPECTRUM_FFT_SIZE == 16)
+        #define SPECTRUM_FFT_BITS 4
+    #elif (SPECTRUM_FFT_SIZE == 32)
+        #define SPECTRUM_FFT_BITS 5
+    #elif (SPECTRUM_FFT_SIZE == 64)
+        #define SPECTRUM_FFT_BITS 6
+    #elif (SPECTRUM_FFT_SIZE == 128)
+        #define SPECTRUM_FFT_BITS 7
+    #elif (SPECTRUM_FFT_SIZE == 256)
+        #define SPECTRUM_FFT_BITS 8
+    #else
+        #error "SPECTRUM_FFT_SIZE must be a power of 2, from 16 to 256"
+    #endif
+
+    /**
+    *   \brief Number of bins of the spectrum, from DC to half the sample rate.
+    */
+    #define SPECTRUM_BINS (SPECTRUM_FFT_SIZE / 2 + 1)
+
+    /**
+    *   \brief Number of fractional bits of the power.
+    */
+    #define SPECTRUM_FRACT_BITS 8
+
+    struct Spectrum_State;
+
+    /**
+    *   \brief Callback called after each segment is processed.
+    *
+    *   The power of the segment can be read with #Spectrum_GetSegment.
+    */
+    typedef void (*Spectrum_SegmentCallback)(const struct Spectrum_State* state);
+
+    /**
+    *   \brief State of the spectrum analyser of a channel.
+    */
+    typedef struct Spectrum_State {
+        /** Last samples, circular buffer **/
+        int32_t samples[SPECTRUM_FFT_SIZE];
+        /** Accumulated power of each bin, in LSB^2 with #SPECTRUM_FRACT_BITS fractional bits **/
+        uint64_t power[SPECTRUM_BINS];
+        /** FFT of the last segment, real part **/
+        int32_t re[SPECTRUM_FFT_SIZE];
+        /** FFT of the last segment, imaginary part **/
+        int32_t im[SPECTRUM_FFT_SIZE];
+        /** Callback called after each segment, or NULL **/
+        Spectrum_SegmentCallback callback;
+        /** Number of averaged segments **/
+        uint32_t segments;
+        /** Position of the next sample in the buffer **/
+        uint16_t index;
+        /** Number of samples in the buffer not yet processed **/
+        uint16_t fill;
+        /** Scale of the last segment, as a power of 2 **/
+        int8_t shift;
+        /** CAPDAC of the last sample **/
+        uint8_t capdac;
+    } Spectrum_State;
+
+    /**
+    *   \brief Reset the spectrum analyser of a channel.
+    *   \param[out] state the state of the analyser.
+    *   \param callback the function called after each segment, or NULL.
+    */
+    void Spectrum_Init(Spectrum_State* state, Spectrum_SegmentCallback callback);
+
+    /**
+    *   \brief Add a sample.
+    *   \param[in,out] state the state of the analyser.
+    *   \param capacitance the capacitance in units of the measurement LSB,
+    *       either raw or as computed by #FDC_ConvertRawMeasurementsFixed.
+    *   \param capdac the CAPDAC setting the sample was measured with.
+    */
+    void Spectrum_AddSample(Spectrum_State* state, int32_t capacitance, uint8_t capdac);
+
+    /**
+    *   \brief Add the samples of a capture block.
+    *
+    *   The samples of each channel recorded in the block are added to the
+    *   analyser of that channel.
+    *   \param[in,out] states the analysers of the four channels.
+    *   \param[in] block the capture block.
+    */
+    void Spectrum_AddCaptureBlock(Spectrum_State* states, const FDC_CaptureBlock* block);
+
+    /**
+    *   \brief Get the average power spectrum.
+    *
+    *   The power of a bin saturates when the sum over all the segments
+    *   exceeds 2^47 LSB^2, e.g. after about 2^16 segments for a tone with
+    *   an amplitude of 2^16 LSB.
+    *   \param[in] state the state of the analyser.
+    *   \param[out] power the power of each of the #SPECTRUM_BINS bins, in
+    *       LSB^2 with #SPECTRUM_FRACT_BITS fractional bits.
+    *   \retval #FDC_OK if the spectrum was computed.
+    *   \retval #FDC_MEAS_NOT_DONE if no segment was processed yet.
+    */
+    uint8_t Spectrum_GetPsd(const Spectrum_State* state, uint64_t* power);
+
+    /**
+    *   \brief Get the power spectrum of the last segment.
+    *   \param[in] state the state of the analyser.
+    *   \param[out] power the power of each of the #SPECTRUM_BINS bins, in
+    *       LSB^2 with #SPECTRUM_FRACT_BITS fractional bits.
+    *   \retval #FDC_OK if the spectrum was computed.
+    *   \retval #FDC_MEAS_NOT_DONE if no segment was processed yet.
+    */
+    uint8_t Spectrum_GetSegment(const Spectrum_State* state, uint64_t* power);
+
+#endif
+/* [] END OF FILE */
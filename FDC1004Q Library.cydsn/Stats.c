@@ -0,0 +1,249 @@
+/**
+*   \brief Source file for the running statistics.
+*/
+
+#include "Stats.h"
+#include "Fixed.h"
+
+// Summary of a block of samples
+typedef struct {
+    // Number of samples
+    uint32_t count;
+    // Reference sample
+    int32_t reference;
+    // Sum of the differences from the reference
+    int64_t sum;
+    // Sum of the squared differences from the reference
+    uint64_t sum_squares;
+    // Minimum and maximum
+    int32_t min;
+    int32_t max;
+} Stats_Block;
+
+// State of a channel
+typedef struct {
+    // Block of the first scale being filled
+    Stats_Block current;
+    // Last completed blocks of each scale, circular buffers
+    Stats_Block blocks[STATS_SCALES][STATS_BLOCKS];
+    // Last tumbling window of each scale
+    Stats_Block tumbling[STATS_SCALES];
+    // Number of blocks completed at each scale
+    uint32_t completed[STATS_SCALES];
+} Stats_Channel;
+
+// State of the channels
+static Stats_Channel stats_channels[STATS_CHANNELS];
+
+// Number of samples in the blocks of the first scale
+static uint16_t stats_block_length = 0;
+
+// Clear a block
+static void stats_clear(Stats_Block* block);
+
+// Add a block to another one
+static void stats_merge(Stats_Block* block, const Stats_Block* other);
+
+// Store a completed block of a scale, cascading to the next scales
+static void stats_push(Stats_Channel* state, uint8_t scale, const Stats_Block* block);
+
+// Compute the summary of a block
+static void stats_summarize(const Stats_Block* block, uint32_t sequence, Stats_Summary* summary);
+
+uint8_t Stats_Init(uint16_t block_length)
+{
+    if (block_length == 0)
+    {
+        return FDC_CONF_ERR;
+    }
+    for (uint8_t ch = 0; ch < STATS_CHANNELS; ch++)
+    {
+        Stats_Channel* state = &stats_channels[ch];
+        stats_clear(&state->current);
+        for (uint8_t s = 0; s < STATS_SCALES; s++)
+        {
+            stats_clear(&state->tumbling[s]);
+            state->completed[s] = 0;
+        }
+    }
+    stats_block_length = block_length;
+    return FDC_OK;
+}
+
+void Stats_Update(uint8_t channel, int32_t capacitance)
+{
+    if (stats_block_length == 0)
+    {
+        return;
+    }
+    Stats_Block* block = &stats_channels[channel].current;
+    if (block->count == 0)
+    {
+        block->reference = capacitance;
+        block->min = capacitance;
+        block->max = capacitance;
+    }
+    int64_t difference = (int64_t)capacitance - block->reference;
+    block->count++;
+    block->sum += difference;
+    block->sum_squares += (uint64_t)(difference * difference);
+    if (capacitance < block->min)
+    {
+        block->min = capacitance;
+    }
+    if (capacitance > block->max)
+    {
+        block->max = capacitance;
+    }
+    if (block->count == stats_block_length)
+    {
+        stats_push(&stats_channels[channel], 0, block);
+        stats_clear(block);
+    }
+}
+
+void Stats_UpdateFrame(const int32_t* capacitance)
+{
+    for (uint8_t ch = 0; ch < STATS_CHANNELS; ch++)
+    {
+        Stats_Update(ch, capacitance[ch]);
+    }
+}
+
+uint8_t Stats_GetTumbling(uint8_t channel, uint8_t scale, Stats_Summary* summary)
+{
+    if ((channel > FDC_CH_4) || (scale >= STATS_SCALES))
+    {
+        return FDC_CONF_ERR;
+    }
+    const Stats_Channel* state = &stats_channels[channel];
+    if (state->completed[scale] < STATS_BLOCKS)
+    {
+        return FDC_MEAS_NOT_DONE;
+    }
+    stats_summarize(&state->tumbling[scale], state->completed[scale] / STATS_BLOCKS, summary);
+    return FDC_OK;
+}
+
+uint8_t Stats_GetSliding(uint8_t channel, uint8_t scale, Stats_Summary* summary)
+{
+    if ((channel > FDC_CH_4) || (scale >= STATS_SCALES))
+    {
+        return FDC_CONF_ERR;
+    }
+    const Stats_Channel* state = &stats_channels[channel];
+    uint32_t completed = state->completed[scale];
+    if (completed == 0)
+    {
+        return FDC_MEAS_NOT_DONE;
+    }
+    uint8_t count = (completed < STATS_BLOCKS) ? (uint8_t)completed : STATS_BLOCKS;
+    Stats_Block window;
+    stats_clear(&window);
+    for (uint8_t i = 0; i < count; i++)
+    {
+        stats_merge(&window, &state->blocks[scale][(completed - 1 - i) % STATS_BLOCKS]);
+    }
+    stats_summarize(&window, completed, summary);
+    return FDC_OK;
+}
+
+// ===================================================================
+//                         HELPER FUNCTIONS
+// ===================================================================
+
+void stats_clear(Stats_Block* block)
+{
+    block->count = 0;
+    block->reference = 0;
+    block->sum = 0;
+    block->sum_squares = 0;
+    block->min = 0;
+    block->max = 0;
+}
+
+void stats_merge(Stats_Block* block, const Stats_Block* other)
+{
+    if (other->count == 0)
+    {
+        return;
+    }
+    if (block->count == 0)
+    {
+        *block = *other;
+        return;
+    }
+    // Move the other block to the same reference, the sums of squares
+    // are exact modulo 2^64 as long as the result fits
+    int64_t offset = (int64_t)other->reference - block->reference;
+    block->sum += other->sum + (int64_t)other->count * offset;
+    block->sum_squares += other->sum_squares + 
+        2 * (uint64_t)offset * (uint64_t)other->sum + 
+        (uint64_t)other->count * (uint64_t)(offset * offset);
+    block->count += other->count;
+    if (other->min < block->min)
+    {
+        block->min = other->min;
+    }
+    if (other->max > block->max)
+    {
+        block->max = other->max;
+    }
+}
+
+void stats_push(Stats_Channel* state, uint8_t scale, const Stats_Block* block)
+{
+    state->blocks[scale][state->completed[scale] % STATS_BLOCKS] = *block;
+    state->completed[scale]++;
+    if ((state->completed[scale] % STATS_BLOCKS) != 0)
+    {
+        return;
+    }
+    // A group of blocks is complete: new tumbling window
+    Stats_Block* window = &state->tumbling[scale];
+    stats_clear(window);
+    for (uint8_t i = 0; i < STATS_BLOCKS; i++)
+    {
+        stats_merge(window, &state->blocks[scale][i]);
+    }
+    if (scale + 1 < STATS_SCALES)
+    {
+        stats_push(state, scale + 1, window);
+    }
+}
+
+void stats_summarize(const Stats_Block* block, uint32_t sequence, Stats_Summary* summary)
+{
+    summary->sequence = sequence;
+    summary->count = block->count;
+    summary->min = block->min;
+    summary->max = block->max;
+    
+    // sum^2 / n = q sum + q r + r^2 / n, with sum = q n + r
+    int64_t n = block->count;
+    int64_t q = block->sum / n;
+    int64_t r = block->sum % n;
+    int64_t rounded = (2 * r >= n) ? q + 1 : ((2 * r <= -n) ? q - 1 : q);
+    summary->mean = (int32_t)(block->reference + rounded);
+    if (n < 2)
+    {
+        summary->std_dev = 0;
+        return;
+    }
+    uint64_t m2 = block->sum_squares - (uint64_t)(q * block->sum) - (uint64_t)(q * r) - 
+                  (uint64_t)((r * r) / n);
+    
+    // Variance with 2 * STATS_FRACT_BITS fractional bits
+    uint64_t divisor = (uint64_t)(n - 1);
+    uint64_t quotient = m2 / divisor;
+    if ((quotient >> (64 - 2 * STATS_FRACT_BITS)) != 0)
+    {
+        summary->std_dev = UINT32_MAX;
+        return;
+    }
+    uint64_t variance = (quotient << (2 * STATS_FRACT_BITS)) + 
+                        ((m2 % divisor) << (2 * STATS_FRACT_BITS)) / divisor;
+    summary->std_dev = Fixed_Sqrt(variance);
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,137 @@
+/**
+*   \file Stats.h
+*   \brief Running statistics of the capacitance samples.
+*
+*   This file contains a per-channel statistics stage that summarises the
+*   samples over windows at #STATS_SCALES time scales, so that a host
+*   needing only the mean, the spread and the range of the signal can
+*   query one summary per window instead of reading every sample.
+*
+*   The samples are accumulated in blocks of a configurable length. Each
+*   scale keeps the summaries of its last #STATS_BLOCKS blocks, and the
+*   blocks of a scale are #STATS_BLOCKS times longer than the ones of the
+*   scale below, each being the combination of #STATS_BLOCKS blocks of the
+*   scale below. For each scale two windows of #STATS_BLOCKS blocks are
+*   available:
+*       - the tumbling window, i.e. the last completed group of blocks,
+*         updated once per window;
+*       - the sliding window, i.e. the last #STATS_BLOCKS completed blocks,
+*         updated at every block.
+*
+*   Each summary holds the number of samples, a reference sample, the sum
+*   and the sum of squares of the differences from the reference, the
+*   minimum and the maximum. Using the differences from a sample of the
+*   same block keeps the sums small, so the variance is computed exactly
+*   with 64-bit integers and without the cancellation of the plain sum of
+*   squares, and summaries are combined exactly. Each sample takes one
+*   multiplication and no division; the divisions are done only when a
+*   window is queried.
+*
+*   \author Davide Marzorati
+*/
+
+#ifndef __STATS_H__
+    #define __STATS_H__
+
+    #include "FDC1004Q.h"
+
+    /**
+    *   \brief Number of channels.
+    */
+    #define STATS_CHANNELS 4
+
+    /**
+    *   \brief Number of time scales.
+    */
+    #ifndef STATS_SCALES
+        #define STATS_SCALES 3
+    #endif
+
+    /**
+    *   \brief Number of blocks in each window, i.e. ratio between consecutive scales.
+    */
+    #ifndef STATS_BLOCKS
+        #define STATS_BLOCKS 10
+    #endif
+
+    #if (STATS_SCALES < 1) || (STATS_BLOCKS < 2)
+        #error "STATS_SCALES must be at least 1 and STATS_BLOCKS at least 2"
+    #endif
+
+    /**
+    *   \brief Number of fractional bits of the standard deviation.
+    */
+    #define STATS_FRACT_BITS 8
+
+    /**
+    *   \brief Summary of a window.
+    */
+    typedef struct {
+        /** Number of windows completed at the scale, identifies the summary **/
+        uint32_t sequence;
+        /** Number of samples **/
+        uint32_t count;
+        /** Mean, rounded to the nearest LSB **/
+        int32_t mean;
+        /** Standard deviation, in LSB with #STATS_FRACT_BITS fractional bits **/
+        uint32_t std_dev;
+        /** Minimum, in LSB **/
+        int32_t min;
+        /** Maximum, in LSB **/
+        int32_t max;
+    } Stats_Summary;
+
+    /**
+    *   \brief Initialize the statistics.
+    *
+    *   All the windows are cleared. The window of scale s spans
+    *   block_length * #STATS_BLOCKS^(s+1) samples.
+    *   \param block_length the number of samples in the blocks of the
+    *       first scale.
+    *   \retval #FDC_OK if the statistics were initialized.
+    *   \retval #FDC_CONF_ERR if the block length is 0.
+    */
+    uint8_t Stats_Init(uint16_t block_length);
+
+    /**
+    *   \brief Add a sample.
+    *   \param channel the channel, from #FDC_CH_1 to #FDC_CH_4.
+    *   \param capacitance the capacitance in units of the measurement LSB,
+    *       as computed by #FDC_ConvertRawMeasurementsFixed.
+    */
+    void Stats_Update(uint8_t channel, int32_t capacitance);
+
+    /**
+    *   \brief Add the samples of a frame.
+    *   \param[in] capacitance the capacitance of the four channels.
+    */
+    void Stats_UpdateFrame(const int32_t* capacitance);
+
+    /**
+    *   \brief Get the last tumbling window of a scale.
+    *   \param channel the channel, from #FDC_CH_1 to #FDC_CH_4.
+    *   \param scale the scale, from 0 to #STATS_SCALES - 1.
+    *   \param[out] summary the summary of the window.
+    *   \retval #FDC_OK if the summary was computed.
+    *   \retval #FDC_CONF_ERR if the channel or the scale are not valid.
+    *   \retval #FDC_MEAS_NOT_DONE if no window was completed yet.
+    */
+    uint8_t Stats_GetTumbling(uint8_t channel, uint8_t scale, Stats_Summary* summary);
+
+    /**
+    *   \brief Get the sliding window of a scale.
+    *
+    *   Until #STATS_BLOCKS blocks are completed, the window holds the
+    *   blocks completed so far.
+    *   \param channel the channel, from #FDC_CH_1 to #FDC_CH_4.
+    *   \param scale the scale, from 0 to #STATS_SCALES - 1.
+    *   \param[out] summary the summary of the window; the sequence is the
+    *       number of blocks completed at the scale.
+    *   \retval #FDC_OK if the summary was computed.
+    *   \retval #FDC_CONF_ERR if the channel or the scale are not valid.
+    *   \retval #FDC_MEAS_NOT_DONE if no block was completed yet.
+    */
+    uint8_t Stats_GetSliding(uint8_t channel, uint8_t scale, Stats_Summary* summary);
+
+#endif
+/* [] END OF FILE */
@@ -0,0 +1,136 @@
+/**
+*   \brief Source file for the per-channel alpha-beta tracker.
+*/
+
+#include "Tracker.h"
+#include "Fixed.h"
+
+/**
+*   \brief Unity gain.
+*/
+#define TRACKER_ONE (1L << TRACKER_GAIN_FRACT_BITS)
+
+/**
+*   \brief Largest tracking index, in Q16.
+*/
+#define TRACKER_LAMBDA_MAX (256L << 16)
+
+/**
+*   \brief Default gains, for a tracking index of 1.
+*/
+#define TRACKER_DEFAULT_ALPHA 49152
+#define TRACKER_DEFAULT_BETA  32768
+
+// State of a channel
+typedef struct {
+    // Position estimate, Q16 LSB
+    int64_t position;
+    // Rate estimate, Q16 LSB per sample
+    int64_t rate;
+    // Gains, Q16
+    uint32_t alpha;
+    uint32_t beta;
+    // CAPDAC of the last sample
+    uint8_t capdac;
+    // Set when the next sample must initialize the state
+    uint8_t reset;
+} Tracker_State;
+
+// State of the channels
+static Tracker_State tracker_states[TRACKER_CHANNELS] = {
+    {0, 0, TRACKER_DEFAULT_ALPHA, TRACKER_DEFAULT_BETA, 0, 1},
+    {0, 0, TRACKER_DEFAULT_ALPHA, TRACKER_DEFAULT_BETA, 0, 1},
+    {0, 0, TRACKER_DEFAULT_ALPHA, TRACKER_DEFAULT_BETA, 0, 1},
+    {0, 0, TRACKER_DEFAULT_ALPHA, TRACKER_DEFAULT_BETA, 0, 1}
+};
+
+uint8_t Tracker_SetGains(uint8_t channel, uint32_t alpha, uint32_t beta)
+{
+    if ((channel > FDC_CH_4) || (alpha == 0) || (alpha > TRACKER_ONE) || 
+        (beta == 0) || (beta >= 4 * TRACKER_ONE - 2 * alpha))
+    {
+        return FDC_CONF_ERR;
+    }
+    tracker_states[channel].alpha = alpha;
+    tracker_states[channel].beta = beta;
+    tracker_states[channel].reset = 1;
+    return FDC_OK;
+}
+
+uint8_t Tracker_SetNoise(uint8_t channel, uint32_t process_noise, uint32_t measurement_noise)
+{
+    if ((process_noise == 0) || (measurement_noise == 0))
+    {
+        return FDC_CONF_ERR;
+    }
+    // Tracking index, Q16
+    uint64_t lambda = ((uint64_t)process_noise << 16) / measurement_noise;
+    if (lambda == 0)
+    {
+        lambda = 1;
+    }
+    if (lambda > TRACKER_LAMBDA_MAX)
+    {
+        lambda = TRACKER_LAMBDA_MAX;
+    }
+    // r = (4 + l - sqrt(8 l + l^2)) / 4, then alpha = 1 - r^2 and
+    // beta = 2 (2 - alpha) - 4 sqrt(1 - alpha) = 2 (1 - r)^2
+    uint32_t root = Fixed_Sqrt((lambda << 19) + lambda * lambda);
+    uint32_t r = (uint32_t)(((4UL << 16) + lambda - root) / 4);
+    uint32_t alpha = TRACKER_ONE - (uint32_t)(((uint64_t)r * r) >> 16);
+    uint32_t beta = (uint32_t)((2 * (uint64_t)(TRACKER_ONE - r) * (TRACKER_ONE - r)) >> 16);
+    // Keep the gains valid after rounding
+    if (alpha == 0)
+    {
+        alpha = 1;
+    }
+    if (beta == 0)
+    {
+        beta = 1;
+    }
+    return Tracker_SetGains(channel, alpha, beta);
+}
+
+void Tracker_Reset(uint8_t channel)
+{
+    if (channel <= FDC_CH_4)
+    {
+        tracker_states[channel].reset = 1;
+    }
+}
+
+void Tracker_Update(uint8_t channel, int32_t capacitance, uint8_t capdac,
+                    Tracker_Estimate* estimate)
+{
+    Tracker_State* state = &tracker_states[channel];
+    int64_t measurement = (int64_t)capacitance * TRACKER_ONE;
+    if (state->reset || (state->capdac != capdac))
+    {
+        // Start again from the current sample
+        state->position = measurement;
+        state->rate = 0;
+        state->capdac = capdac;
+        state->reset = 0;
+    }
+    else
+    {
+        int64_t prediction = state->position + state->rate;
+        int64_t residual = measurement - prediction;
+        state->position = prediction + ((residual * state->alpha) >> TRACKER_GAIN_FRACT_BITS);
+        state->rate += (residual * state->beta) >> TRACKER_GAIN_FRACT_BITS;
+    }
+    // Round to nearest LSB
+    estimate->position = (int32_t)((state->position + TRACKER_ONE / 2) >> TRACKER_GAIN_FRACT_BITS);
+    estimate->rate = (int32_t)(state->rate >> (TRACKER_GAIN_FRACT_BITS - TRACKER_RATE_FRACT_BITS));
+}
+
+void Tracker_UpdateFrame(const int32_t* capacitance, const uint8_t* capdac,
+                         Tracker_Estimate* estimate)
+{
+    for (uint8_t ch = 0; ch < TRACKER_CHANNELS; ch++)
+    {
+        Tracker_Update(ch, capacitance[ch], capdac[ch], &estimate[ch]);
+    }
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,111 @@
+/**
+*   \file Tracker.h
+*   \brief Per-channel alpha-beta tracker.
+*
+*   This file contains a low-latency smoothing stage for the capacitance
+*   samples. Each channel runs a steady-state alpha-beta filter, i.e. the
+*   steady-state form of a 1D constant-velocity Kalman filter, which
+*   estimates both the capacitance and its rate of change without the
+*   group delay of a moving average. The gains are derived from the
+*   process and measurement noise with the closed-form steady-state
+*   solution, and all the processing is done with integer operations.
+*
+*   Changing the CAPDAC of a channel shifts the measured value, so the
+*   state of the channel is reset whenever a sample is measured with a
+*   different CAPDAC setting.
+*
+*   \author Davide Marzorati
+*/
+
+#ifndef __TRACKER_H__
+    #define __TRACKER_H__
+
+    #include "FDC1004Q.h"
+
+    /**
+    *   \brief Number of tracked channels.
+    */
+    #define TRACKER_CHANNELS 4
+
+    /**
+    *   \brief Number of fractional bits of the gains.
+    */
+    #define TRACKER_GAIN_FRACT_BITS 16
+
+    /**
+    *   \brief Number of fractional bits of the rate estimate.
+    */
+    #define TRACKER_RATE_FRACT_BITS 8
+
+    /**
+    *   \brief Output of the tracker.
+    */
+    typedef struct {
+        /** Estimated capacitance, in units of the measurement LSB **/
+        int32_t position;
+        /** Estimated rate, in LSB per sample with #TRACKER_RATE_FRACT_BITS fractional bits **/
+        int32_t rate;
+    } Tracker_Estimate;
+
+    /**
+    *   \brief Set the gains of a channel.
+    *
+    *   The state of the channel is reset.
+    *   \param channel the channel, from #FDC_CH_1 to #FDC_CH_4.
+    *   \param alpha the position gain, with #TRACKER_GAIN_FRACT_BITS fractional bits.
+    *   \param beta the rate gain, with #TRACKER_GAIN_FRACT_BITS fractional bits.
+    *   \retval #FDC_OK if the gains were set.
+    *   \retval #FDC_CONF_ERR if the channel is not valid or the gains are
+    *       not stable (alpha and beta must be greater than 0, alpha at most 1
+    *       and beta below 4 - 2 alpha).
+    */
+    uint8_t Tracker_SetGains(uint8_t channel, uint32_t alpha, uint32_t beta);
+
+    /**
+    *   \brief Set the gains of a channel from the noise levels.
+    *
+    *   The gains are the steady-state gains of the Kalman filter for a
+    *   constant-velocity model, with tracking index
+    *   \f$ \lambda = \sigma_w / \sigma_v \f$ (one sample period), clamped
+    *   between 1/65536 and 256. Higher process noise gives faster tracking,
+    *   higher measurement noise gives more smoothing. The state of the
+    *   channel is reset.
+    *   \param channel the channel, from #FDC_CH_1 to #FDC_CH_4.
+    *   \param process_noise standard deviation of the change of rate
+    *       between samples, in LSB per sample per sample.
+    *   \param measurement_noise standard deviation of the measurement noise, in LSB.
+    *   \retval #FDC_OK if the gains were set.
+    *   \retval #FDC_CONF_ERR if the channel is not valid or a noise level is 0.
+    */
+    uint8_t Tracker_SetNoise(uint8_t channel, uint32_t process_noise, uint32_t measurement_noise);
+
+    /**
+    *   \brief Reset the state of a channel.
+    *
+    *   The next sample of the channel is taken as the initial estimate.
+    *   \param channel the channel, from #FDC_CH_1 to #FDC_CH_4.
+    */
+    void Tracker_Reset(uint8_t channel);
+
+    /**
+    *   \brief Process a sample.
+    *   \param channel the channel, from #FDC_CH_1 to #FDC_CH_4.
+    *   \param capacitance the capacitance in units of the measurement LSB,
+    *       as computed by #FDC_ConvertRawMeasurementsFixed.
+    *   \param capdac the CAPDAC setting the sample was measured with.
+    *   \param[out] estimate the updated estimate.
+    */
+    void Tracker_Update(uint8_t channel, int32_t capacitance, uint8_t capdac,
+                        Tracker_Estimate* estimate);
+
+    /**
+    *   \brief Process the samples of a frame.
+    *   \param[in] capacitance the capacitance of the four channels.
+    *   \param[in] capdac the CAPDAC settings the samples were measured with.
+    *   \param[out] estimate the updated estimates of the four channels.
+    */
+    void Tracker_UpdateFrame(const int32_t* capacitance, const uint8_t* capdac,
+                             Tracker_Estimate* estimate);
+
+#endif
+/* [] END OF FILE */
@@ -7,16 +7,143 @@
 #include "I2C_Interface.h"
 #include "FDC1004Q_Defs.h"
 #include "FDC1004Q.h"
-#include "stdio.h"
+#include "FDC1004Q_Burst.h"
+#include "FDC1004Q_Capture.h"
+#include "FDC1004Q_Trace.h"
+#include "Dispatch.h"
+#include "Sensors.h"
+#include "RateControl.h"
+#include "Stats.h"
+#include "Mains.h"
+#include "Format.h"
 
-void Sensors_ProcessCapacitanceData(void);
+/**
+*   \brief Stream samples as binary capture blocks instead of text.
+*
+*   When enabled, every sample is recorded with the FDC1004Q_Capture
+*   module and the completed blocks are sent over the UART. The host
+*   synchronizes on #FDC_CAPTURE_MAGIC to skip the start-up messages.
+*/
+#ifndef MAIN_BINARY_CAPTURE
+    #define MAIN_BINARY_CAPTURE 0
+#endif
+
+/**
+*   \brief Record pre-trigger bursts of samples.
+*
+*   When enabled, every sample is also fed to the FDC1004Q_Burst module.
+*   The host arms the recorder with the 'a' command and can fire the
+*   trigger with the 'x' command; completed bursts are sent over the UART
+*   one sample per loop iteration.
+*/
+#ifndef MAIN_BURST_CAPTURE
+    #define MAIN_BURST_CAPTURE 0
+#endif
+
+/**
+*   \brief Number of samples recorded after the burst trigger.
+*/
+#ifndef MAIN_BURST_POST_SAMPLES
+    #define MAIN_BURST_POST_SAMPLES (FDC_BURST_SAMPLES / 4)
+#endif
+
+/**
+*   \brief Adapt the sample rate to the activity of the signal.
+*
+*   When enabled, the RateControl module switches between 100, 200 and
+*   400 Hz depending on how much the channels move away from their
+*   baseline. The host can print the switch log with the 'r' command.
+*/
+#ifndef MAIN_ADAPTIVE_RATE
+    #define MAIN_ADAPTIVE_RATE 0
+#endif
+
+/**
+*   \brief Keep running statistics of the samples.
+*
+*   When enabled, every frame is fed to the Stats module and the host can
+*   read the last tumbling windows with the 'm' command and the sliding
+*   windows with the 'n' command, one line per scale and channel:
+*   scale, channel, sequence, count, mean, standard deviation, minimum
+*   and maximum, all in LSB (2^-19 pF).
+*/
+#ifndef MAIN_RUNNING_STATS
+    #define MAIN_RUNNING_STATS 0
+#endif
+
+/**
+*   \brief Number of frames in the blocks of the first statistics scale.
+*
+*   With the default 10 frames and #STATS_BLOCKS of 10, the windows span
+*   100, 1000 and 10000 frames.
+*/
+#ifndef MAIN_STATS_BLOCK_LENGTH
+    #define MAIN_STATS_BLOCK_LENGTH 10
+#endif
+
+/**
+*   \brief Monitor and remove the mains interference.
+*
+*   When enabled, the Mains module runs a Goertzel filter on each harmonic
+*   of the mains frequency, folded to the per-channel sample rate, and can
+*   notch them out of the samples before the statistics and the output.
+*   The host prints the tone amplitudes with the 'h' command and cycles
+*   through the off, monitor, notch and auto modes with the 'k' command.
+*/
+#ifndef MAIN_MAINS_MONITOR
+    #define MAIN_MAINS_MONITOR 0
+#endif
+
+/**
+*   \brief Mains frequency (Hz), 50 or 60.
+*/
+#ifndef MAIN_MAINS_FREQUENCY
+    #define MAIN_MAINS_FREQUENCY 50
+#endif
+
+/**
+*   \brief ID of this node in the capture blocks.
+*/
+#ifndef MAIN_NODE_ID
+    #define MAIN_NODE_ID 0
+#endif
+
+void Sensors_ProcessCapacitanceData(const Dispatch_Frame* frame, void* context);
+void Capture_ProcessFrame(const Dispatch_Frame* frame, void* context);
+void Burst_ProcessFrame(const Dispatch_Frame* frame, void* context);
+void Output_ProcessFrame(const Dispatch_Frame* frame, void* context);
+void Rate_ProcessFrame(const Dispatch_Frame* frame, void* context);
+void Stats_ProcessFrame(const Dispatch_Frame* frame, void* context);
+void Output_Summaries(uint8_t sliding);
+uint8_t Mains_Start(uint16_t frame_rate);
+void Mains_ProcessFrameData(const Dispatch_Frame* frame, void* context);
+void Output_Tones(void);
+void Timestamp_Tick(void);
+void Output_Write(const uint8_t* data, uint16_t length);
+void Main_ProcessCommand(char command);
+uint32_t Cycle_Clock(void);
 
 uint8_t capdac_values[4] = {0,0,0,0};
-double capacitance_values[4] = {0,0,0,0};
+int32_t capacitance_values[4] = {0,0,0,0};
+int32_t mains_values[4] = {0,0,0,0};
+volatile uint32_t timestamp_ms = 0;
+uint8_t frame_mask = FDC_DONE_CH_ALL;
 
 int main(void)
 {
     CyGlobalIntEnable; /* Enable global interrupts. */
+    
+    // 1 ms time base for sample timestamps
+    CySysTickStart();
+    CySysTickSetCallback(0, Timestamp_Tick);
+    
+    // Cycle counter used to time the frame consumers and the register trace
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT = 0;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+    #ifdef FDC_TRACE_ENABLED
+        FDC_Trace_Start(Cycle_Clock);
+    #endif
 
     /* Place your initialization/startup code here (e.g. MyInst_Start()) */
     I2C_Master_Start();
@@ -31,13 +158,16 @@ int main(void)
     uint16_t temp;
     uint32_t cap;
     uint8_t new_data = 0;
-    uint8_t counter = 0;
     
     for (uint8_t reg = 0; reg < 0x14; reg++)
     {
         uint8_t temp[2];
-        I2C_Peripheral_ReadRegisterMulti(0x50, reg, 2, temp);
-        sprintf(message, "0x%02X: 0x%04x\n", reg, (temp[1] << 8 | temp[0]));
+        FDC_ReadRegister(reg, temp);
+        char* end = Format_String(message, "0x");
+        end = Format_Hex(end, reg, 2);
+        end = Format_String(end, ": 0x");
+        end = Format_Hex(end, temp[1] << 8 | temp[0], 4);
+        Format_String(end, "\n");
         UART_PutString(message);
     }
     
@@ -62,7 +192,9 @@ int main(void)
     error = FDC_ReadManufacturerId(&temp);
     if (error == FDC_OK)
     {
-        sprintf(message, "\n\nManufacturer ID: 0x%02X\r\n", temp);
+        char* end = Format_String(message, "\n\nManufacturer ID: 0x");
+        end = Format_Hex(end, temp, 2);
+        Format_String(end, "\r\n");
         UART_PutString(message);
     }
     else
@@ -73,7 +205,9 @@ int main(void)
     error = FDC_ReadDeviceId(&temp);
     if (error == FDC_OK)
     {
-        sprintf(message, "Device ID: 0x%02X\r\n", temp);
+        char* end = Format_String(message, "Device ID: 0x");
+        end = Format_Hex(end, temp, 2);
+        Format_String(end, "\r\n");
         UART_PutString(message);
     }
     
@@ -97,75 +231,412 @@ int main(void)
     
     FDC_EnableRepeatMeasurement(FDC_RP_CH_1 | FDC_RP_CH_2 | FDC_RP_CH_3 | FDC_RP_CH_4);
     
+    #if MAIN_ADAPTIVE_RATE
+        // Thresholds in LSB (2^-19 pF), baseline time constant of 0.64 s
+        RateControl_Config rate_config = {
+            {
+                {FDC_100_Hz, FDC_RP_CH_1 | FDC_RP_CH_2 | FDC_RP_CH_3 | FDC_RP_CH_4, 0, 0},
+                {FDC_200_Hz, FDC_RP_CH_1 | FDC_RP_CH_2 | FDC_RP_CH_3 | FDC_RP_CH_4, 2000, 1000},
+                {FDC_400_Hz, FDC_RP_CH_1 | FDC_RP_CH_2 | FDC_RP_CH_3 | FDC_RP_CH_4, 8000, 4000}
+            },
+            3, 2000, 6
+        };
+        RateControl_Init(&rate_config);
+        RateControl_Apply();
+        frame_mask = RateControl_GetDoneMask();
+    #endif
+    
+    #if MAIN_MAINS_MONITOR
+        #if MAIN_ADAPTIVE_RATE
+            uint8_t mains_error = Mains_Start(1000000UL / RateControl_GetFramePeriod());
+        #else
+            // Four channels measured in sequence at 400 S/s
+            uint8_t mains_error = Mains_Start(100);
+        #endif
+        if (mains_error == FDC_OK)
+        {
+            Mains_SetMode(MAINS_MONITOR);
+        }
+    #endif
+    
+    FDC_Capture_Start(MAIN_NODE_ID, FDC_RP_CH_1 | FDC_RP_CH_2 | FDC_RP_CH_3 | FDC_RP_CH_4, Output_Write);
+    
+    // Consumers of the sample frames, in call order
+    Dispatch_Init(Cycle_Clock);
+    Dispatch_Subscribe(Sensors_ProcessCapacitanceData, NULL, 0);
+    #if MAIN_ADAPTIVE_RATE
+        Dispatch_Subscribe(Rate_ProcessFrame, NULL, 0);
+    #endif
+    // Values after the mains interference is filtered out, if the stage runs
+    int32_t* filtered_values = NULL;
+    #if MAIN_MAINS_MONITOR
+        if (mains_error == FDC_OK)
+        {
+            Dispatch_Subscribe(Mains_ProcessFrameData, NULL, 0);
+            filtered_values = mains_values;
+        }
+    #endif
+    #if MAIN_RUNNING_STATS
+        Stats_Init(MAIN_STATS_BLOCK_LENGTH);
+        Dispatch_Subscribe(Stats_ProcessFrame, filtered_values, 1);
+    #endif
+    #if MAIN_BINARY_CAPTURE
+        Dispatch_Subscribe(Capture_ProcessFrame, NULL, 1);
+    #endif
+    #if MAIN_BURST_CAPTURE
+        Dispatch_Subscribe(Burst_ProcessFrame, NULL, 1);
+    #endif
+    Dispatch_Subscribe(Output_ProcessFrame, filtered_values, 2);
+    
+    #if MAIN_BURST_CAPTURE
+        char* end = Format_String(message, "Burst memory: ");
+        end = Format_Decimal(end, FDC_BURST_MEMORY_SIZE, 0);
+        Format_String(end, " bytes\n");
+        UART_PutString(message);
+    #endif
+    
     for (uint8_t reg = 0; reg < 0x15; reg++)
     {
         uint8_t temp[2];
-        I2C_Peripheral_ReadRegisterMulti(0x50, reg, 2, temp);
-        sprintf(message, "0x%02X: 0x%04x\n", reg, (temp[0] << 8 | temp[1]));
+        FDC_ReadRegister(reg, temp);
+        char* end = Format_String(message, "0x");
+        end = Format_Hex(end, reg, 2);
+        end = Format_String(end, ": 0x");
+        end = Format_Hex(end, temp[0] << 8 | temp[1], 4);
+        Format_String(end, "\n");
         UART_PutString(message);
     }
     
     
     
     
+    uint8_t frame_valid = 0;
     for(;;)
     {
-        // Read register to determine if we have new data
-        uint8_t temp[2];
-        I2C_Peripheral_ReadRegisterMulti(0x50, 0x0C, 2, temp);
+        // Commands sent by the host
+        Main_ProcessCommand(UART_GetChar());
         
-        // We have new data from all four channels
-        if ( (temp[1] & 0xF) == 0x0F)
+        #if MAIN_BURST_CAPTURE
+            // Send out a completed burst a piece at a time
+            FDC_Burst_SendNext(Output_Write);
+        #endif
+        
+        // Read the channels that completed a new measurement and copy the
+        // valid ones into the frame slot, where they collect until all the
+        // measured channels are in
+        FDC_Frame frame;
+        Dispatch_Frame* slot = Dispatch_GetSlot();
+        if (FDC_ReadAllMeasurements(FDC_DONE_CH_ALL, &frame) == FDC_OK)
         {
-            // Counter to avoid sending a packet every time
-            counter ++;
-            
-            // Tune CAPDAC
-            Sensors_ProcessCapacitanceData();
-            if ( counter == 100)
+            for (uint8_t ch = 0; ch < 4; ch++)
             {
-                // Print out capacitance and CAPDAC
-                for (uint8_t ch = 0; ch < 4; ch++)
+                if (frame.valid & (FDC_DONE_CH_1 >> ch))
                 {
-                    sprintf(message, "%1d | %2d - %3d.%02d |\n", ch, capdac_values[ch],
-                                                    (int)(capacitance_values[ch]), 
-                                                    ((int)(capacitance_values[ch]*100))%100);
-                    UART_PutString(message);
+                    slot->capacitance[ch] = frame.capacitance[ch];
+                    slot->capdac[ch] = frame.capdac[ch];
                 }
-                UART_PutString("\n");
-                counter = 0;
-                
-                // Reset CAPDAC value
-                for (uint8 ch = 0; ch < 4; ch++)
+                else if (frame.saturated & (FDC_DONE_CH_1 >> ch))
                 {
-                    capdac_values[ch] = 0;
+                    // Drop the sample and re-range at once, instead of
+                    // climbing one CAPDAC step per frame
+                    capdac_values[ch] = FDC_CorrectiveCapdac(frame.capdac[ch],
+                                            FDC_CheckSaturation(frame.capacitance[ch]));
                     FDC_ConfigureMeasurementInput(ch, ch, FDC_CAPDAC, capdac_values[ch]);
-                    
                 }
             }
-            
+            frame_valid |= frame.valid;
+        }
+        
+        // We have new data from all the measured channels
+        if ( (frame_valid & frame_mask) == frame_mask)
+        {
+            frame_valid = 0;
+            slot->timestamp = timestamp_ms;
+            FDC_ConvertRawMeasurementsFixed(slot->capacitance, slot->capdac, slot->value, 4);
+            Dispatch_Publish();
         }
     }
 }
 
-void Sensors_ProcessCapacitanceData(void)
+void Sensors_ProcessCapacitanceData(const Dispatch_Frame* frame, void* context)
 {
+    (void)context;
+    // Convert with the CAPDAC the frame was measured with, tune the current one
+    uint8_t changed = Sensors_TuneCapdac(frame->capacitance, frame->capdac,
+                                         capdac_values, capacitance_values);
     for (uint8_t ch = 0; ch < 4; ch++)
     {
-        // Read measurement
-        FDC_ReadMeasurement(ch, &capacitance_values[ch]);
+        if (changed & (1 << ch))
+        {
+            FDC_ConfigureMeasurementInput(ch, ch, FDC_CAPDAC, capdac_values[ch]);
+        }
+    }
+}
+
+void Capture_ProcessFrame(const Dispatch_Frame* frame, void* context)
+{
+    (void)context;
+    // Record sample with the CAPDAC it was measured with
+    FDC_Capture_AddSample(frame->timestamp, frame->capacitance, frame->capdac);
+}
+
+void Burst_ProcessFrame(const Dispatch_Frame* frame, void* context)
+{
+    (void)context;
+    FDC_Burst_AddSample(frame->timestamp, frame->capacitance, frame->capdac);
+}
+
+void Output_ProcessFrame(const Dispatch_Frame* frame, void* context)
+{
+    #if MAIN_BINARY_CAPTURE
+        // Only the CAPDAC reset is carried out, the values go out in the capture
+        (void)frame;
+        (void)context;
+    #endif
+    // Counter to avoid sending a packet every time
+    static uint8_t counter = 0;
+    counter ++;
+    if ( counter == 100)
+    {
+        #if MAIN_BINARY_CAPTURE == 0
+        // The values given at subscription, or the ones of the frame
+        const int32_t* values = (context != NULL) ? (const int32_t*)context : frame->value;
+        // Print out capacitance and CAPDAC
+        char message[32];
+        for (uint8_t ch = 0; ch < 4; ch++)
+        {
+            // Capacitance in pF with two decimals
+            char* end = Format_Decimal(message, ch, 1);
+            end = Format_String(end, " | ");
+            end = Format_Decimal(end, capdac_values[ch], 2);
+            end = Format_String(end, " - ");
+            end = Format_Fixed(end, values[ch], 19, 3, 2);
+            Format_String(end, " |\n");
+            UART_PutString(message);
+        }
+        UART_PutString("\n");
+        #endif
+        counter = 0;
         
-        if ( capacitance_values[ch] > (15 + ((capdac_values[ch]) * FDC_CAPDAC_FACTOR)))
+        // Reset CAPDAC value
+        for (uint8 ch = 0; ch < 4; ch++)
         {
-            // Increase CAPDAC
-            if (capdac_values[ch] < 31)
+            capdac_values[ch] = 0;
+            FDC_ConfigureMeasurementInput(ch, ch, FDC_CAPDAC, capdac_values[ch]);
+            
+        }
+    }
+}
+
+void Rate_ProcessFrame(const Dispatch_Frame* frame, void* context)
+{
+    (void)context;
+    if (RateControl_Update(frame->value, frame->capdac))
+    {
+        RateControl_Apply();
+        frame_mask = RateControl_GetDoneMask();
+        #if MAIN_MAINS_MONITOR
+            // One sample of each channel per frame, passed through if the
+            // stage cannot run at the new rate
+            if (Mains_Start(1000000UL / RateControl_GetFramePeriod()) != FDC_OK)
+            {
+                Mains_SetMode(MAINS_OFF);
+            }
+        #endif
+    }
+}
+
+uint8_t Mains_Start(uint16_t frame_rate)
+{
+    // One second blocks, 2 Hz notches, auto notch above 500 LSB
+    Mains_Config config = {
+        MAIN_MAINS_FREQUENCY, frame_rate, MAINS_HARMONICS, frame_rate, 2, 500UL << MAINS_FRACT_BITS
+    };
+    return Mains_Configure(&config);
+}
+
+void Mains_ProcessFrameData(const Dispatch_Frame* frame, void* context)
+{
+    (void)context;
+    Mains_ProcessFrame(frame->value, mains_values);
+}
+
+void Stats_ProcessFrame(const Dispatch_Frame* frame, void* context)
+{
+    // The values given at subscription, or the ones of the frame
+    Stats_UpdateFrame((context != NULL) ? (const int32_t*)context : frame->value);
+}
+
+void Output_Summaries(uint8_t sliding)
+{
+    char message[96];
+    for (uint8_t scale = 0; scale < STATS_SCALES; scale++)
+    {
+        for (uint8_t ch = 0; ch < STATS_CHANNELS; ch++)
+        {
+            Stats_Summary summary;
+            uint8_t error = sliding ? Stats_GetSliding(ch, scale, &summary) : 
+                                      Stats_GetTumbling(ch, scale, &summary);
+            if (error != FDC_OK)
             {
-                capdac_values[ch] += 1;
-                //capdac_values[ch] &= 0x1F;
-                FDC_ConfigureMeasurementInput(ch, ch, FDC_CAPDAC, capdac_values[ch]);
+                continue;
             }
+            char* end = Format_Decimal(message, scale, 0);
+            end = Format_String(end, " ");
+            end = Format_Decimal(end, ch, 0);
+            end = Format_String(end, " ");
+            end = Format_Decimal(end, summary.sequence, 0);
+            end = Format_String(end, " ");
+            end = Format_Decimal(end, summary.count, 0);
+            end = Format_String(end, " ");
+            end = Format_Decimal(end, summary.mean, 0);
+            end = Format_String(end, " ");
+            end = Format_Fixed(end, summary.std_dev, STATS_FRACT_BITS, 0, 2);
+            end = Format_String(end, " ");
+            end = Format_Decimal(end, summary.min, 0);
+            end = Format_String(end, " ");
+            end = Format_Decimal(end, summary.max, 0);
+            Format_String(end, "\n");
+            UART_PutString(message);
         }
-        
+    }
+}
+
+void Output_Tones(void)
+{
+    char message[96];
+    for (uint8_t ch = 0; ch < MAINS_CHANNELS; ch++)
+    {
+        char* end = Format_Decimal(message, ch, 0);
+        end = Format_String(end, " ");
+        end = Format_Fixed(end, Mains_GetLevel(ch), MAINS_FRACT_BITS, 0, 1);
+        for (uint8_t h = 0; h < MAINS_HARMONICS; h++)
+        {
+            Mains_Tone tone;
+            if (Mains_GetTone(ch, h, &tone) == FDC_OK)
+            {
+                end = Format_String(end, " ");
+                end = Format_Decimal(end, tone.frequency, 0);
+                end = Format_String(end, tone.notch ? "Hz* " : "Hz ");
+                end = Format_Fixed(end, tone.amplitude, MAINS_FRACT_BITS, 0, 1);
+            }
+        }
+        Format_String(end, "\n");
+        UART_PutString(message);
+    }
+}
+
+void Timestamp_Tick(void)
+{
+    timestamp_ms++;
+}
+
+void Main_ProcessCommand(char command)
+{
+    switch (command)
+    {
+        case 't':
+            // Dump the register trace
+            FDC_Trace_Dump(Output_Write);
+            break;
+        case 's':
+        {
+            // Report the slowest frame consumer
+            Dispatch_Stats stats;
+            uint8_t slowest = Dispatch_GetSlowest();
+            if (Dispatch_GetStats(slowest, &stats) == FDC_OK)
+            {
+                char message[48];
+                char* end = Format_String(message, "Slowest subscriber: ");
+                end = Format_Decimal(end, slowest, 0);
+                end = Format_String(end, " (");
+                end = Format_Decimal(end, stats.max_time, 0);
+                Format_String(end, " cycles)\n");
+                UART_PutString(message);
+            }
+            break;
+        }
+        #if MAIN_ADAPTIVE_RATE
+        case 'r':
+        {
+            // Print the sample rate switch log
+            RateControl_Switch entry;
+            char message[64];
+            for (uint8_t i = 0; RateControl_GetSwitch(i, &entry) == FDC_OK; i++)
+            {
+                char* end = Format_Decimal(message, entry.timestamp, 0);
+                end = Format_String(end, " ms: tier ");
+                end = Format_Decimal(end, entry.from, 0);
+                end = Format_String(end, " -> ");
+                end = Format_Decimal(end, entry.to, 0);
+                end = Format_String(end, " (");
+                end = Format_Decimal(end, entry.activity, 0);
+                Format_String(end, " LSB)\n");
+                UART_PutString(message);
+            }
+            break;
+        }
+        #endif
+        #if MAIN_RUNNING_STATS
+        case 'm':
+            // Send the last tumbling windows
+            Output_Summaries(0);
+            break;
+        case 'n':
+            // Send the sliding windows
+            Output_Summaries(1);
+            break;
+        #endif
+        #if MAIN_MAINS_MONITOR
+        case 'h':
+            // Print the mains interference
+            Output_Tones();
+            break;
+        case 'k':
+        {
+            // Cycle through the modes
+            uint8_t mode = (Mains_GetMode() + 1) % (MAINS_AUTO + 1);
+            Mains_SetMode(mode);
+            char message[16];
+            char* end = Format_String(message, "Mode ");
+            end = Format_Decimal(end, mode, 0);
+            Format_String(end, "\n");
+            UART_PutString(message);
+            break;
+        }
+        #endif
+        #if MAIN_BURST_CAPTURE
+        case 'a':
+        {
+            // Arm the burst recorder, external trigger only
+            FDC_BurstTrigger trigger = {FDC_BURST_TRIGGER_EXTERNAL, FDC_CH_1, 0, 0};
+            FDC_Burst_Arm(MAIN_NODE_ID, &trigger, MAIN_BURST_POST_SAMPLES);
+            break;
+        }
+        case 'x':
+            // Fire the burst trigger
+            FDC_Burst_Trigger();
+            break;
+        #endif
+        default:
+            break;
+    }
+}
+
+uint32_t Cycle_Clock(void)
+{
+    return DWT->CYCCNT;
+}
+
+void Output_Write(const uint8_t* data, uint16_t length)
+{
+    // UART_PutArray takes up to 255 bytes at a time
+    while (length > 0)
+    {
+        uint8_t chunk = length > 0xFF ? 0xFF : length;
+        UART_PutArray(data, chunk);
+        data += chunk;
+        length -= chunk;
     }
 }
 
@@ -0,0 +1,870 @@
+/**
+*   \brief Source file for the host aggregator of the capture streams.
+*/
+
+#include "Aggregator.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+
+/**
+*   \brief Size of the receive buffer of each port.
+*/
+#define AGGREGATOR_PORT_BUFFER (2 * sizeof(FDC_CaptureBlock))
+
+/**
+*   \brief Bytes of the block magic, in stream order.
+*/
+#define AGGREGATOR_MAGIC_SIZE 4
+
+/**
+*   \brief Time the reader sleeps when all the decoder queues are full (ns).
+*/
+#define AGGREGATOR_STALL_NS 50000
+
+// Block travelling from the reader to the sinks
+typedef struct {
+    // Arrival time of the last byte (ns)
+    uint64_t arrival_ns;
+    // Port the block was read from
+    uint32_t port;
+    // Sinks still to be served
+    uint32_t refs;
+    FDC_CaptureBlock block;
+} Aggregator_Job;
+
+// Serial port
+typedef struct {
+    int fd;
+    // Node last seen on the port, -1 if none
+    int32_t node_id;
+    uint32_t index;
+    uint32_t fill;
+    uint8_t buffer[AGGREGATOR_PORT_BUFFER];
+} Aggregator_Port;
+
+// Decoder thread and its queue
+typedef struct {
+    Aggregator* aggregator;
+    pthread_t thread;
+    pthread_mutex_t lock;
+    Aggregator_Job* queue[AGGREGATOR_QUEUE_SIZE];
+    uint32_t head;
+    uint32_t count;
+    uint8_t index;
+    uint64_t decoded;
+    uint64_t stolen;
+    uint64_t cpu_ns;
+} Aggregator_Worker;
+
+// Sink thread and its queue
+typedef struct {
+    Aggregator* aggregator;
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t not_empty;
+    pthread_cond_t not_full;
+    Aggregator_SinkCallback callback;
+    void* context;
+    Aggregator_Job** queue;
+    uint32_t depth;
+    uint32_t head;
+    uint32_t count;
+    uint8_t policy;
+    uint8_t stopping;
+    Aggregator_SinkStats stats;
+} Aggregator_Sink;
+
+// State of a node
+typedef struct {
+    pthread_mutex_t lock;
+    Aggregator_NodeStats stats;
+    uint64_t latency_total_ns;
+    uint32_t latency_histogram[AGGREGATOR_LATENCY_BUCKETS];
+} Aggregator_Node;
+
+struct Aggregator {
+    int epoll_fd;
+    int wake_fd;
+    uint8_t running;
+    uint8_t stopping;
+    uint8_t workers_stopping;
+
+    // Ports, added under the lock
+    pthread_mutex_t ports_lock;
+    Aggregator_Port* ports[AGGREGATOR_MAX_PORTS];
+    uint32_t port_count;
+    uint32_t open_ports;
+
+    // Reader
+    pthread_t reader;
+    uint64_t bytes;
+    uint64_t skipped_bytes;
+    uint64_t blocks;
+    uint64_t reader_stalls;
+    uint64_t reader_cpu_ns;
+    uint32_t next_worker;
+
+    // Decoders, and the lock they sleep on when all queues are empty
+    Aggregator_Worker workers[AGGREGATOR_MAX_WORKERS];
+    uint8_t worker_count;
+    pthread_mutex_t sleep_lock;
+    pthread_cond_t work_available;
+    uint32_t queued;
+    uint32_t sleepers;
+
+    // Sinks
+    Aggregator_Sink sinks[AGGREGATOR_MAX_SINKS];
+    uint8_t sink_count;
+
+    // Nodes, indexed by ID and created on the first block
+    pthread_mutex_t nodes_lock;
+    Aggregator_Node* nodes[65536];
+    uint32_t node_count;
+
+    // Blocks framed and not yet released
+    uint32_t jobs_alive;
+};
+
+// Current monotonic time (ns)
+static uint64_t aggregator_now(void);
+
+// CPU time of the calling thread (ns)
+static uint64_t aggregator_thread_cpu(void);
+
+// Map a baud rate to its termios constant
+static speed_t aggregator_speed(uint32_t baud);
+
+// Reader thread
+static void* aggregator_reader(void* argument);
+
+// Read all the available bytes of a port, 0 when the port hung up
+static int aggregator_read_port(Aggregator* aggregator, Aggregator_Port* port);
+
+// Cut the buffer of a port into blocks
+static void aggregator_frame(Aggregator* aggregator, Aggregator_Port* port);
+
+// Hand a block to the decoders
+static void aggregator_submit(Aggregator* aggregator, Aggregator_Job* job);
+
+// Decoder thread
+static void* aggregator_worker(void* argument);
+
+// Take a block from the queue of a decoder, from the head or the tail
+static Aggregator_Job* aggregator_take(Aggregator_Worker* worker, uint8_t steal);
+
+// Check a block, update the statistics of its node and deliver it
+static void aggregator_decode(Aggregator* aggregator, Aggregator_Job* job);
+
+// Get the state of a node, creating it if needed
+static Aggregator_Node* aggregator_node(Aggregator* aggregator, uint16_t node_id);
+
+// Sink thread
+static void* aggregator_sink(void* argument);
+
+// Release a reference to a block
+static void aggregator_release(Aggregator* aggregator, Aggregator_Job* job);
+
+// Copy the statistics of a node, computing the derived values
+static void aggregator_node_stats(Aggregator_Node* node, Aggregator_NodeStats* stats);
+
+// ===========================================================
+//                      LIFE CYCLE
+// ===========================================================
+
+Aggregator* Aggregator_Create(uint8_t workers)
+{
+    if ((workers == 0) || (workers > AGGREGATOR_MAX_WORKERS))
+    {
+        return NULL;
+    }
+    Aggregator* aggregator = calloc(1, sizeof(Aggregator));
+    if (aggregator == NULL)
+    {
+        return NULL;
+    }
+    aggregator->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    aggregator->wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if ((aggregator->epoll_fd < 0) || (aggregator->wake_fd < 0))
+    {
+        Aggregator_Destroy(aggregator);
+        return NULL;
+    }
+    struct epoll_event event = { .events = EPOLLIN, .data.ptr = NULL };
+    epoll_ctl(aggregator->epoll_fd, EPOLL_CTL_ADD, aggregator->wake_fd, &event);
+    pthread_mutex_init(&aggregator->ports_lock, NULL);
+    pthread_mutex_init(&aggregator->sleep_lock, NULL);
+    pthread_cond_init(&aggregator->work_available, NULL);
+    pthread_mutex_init(&aggregator->nodes_lock, NULL);
+    aggregator->worker_count = workers;
+    for (uint8_t i = 0; i < workers; i++)
+    {
+        aggregator->workers[i].aggregator = aggregator;
+        aggregator->workers[i].index = i;
+        pthread_mutex_init(&aggregator->workers[i].lock, NULL);
+    }
+    return aggregator;
+}
+
+void Aggregator_Destroy(Aggregator* aggregator)
+{
+    if (aggregator == NULL)
+    {
+        return;
+    }
+    Aggregator_Stop(aggregator);
+    for (uint32_t i = 0; i < aggregator->port_count; i++)
+    {
+        if (aggregator->ports[i]->fd >= 0)
+        {
+            close(aggregator->ports[i]->fd);
+        }
+        free(aggregator->ports[i]);
+    }
+    for (uint8_t i = 0; i < aggregator->sink_count; i++)
+    {
+        free(aggregator->sinks[i].queue);
+    }
+    for (uint32_t id = 0; id < 65536; id++)
+    {
+        free(aggregator->nodes[id]);
+    }
+    if (aggregator->epoll_fd >= 0)
+    {
+        close(aggregator->epoll_fd);
+    }
+    if (aggregator->wake_fd >= 0)
+    {
+        close(aggregator->wake_fd);
+    }
+    free(aggregator);
+}
+
+int Aggregator_AddPort(Aggregator* aggregator, const char* path, uint32_t baud)
+{
+    int fd = open(path, O_RDONLY | O_NOCTTY | O_NONBLOCK | O_CLOEXEC);
+    if (fd < 0)
+    {
+        return -1;
+    }
+    struct termios options;
+    if (tcgetattr(fd, &options) == 0)
+    {
+        cfmakeraw(&options);
+        options.c_cflag |= CLOCAL | CREAD;
+        if (baud != 0)
+        {
+            cfsetspeed(&options, aggregator_speed(baud));
+        }
+        tcsetattr(fd, TCSANOW, &options);
+    }
+    Aggregator_Port* port = calloc(1, sizeof(Aggregator_Port));
+    if (port == NULL)
+    {
+        close(fd);
+        return -1;
+    }
+    port->fd = fd;
+    port->node_id = -1;
+    pthread_mutex_lock(&aggregator->ports_lock);
+    if (aggregator->port_count == AGGREGATOR_MAX_PORTS)
+    {
+        pthread_mutex_unlock(&aggregator->ports_lock);
+        close(fd);
+        free(port);
+        errno = ENOSPC;
+        return -1;
+    }
+    port->index = aggregator->port_count;
+    aggregator->ports[aggregator->port_count++] = port;
+    __atomic_add_fetch(&aggregator->open_ports, 1, __ATOMIC_SEQ_CST);
+    struct epoll_event event = { .events = EPOLLIN, .data.ptr = port };
+    int result = epoll_ctl(aggregator->epoll_fd, EPOLL_CTL_ADD, fd, &event);
+    pthread_mutex_unlock(&aggregator->ports_lock);
+    return result;
+}
+
+int Aggregator_AddSink(Aggregator* aggregator, Aggregator_SinkCallback callback,
+                       void* context, uint32_t depth, uint8_t policy)
+{
+    if ((aggregator->running) || (aggregator->sink_count == AGGREGATOR_MAX_SINKS) ||
+        (callback == NULL) || (depth == 0) || (policy > AGGREGATOR_SINK_DROP))
+    {
+        return -1;
+    }
+    Aggregator_Sink* sink = &aggregator->sinks[aggregator->sink_count];
+    sink->queue = calloc(depth, sizeof(Aggregator_Job*));
+    if (sink->queue == NULL)
+    {
+        return -1;
+    }
+    sink->aggregator = aggregator;
+    sink->callback = callback;
+    sink->context = context;
+    sink->depth = depth;
+    sink->policy = policy;
+    pthread_mutex_init(&sink->lock, NULL);
+    pthread_cond_init(&sink->not_empty, NULL);
+    pthread_cond_init(&sink->not_full, NULL);
+    return aggregator->sink_count++;
+}
+
+int Aggregator_Start(Aggregator* aggregator)
+{
+    if (aggregator->running)
+    {
+        return -1;
+    }
+    aggregator->running = 1;
+    for (uint8_t i = 0; i < aggregator->sink_count; i++)
+    {
+        pthread_create(&aggregator->sinks[i].thread, NULL, aggregator_sink, &aggregator->sinks[i]);
+    }
+    for (uint8_t i = 0; i < aggregator->worker_count; i++)
+    {
+        pthread_create(&aggregator->workers[i].thread, NULL, aggregator_worker, &aggregator->workers[i]);
+    }
+    pthread_create(&aggregator->reader, NULL, aggregator_reader, aggregator);
+    return 0;
+}
+
+int Aggregator_WaitIdle(Aggregator* aggregator, uint32_t timeout_ms)
+{
+    uint64_t deadline = aggregator_now() + (uint64_t)timeout_ms * 1000000;
+    while ((__atomic_load_n(&aggregator->open_ports, __ATOMIC_SEQ_CST) > 0) ||
+           (__atomic_load_n(&aggregator->jobs_alive, __ATOMIC_SEQ_CST) > 0))
+    {
+        if (aggregator_now() > deadline)
+        {
+            return -1;
+        }
+        struct timespec pause = { 0, 1000000 };
+        nanosleep(&pause, NULL);
+    }
+    return 0;
+}
+
+void Aggregator_Stop(Aggregator* aggregator)
+{
+    if (!aggregator->running)
+    {
+        return;
+    }
+    // Reader first, then the decoders once their queues are empty,
+    // then the sinks once theirs are
+    __atomic_store_n(&aggregator->stopping, 1, __ATOMIC_SEQ_CST);
+    uint64_t one = 1;
+    if (write(aggregator->wake_fd, &one, sizeof(one)) < 0)
+    {
+        // The reader also wakes up on its epoll timeout
+    }
+    pthread_join(aggregator->reader, NULL);
+
+    pthread_mutex_lock(&aggregator->sleep_lock);
+    __atomic_store_n(&aggregator->workers_stopping, 1, __ATOMIC_SEQ_CST);
+    pthread_cond_broadcast(&aggregator->work_available);
+    pthread_mutex_unlock(&aggregator->sleep_lock);
+    for (uint8_t i = 0; i < aggregator->worker_count; i++)
+    {
+        pthread_join(aggregator->workers[i].thread, NULL);
+    }
+
+    for (uint8_t i = 0; i < aggregator->sink_count; i++)
+    {
+        Aggregator_Sink* sink = &aggregator->sinks[i];
+        pthread_mutex_lock(&sink->lock);
+        sink->stopping = 1;
+        pthread_cond_broadcast(&sink->not_empty);
+        pthread_mutex_unlock(&sink->lock);
+        pthread_join(sink->thread, NULL);
+    }
+    aggregator->running = 0;
+}
+
+// ===========================================================
+//                      STATISTICS
+// ===========================================================
+
+void Aggregator_GetStats(Aggregator* aggregator, Aggregator_Stats* stats)
+{
+    memset(stats, 0, sizeof(Aggregator_Stats));
+    stats->bytes = __atomic_load_n(&aggregator->bytes, __ATOMIC_RELAXED);
+    stats->skipped_bytes = __atomic_load_n(&aggregator->skipped_bytes, __ATOMIC_RELAXED);
+    stats->blocks = __atomic_load_n(&aggregator->blocks, __ATOMIC_RELAXED);
+    stats->reader_stalls = __atomic_load_n(&aggregator->reader_stalls, __ATOMIC_RELAXED);
+    stats->reader_cpu_ns = __atomic_load_n(&aggregator->reader_cpu_ns, __ATOMIC_RELAXED);
+    for (uint8_t i = 0; i < aggregator->worker_count; i++)
+    {
+        stats->decoded[i] = __atomic_load_n(&aggregator->workers[i].decoded, __ATOMIC_RELAXED);
+        stats->stolen[i] = __atomic_load_n(&aggregator->workers[i].stolen, __ATOMIC_RELAXED);
+        stats->worker_cpu_ns += __atomic_load_n(&aggregator->workers[i].cpu_ns, __ATOMIC_RELAXED);
+    }
+    stats->nodes = __atomic_load_n(&aggregator->node_count, __ATOMIC_RELAXED);
+    stats->open_ports = __atomic_load_n(&aggregator->open_ports, __ATOMIC_RELAXED);
+}
+
+int Aggregator_GetNodeStats(Aggregator* aggregator, uint16_t node_id,
+                            Aggregator_NodeStats* stats)
+{
+    Aggregator_Node* node = __atomic_load_n(&aggregator->nodes[node_id], __ATOMIC_ACQUIRE);
+    if (node == NULL)
+    {
+        return -1;
+    }
+    aggregator_node_stats(node, stats);
+    return 0;
+}
+
+int Aggregator_GetSinkStats(Aggregator* aggregator, int sink, Aggregator_SinkStats* stats)
+{
+    if ((sink < 0) || (sink >= aggregator->sink_count))
+    {
+        return -1;
+    }
+    pthread_mutex_lock(&aggregator->sinks[sink].lock);
+    *stats = aggregator->sinks[sink].stats;
+    pthread_mutex_unlock(&aggregator->sinks[sink].lock);
+    return 0;
+}
+
+void Aggregator_ForEachNode(Aggregator* aggregator,
+                            void (*callback)(const Aggregator_NodeStats* stats, void* context),
+                            void* context)
+{
+    for (uint32_t id = 0; id < 65536; id++)
+    {
+        Aggregator_NodeStats stats;
+        if (Aggregator_GetNodeStats(aggregator, (uint16_t)id, &stats) == 0)
+        {
+            callback(&stats, context);
+        }
+    }
+}
+
+// ===================================================================
+//                         HELPER FUNCTIONS
+// ===================================================================
+
+uint64_t aggregator_now(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000ULL + (uint64_t)now.tv_nsec;
+}
+
+uint64_t aggregator_thread_cpu(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+    return (uint64_t)now.tv_sec * 1000000000ULL + (uint64_t)now.tv_nsec;
+}
+
+speed_t aggregator_speed(uint32_t baud)
+{
+    switch (baud)
+    {
+        case 9600:    return B9600;
+        case 19200:   return B19200;
+        case 38400:   return B38400;
+        case 57600:   return B57600;
+        case 115200:  return B115200;
+        case 230400:  return B230400;
+        case 460800:  return B460800;
+        case 921600:  return B921600;
+        case 1000000: return B1000000;
+        case 2000000: return B2000000;
+        case 3000000: return B3000000;
+        default:      return B4000000;
+    }
+}
+
+void* aggregator_reader(void* argument)
+{
+    Aggregator* aggregator = argument;
+    struct epoll_event events[64];
+    while (!__atomic_load_n(&aggregator->stopping, __ATOMIC_SEQ_CST))
+    {
+        int count = epoll_wait(aggregator->epoll_fd, events, 64, 100);
+        for (int i = 0; i < count; i++)
+        {
+            Aggregator_Port* port = events[i].data.ptr;
+            if (port == NULL)
+            {
+                // Woken up by Aggregator_Stop
+                continue;
+            }
+            if ((port->fd >= 0) && (aggregator_read_port(aggregator, port) == 0))
+            {
+                // Hung up: the partial block left in the buffer is lost
+                epoll_ctl(aggregator->epoll_fd, EPOLL_CTL_DEL, port->fd, NULL);
+                close(port->fd);
+                port->fd = -1;
+                __atomic_sub_fetch(&aggregator->open_ports, 1, __ATOMIC_SEQ_CST);
+            }
+        }
+        __atomic_store_n(&aggregator->reader_cpu_ns, aggregator_thread_cpu(), __ATOMIC_RELAXED);
+    }
+    return NULL;
+}
+
+int aggregator_read_port(Aggregator* aggregator, Aggregator_Port* port)
+{
+    for (;;)
+    {
+        ssize_t length = read(port->fd, port->buffer + port->fill,
+                              AGGREGATOR_PORT_BUFFER - port->fill);
+        if (length > 0)
+        {
+            __atomic_add_fetch(&aggregator->bytes, (uint64_t)length, __ATOMIC_RELAXED);
+            port->fill += (uint32_t)length;
+            aggregator_frame(aggregator, port);
+            continue;
+        }
+        if ((length < 0) && ((errno == EAGAIN) || (errno == EINTR)))
+        {
+            return 1;
+        }
+        return 0;
+    }
+}
+
+void aggregator_frame(Aggregator* aggregator, Aggregator_Port* port)
+{
+    static const uint8_t magic[AGGREGATOR_MAGIC_SIZE] = {
+        FDC_CAPTURE_MAGIC & 0xFF, (FDC_CAPTURE_MAGIC >> 8) & 0xFF,
+        (FDC_CAPTURE_MAGIC >> 16) & 0xFF, (FDC_CAPTURE_MAGIC >> 24) & 0xFF
+    };
+    uint32_t start = 0;
+    while (port->fill - start >= AGGREGATOR_MAGIC_SIZE)
+    {
+        uint8_t* data = port->buffer + start;
+        if (memcmp(data, magic, AGGREGATOR_MAGIC_SIZE) != 0)
+        {
+            // Skip to the next candidate magic
+            uint8_t* next = memchr(data + 1, magic[0], port->fill - start - 1);
+            uint32_t skip = (next != NULL) ? (uint32_t)(next - data) : port->fill - start;
+            __atomic_add_fetch(&aggregator->skipped_bytes, skip, __ATOMIC_RELAXED);
+            start += skip;
+            continue;
+        }
+        if (port->fill - start >= sizeof(FDC_CaptureHeader))
+        {
+            // Reject a magic found inside the data of a block
+            FDC_CaptureHeader header;
+            memcpy(&header, data, sizeof(header));
+            if ((header.version != FDC_CAPTURE_VERSION) || (header.sample_count == 0) ||
+                (header.sample_count > FDC_CAPTURE_BLOCK_SAMPLES))
+            {
+                __atomic_add_fetch(&aggregator->skipped_bytes, 1, __ATOMIC_RELAXED);
+                start++;
+                continue;
+            }
+        }
+        if (port->fill - start < sizeof(FDC_CaptureBlock))
+        {
+            break;
+        }
+        Aggregator_Job* job = malloc(sizeof(Aggregator_Job));
+        if (job != NULL)
+        {
+            __atomic_add_fetch(&aggregator->jobs_alive, 1, __ATOMIC_SEQ_CST);
+            job->arrival_ns = aggregator_now();
+            job->port = port->index;
+            memcpy(&job->block, data, sizeof(FDC_CaptureBlock));
+            __atomic_add_fetch(&aggregator->blocks, 1, __ATOMIC_RELAXED);
+            aggregator_submit(aggregator, job);
+        }
+        start += sizeof(FDC_CaptureBlock);
+    }
+    // Keep the incomplete block, or the bytes that may start a magic
+    memmove(port->buffer, port->buffer + start, port->fill - start);
+    port->fill -= start;
+}
+
+void aggregator_submit(Aggregator* aggregator, Aggregator_Job* job)
+{
+    // Blocks of a port go to the same decoder unless its queue is full
+    uint8_t first = job->port % aggregator->worker_count;
+    for (;;)
+    {
+        for (uint8_t i = 0; i < aggregator->worker_count; i++)
+        {
+            Aggregator_Worker* worker = &aggregator->workers[(first + i) % aggregator->worker_count];
+            pthread_mutex_lock(&worker->lock);
+            if (worker->count < AGGREGATOR_QUEUE_SIZE)
+            {
+                worker->queue[(worker->head + worker->count) % AGGREGATOR_QUEUE_SIZE] = job;
+                worker->count++;
+                pthread_mutex_unlock(&worker->lock);
+                __atomic_add_fetch(&aggregator->queued, 1, __ATOMIC_SEQ_CST);
+                if (__atomic_load_n(&aggregator->sleepers, __ATOMIC_SEQ_CST) > 0)
+                {
+                    pthread_mutex_lock(&aggregator->sleep_lock);
+                    pthread_cond_signal(&aggregator->work_available);
+                    pthread_mutex_unlock(&aggregator->sleep_lock);
+                }
+                return;
+            }
+            pthread_mutex_unlock(&worker->lock);
+        }
+        // All the decoders are behind: stop reading for a while
+        __atomic_add_fetch(&aggregator->reader_stalls, 1, __ATOMIC_RELAXED);
+        struct timespec pause = { 0, AGGREGATOR_STALL_NS };
+        nanosleep(&pause, NULL);
+    }
+}
+
+void* aggregator_worker(void* argument)
+{
+    Aggregator_Worker* worker = argument;
+    Aggregator* aggregator = worker->aggregator;
+    for (;;)
+    {
+        // Own queue first, oldest block first
+        Aggregator_Job* job = aggregator_take(worker, 0);
+        for (uint8_t i = 1; (job == NULL) && (i < aggregator->worker_count); i++)
+        {
+            // Steal the newest block of another decoder
+            job = aggregator_take(&aggregator->workers[(worker->index + i) % aggregator->worker_count], 1);
+            if (job != NULL)
+            {
+                __atomic_add_fetch(&worker->stolen, 1, __ATOMIC_RELAXED);
+            }
+        }
+        if (job != NULL)
+        {
+            __atomic_sub_fetch(&aggregator->queued, 1, __ATOMIC_SEQ_CST);
+            aggregator_decode(aggregator, job);
+            __atomic_add_fetch(&worker->decoded, 1, __ATOMIC_RELAXED);
+            __atomic_store_n(&worker->cpu_ns, aggregator_thread_cpu(), __ATOMIC_RELAXED);
+            continue;
+        }
+        pthread_mutex_lock(&aggregator->sleep_lock);
+        __atomic_add_fetch(&aggregator->sleepers, 1, __ATOMIC_SEQ_CST);
+        uint8_t done = 0;
+        if (__atomic_load_n(&aggregator->queued, __ATOMIC_SEQ_CST) == 0)
+        {
+            if (__atomic_load_n(&aggregator->workers_stopping, __ATOMIC_SEQ_CST))
+            {
+                done = 1;
+            }
+            else
+            {
+                pthread_cond_wait(&aggregator->work_available, &aggregator->sleep_lock);
+            }
+        }
+        __atomic_sub_fetch(&aggregator->sleepers, 1, __ATOMIC_SEQ_CST);
+        pthread_mutex_unlock(&aggregator->sleep_lock);
+        if (done)
+        {
+            __atomic_store_n(&worker->cpu_ns, aggregator_thread_cpu(), __ATOMIC_RELAXED);
+            return NULL;
+        }
+    }
+}
+
+Aggregator_Job* aggregator_take(Aggregator_Worker* worker, uint8_t steal)
+{
+    Aggregator_Job* job = NULL;
+    pthread_mutex_lock(&worker->lock);
+    if (worker->count > 0)
+    {
+        if (steal)
+        {
+            job = worker->queue[(worker->head + worker->count - 1) % AGGREGATOR_QUEUE_SIZE];
+        }
+        else
+        {
+            job = worker->queue[worker->head];
+            worker->head = (worker->head + 1) % AGGREGATOR_QUEUE_SIZE;
+        }
+        worker->count--;
+    }
+    pthread_mutex_unlock(&worker->lock);
+    return job;
+}
+
+void aggregator_decode(Aggregator* aggregator, Aggregator_Job* job)
+{
+    FDC_CaptureHeader* header = &job->block.header;
+    uint16_t crc = header->crc;
+    header->crc = 0;
+    uint8_t valid = (FDC_Capture_Crc16((const uint8_t*)&job->block, sizeof(FDC_CaptureBlock)) == crc);
+    header->crc = crc;
+
+    // The node ID of a corrupted block cannot be trusted: the error goes
+    // to the node last seen on the port
+    Aggregator_Port* port = aggregator->ports[job->port];
+    int32_t node_id = valid ? header->node_id : __atomic_load_n(&port->node_id, __ATOMIC_RELAXED);
+    if (node_id < 0)
+    {
+        node_id = header->node_id;
+    }
+    if (valid)
+    {
+        __atomic_store_n(&port->node_id, node_id, __ATOMIC_RELAXED);
+    }
+    Aggregator_Node* node = aggregator_node(aggregator, (uint16_t)node_id);
+    if (node == NULL)
+    {
+        aggregator_release(aggregator, job);
+        return;
+    }
+    uint64_t latency = aggregator_now() - job->arrival_ns;
+    pthread_mutex_lock(&node->lock);
+    if (!valid)
+    {
+        node->stats.crc_errors++;
+    }
+    else
+    {
+        if ((node->stats.blocks == 0) || (header->sequence < node->stats.first_sequence))
+        {
+            node->stats.first_sequence = header->sequence;
+        }
+        if ((node->stats.blocks == 0) || (header->sequence > node->stats.last_sequence))
+        {
+            node->stats.last_sequence = header->sequence;
+        }
+        node->stats.blocks++;
+        node->stats.samples += header->sample_count;
+        node->latency_total_ns += latency;
+        if (latency > node->stats.latency_max_ns)
+        {
+            node->stats.latency_max_ns = latency;
+        }
+        uint64_t bucket = latency / AGGREGATOR_LATENCY_BUCKET_NS;
+        node->latency_histogram[(bucket < AGGREGATOR_LATENCY_BUCKETS) ? bucket : AGGREGATOR_LATENCY_BUCKETS - 1]++;
+    }
+    pthread_mutex_unlock(&node->lock);
+    if (!valid || (aggregator->sink_count == 0))
+    {
+        aggregator_release(aggregator, job);
+        return;
+    }
+
+    // Deliver to the sinks, the last one to finish releases the block
+    job->refs = aggregator->sink_count;
+    for (uint8_t i = 0; i < aggregator->sink_count; i++)
+    {
+        Aggregator_Sink* sink = &aggregator->sinks[i];
+        pthread_mutex_lock(&sink->lock);
+        if ((sink->count == sink->depth) && (sink->policy == AGGREGATOR_SINK_BLOCK))
+        {
+            sink->stats.stalls++;
+            while (sink->count == sink->depth)
+            {
+                pthread_cond_wait(&sink->not_full, &sink->lock);
+            }
+        }
+        if (sink->count == sink->depth)
+        {
+            sink->stats.dropped++;
+            pthread_mutex_unlock(&sink->lock);
+            aggregator_release(aggregator, job);
+            continue;
+        }
+        sink->queue[(sink->head + sink->count) % sink->depth] = job;
+        sink->count++;
+        pthread_cond_signal(&sink->not_empty);
+        pthread_mutex_unlock(&sink->lock);
+    }
+}
+
+Aggregator_Node* aggregator_node(Aggregator* aggregator, uint16_t node_id)
+{
+    Aggregator_Node* node = __atomic_load_n(&aggregator->nodes[node_id], __ATOMIC_ACQUIRE);
+    if (node != NULL)
+    {
+        return node;
+    }
+    pthread_mutex_lock(&aggregator->nodes_lock);
+    node = aggregator->nodes[node_id];
+    if (node == NULL)
+    {
+        node = calloc(1, sizeof(Aggregator_Node));
+        if (node != NULL)
+        {
+            pthread_mutex_init(&node->lock, NULL);
+            node->stats.node_id = node_id;
+            __atomic_store_n(&aggregator->nodes[node_id], node, __ATOMIC_RELEASE);
+            __atomic_add_fetch(&aggregator->node_count, 1, __ATOMIC_RELAXED);
+        }
+    }
+    pthread_mutex_unlock(&aggregator->nodes_lock);
+    return node;
+}
+
+void* aggregator_sink(void* argument)
+{
+    Aggregator_Sink* sink = argument;
+    for (;;)
+    {
+        pthread_mutex_lock(&sink->lock);
+        while ((sink->count == 0) && !sink->stopping)
+        {
+            pthread_cond_wait(&sink->not_empty, &sink->lock);
+        }
+        if (sink->count == 0)
+        {
+            pthread_mutex_unlock(&sink->lock);
+            return NULL;
+        }
+        Aggregator_Job* job = sink->queue[sink->head];
+        sink->head = (sink->head + 1) % sink->depth;
+        sink->count--;
+        sink->stats.delivered++;
+        pthread_cond_signal(&sink->not_full);
+        pthread_mutex_unlock(&sink->lock);
+        sink->callback(&job->block, sink->context);
+        aggregator_release(sink->aggregator, job);
+    }
+}
+
+void aggregator_release(Aggregator* aggregator, Aggregator_Job* job)
+{
+    if ((job->refs == 0) || (__atomic_sub_fetch(&job->refs, 1, __ATOMIC_ACQ_REL) == 0))
+    {
+        free(job);
+        __atomic_sub_fetch(&aggregator->jobs_alive, 1, __ATOMIC_SEQ_CST);
+    }
+}
+
+void aggregator_node_stats(Aggregator_Node* node, Aggregator_NodeStats* stats)
+{
+    pthread_mutex_lock(&node->lock);
+    *stats = node->stats;
+    if (stats->blocks > 0)
+    {
+        uint64_t expected = (uint64_t)stats->last_sequence - stats->first_sequence + 1;
+        stats->sequence_gaps = (expected > stats->blocks) ? (uint32_t)(expected - stats->blocks) : 0;
+        stats->latency_mean_ns = node->latency_total_ns / stats->blocks;
+        // Upper edge of the bucket holding the 99th percentile
+        uint64_t rank = (stats->blocks * 99 + 99) / 100;
+        uint64_t seen = 0;
+        for (uint32_t i = 0; i < AGGREGATOR_LATENCY_BUCKETS; i++)
+        {
+            seen += node->latency_histogram[i];
+            if (seen >= rank)
+            {
+                stats->latency_p99_ns = (uint64_t)(i + 1) * AGGREGATOR_LATENCY_BUCKET_NS;
+                break;
+            }
+        }
+        if (stats->latency_p99_ns > stats->latency_max_ns)
+        {
+            stats->latency_p99_ns = stats->latency_max_ns;
+        }
+    }
+    pthread_mutex_unlock(&node->lock);
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,253 @@
+/**
+*   \file Aggregator.h
+*   \brief Host aggregator of the capture streams of many nodes.
+*
+*   The aggregator reads the capture blocks (see FDC1004Q_Capture.h) sent
+*   by many nodes over serial ports. A single reader thread multiplexes all
+*   the ports with epoll and cuts each byte stream into blocks, resyncing on
+*   the block magic after garbage or lost bytes. Complete blocks are handed
+*   to a pool of decoder threads: each thread owns a queue, the reader
+*   spreads the blocks by port over the queues, and idle threads steal work
+*   from the others, so that a burst on a few ports keeps all the threads
+*   busy. The decoders check the CRC, keep per-node statistics (sequence
+*   gaps, CRC errors, latency from the arrival of the last byte of a block
+*   to the end of its decoding) and pass the valid blocks to the sinks.
+*
+*   Each sink runs on its own thread behind a bounded queue. A sink created
+*   with #AGGREGATOR_SINK_BLOCK applies backpressure: when its queue is full
+*   the decoders wait, their queues fill up, the reader stops reading and
+*   the nodes are eventually held back by the serial link. A sink created
+*   with #AGGREGATOR_SINK_DROP never holds back the others and counts the
+*   blocks it had to drop.
+*
+*   \author Davide Marzorati
+*/
+
+#ifndef __AGGREGATOR_H__
+    #define __AGGREGATOR_H__
+
+    #include <stdint.h>
+    #include "FDC1004Q_Capture.h"
+
+    /**
+    *   \brief Maximum number of ports.
+    */
+    #ifndef AGGREGATOR_MAX_PORTS
+        #define AGGREGATOR_MAX_PORTS 1024
+    #endif
+
+    /**
+    *   \brief Maximum number of decoder threads.
+    */
+    #define AGGREGATOR_MAX_WORKERS 64
+
+    /**
+    *   \brief Maximum number of sinks.
+    */
+    #define AGGREGATOR_MAX_SINKS 8
+
+    /**
+    *   \brief Number of blocks each decoder queue can hold.
+    */
+    #ifndef AGGREGATOR_QUEUE_SIZE
+        #define AGGREGATOR_QUEUE_SIZE 256
+    #endif
+
+    /**
+    *   \brief Width of the latency histogram buckets (ns).
+    */
+    #define AGGREGATOR_LATENCY_BUCKET_NS 10000
+
+    /**
+    *   \brief Number of latency histogram buckets, the last one collects
+    *   all the latencies above the range.
+    */
+    #define AGGREGATOR_LATENCY_BUCKETS 1000
+
+    /**
+    *   \brief The sink holds back the decoders when its queue is full.
+    */
+    #define AGGREGATOR_SINK_BLOCK 0
+
+    /**
+    *   \brief The sink drops blocks when its queue is full.
+    */
+    #define AGGREGATOR_SINK_DROP  1
+
+    /**
+    *   \brief Statistics of a node.
+    */
+    typedef struct {
+        /** ID of the node **/
+        uint16_t node_id;
+        /** Valid blocks received **/
+        uint32_t blocks;
+        /** Samples in the valid blocks **/
+        uint64_t samples;
+        /** Blocks rejected by the CRC check **/
+        uint32_t crc_errors;
+        /** Blocks missing from the sequence, lost or rejected by the CRC check **/
+        uint32_t sequence_gaps;
+        /** Lowest and highest sequence number received **/
+        uint32_t first_sequence;
+        uint32_t last_sequence;
+        /** Average and maximum latency (ns) **/
+        uint64_t latency_mean_ns;
+        uint64_t latency_max_ns;
+        /** 99th percentile of the latency (ns), within a histogram bucket **/
+        uint64_t latency_p99_ns;
+    } Aggregator_NodeStats;
+
+    /**
+    *   \brief Statistics of the whole aggregator.
+    */
+    typedef struct {
+        /** Bytes read from the ports **/
+        uint64_t bytes;
+        /** Bytes skipped while looking for the block magic **/
+        uint64_t skipped_bytes;
+        /** Blocks framed by the reader **/
+        uint64_t blocks;
+        /** Blocks decoded by each thread, stolen from another thread included **/
+        uint64_t decoded[AGGREGATOR_MAX_WORKERS];
+        /** Blocks stolen by each thread **/
+        uint64_t stolen[AGGREGATOR_MAX_WORKERS];
+        /** Times the reader waited for room in the decoder queues **/
+        uint64_t reader_stalls;
+        /** CPU time used by the reader and by the decoders (ns) **/
+        uint64_t reader_cpu_ns;
+        uint64_t worker_cpu_ns;
+        /** Number of nodes seen **/
+        uint32_t nodes;
+        /** Ports still open **/
+        uint32_t open_ports;
+    } Aggregator_Stats;
+
+    /**
+    *   \brief Statistics of a sink.
+    */
+    typedef struct {
+        /** Blocks delivered to the sink **/
+        uint64_t delivered;
+        /** Blocks dropped because the queue was full **/
+        uint64_t dropped;
+        /** Times a decoder waited for room in the queue **/
+        uint64_t stalls;
+    } Aggregator_SinkStats;
+
+    /**
+    *   \brief Sink callback, called on the thread of the sink.
+    *   \param[in] block the valid block, valid only during the call.
+    *   \param context the context pointer given when the sink was added.
+    */
+    typedef void (*Aggregator_SinkCallback)(const FDC_CaptureBlock* block, void* context);
+
+    typedef struct Aggregator Aggregator;
+
+    /**
+    *   \brief Create an aggregator.
+    *   \param workers the number of decoder threads, from 1 to
+    *       #AGGREGATOR_MAX_WORKERS.
+    *   \return the aggregator, or NULL if it could not be created.
+    */
+    Aggregator* Aggregator_Create(uint8_t workers);
+
+    /**
+    *   \brief Destroy an aggregator, stopping it if needed.
+    *
+    *   The ports opened with #Aggregator_AddPort are closed.
+    *   \param aggregator the aggregator.
+    */
+    void Aggregator_Destroy(Aggregator* aggregator);
+
+    /**
+    *   \brief Add a serial port.
+    *
+    *   The device is opened in non-blocking mode and switched to raw mode.
+    *   Ports can be added before and after #Aggregator_Start.
+    *   \param aggregator the aggregator.
+    *   \param path the path of the device, e.g. "/dev/ttyACM0".
+    *   \param baud the baud rate, e.g. 921600, or 0 to keep the current one.
+    *   \return 0 on success, -1 on error (errno is set).
+    */
+    int Aggregator_AddPort(Aggregator* aggregator, const char* path, uint32_t baud);
+
+    /**
+    *   \brief Add a sink.
+    *
+    *   Sinks must be added before #Aggregator_Start.
+    *   \param aggregator the aggregator.
+    *   \param callback the function receiving the valid blocks.
+    *   \param context the pointer passed to the callback.
+    *   \param depth the number of blocks the queue of the sink can hold.
+    *   \param policy #AGGREGATOR_SINK_BLOCK or #AGGREGATOR_SINK_DROP.
+    *   \return the index of the sink, or -1 on error.
+    */
+    int Aggregator_AddSink(Aggregator* aggregator, Aggregator_SinkCallback callback,
+                           void* context, uint32_t depth, uint8_t policy);
+
+    /**
+    *   \brief Start the reader, decoder and sink threads.
+    *   \param aggregator the aggregator.
+    *   \return 0 on success, -1 on error.
+    */
+    int Aggregator_Start(Aggregator* aggregator);
+
+    /**
+    *   \brief Wait until all the ports are closed and all the blocks delivered.
+    *
+    *   A port is closed when its device hangs up (e.g. when the node
+    *   side of a pseudo-terminal is closed).
+    *   \param aggregator the aggregator.
+    *   \param timeout_ms the maximum time to wait.
+    *   \return 0 if the aggregator went idle, -1 on timeout.
+    */
+    int Aggregator_WaitIdle(Aggregator* aggregator, uint32_t timeout_ms);
+
+    /**
+    *   \brief Stop all the threads.
+    *
+    *   The blocks already framed are decoded and delivered first.
+    *   \param aggregator the aggregator.
+    */
+    void Aggregator_Stop(Aggregator* aggregator);
+
+    /**
+    *   \brief Read the statistics of the aggregator.
+    *   \param aggregator the aggregator.
+    *   \param[out] stats pointer to the structure to be filled.
+    */
+    void Aggregator_GetStats(Aggregator* aggregator, Aggregator_Stats* stats);
+
+    /**
+    *   \brief Read the statistics of a node.
+    *   \param aggregator the aggregator.
+    *   \param node_id the ID of the node.
+    *   \param[out] stats pointer to the structure to be filled.
+    *   \return 0 on success, -1 if no block was received from the node.
+    */
+    int Aggregator_GetNodeStats(Aggregator* aggregator, uint16_t node_id,
+                                Aggregator_NodeStats* stats);
+
+    /**
+    *   \brief Read the statistics of a sink.
+    *   \param aggregator the aggregator.
+    *   \param sink the index of the sink.
+    *   \param[out] stats pointer to the structure to be filled.
+    *   \return 0 on success, -1 if the sink does not exist.
+    */
+    int Aggregator_GetSinkStats(Aggregator* aggregator, int sink,
+                                Aggregator_SinkStats* stats);
+
+    /**
+    *   \brief Call a function for each node seen, by increasing node ID.
+    *   \param aggregator the aggregator.
+    *   \param callback the function called with the statistics of each node.
+    *   \param context the pointer passed to the callback.
+    */
+    void Aggregator_ForEachNode(Aggregator* aggregator,
+                                void (*callback)(const Aggregator_NodeStats* stats, void* context),
+                                void* context);
+
+#endif
+/* [] END OF FILE */
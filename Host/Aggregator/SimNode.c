@@ -0,0 +1,142 @@
+/**
+*   \brief Source file for the simulated node.
+*/
+
+#define _GNU_SOURCE
+
+#include "SimNode.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <unistd.h>
+
+int SimNode_Open(SimNode* node, uint16_t node_id)
+{
+    memset(node, 0, sizeof(SimNode));
+    node->node_id = node_id;
+    node->fd = posix_openpt(O_RDWR | O_NOCTTY | O_CLOEXEC);
+    if (node->fd < 0)
+    {
+        return -1;
+    }
+    if ((grantpt(node->fd) != 0) || (unlockpt(node->fd) != 0) ||
+        (ptsname_r(node->fd, node->path, sizeof(node->path)) != 0))
+    {
+        close(node->fd);
+        node->fd = -1;
+        return -1;
+    }
+    // Raw slave side from the start, so that no byte is translated
+    int slave = open(node->path, O_RDWR | O_NOCTTY);
+    if (slave >= 0)
+    {
+        struct termios options;
+        if (tcgetattr(slave, &options) == 0)
+        {
+            cfmakeraw(&options);
+            tcsetattr(slave, TCSANOW, &options);
+        }
+        close(slave);
+    }
+    return 0;
+}
+
+void SimNode_Close(SimNode* node)
+{
+    if (node->fd >= 0)
+    {
+        close(node->fd);
+        node->fd = -1;
+    }
+}
+
+void SimNode_NextBlock(SimNode* node, FDC_CaptureBlock* block)
+{
+    memset(block, 0, sizeof(FDC_CaptureBlock));
+    block->header.magic = FDC_CAPTURE_MAGIC;
+    block->header.version = FDC_CAPTURE_VERSION;
+    block->header.channel_mask = FDC_RP_CH_1 | FDC_RP_CH_2 | FDC_RP_CH_3 | FDC_RP_CH_4;
+    block->header.sample_count = FDC_CAPTURE_BLOCK_SAMPLES;
+    block->header.sequence = node->sequence++;
+    block->header.node_id = node->node_id;
+    block->header.first_timestamp = node->timestamp;
+    for (uint8_t i = 0; i < FDC_CAPTURE_BLOCK_SAMPLES; i++)
+    {
+        block->timestamp[i] = node->timestamp;
+        for (uint8_t ch = 0; ch < FDC_CAPTURE_CHANNELS; ch++)
+        {
+            // Triangle wave, different on each node and channel
+            int32_t phase = (int32_t)((node->timestamp / 10 + 7 * ch + node->node_id) % 200);
+            block->raw[ch][i] = ((phase < 100) ? phase : 200 - phase) * 1000 - 50000;
+            block->capdac[ch][i] = ch;
+        }
+        node->timestamp += 10;
+    }
+    block->header.last_timestamp = node->timestamp - 10;
+    block->header.crc = FDC_Capture_Crc16((const uint8_t*)block, sizeof(FDC_CaptureBlock));
+}
+
+int SimNode_SendBlock(SimNode* node, uint8_t corrupt)
+{
+    FDC_CaptureBlock block;
+    SimNode_NextBlock(node, &block);
+    if (corrupt)
+    {
+        block.raw[1][3] ^= 0x10;
+    }
+    node->blocks++;
+    return SimNode_Write(node, &block, sizeof(block));
+}
+
+void SimNode_LoseBlock(SimNode* node)
+{
+    FDC_CaptureBlock block;
+    SimNode_NextBlock(node, &block);
+    node->blocks++;
+}
+
+int SimNode_SendGarbage(SimNode* node, uint16_t length)
+{
+    uint8_t garbage[256];
+    for (uint16_t i = 0; i < sizeof(garbage); i++)
+    {
+        // Includes the first byte of the magic
+        garbage[i] = (uint8_t)(i * 37 + 'F');
+    }
+    while (length > 0)
+    {
+        uint16_t chunk = (length > sizeof(garbage)) ? sizeof(garbage) : length;
+        if (SimNode_Write(node, garbage, chunk) != 0)
+        {
+            return -1;
+        }
+        length -= chunk;
+    }
+    return 0;
+}
+
+int SimNode_Write(SimNode* node, const void* data, uint32_t length)
+{
+    const uint8_t* bytes = data;
+    while (length > 0)
+    {
+        ssize_t written = write(node->fd, bytes, length);
+        if (written < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            return -1;
+        }
+        bytes += written;
+        length -= (uint32_t)written;
+    }
+    return 0;
+}
+
+/* [] END OF FILE */
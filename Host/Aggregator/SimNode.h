@@ -0,0 +1,95 @@
+/**
+*   \file SimNode.h
+*   \brief Simulated node streaming capture blocks over a pseudo-terminal.
+*
+*   A simulated node owns the master side of a pseudo-terminal and writes
+*   the capture blocks a node would send over its serial port, so that the
+*   aggregator can be tested and benchmarked on a host by opening the slave
+*   side as if it were a serial port. The blocks carry a deterministic
+*   waveform and a valid CRC, and faults can be injected on request: lost
+*   blocks, corrupted blocks and garbage between blocks.
+*
+*   \author Davide Marzorati
+*/
+
+#ifndef __SIM_NODE_H__
+    #define __SIM_NODE_H__
+
+    #include <stdint.h>
+    #include "FDC1004Q_Capture.h"
+
+    /**
+    *   \brief Simulated node.
+    */
+    typedef struct {
+        /** Master side of the pseudo-terminal, -1 when closed **/
+        int fd;
+        /** Path of the slave side, to be opened by the aggregator **/
+        char path[64];
+        /** ID of the node **/
+        uint16_t node_id;
+        /** Sequence number of the next block **/
+        uint32_t sequence;
+        /** Timestamp of the next sample (ms) **/
+        uint32_t timestamp;
+        /** Blocks written, lost and corrupted blocks included **/
+        uint32_t blocks;
+    } SimNode;
+
+    /**
+    *   \brief Open the pseudo-terminal of a node.
+    *   \param[out] node the node.
+    *   \param node_id the ID of the node.
+    *   \return 0 on success, -1 on error (errno is set).
+    */
+    int SimNode_Open(SimNode* node, uint16_t node_id);
+
+    /**
+    *   \brief Close the master side, the slave side then hangs up.
+    *   \param node the node.
+    */
+    void SimNode_Close(SimNode* node);
+
+    /**
+    *   \brief Build the next block of a node.
+    *
+    *   The block holds #FDC_CAPTURE_BLOCK_SAMPLES samples taken every 10 ms
+    *   on the four channels. The sequence number is advanced.
+    *   \param node the node.
+    *   \param[out] block the block, with its CRC.
+    */
+    void SimNode_NextBlock(SimNode* node, FDC_CaptureBlock* block);
+
+    /**
+    *   \brief Write the next block.
+    *   \param node the node.
+    *   \param corrupt nonzero to flip a bit of the block after its CRC is computed.
+    *   \return 0 on success, -1 on error.
+    */
+    int SimNode_SendBlock(SimNode* node, uint8_t corrupt);
+
+    /**
+    *   \brief Skip the next block, as if it was lost on the link.
+    *   \param node the node.
+    */
+    void SimNode_LoseBlock(SimNode* node);
+
+    /**
+    *   \brief Write bytes that are not part of a block.
+    *   \param node the node.
+    *   \param length the number of bytes.
+    *   \return 0 on success, -1 on error.
+    */
+    int SimNode_SendGarbage(SimNode* node, uint16_t length);
+
+    /**
+    *   \brief Write a buffer, waiting until all of it is written.
+    *   \param node the node.
+    *   \param[in] data the bytes.
+    *   \param length the number of bytes.
+    *   \return 0 on success, -1 on error.
+    */
+    int SimNode_Write(SimNode* node, const void* data, uint32_t length);
+
+#endif
+/* [] END OF FILE */
@@ -0,0 +1,164 @@
+/**
+*   \brief Aggregator daemon for the capture streams of many nodes.
+*
+*   Usage: fdc_aggregator [-w workers] [-b baud] [-o file] [-d] [-i seconds] port...
+*
+*   The valid blocks of all the ports are appended unchanged to the output
+*   file, which can then be read as a capture file (see FDC1004Q_Capture.h).
+*   With -d the file sink drops blocks when the disk falls behind instead of
+*   holding back the ports. The statistics of each node are printed every
+*   interval, and once more on SIGINT or SIGTERM before exiting.
+*/
+
+#include "Aggregator.h"
+
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// Set by the signal handler
+static volatile sig_atomic_t daemon_stop;
+
+// Stop on SIGINT and SIGTERM
+static void daemon_signal(int signal_number);
+
+// File sink
+static void daemon_write_block(const FDC_CaptureBlock* block, void* context);
+
+// Print the statistics of a node
+static void daemon_print_node(const Aggregator_NodeStats* stats, void* context);
+
+// Print the statistics of the aggregator and of all the nodes
+static void daemon_print(Aggregator* aggregator, int sink);
+
+int main(int argc, char** argv)
+{
+    uint8_t workers = 4;
+    uint32_t baud = 921600;
+    const char* output = NULL;
+    uint8_t policy = AGGREGATOR_SINK_BLOCK;
+    unsigned interval = 10;
+    int option;
+    while ((option = getopt(argc, argv, "w:b:o:di:")) != -1)
+    {
+        switch (option)
+        {
+            case 'w':
+                workers = (uint8_t)atoi(optarg);
+                break;
+            case 'b':
+                baud = (uint32_t)strtoul(optarg, NULL, 10);
+                break;
+            case 'o':
+                output = optarg;
+                break;
+            case 'd':
+                policy = AGGREGATOR_SINK_DROP;
+                break;
+            case 'i':
+                interval = (unsigned)atoi(optarg);
+                break;
+            default:
+                fprintf(stderr, "Usage: %s [-w workers] [-b baud] [-o file] [-d] [-i seconds] port...\n", argv[0]);
+                return 2;
+        }
+    }
+    if (optind == argc)
+    {
+        fprintf(stderr, "No port given\n");
+        return 2;
+    }
+
+    Aggregator* aggregator = Aggregator_Create(workers);
+    if (aggregator == NULL)
+    {
+        fprintf(stderr, "Could not create the aggregator\n");
+        return 1;
+    }
+    FILE* file = NULL;
+    int sink = -1;
+    if (output != NULL)
+    {
+        file = fopen(output, "ab");
+        if (file == NULL)
+        {
+            perror(output);
+            Aggregator_Destroy(aggregator);
+            return 1;
+        }
+        sink = Aggregator_AddSink(aggregator, daemon_write_block, file, 4096, policy);
+    }
+    for (int i = optind; i < argc; i++)
+    {
+        if (Aggregator_AddPort(aggregator, argv[i], baud) != 0)
+        {
+            perror(argv[i]);
+        }
+    }
+
+    signal(SIGINT, daemon_signal);
+    signal(SIGTERM, daemon_signal);
+    Aggregator_Start(aggregator);
+    unsigned elapsed = 0;
+    while (!daemon_stop)
+    {
+        sleep(1);
+        if ((interval > 0) && (++elapsed % interval == 0))
+        {
+            daemon_print(aggregator, sink);
+        }
+    }
+    Aggregator_Stop(aggregator);
+    daemon_print(aggregator, sink);
+    Aggregator_Destroy(aggregator);
+    if (file != NULL)
+    {
+        fclose(file);
+    }
+    return 0;
+}
+
+void daemon_signal(int signal_number)
+{
+    (void)signal_number;
+    daemon_stop = 1;
+}
+
+void daemon_write_block(const FDC_CaptureBlock* block, void* context)
+{
+    fwrite(block, sizeof(FDC_CaptureBlock), 1, (FILE*)context);
+}
+
+void daemon_print_node(const Aggregator_NodeStats* stats, void* context)
+{
+    (void)context;
+    printf("node %5u: %8u blocks %10llu samples %4u gaps %4u crc errors, latency %6llu us mean %6llu us p99 %6llu us max\n",
+           stats->node_id, stats->blocks, (unsigned long long)stats->samples,
+           stats->sequence_gaps, stats->crc_errors,
+           (unsigned long long)(stats->latency_mean_ns / 1000),
+           (unsigned long long)(stats->latency_p99_ns / 1000),
+           (unsigned long long)(stats->latency_max_ns / 1000));
+}
+
+void daemon_print(Aggregator* aggregator, int sink)
+{
+    Aggregator_Stats stats;
+    Aggregator_GetStats(aggregator, &stats);
+    printf("%u nodes, %u ports open, %llu blocks, %llu bytes, %llu skipped, %llu reader stalls\n",
+           stats.nodes, stats.open_ports, (unsigned long long)stats.blocks,
+           (unsigned long long)stats.bytes, (unsigned long long)stats.skipped_bytes,
+           (unsigned long long)stats.reader_stalls);
+    Aggregator_SinkStats sink_stats;
+    if (Aggregator_GetSinkStats(aggregator, sink, &sink_stats) == 0)
+    {
+        printf("file sink: %llu written, %llu dropped, %llu stalls\n",
+               (unsigned long long)sink_stats.delivered, (unsigned long long)sink_stats.dropped,
+               (unsigned long long)sink_stats.stalls);
+    }
+    Aggregator_ForEachNode(aggregator, daemon_print_node, NULL);
+    fflush(stdout);
+}
+
+/* [] END OF FILE */
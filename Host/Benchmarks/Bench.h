@@ -0,0 +1,40 @@
+/**
+*   \file Bench.h
+*   \brief Timing helpers for the host benchmarks.
+*
+*   The cost of the firmware routines is measured on the host in ns and,
+*   on x86, in time stamp counter cycles. The cycles are those of the host
+*   core, so they only give the relative cost of the routines: on the
+*   Cortex-M3 every 64-bit or floating point operation is slower.
+*
+*   \author Davide Marzorati
+*/
+
+#ifndef __BENCH_H__
+    #define __BENCH_H__
+
+    #include <stdint.h>
+    #include <time.h>
+
+    #if defined(__x86_64__) || defined(__i386__)
+        #include <x86intrin.h>
+        /**
+        *   \brief Read the time stamp counter, 0 when there is none.
+        */
+        #define BENCH_CYCLES() __rdtsc()
+    #else
+        #define BENCH_CYCLES() 0
+    #endif
+
+    /**
+    *   \brief Monotonic time (ns).
+    */
+    static inline uint64_t bench_now_ns(void)
+    {
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        return (uint64_t)now.tv_sec * 1000000000ULL + now.tv_nsec;
+    }
+
+#endif
+/* [] END OF FILE */
@@ -0,0 +1,140 @@
+/**
+*   \brief Benchmark of the aggregator throughput per core.
+*
+*   Usage: bench_aggregator [nodes] [seconds]
+*
+*   Simulated nodes on pseudo-terminals stream blocks as fast as the
+*   generator threads can build them, for each number of decoder threads.
+*   The throughput is divided by the CPU time of the aggregator threads
+*   (reader and decoders) to give the samples per second one core can
+*   sustain, and the number of nodes at 400 S/s (four channels at 100
+*   frames per second) this corresponds to.
+*/
+
+#include "Aggregator.h"
+#include "SimNode.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define BENCH_GENERATORS 4
+#define BENCH_MAX_NODES 512
+
+typedef struct {
+    SimNode* nodes;
+    uint32_t first;
+    uint32_t count;
+    volatile int* stop;
+} Bench_Generator;
+
+static void* bench_generate(void* argument)
+{
+    Bench_Generator* generator = argument;
+    while (!*generator->stop)
+    {
+        for (uint32_t i = generator->first; i < generator->first + generator->count; i++)
+        {
+            SimNode_SendBlock(&generator->nodes[i], 0);
+        }
+    }
+    return NULL;
+}
+
+static double bench_now(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec * 1e-9;
+}
+
+static void bench_run(uint32_t node_count, uint8_t workers, double seconds)
+{
+    static SimNode nodes[BENCH_MAX_NODES];
+    Aggregator* aggregator = Aggregator_Create(workers);
+    for (uint32_t i = 0; i < node_count; i++)
+    {
+        if ((SimNode_Open(&nodes[i], (uint16_t)i) != 0) ||
+            (Aggregator_AddPort(aggregator, nodes[i].path, 0) != 0))
+        {
+            perror("pty");
+            exit(1);
+        }
+    }
+    Aggregator_Start(aggregator);
+
+    volatile int stop = 0;
+    pthread_t threads[BENCH_GENERATORS];
+    Bench_Generator generators[BENCH_GENERATORS];
+    for (uint32_t g = 0; g < BENCH_GENERATORS; g++)
+    {
+        generators[g].nodes = nodes;
+        generators[g].first = g * node_count / BENCH_GENERATORS;
+        generators[g].count = (g + 1) * node_count / BENCH_GENERATORS - generators[g].first;
+        generators[g].stop = &stop;
+        pthread_create(&threads[g], NULL, bench_generate, &generators[g]);
+    }
+    double start = bench_now();
+    Aggregator_Stats before;
+    Aggregator_GetStats(aggregator, &before);
+    struct timespec pause = { (time_t)seconds, (long)((seconds - (time_t)seconds) * 1e9) };
+    nanosleep(&pause, NULL);
+    Aggregator_Stats after;
+    Aggregator_GetStats(aggregator, &after);
+    double elapsed = bench_now() - start;
+    stop = 1;
+    for (uint32_t g = 0; g < BENCH_GENERATORS; g++)
+    {
+        pthread_join(threads[g], NULL);
+    }
+    for (uint32_t i = 0; i < node_count; i++)
+    {
+        SimNode_Close(&nodes[i]);
+    }
+    Aggregator_WaitIdle(aggregator, 10000);
+
+    uint64_t decoded = 0;
+    for (uint8_t w = 0; w < workers; w++)
+    {
+        decoded += after.decoded[w] - before.decoded[w];
+    }
+    double cpu = ((after.reader_cpu_ns - before.reader_cpu_ns) +
+                  (after.worker_cpu_ns - before.worker_cpu_ns)) * 1e-9;
+    double frames = (double)decoded * FDC_CAPTURE_BLOCK_SAMPLES;
+    double frames_per_core = frames / cpu;
+    uint64_t p99_max = 0;
+    for (uint32_t i = 0; i < node_count; i++)
+    {
+        Aggregator_NodeStats stats;
+        if ((Aggregator_GetNodeStats(aggregator, (uint16_t)i, &stats) == 0) && (stats.latency_p99_ns > p99_max))
+        {
+            p99_max = stats.latency_p99_ns;
+        }
+    }
+    printf("%4u nodes %2u decoders: %8.0f blocks/s %10.0f S/s, %5.2f cores busy, "
+           "%10.0f S/s per core = %6.0f nodes at 400 S/s per core, worst p99 %llu us, %llu reader stalls\n",
+           node_count, workers, decoded / elapsed, 4 * frames / elapsed, cpu / elapsed,
+           4 * frames_per_core, frames_per_core / 100, (unsigned long long)(p99_max / 1000),
+           (unsigned long long)(after.reader_stalls - before.reader_stalls));
+    Aggregator_Destroy(aggregator);
+}
+
+int main(int argc, char** argv)
+{
+    uint32_t node_count = (argc > 1) ? (uint32_t)atoi(argv[1]) : 64;
+    double seconds = (argc > 2) ? atof(argv[2]) : 2.0;
+    if ((node_count == 0) || (node_count > BENCH_MAX_NODES))
+    {
+        fprintf(stderr, "Between 1 and %u nodes\n", BENCH_MAX_NODES);
+        return 2;
+    }
+    static const uint8_t workers[] = { 1, 2, 4 };
+    for (uint8_t i = 0; i < sizeof(workers); i++)
+    {
+        bench_run(node_count, workers[i], seconds);
+    }
+    return 0;
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,225 @@
+/**
+*   \brief Simulation of a bus shared by the FDC1004Q, an IMU and an EEPROM.
+*
+*   Usage: bench_arbiter [seconds]
+*
+*   The FDC1004Q converts its four channels at 400 S/s and is polled every
+*   2.5 ms through the blocking API. An IMU is read (14 bytes) every 1 ms,
+*   each read being due before the next one. Every 100 ms 1 KB of log is
+*   written to an EEPROM, with up to 8 transactions queued at once (the
+*   write cycle of the EEPROM is not modelled). All the traffic goes through
+*   the arbiter, in virtual time on the simulator, with three settings:
+*   - FIFO: same priority and no deadline for all, 128 byte page writes;
+*   - priorities: FDC1004Q high, IMU normal with deadlines, EEPROM bulk,
+*     still with whole pages;
+*   - priorities and 16 byte chunks for the EEPROM.
+*   For each setting the conversions overwritten before being read, the
+*   IMU deadline misses and the EEPROM throughput are reported. The clock
+*   of the arbiter wraps through 0 during the run.
+*/
+
+#include "FDC1004Q.h"
+#include "FDC1004Q_Sim.h"
+#include "I2C_Arbiter.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define BENCH_IMU_ADDR 0x68
+#define BENCH_IMU_BYTES 14
+#define BENCH_IMU_PERIOD_NS 1000000ULL
+
+#define BENCH_EEPROM_ADDR 0x54
+#define BENCH_EEPROM_PAGE 128
+#define BENCH_EEPROM_FLUSH 1024
+#define BENCH_EEPROM_PERIOD_NS 100000000ULL
+#define BENCH_EEPROM_WINDOW 8
+
+#define BENCH_FDC_PERIOD_NS 2500000ULL
+
+// Offset of the arbiter clock, so that it wraps after 2 s
+#define BENCH_CLOCK_OFFSET ((uint32_t)0 - 2000000UL)
+
+typedef struct {
+    const char* name;
+    uint8_t fdc_priority;
+    uint8_t imu_priority;
+    uint8_t eeprom_priority;
+    uint8_t imu_deadlines;
+    uint8_t eeprom_chunk;
+} Bench_Config;
+
+// IMU reads
+static I2C_Transaction bench_imu;
+static uint8_t bench_imu_data[BENCH_IMU_BYTES];
+static uint8_t bench_imu_busy;
+static uint32_t bench_imu_release;
+static uint32_t bench_imu_reads;
+static uint32_t bench_imu_misses;
+static uint32_t bench_imu_worst_us;
+
+// EEPROM writes
+static I2C_Transaction bench_eeprom[BENCH_EEPROM_WINDOW];
+static uint8_t bench_eeprom_data[BENCH_EEPROM_PAGE];
+static uint8_t bench_eeprom_busy[BENCH_EEPROM_WINDOW];
+static uint32_t bench_eeprom_left;
+static uint64_t bench_eeprom_written;
+
+static uint32_t bench_clock(void)
+{
+    return (uint32_t)(FDC_Sim_GetTime() / 1000) + BENCH_CLOCK_OFFSET;
+}
+
+static void bench_imu_done(I2C_Transaction* transaction)
+{
+    uint32_t latency = bench_clock() - bench_imu_release;
+    bench_imu_worst_us = (latency > bench_imu_worst_us) ? latency : bench_imu_worst_us;
+    if ((int32_t)(bench_clock() - transaction->deadline) > 0)
+    {
+        bench_imu_misses++;
+    }
+    bench_imu_reads++;
+    bench_imu_busy = 0;
+}
+
+static void bench_eeprom_done(I2C_Transaction* transaction)
+{
+    bench_eeprom_written += transaction->register_count;
+    bench_eeprom_busy[transaction - bench_eeprom] = 0;
+}
+
+static void bench_run(const Bench_Config* config, uint64_t duration_ns)
+{
+    FDC_Sim_Init();
+    FDC_Sim_AttachAuxDevice(BENCH_IMU_ADDR);
+    FDC_Sim_AttachAuxDevice(BENCH_EEPROM_ADDR);
+    FDC_Sim_SetCapacitance(0, 1000000);
+    FDC_SetBusPriority(FDC_BUS_DIRECT, 0);
+    FDC_Start();
+    FDC_SetSampleRate(FDC_400_Hz);
+    for (uint8_t ch = 0; ch < 4; ch++)
+    {
+        FDC_ConfigureMeasurementInput(ch, ch, FDC_DISABLED, 0);
+    }
+    FDC_EnableRepeatMeasurement(0xF0);
+    I2C_Arbiter_Init(bench_clock);
+    FDC_SetBusPriority(config->fdc_priority, 0);
+
+    bench_imu.device_address = BENCH_IMU_ADDR;
+    bench_imu.register_address = 0x3B;
+    bench_imu.register_count = BENCH_IMU_BYTES;
+    bench_imu.op = I2C_ARBITER_READ;
+    bench_imu.priority = config->imu_priority;
+    bench_imu.data = bench_imu_data;
+    bench_imu.has_deadline = config->imu_deadlines;
+    bench_imu.callback = bench_imu_done;
+    bench_imu.bus = 0;
+    bench_imu_busy = 0;
+    bench_imu_reads = 0;
+    bench_imu_misses = 0;
+    bench_imu_worst_us = 0;
+    for (uint8_t i = 0; i < BENCH_EEPROM_WINDOW; i++)
+    {
+        bench_eeprom[i].device_address = BENCH_EEPROM_ADDR;
+        bench_eeprom[i].op = I2C_ARBITER_WRITE;
+        bench_eeprom[i].priority = config->eeprom_priority;
+        bench_eeprom[i].data = bench_eeprom_data;
+        bench_eeprom[i].has_deadline = 0;
+        bench_eeprom[i].callback = bench_eeprom_done;
+        bench_eeprom[i].bus = 0;
+        bench_eeprom_busy[i] = 0;
+    }
+    bench_eeprom_left = 0;
+    bench_eeprom_written = 0;
+
+    FDC_Sim_ResetStats();
+    uint64_t start = FDC_Sim_GetTime();
+    uint64_t imu_next = start;
+    uint64_t eeprom_next = start;
+    uint64_t fdc_next = start;
+    uint64_t fdc_worst = 0;
+    uint32_t imu_skipped = 0;
+    uint32_t eeprom_address = 0;
+    while (FDC_Sim_GetTime() - start < duration_ns)
+    {
+        uint64_t now = FDC_Sim_GetTime();
+        if (now >= imu_next)
+        {
+            if (bench_imu_busy)
+            {
+                // The previous read is late: this sample is lost
+                imu_skipped++;
+            }
+            else
+            {
+                bench_imu_release = (uint32_t)(imu_next / 1000) + BENCH_CLOCK_OFFSET;
+                bench_imu.deadline = bench_imu_release + (uint32_t)(BENCH_IMU_PERIOD_NS / 1000);
+                bench_imu_busy = 1;
+                I2C_Arbiter_Submit(&bench_imu);
+            }
+            imu_next += BENCH_IMU_PERIOD_NS;
+        }
+        if (now >= eeprom_next)
+        {
+            bench_eeprom_left += BENCH_EEPROM_FLUSH;
+            eeprom_next += BENCH_EEPROM_PERIOD_NS;
+        }
+        for (uint8_t i = 0; (i < BENCH_EEPROM_WINDOW) && (bench_eeprom_left > 0); i++)
+        {
+            if (!bench_eeprom_busy[i])
+            {
+                uint8_t chunk = (bench_eeprom_left < config->eeprom_chunk) ? bench_eeprom_left : config->eeprom_chunk;
+                bench_eeprom[i].register_address = (uint8_t)eeprom_address;
+                bench_eeprom[i].register_count = chunk;
+                bench_eeprom_busy[i] = 1;
+                I2C_Arbiter_Submit(&bench_eeprom[i]);
+                eeprom_address += chunk;
+                bench_eeprom_left -= chunk;
+            }
+        }
+        if (now >= fdc_next)
+        {
+            FDC_Frame frame;
+            FDC_ReadAllMeasurements(FDC_DONE_CH_ALL, &frame);
+            uint64_t latency = FDC_Sim_GetTime() - fdc_next;
+            fdc_worst = (latency > fdc_worst) ? latency : fdc_worst;
+            fdc_next += BENCH_FDC_PERIOD_NS;
+            continue;
+        }
+        if (!I2C_Arbiter_Process())
+        {
+            uint64_t next = (imu_next < fdc_next) ? imu_next : fdc_next;
+            next = (eeprom_next < next) ? eeprom_next : next;
+            FDC_Sim_AdvanceTime(next - now);
+        }
+    }
+    double seconds = (FDC_Sim_GetTime() - start) * 1e-9;
+    FDC_Sim_Stats stats;
+    FDC_Sim_GetStats(&stats);
+    printf("%-26s FDC: %5u/%5u conversions overwritten, poll to read max %5.2f ms | "
+           "IMU: %5u/%5u deadlines missed, max %5.2f ms | EEPROM %5.0f B/s | bus %3.0f%%\n",
+           config->name, stats.overruns, stats.conversions, fdc_worst * 1e-6,
+           bench_imu_misses + imu_skipped, bench_imu_reads + imu_skipped, bench_imu_worst_us * 1e-3,
+           bench_eeprom_written / seconds, 100.0 * stats.bus_time_ns / (seconds * 1e9));
+    FDC_SetBusPriority(FDC_BUS_DIRECT, 0);
+}
+
+int main(int argc, char** argv)
+{
+    double seconds = (argc > 1) ? atof(argv[1]) : 10.0;
+    static const Bench_Config configs[] = {
+        { "FIFO, whole pages", I2C_ARBITER_PRIORITY_NORMAL, I2C_ARBITER_PRIORITY_NORMAL,
+          I2C_ARBITER_PRIORITY_NORMAL, 0, BENCH_EEPROM_PAGE },
+        { "priorities, whole pages", I2C_ARBITER_PRIORITY_HIGH, I2C_ARBITER_PRIORITY_NORMAL,
+          I2C_ARBITER_PRIORITY_BULK, 1, BENCH_EEPROM_PAGE },
+        { "priorities, 16 B chunks", I2C_ARBITER_PRIORITY_HIGH, I2C_ARBITER_PRIORITY_NORMAL,
+          I2C_ARBITER_PRIORITY_BULK, 1, 16 },
+    };
+    for (uint8_t i = 0; i < sizeof(configs) / sizeof(configs[0]); i++)
+    {
+        bench_run(&configs[i], (uint64_t)(seconds * 1e9));
+    }
+    return 0;
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,194 @@
+/**
+*   \brief Benchmark of the asynchronous API with many contexts in flight.
+*
+*   Usage: bench_async [contexts]
+*
+*   Eight simulated sensors sit behind a bus multiplexer, and up to 256
+*   contexts (the default) are spread over them. A superloop calls every
+*   context once, then lets the arbiter run one transaction, for one second
+*   of virtual time. Two operations are run: a single register read, and
+*   #FDC_Async_ReadAllMeasurements, which takes a transaction for FDC_CONF
+*   and two for each new measurement. For 1, 16 and the given number of
+*   contexts the operations completed per second, the host time of a call
+*   to a context (most calls only find the transaction still queued and
+*   yield again) and of an arbiter step (the simulated transfer included)
+*   are reported, in ns and in time stamp counter cycles, less the cost of
+*   reading the clocks.
+*/
+
+#include "Bench.h"
+#include "FDC1004Q_Async.h"
+#include "FDC1004Q_Sim.h"
+#include "I2C_Mux.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define BENCH_SENSORS 8
+#define BENCH_MAX_CONTEXTS 256
+#define BENCH_DURATION_NS 1000000000ULL
+
+typedef uint8_t (*Bench_Operation)(FDC_AsyncContext* ctx, uint16_t index);
+
+static FDC_AsyncDevice bench_devices[BENCH_SENSORS];
+static FDC_AsyncContext bench_contexts[BENCH_MAX_CONTEXTS];
+static uint8_t bench_data[BENCH_MAX_CONTEXTS][2];
+static FDC_Frame bench_frames[BENCH_MAX_CONTEXTS];
+static uint32_t bench_errors;
+// Cost of timing an empty interval
+static double bench_timer_ns;
+static double bench_timer_cycles;
+
+static uint32_t bench_clock(void)
+{
+    return (uint32_t)(FDC_Sim_GetTime() / 1000);
+}
+
+static uint8_t bench_read_register(FDC_AsyncContext* ctx, uint16_t index)
+{
+    uint8_t error = FDC_Async_ReadRegister(ctx, FDC1004Q_MANUFACTURER_ID, bench_data[index]);
+    if ((error == FDC_OK) && 
+        ((bench_data[index][0] << 8 | bench_data[index][1]) != FDC1004Q_MANUFACTURED_ID_VALUE))
+    {
+        bench_errors++;
+    }
+    return error;
+}
+
+static uint8_t bench_read_frame(FDC_AsyncContext* ctx, uint16_t index)
+{
+    return FDC_Async_ReadAllMeasurements(ctx, FDC_DONE_CH_ALL, &bench_frames[index]);
+}
+
+static void bench_calibrate(void)
+{
+    uint64_t ns = 0;
+    uint64_t cycles = 0;
+    for (uint16_t i = 0; i < 10000; i++)
+    {
+        uint64_t begin = bench_now_ns();
+        uint64_t start = BENCH_CYCLES();
+        cycles += BENCH_CYCLES() - start;
+        ns += bench_now_ns() - begin;
+    }
+    bench_timer_ns = ns / 10000.0;
+    bench_timer_cycles = cycles / 10000.0;
+}
+
+static void bench_setup(void)
+{
+    FDC_Sim_Init();
+    FDC_Sim_AttachMux(BENCH_SENSORS);
+    for (uint8_t d = 0; d < BENCH_SENSORS; d++)
+    {
+        FDC_Sim_SelectDevice(d);
+        FDC_Sim_SetCapacitance(FDC_IN_1, 1000000);
+        I2C_Mux_Select(d);
+        FDC_Reset();
+        for (uint8_t ch = 0; ch < 4; ch++)
+        {
+            FDC_ConfigureMeasurementInput(ch, ch, FDC_DISABLED, 0);
+        }
+        FDC_SetSampleRate(FDC_400_Hz);
+        FDC_EnableRepeatMeasurement(0xF0);
+        FDC_Async_InitDevice(&bench_devices[d], FDC1004Q_I2C_ADDR, d);
+    }
+    I2C_Arbiter_Init(bench_clock);
+    I2C_Arbiter_SetBusSelect(I2C_Mux_Select);
+}
+
+static void bench_run(const char* name, Bench_Operation operation, uint16_t count)
+{
+    bench_setup();
+    for (uint16_t c = 0; c < count; c++)
+    {
+        FDC_Async_Init(&bench_contexts[c], &bench_devices[c % BENCH_SENSORS], I2C_ARBITER_PRIORITY_NORMAL);
+    }
+    bench_errors = 0;
+
+    FDC_Sim_ResetStats();
+    uint64_t start = FDC_Sim_GetTime();
+    uint64_t sweeps = 0;
+    uint64_t calls = 0;
+    uint64_t operations = 0;
+    uint64_t steps = 0;
+    uint64_t call_ns = 0;
+    uint64_t call_cycles = 0;
+    uint64_t step_ns = 0;
+    uint64_t step_cycles = 0;
+    while (FDC_Sim_GetTime() - start < BENCH_DURATION_NS)
+    {
+        uint64_t begin = bench_now_ns();
+        uint64_t cycles = BENCH_CYCLES();
+        for (uint16_t c = 0; c < count; c++)
+        {
+            uint8_t error = operation(&bench_contexts[c], c);
+            if (error != FDC_ASYNC_PENDING)
+            {
+                operations++;
+                bench_errors += (error != FDC_OK);
+            }
+        }
+        call_cycles += BENCH_CYCLES() - cycles;
+        call_ns += bench_now_ns() - begin;
+        calls += count;
+        sweeps++;
+
+        begin = bench_now_ns();
+        cycles = BENCH_CYCLES();
+        uint8_t processed = I2C_Arbiter_Process();
+        step_cycles += BENCH_CYCLES() - cycles;
+        step_ns += bench_now_ns() - begin;
+        steps += processed;
+        if (!processed)
+        {
+            FDC_Sim_AdvanceTime(10000);
+        }
+    }
+    FDC_Sim_Stats stats;
+    FDC_Sim_GetStats(&stats);
+    double seconds = (FDC_Sim_GetTime() - start) * 1e-9;
+    double call = (call_ns - sweeps * bench_timer_ns) / calls;
+    double call_cycle = (call_cycles - sweeps * bench_timer_cycles) / calls;
+    // Every sweep is followed by an arbiter step, with or without a transaction
+    double step = (step_ns - sweeps * bench_timer_ns) / (steps ? steps : 1);
+    double step_cycle = (step_cycles - sweeps * bench_timer_cycles) / (steps ? steps : 1);
+    printf("%-14s %3u contexts: %6.0f ops/s, bus %3.0f%%, %3.1f calls/op, "
+           "call %5.1f ns %5.0f cycles, arbiter step %6.1f ns %6.0f cycles, %u errors\n",
+           name, count, operations / seconds, 100.0 * stats.bus_time_ns / (seconds * 1e9),
+           (double)calls / (operations ? operations : 1), call, call_cycle, step, step_cycle, 
+           bench_errors);
+}
+
+int main(int argc, char** argv)
+{
+    uint16_t count = (argc > 1) ? atoi(argv[1]) : BENCH_MAX_CONTEXTS;
+    if ((count == 0) || (count > BENCH_MAX_CONTEXTS))
+    {
+        fprintf(stderr, "contexts must be 1 to %u\n", BENCH_MAX_CONTEXTS);
+        return 1;
+    }
+    bench_calibrate();
+    printf("context %u B, device %u B on the host\n", 
+           (unsigned)sizeof(FDC_AsyncContext), (unsigned)sizeof(FDC_AsyncDevice));
+    const uint16_t counts[] = { 1, 16, count };
+    for (uint8_t i = 0; i < 3; i++)
+    {
+        if ((i > 0) && (counts[i] <= counts[i - 1]))
+        {
+            break;
+        }
+        bench_run("register read", bench_read_register, counts[i]);
+    }
+    for (uint8_t i = 0; i < 3; i++)
+    {
+        if ((i > 0) && (counts[i] <= counts[i - 1]))
+        {
+            break;
+        }
+        bench_run("frame read", bench_read_frame, counts[i]);
+    }
+    return 0;
+}
+
+/* [] END OF FILE */
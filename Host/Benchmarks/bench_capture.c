@@ -0,0 +1,165 @@
+/**
+*   \brief Benchmark of the capture ingest and of the queries on the mapped file.
+*
+*   Usage: bench_capture [samples]
+*
+*   A capture of four channels at 100 S/s (2 million samples by default,
+*   timestamps in ms) is recorded to a temporary file with
+*   #FDC_Capture_AddSample, then mapped with #CaptureFile_Open and queried:
+*   - one second windows of one channel at random times, through the index
+*     of the block headers, against a scan of the file with fread from the
+*     start to the end of the window;
+*   - the whole file on one channel and on all the channels, with and
+*     without the CRC check.
+*   The ingest rate, the time per query and the samples read per second
+*   are reported. The file is read from the page cache.
+*/
+
+#include "Bench.h"
+#include "CaptureFile.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#define BENCH_PERIOD_MS 10
+#define BENCH_WINDOW_MS 1000
+#define BENCH_QUERIES 100000
+#define BENCH_SCANS 100
+
+static FILE* bench_file;
+static volatile int64_t bench_sink;
+
+static void bench_write(const uint8_t* data, uint16_t length)
+{
+    fwrite(data, 1, length, bench_file);
+}
+
+static void bench_sum(uint8_t channel, const uint32_t* timestamp, const int32_t* raw,
+                      const uint8_t* capdac, uint8_t count, void* context)
+{
+    (void)channel;
+    (void)timestamp;
+    (void)capdac;
+    int64_t* sum = context;
+    for (uint8_t i = 0; i < count; i++)
+    {
+        *sum += raw[i];
+    }
+}
+
+// Sum a window of CH1 reading the file from the start
+static int64_t bench_scan(const char* path, uint32_t from, uint32_t to)
+{
+    static FDC_CaptureBlock block;
+    int64_t sum = 0;
+    FILE* file = fopen(path, "rb");
+    while ((file != NULL) && (fread(&block, sizeof(block), 1, file) == 1) &&
+           (block.header.first_timestamp <= to))
+    {
+        for (uint8_t i = 0; i < block.header.sample_count; i++)
+        {
+            if ((block.timestamp[i] >= from) && (block.timestamp[i] <= to))
+            {
+                sum += block.raw[FDC_CH_1][i];
+            }
+        }
+    }
+    if (file != NULL)
+    {
+        fclose(file);
+    }
+    return sum;
+}
+
+int main(int argc, char** argv)
+{
+    uint32_t samples = (argc > 1) ? strtoul(argv[1], NULL, 0) : 2000000;
+    if (samples < 2 * BENCH_WINDOW_MS / BENCH_PERIOD_MS)
+    {
+        fprintf(stderr, "samples must be at least %u\n", 2 * BENCH_WINDOW_MS / BENCH_PERIOD_MS);
+        return 2;
+    }
+    char path[] = "/tmp/bench_captureXXXXXX";
+    int fd = mkstemp(path);
+    if ((fd < 0) || ((bench_file = fdopen(fd, "wb")) == NULL))
+    {
+        perror(path);
+        return 1;
+    }
+
+    // Ingest
+    uint32_t capacitance[4];
+    uint8_t capdac[4] = { 1, 2, 3, 4 };
+    FDC_Capture_Start(0, FDC_RP_CH_1 | FDC_RP_CH_2 | FDC_RP_CH_3 | FDC_RP_CH_4, bench_write);
+    uint64_t begin = bench_now_ns();
+    for (uint32_t i = 0; i < samples; i++)
+    {
+        for (uint8_t ch = 0; ch < 4; ch++)
+        {
+            capacitance[ch] = (uint32_t)((i * 13 + ch * 100000) & 0xFFFFFF) << 8;
+        }
+        FDC_Capture_AddSample(i * BENCH_PERIOD_MS, capacitance, capdac);
+    }
+    FDC_Capture_Flush();
+    fclose(bench_file);
+    double seconds = (bench_now_ns() - begin) * 1e-9;
+    printf("ingest: %.1f M samples/s, %.0f MB/s written, CRC included\n",
+           samples / seconds * 1e-6,
+           (samples + FDC_CAPTURE_BLOCK_SAMPLES - 1) / FDC_CAPTURE_BLOCK_SAMPLES *
+           sizeof(FDC_CaptureBlock) / seconds * 1e-6);
+
+    CaptureFile file;
+    if (CaptureFile_Open(&file, path) < 0)
+    {
+        perror(path);
+        return 1;
+    }
+    uint32_t end = (samples - 1) * BENCH_PERIOD_MS - BENCH_WINDOW_MS;
+
+    // Random windows, through the index and with a scan from the start
+    int64_t sum = 0;
+    CaptureFile_QueryStats stats;
+    uint64_t read = 0;
+    srand(1);
+    begin = bench_now_ns();
+    for (uint32_t q = 0; q < BENCH_QUERIES; q++)
+    {
+        uint32_t from = (uint32_t)(((uint64_t)rand() * end) / RAND_MAX);
+        CaptureFile_Query(&file, from, from + BENCH_WINDOW_MS, FDC_RP_CH_1, 1, bench_sum, &sum, &stats);
+        read += stats.samples;
+    }
+    seconds = (bench_now_ns() - begin) * 1e-9;
+    printf("1 s window, index:  %8.2f us per query, %5.1f samples per query\n",
+           seconds * 1e6 / BENCH_QUERIES, (double)read / BENCH_QUERIES);
+    srand(1);
+    begin = bench_now_ns();
+    for (uint32_t q = 0; q < BENCH_SCANS; q++)
+    {
+        uint32_t from = (uint32_t)(((uint64_t)rand() * end) / RAND_MAX);
+        sum += bench_scan(path, from, from + BENCH_WINDOW_MS);
+    }
+    seconds = (bench_now_ns() - begin) * 1e-9;
+    printf("1 s window, fread:  %8.2f us per query\n", seconds * 1e6 / BENCH_SCANS);
+
+    // Whole file
+    for (uint8_t mask = FDC_RP_CH_1; mask != 0; mask = (mask == FDC_RP_CH_1) ? 0xF0 : 0)
+    {
+        for (uint8_t verify = 0; verify <= 1; verify++)
+        {
+            begin = bench_now_ns();
+            CaptureFile_Query(&file, 0, UINT32_MAX, mask, verify, bench_sum, &sum, &stats);
+            seconds = (bench_now_ns() - begin) * 1e-9;
+            printf("whole file, %s, %-8s %6.1f M samples/s, %6.0f MB/s of blocks\n",
+                   (mask == FDC_RP_CH_1) ? "CH1" : "all", verify ? "CRC:" : "no CRC:",
+                   stats.samples / seconds * 1e-6,
+                   stats.blocks * sizeof(FDC_CaptureBlock) / seconds * 1e-6);
+        }
+    }
+    bench_sink = sum;
+    CaptureFile_Close(&file);
+    unlink(path);
+    return 0;
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,118 @@
+/**
+*   \brief Benchmark of the cost per frame of the common-mode rejection.
+*
+*   Usage: bench_common_mode [frames]
+*
+*   Frames with a drift coupled into the first three channels (coupling
+*   0.8, 1.2 and -0.3) and a reference on the fourth are used to calibrate
+*   the couplings, then corrected. The cost per frame of the calibration
+*   and of the correction is reported (see Bench.h), with the coupling
+*   found and the mean error left on the first channel.
+*/
+
+#include "Bench.h"
+#include "CommonMode.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define BENCH_CALIBRATION_FRAMES 2000
+
+static volatile int32_t bench_sink;
+
+static const double bench_coupling[3] = { 0.8, 1.2, -0.3 };
+
+// Frame with the given drift and noise of up to noise LSB
+static void bench_frame(double drift, int32_t noise, int32_t* capacitance)
+{
+    for (uint8_t ch = 0; ch < 3; ch++)
+    {
+        capacitance[ch] = 1000000 * (ch + 1) + (int32_t)(bench_coupling[ch] * drift) + rand() % noise;
+    }
+    capacitance[3] = 7000000 + (int32_t)drift + rand() % noise;
+}
+
+static void bench_report(const char* name, uint64_t ns, uint64_t cycles, uint32_t count)
+{
+    printf("%-12s %6.1f ns/frame %7.1f cycles/frame\n", name, (double)ns / count, (double)cycles / count);
+}
+
+int main(int argc, char** argv)
+{
+    uint32_t count = (argc > 1) ? (uint32_t)atoi(argv[1]) : 1000000;
+    if (count == 0)
+    {
+        fprintf(stderr, "At least one frame\n");
+        return 2;
+    }
+    int32_t (*frames)[COMMON_MODE_CHANNELS] = malloc(count * sizeof(*frames));
+    if (frames == NULL)
+    {
+        return 1;
+    }
+    srand(3);
+    for (uint32_t n = 0; n < count; n++)
+    {
+        bench_frame(50000 * sin(n / 300.0) + (n % 4000) * 20, 50, frames[n]);
+    }
+    static const int16_t weights[COMMON_MODE_CHANNELS] = { 0, 0, 0, 32767 };
+    CommonMode_SetReference(weights);
+
+    // Only the first frames fit in a calibration, the rest restart it
+    CommonMode_StartCalibration();
+    uint64_t start = bench_now_ns();
+    uint64_t cycles = BENCH_CYCLES();
+    for (uint32_t n = 0; n < count; n++)
+    {
+        if ((n % BENCH_CALIBRATION_FRAMES == 0) && (n > 0))
+        {
+            CommonMode_StartCalibration();
+        }
+        CommonMode_AddCalibrationFrame(frames[n]);
+    }
+    cycles = BENCH_CYCLES() - cycles;
+    bench_report("calibration", bench_now_ns() - start, cycles, count);
+    CommonMode_StartCalibration();
+    for (uint32_t n = 0; n < BENCH_CALIBRATION_FRAMES && n < count; n++)
+    {
+        CommonMode_AddCalibrationFrame(frames[n]);
+    }
+    start = bench_now_ns();
+    cycles = BENCH_CYCLES();
+    uint8_t status = CommonMode_FinishCalibration();
+    cycles = BENCH_CYCLES() - cycles;
+    printf("%-12s %6.1f ns once  %7.1f cycles once\n", "finish", (double)(bench_now_ns() - start), (double)cycles);
+
+    int32_t result[COMMON_MODE_CHANNELS];
+    int32_t sum = 0;
+    start = bench_now_ns();
+    cycles = BENCH_CYCLES();
+    for (uint32_t n = 0; n < count; n++)
+    {
+        CommonMode_Process(frames[n], result);
+        sum += result[0];
+    }
+    cycles = BENCH_CYCLES() - cycles;
+    bench_report("correction", bench_now_ns() - start, cycles, count);
+    bench_sink = sum;
+
+    int32_t coupling[COMMON_MODE_CHANNELS];
+    CommonMode_GetCoupling(coupling);
+    printf("calibration %s, coupling %.4f %.4f %.4f\n", (status == FDC_OK) ? "done" : "failed",
+           coupling[0] / 65536.0, coupling[1] / 65536.0, coupling[2] / 65536.0);
+    double raw = 0;
+    double corrected = 0;
+    for (uint32_t n = 0; n < count; n++)
+    {
+        CommonMode_Process(frames[n], result);
+        raw += fabs(frames[n][0] - 1000000.0);
+        corrected += fabs(result[0] - 1000000.0);
+    }
+    printf("mean error on the first channel: %.0f LSB, %.0f LSB corrected\n",
+           raw / count, corrected / count);
+    free(frames);
+    return 0;
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,115 @@
+/**
+*   \brief Benchmark of the raw measurement conversions.
+*
+*   Usage: bench_conversion [samples]
+*
+*   Random raw measurements and CAPDAC settings are converted in batches of
+*   1024 samples, the length of the frames and bursts the host tools work
+*   on, by:
+*   - the conversion of the driver before the batch functions, a sample at
+*     a time with a branch and a division in double precision;
+*   - #FDC_ConvertRawMeasurement a sample at a time, plus the CAPDAC offset;
+*   - #FDC_ConvertRawMeasurements to float;
+*   - #FDC_ConvertRawMeasurementsFixed to fixed point.
+*   The throughput is reported in samples/s, with the cost in ns and, on
+*   x86, in time stamp counter cycles per sample (see Bench.h).
+*/
+
+#include "Bench.h"
+#include "FDC1004Q.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define BENCH_BATCH 1024
+
+static uint32_t bench_raw[BENCH_BATCH];
+static uint8_t bench_capdac[BENCH_BATCH];
+static double bench_double[BENCH_BATCH];
+static float bench_float[BENCH_BATCH];
+static int32_t bench_fixed[BENCH_BATCH];
+static volatile double bench_sink;
+
+// Conversion of the driver before the batch functions
+static double bench_old_conversion(uint32_t capacitance)
+{
+    double temp_cap = (double)(capacitance >> 8);
+    if (temp_cap > ( (1 << 23) -1))
+    {
+        temp_cap -= ( 1 << 24);
+    }
+    temp_cap /= (2<<18);
+    return temp_cap;
+}
+
+static void bench_report(const char* name, uint64_t ns, uint64_t cycles, uint32_t count)
+{
+    printf("%-36s %7.1f M samples/s %6.2f ns/sample %6.2f cycles/sample\n",
+           name, count * 1e3 / ns, (double)ns / count, (double)cycles / count);
+}
+
+int main(int argc, char** argv)
+{
+    uint32_t batches = ((argc > 1) ? (uint32_t)atoi(argv[1]) : 100000000) / BENCH_BATCH;
+    if (batches == 0)
+    {
+        fprintf(stderr, "At least %u samples\n", BENCH_BATCH);
+        return 2;
+    }
+    uint32_t count = batches * BENCH_BATCH;
+    srand(1);
+    for (uint16_t i = 0; i < BENCH_BATCH; i++)
+    {
+        bench_raw[i] = (uint32_t)(rand() & 0xFFFFFF) << 8;
+        bench_capdac[i] = rand() % (FDC_CAPDAC_MAX + 1);
+    }
+
+    uint64_t start = bench_now_ns();
+    uint64_t cycles = BENCH_CYCLES();
+    for (uint32_t b = 0; b < batches; b++)
+    {
+        for (uint16_t i = 0; i < BENCH_BATCH; i++)
+        {
+            bench_double[i] = bench_old_conversion(bench_raw[i]) + bench_capdac[i] * FDC_CAPDAC_FACTOR;
+        }
+        bench_sink = bench_double[b % BENCH_BATCH];
+    }
+    cycles = BENCH_CYCLES() - cycles;
+    bench_report("previous conversion (double)", bench_now_ns() - start, cycles, count);
+
+    start = bench_now_ns();
+    cycles = BENCH_CYCLES();
+    for (uint32_t b = 0; b < batches; b++)
+    {
+        for (uint16_t i = 0; i < BENCH_BATCH; i++)
+        {
+            bench_double[i] = FDC_ConvertRawMeasurement(bench_raw[i]) + bench_capdac[i] * FDC_CAPDAC_FACTOR;
+        }
+        bench_sink = bench_double[b % BENCH_BATCH];
+    }
+    cycles = BENCH_CYCLES() - cycles;
+    bench_report("FDC_ConvertRawMeasurement (double)", bench_now_ns() - start, cycles, count);
+
+    start = bench_now_ns();
+    cycles = BENCH_CYCLES();
+    for (uint32_t b = 0; b < batches; b++)
+    {
+        FDC_ConvertRawMeasurements(bench_raw, bench_capdac, bench_float, BENCH_BATCH);
+        bench_sink = bench_float[b % BENCH_BATCH];
+    }
+    cycles = BENCH_CYCLES() - cycles;
+    bench_report("FDC_ConvertRawMeasurements (float)", bench_now_ns() - start, cycles, count);
+
+    start = bench_now_ns();
+    cycles = BENCH_CYCLES();
+    for (uint32_t b = 0; b < batches; b++)
+    {
+        FDC_ConvertRawMeasurementsFixed(bench_raw, bench_capdac, bench_fixed, BENCH_BATCH);
+        bench_sink = bench_fixed[b % BENCH_BATCH];
+    }
+    cycles = BENCH_CYCLES() - cycles;
+    bench_report("FDC_ConvertRawMeasurementsFixed", bench_now_ns() - start, cycles, count);
+    return 0;
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,106 @@
+/**
+*   \brief Bus cost of reading a frame, per channel and with FDC_ReadAllMeasurements.
+*
+*   Usage: bench_frame_read [frames]
+*
+*   The simulated device converts 1 to 4 channels at 400 S/s, and every
+*   frame is read once all its channels are done, in two ways:
+*   - per channel, as the driver did before #FDC_ReadAllMeasurements: a
+*     read of FDC_CONF for the DONE bits, then for each channel the MSB and
+*     LSB of the measurement and CONF_MEASx for the CAPDAC;
+*   - with #FDC_ReadAllMeasurements, which takes the CAPDAC from the copy
+*     of CONF_MEASx kept by the driver.
+*   The transactions, bytes and bus time per frame are taken from the
+*   statistics of the simulator, with the share of the bus the reads take.
+*/
+
+#include "FDC1004Q.h"
+#include "FDC1004Q_Sim.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+// Conversion period at 400 S/s (ns)
+#define BENCH_CONVERSION_NS 2500000ULL
+
+// Read a frame one channel at a time
+static uint8_t bench_read_per_channel(uint8_t mask, FDC_Frame* frame)
+{
+    uint8_t data[2];
+    uint8_t error = FDC_ReadRegister(FDC1004Q_FDC_CONF, data);
+    uint8_t done = data[1] & mask;
+    frame->valid = 0;
+    for (uint8_t ch = FDC_CH_1; (ch <= FDC_CH_4) && (error == FDC_OK); ch++)
+    {
+        if (done & (FDC_DONE_CH_1 >> ch))
+        {
+            uint8_t msb[2];
+            uint8_t lsb[2];
+            error = FDC_ReadRegister(FDC1004Q_MEAS1_MSB + (2*ch), msb);
+            error |= FDC_ReadRegister(FDC1004Q_MEAS1_LSB + (2*ch), lsb);
+            error |= FDC_ReadRegister(FDC1004Q_CONF_MEAS1 + ch, data);
+            frame->capacitance[ch] = ((uint32_t)msb[0] << 24) | ((uint32_t)msb[1] << 16) |
+                                     (lsb[0] << 8) | lsb[1];
+            frame->capdac[ch] = ((data[0] << 8 | data[1]) >> 5) & 0x1F;
+            frame->valid |= FDC_DONE_CH_1 >> ch;
+        }
+    }
+    return error;
+}
+
+static void bench_run(const char* name, uint8_t (*read)(uint8_t, FDC_Frame*),
+                      uint8_t channels, uint32_t frames)
+{
+    FDC_Sim_Init();
+    FDC_Start();
+    FDC_SetSampleRate(FDC_400_Hz);
+    uint8_t repeat = 0;
+    for (uint8_t ch = FDC_CH_1; ch < channels; ch++)
+    {
+        FDC_Sim_SetCapacitance(ch, 1000000 * (ch + 1));
+        FDC_ConfigureMeasurementInput(ch, ch, FDC_CAPDAC, 0);
+        repeat |= FDC_RP_CH_1 >> ch;
+    }
+    FDC_EnableRepeatMeasurement(repeat);
+    FDC_Sim_ResetStats();
+
+    uint32_t full = 0;
+    uint32_t errors = 0;
+    for (uint32_t f = 0; f < frames; f++)
+    {
+        // The channels are converted one after the other
+        FDC_Sim_AdvanceTime(channels * BENCH_CONVERSION_NS);
+        FDC_Frame frame;
+        if (read(FDC_DONE_CH_ALL, &frame) != FDC_OK)
+        {
+            errors++;
+        }
+        full += (frame.valid == (repeat >> 4));
+    }
+    FDC_Sim_Stats stats;
+    FDC_Sim_GetStats(&stats);
+    double frame_ns = channels * BENCH_CONVERSION_NS;
+    printf("%-23s %u ch: %5.2f transactions, %5.1f bytes, %6.1f us of bus per frame, "
+           "bus %4.1f%%, %u/%u full frames, %u errors\n",
+           name, channels, (double)stats.transactions / frames, (double)stats.bytes / frames,
+           stats.bus_time_ns * 1e-3 / frames, 100.0 * stats.bus_time_ns / (frames * frame_ns),
+           full, frames, errors);
+}
+
+int main(int argc, char** argv)
+{
+    uint32_t frames = (argc > 1) ? strtoul(argv[1], NULL, 0) : 10000;
+    if (frames == 0)
+    {
+        fprintf(stderr, "frames must be at least 1\n");
+        return 1;
+    }
+    for (uint8_t channels = 1; channels <= 4; channels++)
+    {
+        bench_run("per channel", bench_read_per_channel, channels, frames);
+        bench_run("FDC_ReadAllMeasurements", FDC_ReadAllMeasurements, channels, frames);
+    }
+    return 0;
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,125 @@
+/**
+*   \brief Benchmark of the system calls per frame of the Linux i2c-dev backend.
+*
+*   Usage: bench_linux [frames]
+*
+*   The firmware is built with I2C_INTERFACE_LINUX defined. Each ioctl is
+*   issued for real on /dev/null, which rejects it, so that the cost of
+*   entering the kernel is paid, then answered by the simulator. Frames of
+*   four channels are read with #FDC_ReadAllMeasurements:
+*   - directly, the measurement registers batched in a single I2C_RDWR call;
+*   - through the arbiter, each register in a call of its own, as without
+*     batching.
+*   The system calls and the I2C messages per frame, and the host time per
+*   frame and per system call, are reported.
+*/
+
+#include "Bench.h"
+#include "FDC1004Q.h"
+#include "FDC1004Q_Sim.h"
+#include "I2C_Arbiter.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/ioctl.h>
+#include <linux/i2c.h>
+#include <linux/i2c-dev.h>
+
+// Conversion period at 400 S/s (ns)
+#define BENCH_CONVERSION_NS 2500000ULL
+
+static uint64_t bench_calls;
+static uint64_t bench_messages;
+static uint64_t bench_syscall_ns;
+
+static uint32_t bench_clock(void)
+{
+    return (uint32_t)(FDC_Sim_GetTime() / 1000);
+}
+
+// Enter the kernel, then emulate the adapter on top of the simulator
+static int bench_ioctl(int fd, unsigned long request, void* arg)
+{
+    uint64_t begin = bench_now_ns();
+    ioctl(fd, request, arg);
+    bench_syscall_ns += bench_now_ns() - begin;
+    bench_calls++;
+    const struct i2c_rdwr_ioctl_data* transfer = arg;
+    bench_messages += transfer->nmsgs;
+    for (uint32_t i = 0; i < transfer->nmsgs; i++)
+    {
+        const struct i2c_msg* message = &transfer->msgs[i];
+        I2C_ErrorCode error = I2C_NO_ERROR;
+        if ((i + 1 < transfer->nmsgs) && (message->len == 1) && (transfer->msgs[i + 1].flags & I2C_M_RD))
+        {
+            error = FDC_Sim_Read(message->addr, message->buf[0], transfer->msgs[i + 1].len, 
+                                 transfer->msgs[i + 1].buf);
+            i++;
+        }
+        else if (message->len > 0)
+        {
+            error = FDC_Sim_Write(message->addr, message->buf[0], message->len - 1, &message->buf[1]);
+        }
+        if (error != I2C_NO_ERROR)
+        {
+            errno = ENXIO;
+            return -1;
+        }
+    }
+    return transfer->nmsgs;
+}
+
+static void bench_run(const char* name, uint8_t priority, uint32_t frames)
+{
+    FDC_Sim_Init();
+    FDC_Start();
+    for (uint8_t ch = FDC_CH_1; ch <= FDC_CH_4; ch++)
+    {
+        FDC_Sim_SetCapacitance(ch, 1000000 * (ch + 1));
+        FDC_ConfigureMeasurementInput(ch, ch, FDC_DISABLED, 0);
+    }
+    FDC_SetSampleRate(FDC_400_Hz);
+    FDC_EnableRepeatMeasurement(0xF0);
+    I2C_Arbiter_Init(bench_clock);
+    FDC_SetBusPriority(priority, 0);
+    FDC_Sim_AdvanceTime(4 * BENCH_CONVERSION_NS);
+
+    bench_calls = 0;
+    bench_messages = 0;
+    bench_syscall_ns = 0;
+    uint32_t full = 0;
+    uint64_t host_ns = 0;
+    for (uint32_t f = 0; f < frames; f++)
+    {
+        FDC_Sim_AdvanceTime(4 * BENCH_CONVERSION_NS);
+        FDC_Frame frame;
+        uint64_t begin = bench_now_ns();
+        uint8_t error = FDC_ReadAllMeasurements(FDC_DONE_CH_ALL, &frame);
+        host_ns += bench_now_ns() - begin;
+        full += (error == FDC_OK) && (frame.valid == FDC_DONE_CH_ALL);
+    }
+    printf("%-16s %5.2f system calls, %5.2f messages, %6.0f ns per frame, "
+           "%4.0f ns per system call, %u/%u full frames\n",
+           name, (double)bench_calls / frames, (double)bench_messages / frames,
+           (double)host_ns / frames, (double)bench_syscall_ns / bench_calls, full, frames);
+    FDC_SetBusPriority(FDC_BUS_DIRECT, 0);
+    FDC_Stop();
+}
+
+int main(int argc, char** argv)
+{
+    uint32_t frames = (argc > 1) ? strtoul(argv[1], NULL, 0) : 100000;
+    if (frames == 0)
+    {
+        fprintf(stderr, "frames must be at least 1\n");
+        return 1;
+    }
+    I2C_Linux_SetDevice("/dev/null");
+    I2C_Linux_SetIoctl(bench_ioctl);
+    bench_run("batched", FDC_BUS_DIRECT, frames);
+    bench_run("one per register", I2C_ARBITER_PRIORITY_HIGH, frames);
+    return 0;
+}
+
+/* [] END OF FILE */
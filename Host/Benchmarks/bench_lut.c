@@ -0,0 +1,90 @@
+/**
+*   \brief Benchmark of the cost of a lookup table conversion.
+*
+*   Usage: bench_lut [samples]
+*
+*   Tables of #LUT_MAX_POINTS breakpoints, evenly spaced by a power of two
+*   (single shift) and irregular (binary search), convert random samples
+*   across their range. A cubic polynomial in double precision, as used by
+*   the applications before, is timed on the same samples for comparison.
+*   The cost is reported in ns and, on x86, in time stamp counter cycles
+*   per sample (see Bench.h).
+*/
+
+#include "Bench.h"
+#include "Lut.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+static volatile int32_t bench_sink;
+
+static void bench_report(const char* name, uint64_t ns, uint64_t cycles, uint32_t count)
+{
+    printf("%-28s %6.1f ns/sample %7.1f cycles/sample\n", name, (double)ns / count, (double)cycles / count);
+}
+
+static void bench_table(const char* name, uint8_t channel, const int32_t* samples, uint32_t count)
+{
+    int32_t sum = 0;
+    uint64_t start = bench_now_ns();
+    uint64_t cycles = BENCH_CYCLES();
+    for (uint32_t i = 0; i < count; i++)
+    {
+        sum += Lut_Convert(channel, samples[i]);
+    }
+    cycles = BENCH_CYCLES() - cycles;
+    bench_report(name, bench_now_ns() - start, cycles, count);
+    bench_sink = sum;
+}
+
+int main(int argc, char** argv)
+{
+    uint32_t count = (argc > 1) ? (uint32_t)atoi(argv[1]) : 10000000;
+    if (count == 0)
+    {
+        fprintf(stderr, "At least one sample\n");
+        return 2;
+    }
+    int32_t uniform[LUT_MAX_POINTS];
+    int32_t irregular[LUT_MAX_POINTS];
+    int32_t output[LUT_MAX_POINTS];
+    for (uint8_t i = 0; i < LUT_MAX_POINTS; i++)
+    {
+        uniform[i] = i << 18;
+        irregular[i] = i * 250000 + (i * i) * 1000;
+        output[i] = 40000 - (int32_t)(LUT_MAX_POINTS - i) * (LUT_MAX_POINTS - i) * 100;
+    }
+    Lut_Load(FDC_CH_1, uniform, output, LUT_MAX_POINTS);
+    Lut_Load(FDC_CH_2, irregular, output, LUT_MAX_POINTS);
+
+    int32_t* samples = malloc(count * sizeof(int32_t));
+    if (samples == NULL)
+    {
+        return 1;
+    }
+    srand(1);
+    for (uint32_t i = 0; i < count; i++)
+    {
+        samples[i] = rand() % (uniform[LUT_MAX_POINTS - 1] + 100000) - 50000;
+    }
+
+    bench_table("evenly spaced (shift)", FDC_CH_1, samples, count);
+    bench_table("irregular (binary search)", FDC_CH_2, samples, count);
+
+    double sum = 0;
+    uint64_t start = bench_now_ns();
+    uint64_t cycles = BENCH_CYCLES();
+    for (uint32_t i = 0; i < count; i++)
+    {
+        double pf = samples[i] / 524288.0;
+        sum += ((0.02 * pf - 1.5) * pf + 400.0) * pf + 7.0;
+    }
+    cycles = BENCH_CYCLES() - cycles;
+    bench_report("double cubic polynomial", bench_now_ns() - start, cycles, count);
+    bench_sink = (int32_t)sum;
+    free(samples);
+    return 0;
+}
+
+/* [] END OF FILE */
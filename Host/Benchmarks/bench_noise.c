@@ -0,0 +1,109 @@
+/**
+*   \brief Benchmark of the streaming noise characterisation.
+*
+*   Usage: bench_noise [samples]
+*
+*   Random samples are added to a #Noise_State one at a time with
+*   #Noise_AddSample, and in capture blocks of four channels with
+*   #Noise_AddCaptureBlock, as when a capture file is analysed on the host.
+*   The throughput is reported in samples/s, with the cost in ns and, on
+*   x86, in time stamp counter cycles per sample (see Bench.h), and the
+*   cost of reading the summary and all the Allan deviations.
+*/
+
+#include "Bench.h"
+#include "Noise.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define BENCH_SAMPLES 4096
+
+static volatile uint32_t bench_sink;
+
+static void bench_report(const char* name, uint64_t ns, uint64_t cycles, uint64_t count)
+{
+    printf("%-24s %7.1f M samples/s %6.2f ns/sample %6.2f cycles/sample\n",
+           name, count * 1e3 / ns, (double)ns / count, (double)cycles / count);
+}
+
+int main(int argc, char** argv)
+{
+    uint32_t rounds = ((argc > 1) ? (uint32_t)atoi(argv[1]) : 50000000) / BENCH_SAMPLES;
+    if (rounds == 0)
+    {
+        fprintf(stderr, "At least %u samples\n", BENCH_SAMPLES);
+        return 2;
+    }
+    static int32_t samples[BENCH_SAMPLES];
+    static FDC_CaptureBlock blocks[BENCH_SAMPLES / FDC_CAPTURE_BLOCK_SAMPLES];
+    srand(1);
+    for (uint32_t i = 0; i < BENCH_SAMPLES; i++)
+    {
+        samples[i] = 524288 + rand() % 2001 - 1000;
+    }
+    for (uint32_t b = 0; b < BENCH_SAMPLES / FDC_CAPTURE_BLOCK_SAMPLES; b++)
+    {
+        blocks[b].header.channel_mask = FDC_RP_CH_1 | FDC_RP_CH_2 | FDC_RP_CH_3 | FDC_RP_CH_4;
+        blocks[b].header.sample_count = FDC_CAPTURE_BLOCK_SAMPLES;
+        for (uint8_t ch = 0; ch < FDC_CAPTURE_CHANNELS; ch++)
+        {
+            for (uint8_t i = 0; i < FDC_CAPTURE_BLOCK_SAMPLES; i++)
+            {
+                blocks[b].raw[ch][i] = samples[(b * FDC_CAPTURE_BLOCK_SAMPLES + i + ch * 1000) % BENCH_SAMPLES];
+            }
+        }
+    }
+
+    static Noise_State state;
+    Noise_Init(&state);
+    uint64_t start = bench_now_ns();
+    uint64_t cycles = BENCH_CYCLES();
+    for (uint32_t r = 0; r < rounds; r++)
+    {
+        for (uint32_t i = 0; i < BENCH_SAMPLES; i++)
+        {
+            Noise_AddSample(&state, samples[i], 0);
+        }
+    }
+    cycles = BENCH_CYCLES() - cycles;
+    bench_report("Noise_AddSample", bench_now_ns() - start, cycles, (uint64_t)rounds * BENCH_SAMPLES);
+
+    static Noise_State states[FDC_CAPTURE_CHANNELS];
+    for (uint8_t ch = 0; ch < FDC_CAPTURE_CHANNELS; ch++)
+    {
+        Noise_Init(&states[ch]);
+    }
+    // A quarter of the rounds, four channels per block
+    start = bench_now_ns();
+    cycles = BENCH_CYCLES();
+    for (uint32_t r = 0; r < (rounds + 3) / 4; r++)
+    {
+        for (uint32_t b = 0; b < BENCH_SAMPLES / FDC_CAPTURE_BLOCK_SAMPLES; b++)
+        {
+            Noise_AddCaptureBlock(states, &blocks[b]);
+        }
+    }
+    cycles = BENCH_CYCLES() - cycles;
+    bench_report("Noise_AddCaptureBlock", bench_now_ns() - start, cycles, (uint64_t)(rounds + 3) / 4 * BENCH_SAMPLES * 4);
+
+    Noise_Summary summary;
+    uint32_t deviation = 0;
+    start = bench_now_ns();
+    cycles = BENCH_CYCLES();
+    for (uint32_t r = 0; r < 10000; r++)
+    {
+        Noise_GetSummary(&state, &summary);
+        for (uint8_t k = 0; k < NOISE_OCTAVES; k++)
+        {
+            Noise_GetAllanDeviation(&state, k, &deviation);
+        }
+    }
+    cycles = BENCH_CYCLES() - cycles;
+    printf("summary and %u deviations: %6.0f ns %8.0f cycles\n", NOISE_OCTAVES,
+           (bench_now_ns() - start) / 10000.0, cycles / 10000.0);
+    bench_sink = summary.rms + deviation + states[FDC_CH_4].count;
+    return 0;
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,285 @@
+/**
+*   \brief Replay of day-long traces through the adaptive sample rate.
+*
+*   Usage: bench_rate_control [capture file]
+*
+*   The traces are replayed through #RateControl_Update at the rate of the
+*   tier selected at each frame, as main.c configures it (100, 200 and
+*   400 S/s over four channels), and the bus time spent reading the frames
+*   is compared with the one of sampling at 400 S/s all day. The bus time
+*   of a frame read in each tier is measured once on the simulator.
+*
+*   Without arguments two synthetic days are replayed: an office day,
+*   with 40 touches per hour from 8:00 to 20:00 and 2 per hour at night,
+*   and a quiet day with 2 touches per hour. Both carry a daily drift of
+*   20000 LSB and 150 LSB rms of noise. The time from the start of a touch
+*   to the fastest tier is reported. A capture file (see
+*   FDC1004Q_Capture.h) is replayed instead when given, holding each
+*   sample until the next one.
+*/
+
+#include "FDC1004Q_Capture.h"
+#include "FDC1004Q_Sim.h"
+#include "RateControl.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define BENCH_DAY_US 86400000000ULL
+#define BENCH_MAX_TOUCHES 2048
+#define BENCH_TOUCH_AMPLITUDE 30000
+#define BENCH_NOISE 150
+#define BENCH_DRIFT 20000
+// Frame period at 400 S/s over four channels (us)
+#define BENCH_FIXED_PERIOD 10000
+
+// Touch of a synthetic trace
+typedef struct {
+    uint64_t start;
+    uint64_t length;
+    uint8_t channel;
+} Bench_Touch;
+
+// Trace: synthetic touches, or the samples of a capture file
+typedef struct {
+    Bench_Touch touches[BENCH_MAX_TOUCHES];
+    uint32_t touch_count;
+    uint64_t* time;
+    int32_t (*value)[4];
+    uint8_t (*capdac)[4];
+    uint32_t sample_count;
+    uint64_t duration;
+} Bench_Trace;
+
+static RateControl_Config bench_config = {
+    {
+        {FDC_100_Hz, FDC_RP_CH_1 | FDC_RP_CH_2 | FDC_RP_CH_3 | FDC_RP_CH_4, 0, 0},
+        {FDC_200_Hz, FDC_RP_CH_1 | FDC_RP_CH_2 | FDC_RP_CH_3 | FDC_RP_CH_4, 2000, 1000},
+        {FDC_400_Hz, FDC_RP_CH_1 | FDC_RP_CH_2 | FDC_RP_CH_3 | FDC_RP_CH_4, 8000, 4000}
+    },
+    3, 2000, 6
+};
+
+static double bench_gauss(void)
+{
+    double u = (rand() + 1.0) / (RAND_MAX + 2.0);
+    double v = (rand() + 1.0) / (RAND_MAX + 2.0);
+    return sqrt(-2 * log(u)) * cos(6.283185307179586 * v);
+}
+
+// Bus time of a frame read in a tier (ns), on the simulator
+static uint64_t bench_frame_bus_time(const RateControl_Tier* tier)
+{
+    FDC_Sim_Init();
+    FDC_Start();
+    FDC_SetSampleRate(tier->rate);
+    for (uint8_t ch = 0; ch < 4; ch++)
+    {
+        FDC_ConfigureMeasurementInput(ch, ch, FDC_DISABLED, 0);
+    }
+    FDC_EnableRepeatMeasurement(tier->channels);
+    FDC_Sim_AdvanceTime(50000000);
+    FDC_Sim_ResetStats();
+    FDC_Frame frame;
+    FDC_ReadAllMeasurements(tier->channels >> 4, &frame);
+    FDC_Sim_Stats stats;
+    FDC_Sim_GetStats(&stats);
+    return stats.bus_time_ns;
+}
+
+// Touches at the given rates per hour by day (8:00 to 20:00) and by night
+static void bench_synthetic(Bench_Trace* trace, double day_rate, double night_rate, unsigned seed)
+{
+    srand(seed);
+    trace->touch_count = 0;
+    trace->sample_count = 0;
+    trace->duration = BENCH_DAY_US;
+    double time = 0;
+    while (trace->touch_count < BENCH_MAX_TOUCHES)
+    {
+        double hour = time / 3600e6;
+        double rate = ((hour >= 8) && (hour < 20)) ? day_rate : night_rate;
+        time += -log((rand() + 1.0) / (RAND_MAX + 2.0)) * 3600e6 / rate;
+        if (time >= BENCH_DAY_US)
+        {
+            break;
+        }
+        Bench_Touch* touch = &trace->touches[trace->touch_count++];
+        touch->start = (uint64_t)time;
+        // From 0.2 to 5 s
+        touch->length = 200000 + (uint64_t)rand() % 4800000;
+        touch->channel = (uint8_t)(rand() % 4);
+        time += touch->length;
+    }
+}
+
+static uint8_t bench_load(Bench_Trace* trace, const char* path)
+{
+    FILE* file = fopen(path, "rb");
+    if (file == NULL)
+    {
+        perror(path);
+        return 0;
+    }
+    fseek(file, 0, SEEK_END);
+    uint32_t blocks = (uint32_t)(ftell(file) / sizeof(FDC_CaptureBlock));
+    fseek(file, 0, SEEK_SET);
+    uint32_t capacity = blocks * FDC_CAPTURE_BLOCK_SAMPLES;
+    trace->time = malloc(capacity * sizeof(trace->time[0]));
+    trace->value = malloc(capacity * sizeof(trace->value[0]));
+    trace->capdac = malloc(capacity * sizeof(trace->capdac[0]));
+    trace->sample_count = 0;
+    trace->touch_count = 0;
+    FDC_CaptureBlock block;
+    uint32_t first = 0;
+    while ((trace->time != NULL) && (trace->value != NULL) && (trace->capdac != NULL) &&
+           (fread(&block, sizeof(block), 1, file) == 1))
+    {
+        if ((block.header.magic != FDC_CAPTURE_MAGIC) || (block.header.sample_count > FDC_CAPTURE_BLOCK_SAMPLES))
+        {
+            continue;
+        }
+        for (uint8_t i = 0; i < block.header.sample_count; i++)
+        {
+            uint32_t n = trace->sample_count++;
+            uint32_t raw[4];
+            for (uint8_t ch = 0; ch < 4; ch++)
+            {
+                raw[ch] = (uint32_t)block.raw[ch][i] << 8;
+                trace->capdac[n][ch] = block.capdac[ch][i];
+            }
+            FDC_ConvertRawMeasurementsFixed(raw, trace->capdac[n], trace->value[n], 4);
+            // Timestamps in ms, relative to the first sample
+            first = (n == 0) ? block.timestamp[i] : first;
+            trace->time[n] = (uint64_t)(block.timestamp[i] - first) * 1000;
+        }
+    }
+    fclose(file);
+    trace->duration = (trace->sample_count > 0) ? trace->time[trace->sample_count - 1] : 0;
+    return trace->sample_count > 0;
+}
+
+// Values of the trace at a time. The touch index only moves forward.
+static void bench_sample(const Bench_Trace* trace, uint64_t time, uint32_t* index,
+                         int32_t* value, uint8_t* capdac)
+{
+    if (trace->sample_count > 0)
+    {
+        while ((*index + 1 < trace->sample_count) && (trace->time[*index + 1] <= time))
+        {
+            (*index)++;
+        }
+        for (uint8_t ch = 0; ch < 4; ch++)
+        {
+            value[ch] = trace->value[*index][ch];
+            capdac[ch] = trace->capdac[*index][ch];
+        }
+        return;
+    }
+    while ((*index < trace->touch_count) &&
+           (trace->touches[*index].start + trace->touches[*index].length <= time))
+    {
+        (*index)++;
+    }
+    double drift = BENCH_DRIFT * sin(6.283185307179586 * time / BENCH_DAY_US);
+    for (uint8_t ch = 0; ch < 4; ch++)
+    {
+        value[ch] = 5000000 + (int32_t)(drift + BENCH_NOISE * bench_gauss());
+        capdac[ch] = 0;
+    }
+    if ((*index < trace->touch_count) && (trace->touches[*index].start <= time))
+    {
+        // 100 ms ramps at both ends
+        const Bench_Touch* touch = &trace->touches[*index];
+        uint64_t in = time - touch->start;
+        uint64_t out = touch->start + touch->length - time;
+        uint64_t edge = (in < out) ? in : out;
+        value[touch->channel] += (int32_t)(BENCH_TOUCH_AMPLITUDE * ((edge < 100000) ? edge / 100000.0 : 1.0));
+    }
+}
+
+static void bench_replay(const char* name, const Bench_Trace* trace, const uint64_t* frame_bus_time)
+{
+    RateControl_Init(&bench_config);
+    uint8_t top = bench_config.tier_count - 1;
+    uint64_t tier_time[RATE_CONTROL_MAX_TIERS] = { 0 };
+    uint64_t bus_time = 0;
+    uint64_t frames = 0;
+    uint32_t index = 0;
+    uint32_t last_touch = UINT32_MAX;
+    uint64_t reaction_total = 0;
+    uint64_t reaction_max = 0;
+    uint32_t reactions = 0;
+    uint8_t waiting = 0;
+    uint64_t time = 0;
+    while (time < trace->duration)
+    {
+        uint8_t tier = RateControl_GetTier();
+        int32_t value[4];
+        uint8_t capdac[4];
+        bench_sample(trace, time, &index, value, capdac);
+        if ((trace->sample_count == 0) && (index < trace->touch_count) &&
+            (trace->touches[index].start <= time) && (index != last_touch))
+        {
+            last_touch = index;
+            waiting = 1;
+        }
+        RateControl_Update(value, capdac);
+        uint64_t now = RateControl_GetTimestamp();
+        tier_time[tier] += now - time;
+        bus_time += frame_bus_time[tier];
+        frames++;
+        time = now;
+        if (waiting && (RateControl_GetTier() == top))
+        {
+            uint64_t reaction = time - trace->touches[last_touch].start;
+            reaction_total += reaction;
+            reaction_max = (reaction > reaction_max) ? reaction : reaction_max;
+            reactions++;
+            waiting = 0;
+        }
+    }
+    uint64_t fixed = trace->duration / BENCH_FIXED_PERIOD * frame_bus_time[top];
+    printf("%-12s %5.1f h: %9llu frames, %5u switches, hours per tier", name, trace->duration / 3600e6,
+           (unsigned long long)frames, RateControl_GetSwitchCount());
+    for (uint8_t t = 0; t < bench_config.tier_count; t++)
+    {
+        printf(" %5.2f", tier_time[t] / 3600e6);
+    }
+    printf(", frame reads %6.0f s on the bus against %6.0f s at 400 S/s (-%4.1f%%)\n",
+           bus_time * 1e-9, fixed * 1e-9, 100.0 * (1.0 - (double)bus_time / fixed));
+    if (trace->sample_count == 0)
+    {
+        printf("%-12s %u touches, %u reached 400 S/s after %.1f ms on average, %.1f ms at most\n", "",
+               trace->touch_count, reactions, reactions ? reaction_total / 1e3 / reactions : 0.0,
+               reaction_max / 1e3);
+    }
+}
+
+int main(int argc, char** argv)
+{
+    uint64_t frame_bus_time[RATE_CONTROL_MAX_TIERS];
+    for (uint8_t t = 0; t < bench_config.tier_count; t++)
+    {
+        frame_bus_time[t] = bench_frame_bus_time(&bench_config.tiers[t]);
+    }
+    static Bench_Trace trace;
+    if (argc > 1)
+    {
+        if (!bench_load(&trace, argv[1]))
+        {
+            fprintf(stderr, "No samples in %s\n", argv[1]);
+            return 1;
+        }
+        bench_replay("capture", &trace, frame_bus_time);
+        return 0;
+    }
+    bench_synthetic(&trace, 40, 2, 1);
+    bench_replay("office day", &trace, frame_bus_time);
+    bench_synthetic(&trace, 2, 2, 2);
+    bench_replay("quiet day", &trace, frame_bus_time);
+    return 0;
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,344 @@
+/**
+*   \brief Replay of a capture through the driver and the CAPDAC tuning.
+*
+*   Usage: bench_replay [-s scale] [-n frames] [-o output] [-g golden] [capture]
+*
+*   The frames of a capture file (a synthetic one of an hour at 100 S/s by
+*   default, or the first given number of frames) drive the inputs of the
+*   simulated FDC1004Q in replay mode, so that the conversions complete at
+*   the recorded times. As in the main loop of the firmware, each completed
+*   frame is read with #FDC_ReadAllMeasurements, the saturated channels are
+*   re-ranged and the others go through #Sensors_TuneCapdac, whose new
+*   CAPDAC settings are written back to the device.
+*
+*   The replay runs as fast as the host allows, or with -s at the given
+*   multiple of real time (-s 1 for real time). The host time per sample
+*   is reported for the whole pipeline and for #Sensors_TuneCapdac alone,
+*   fed again with the same frames. The converted capacitance and the
+*   CAPDAC settings of each frame can be written to a file with -o, and
+*   compared with -g against the ones of a previous replay: the frames
+*   that differ, the first of them and the largest difference are reported,
+*   and the exit status is 1 when the replay diverges.
+*/
+
+#include "Bench.h"
+#include "CaptureFile.h"
+#include "FDC1004Q_Sim.h"
+#include "Sensors.h"
+
+#include <errno.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+// Synthetic capture: one hour at 100 S/s
+#define BENCH_SYNTHETIC_FRAMES 360000
+#define BENCH_SYNTHETIC_PERIOD_NS 10000000ULL
+
+/**
+*   \brief Output of the processing of a frame.
+*/
+typedef struct {
+    /** Converted capacitance, in units of the measurement LSB **/
+    int32_t capacitance[SENSORS_CHANNELS];
+    /** CAPDAC settings after the frame **/
+    uint8_t capdac[SENSORS_CHANNELS];
+} BenchOutput;
+
+/**
+*   \brief Input of the processing of a frame, kept to time it alone.
+*/
+typedef struct {
+    uint32_t raw[SENSORS_CHANNELS];
+    uint8_t capdac[SENSORS_CHANNELS];
+} BenchInput;
+
+static volatile int32_t bench_sink;
+
+// Frames of a capture file, the invalid blocks skipped
+static FDC_Sim_ReplayFrame* bench_load(const char* path, uint32_t* count);
+
+// Frames of a sine sweeping the CAPDAC range
+static FDC_Sim_ReplayFrame* bench_synthesize(uint32_t count);
+
+// Sleep until the given host time, return the time slept (ns)
+static uint64_t bench_sleep_until(uint64_t time_ns);
+
+int main(int argc, char** argv)
+{
+    double scale = 0;
+    uint32_t limit = 0;
+    const char* output_path = NULL;
+    const char* golden_path = NULL;
+    int option;
+    while ((option = getopt(argc, argv, "s:n:o:g:")) != -1)
+    {
+        if (option == 's')
+        {
+            scale = atof(optarg);
+        }
+        else if (option == 'n')
+        {
+            limit = strtoul(optarg, NULL, 0);
+        }
+        else if (option == 'o')
+        {
+            output_path = optarg;
+        }
+        else if (option == 'g')
+        {
+            golden_path = optarg;
+        }
+        else
+        {
+            fprintf(stderr, "Usage: %s [-s scale] [-n frames] [-o output] [-g golden] [capture]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    uint32_t count = (limit != 0) ? limit : BENCH_SYNTHETIC_FRAMES;
+    FDC_Sim_ReplayFrame* frames = (optind < argc) ? bench_load(argv[optind], &count) : bench_synthesize(count);
+    if (frames == NULL)
+    {
+        return 1;
+    }
+    if ((limit != 0) && (limit < count))
+    {
+        count = limit;
+    }
+    BenchOutput* outputs = calloc(count, sizeof(BenchOutput));
+    BenchInput* inputs = calloc(count, sizeof(BenchInput));
+    if ((count == 0) || (outputs == NULL) || (inputs == NULL))
+    {
+        fprintf(stderr, "No frames to replay\n");
+        return 1;
+    }
+
+    // Device set up as in the firmware, then the frames shifted past the set up
+    FDC_Sim_Init();
+    FDC_Start();
+    for (uint8_t ch = 0; ch < SENSORS_CHANNELS; ch++)
+    {
+        FDC_ConfigureMeasurementInput(ch, ch, FDC_CAPDAC, 0);
+    }
+    FDC_SetSampleRate(FDC_100_Hz);
+    FDC_EnableRepeatMeasurement(0xF0);
+    uint64_t offset = FDC_Sim_GetTime() + 1000000 - frames[0].time_ns;
+    for (uint32_t i = 0; i < count; i++)
+    {
+        frames[i].time_ns += offset;
+    }
+    FDC_Sim_SetReplay(frames, count);
+
+    uint8_t capdac[SENSORS_CHANNELS] = { 0 };
+    uint32_t produced = 0;
+    uint8_t frame_valid = 0;
+    FDC_Frame frame;
+    BenchInput* slot = &inputs[0];
+    uint64_t slept = 0;
+    uint64_t start = bench_now_ns();
+    for (uint32_t i = 0; i < count; i++)
+    {
+        if (frames[i].time_ns > FDC_Sim_GetTime())
+        {
+            FDC_Sim_AdvanceTime(frames[i].time_ns - FDC_Sim_GetTime());
+        }
+        if (scale > 0)
+        {
+            slept += bench_sleep_until(start + (uint64_t)((frames[i].time_ns - frames[0].time_ns) / scale));
+        }
+        if (FDC_ReadAllMeasurements(FDC_DONE_CH_ALL, &frame) != FDC_OK)
+        {
+            continue;
+        }
+        for (uint8_t ch = 0; ch < SENSORS_CHANNELS; ch++)
+        {
+            if (frame.valid & (FDC_DONE_CH_1 >> ch))
+            {
+                slot->raw[ch] = frame.capacitance[ch];
+                slot->capdac[ch] = frame.capdac[ch];
+            }
+            else if (frame.saturated & (FDC_DONE_CH_1 >> ch))
+            {
+                capdac[ch] = FDC_CorrectiveCapdac(frame.capdac[ch], FDC_CheckSaturation(frame.capacitance[ch]));
+                FDC_ConfigureMeasurementInput(ch, ch, FDC_CAPDAC, capdac[ch]);
+            }
+        }
+        frame_valid |= frame.valid;
+        if ((frame_valid & FDC_DONE_CH_ALL) == FDC_DONE_CH_ALL)
+        {
+            frame_valid = 0;
+            BenchOutput* output = &outputs[produced];
+            uint8_t changed = Sensors_TuneCapdac(slot->raw, slot->capdac, capdac, output->capacitance);
+            for (uint8_t ch = 0; ch < SENSORS_CHANNELS; ch++)
+            {
+                if (changed & (1 << ch))
+                {
+                    FDC_ConfigureMeasurementInput(ch, ch, FDC_CAPDAC, capdac[ch]);
+                }
+            }
+            memcpy(output->capdac, capdac, sizeof(capdac));
+            slot = &inputs[++produced];
+            if (produced == count)
+            {
+                break;
+            }
+            *slot = inputs[produced - 1];
+        }
+    }
+    uint64_t elapsed = bench_now_ns() - start;
+    double duration = (frames[count - 1].time_ns - frames[0].time_ns) * 1e-9;
+    printf("%u frames, %u processed, %.0f s of capture replayed in %.3f s (%.0fx real time)\n",
+           count, produced, duration, elapsed * 1e-9, duration / (elapsed * 1e-9));
+    // The time slept to keep the pace is not charged to the samples
+    printf("pipeline:           %7.1f ns/sample\n", (double)(elapsed - slept) / (produced * SENSORS_CHANNELS));
+
+    // Processing alone, on the same frames
+    int32_t capacitance[SENSORS_CHANNELS];
+    memset(capdac, 0, sizeof(capdac));
+    start = bench_now_ns();
+    for (uint32_t i = 0; i < produced; i++)
+    {
+        Sensors_TuneCapdac(inputs[i].raw, inputs[i].capdac, capdac, capacitance);
+        bench_sink = capacitance[0];
+    }
+    printf("Sensors_TuneCapdac: %7.1f ns/sample\n",
+           (double)(bench_now_ns() - start) / (produced * SENSORS_CHANNELS));
+
+    if (output_path != NULL)
+    {
+        FILE* file = fopen(output_path, "wb");
+        if ((file == NULL) || (fwrite(outputs, sizeof(BenchOutput), produced, file) != produced))
+        {
+            fprintf(stderr, "%s: %s\n", output_path, strerror(errno));
+            return 1;
+        }
+        fclose(file);
+    }
+
+    int status = 0;
+    if (golden_path != NULL)
+    {
+        FILE* file = fopen(golden_path, "rb");
+        if (file == NULL)
+        {
+            fprintf(stderr, "%s: %s\n", golden_path, strerror(errno));
+            return 1;
+        }
+        BenchOutput golden;
+        uint32_t compared = 0;
+        uint32_t diverged = 0;
+        uint32_t first = 0;
+        int64_t largest = 0;
+        while ((compared < produced) && (fread(&golden, sizeof(golden), 1, file) == 1))
+        {
+            uint8_t differs = memcmp(golden.capdac, outputs[compared].capdac, sizeof(golden.capdac)) != 0;
+            for (uint8_t ch = 0; ch < SENSORS_CHANNELS; ch++)
+            {
+                int64_t difference = llabs((int64_t)golden.capacitance[ch] - outputs[compared].capacitance[ch]);
+                differs |= difference != 0;
+                largest = (difference > largest) ? difference : largest;
+            }
+            if (differs && (diverged++ == 0))
+            {
+                first = compared;
+            }
+            compared++;
+        }
+        uint8_t longer = fread(&golden, sizeof(golden), 1, file) == 1;
+        fclose(file);
+        if ((diverged == 0) && (compared == produced) && !longer)
+        {
+            printf("golden: %u frames identical\n", compared);
+        }
+        else
+        {
+            printf("golden: %u of %u frames differ, first %u, largest difference %.6f pF%s\n",
+                   diverged, compared, first, largest / 524288.0,
+                   ((compared < produced) || longer) ? ", frame count differs" : "");
+            status = 1;
+        }
+    }
+    free(frames);
+    free(outputs);
+    free(inputs);
+    return status;
+}
+
+// ===========================================================
+//                  HELPER FUNCTIONS
+// ===========================================================
+
+FDC_Sim_ReplayFrame* bench_load(const char* path, uint32_t* count)
+{
+    CaptureFile file;
+    if (CaptureFile_Open(&file, path) < 0)
+    {
+        fprintf(stderr, "%s: %s\n", path, strerror(errno));
+        return NULL;
+    }
+    FDC_Sim_ReplayFrame* frames = calloc(file.block_count * FDC_CAPTURE_BLOCK_SAMPLES + 1, sizeof(FDC_Sim_ReplayFrame));
+    uint32_t n = 0;
+    uint32_t skipped = 0;
+    for (size_t b = 0; (frames != NULL) && (b < file.block_count); b++)
+    {
+        const FDC_CaptureBlock* block = &file.blocks[b];
+        if (!CaptureFile_IsValid(block))
+        {
+            skipped++;
+            continue;
+        }
+        for (uint8_t i = 0; i < block->header.sample_count; i++)
+        {
+            // Timestamps in ms
+            frames[n].time_ns = block->timestamp[i] * 1000000ULL;
+            for (uint8_t ch = 0; ch < FDC_CAPTURE_CHANNELS; ch++)
+            {
+                if (block->header.channel_mask & (FDC_RP_CH_1 >> ch))
+                {
+                    frames[n].capacitance_af[ch] = FDC_Sim_RawToCapacitance(block->raw[ch][i], block->capdac[ch][i]);
+                }
+            }
+            n++;
+        }
+    }
+    if (skipped != 0)
+    {
+        fprintf(stderr, "%s: %u invalid blocks skipped\n", path, skipped);
+    }
+    CaptureFile_Close(&file);
+    *count = n;
+    return frames;
+}
+
+FDC_Sim_ReplayFrame* bench_synthesize(uint32_t count)
+{
+    FDC_Sim_ReplayFrame* frames = malloc(count * sizeof(FDC_Sim_ReplayFrame));
+    for (uint32_t i = 0; (frames != NULL) && (i < count); i++)
+    {
+        frames[i].time_ns = i * BENCH_SYNTHETIC_PERIOD_NS;
+        for (uint8_t ch = 0; ch < FDC_CAPTURE_CHANNELS; ch++)
+        {
+            // 5 to 85 pF over a minute, a phase per channel, plus a 1 fF ripple
+            double phase = 2 * M_PI * (i * (BENCH_SYNTHETIC_PERIOD_NS * 1e-9) / 60.0 + ch / 4.0);
+            frames[i].capacitance_af[ch] = (int32_t)(45e6 + 40e6 * sin(phase)) + (int32_t)((i * 7919 + ch) % 1000);
+        }
+    }
+    return frames;
+}
+
+uint64_t bench_sleep_until(uint64_t time_ns)
+{
+    uint64_t now = bench_now_ns();
+    if (time_ns > now)
+    {
+        struct timespec delay = { (time_t)((time_ns - now) / 1000000000ULL), (long)((time_ns - now) % 1000000000ULL) };
+        nanosleep(&delay, NULL);
+    }
+    return bench_now_ns() - now;
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,161 @@
+/**
+*   \brief Benchmark of the latency added by the FreeRTOS layer.
+*
+*   Usage: bench_rtos [frames]
+*
+*   Three costs are measured against a direct call of the driver on the
+*   simulator:
+*   - the driver mutexes, taken but never contended, on each frame read;
+*   - a request served by the bus task (#FDC_Rtos_Call) instead of a
+*     direct register read;
+*   - the delivery of a frame from the bus task to a subscriber, from the
+*     end of the read to the return of xQueueReceive in the subscriber.
+*/
+
+#include "FDC1004Q_Rtos.h"
+#include "FDC1004Q_Sim.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+// Longest latency recorded by the histogram (us)
+#define BENCH_MAX_LATENCY 10000
+
+static uint32_t bench_frames;
+static QueueHandle_t bench_samples;
+static uint32_t bench_histogram[BENCH_MAX_LATENCY + 1];
+
+static uint64_t bench_now_ns(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+
+static uint8_t bench_advance(void* argument)
+{
+    (void)argument;
+    FDC_Sim_AdvanceTime(10000000);
+    return FDC_OK;
+}
+
+static uint8_t bench_read_id(void* argument)
+{
+    return FDC_ReadRegister(FDC1004Q_MANUFACTURER_ID, argument);
+}
+
+// Host time of a frame read (ns), the conversions being completed first
+static double bench_read_frames(uint32_t count)
+{
+    uint64_t total = 0;
+    for (uint32_t i = 0; i < count; i++)
+    {
+        FDC_Sim_AdvanceTime(10000000);
+        FDC_Frame frame;
+        uint64_t start = bench_now_ns();
+        FDC_ReadAllMeasurements(FDC_DONE_CH_ALL, &frame);
+        total += bench_now_ns() - start;
+    }
+    return (double)total / count;
+}
+
+static uint32_t bench_percentile(uint32_t count, uint32_t percent)
+{
+    uint64_t seen = 0;
+    for (uint32_t us = 0; us <= BENCH_MAX_LATENCY; us++)
+    {
+        seen += bench_histogram[us];
+        if (seen * 100 >= (uint64_t)count * percent)
+        {
+            return us;
+        }
+    }
+    return BENCH_MAX_LATENCY;
+}
+
+static void bench_task(void* parameters)
+{
+    (void)parameters;
+    // Requests against direct reads
+    uint8_t data[2];
+    uint64_t start = bench_now_ns();
+    for (uint32_t i = 0; i < bench_frames; i++)
+    {
+        FDC_ReadRegister(FDC1004Q_MANUFACTURER_ID, data);
+    }
+    double direct_ns = (double)(bench_now_ns() - start) / bench_frames;
+    start = bench_now_ns();
+    for (uint32_t i = 0; i < bench_frames; i++)
+    {
+        FDC_Rtos_Call(bench_read_id, data);
+    }
+    double call_ns = (double)(bench_now_ns() - start) / bench_frames;
+    printf("register read: direct %.0f ns, through the bus task %.0f ns (+%.0f ns)\n",
+           direct_ns, call_ns, call_ns - direct_ns);
+
+    // Delivery of the frames
+    FDC_Rtos_StartStreaming(FDC_DONE_CH_ALL, 1);
+    uint32_t received = 0;
+    uint64_t total = 0;
+    uint32_t worst = 0;
+    while (received < bench_frames)
+    {
+        FDC_Rtos_Call(bench_advance, NULL);
+        FDC_Rtos_Sample sample;
+        if (xQueueReceive(bench_samples, &sample, pdMS_TO_TICKS(1000)) != pdPASS)
+        {
+            printf("no frame received\n");
+            break;
+        }
+        uint32_t latency = FDC_RTOS_CLOCK() - sample.timestamp;
+        total += latency;
+        worst = (latency > worst) ? latency : worst;
+        bench_histogram[(latency < BENCH_MAX_LATENCY) ? latency : BENCH_MAX_LATENCY]++;
+        received++;
+    }
+    FDC_Rtos_StopStreaming();
+    FDC_Rtos_Stats stats;
+    FDC_Rtos_GetStats(&stats);
+    printf("frame delivery: %u frames, mean %.1f us, p50 %u us, p99 %u us, max %u us, %u dropped\n",
+           received, received ? (double)total / received : 0.0, bench_percentile(received, 50),
+           bench_percentile(received, 99), worst, stats.dropped);
+    vTaskEndScheduler();
+    vTaskDelete(NULL);
+}
+
+int main(int argc, char** argv)
+{
+    bench_frames = (argc > 1) ? (uint32_t)atoi(argv[1]) : 10000;
+    if (bench_frames == 0)
+    {
+        fprintf(stderr, "At least one frame\n");
+        return 2;
+    }
+    FDC_Sim_Init();
+    FDC_Start();
+    FDC_SetSampleRate(FDC_400_Hz);
+    for (uint8_t ch = 0; ch < 4; ch++)
+    {
+        FDC_ConfigureMeasurementInput(ch, ch, FDC_DISABLED, 0);
+    }
+    FDC_EnableRepeatMeasurement(0xF0);
+
+    // The mutexes are only taken once the layer is initialized
+    double unlocked_ns = bench_read_frames(bench_frames);
+    if (FDC_Rtos_Init(2, configMINIMAL_STACK_SIZE) != FDC_OK)
+    {
+        fprintf(stderr, "Could not create the layer\n");
+        return 1;
+    }
+    double locked_ns = bench_read_frames(bench_frames);
+    printf("frame read: without mutexes %.0f ns, with mutexes %.0f ns (+%.0f ns)\n",
+           unlocked_ns, locked_ns, locked_ns - unlocked_ns);
+
+    bench_samples = FDC_Rtos_Subscribe(16);
+    xTaskCreate(bench_task, "bench", configMINIMAL_STACK_SIZE, NULL, 1, NULL);
+    vTaskStartScheduler();
+    return 0;
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,302 @@
+/**
+*   \brief Benchmark of three ways of serving many FDC1004Q on one bus.
+*
+*   Usage: bench_rtos_sensors [rate]
+*
+*   Eight simulated sensors sit behind a bus multiplexer and convert their
+*   four channels at 400 S/s (or 100, 200 S/s), for one second of virtual
+*   time. They are served:
+*   - by one superloop with an asynchronous context per sensor, the
+*     transactions going through the I2C arbiter;
+*   - by one loop reading the sensors in turn with the blocking API;
+*   - by one task per sensor, each reading its sensor with the blocking
+*     API while holding the driver mutex, then yielding. Without the yield
+*     the host threads hand the mutex back to themselves and starve the
+*     other sensors.
+*   The input of each channel encodes the time of its conversion, so that
+*   the latency from the end of a conversion to its readout is known. The
+*   samples read, the conversions overwritten before being read, the
+*   latency and the host time per sample are reported, with the RAM each
+*   sensor costs on the Cortex-M3 (context and device for the superloop,
+*   stack of a task of #configMINIMAL_STACK_SIZE words, TCB excluded, for
+*   the tasks).
+*/
+
+#include "Bench.h"
+#include "FDC1004Q_Async.h"
+#include "FDC1004Q_Rtos.h"
+#include "FDC1004Q_Sim.h"
+#include "I2C_Mux.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define BENCH_SENSORS 8
+#define BENCH_DURATION_NS 1000000000ULL
+#define BENCH_MAX_SAMPLES 200000
+// Period of the input waveform (us)
+#define BENCH_WAVE_PERIOD_US 4000000
+
+static uint8_t bench_rate = FDC_400_Hz;
+static uint32_t bench_latency[BENCH_MAX_SAMPLES];
+static uint32_t bench_count;
+static uint64_t bench_start;
+static volatile uint8_t bench_running;
+
+// 1 aF per us of the conversion time, plus 1 pF per input
+static int32_t bench_wave(uint8_t input, uint64_t time_ns)
+{
+    return (int32_t)((time_ns / 1000) % BENCH_WAVE_PERIOD_US) + input * 1000000;
+}
+
+static uint32_t bench_clock(void)
+{
+    return (uint32_t)(FDC_Sim_GetTime() / 1000);
+}
+
+// Latency of the samples of a frame, read now
+static void bench_record(const FDC_Frame* frame)
+{
+    uint64_t now_us = FDC_Sim_GetTime() / 1000;
+    for (uint8_t ch = 0; ch < 4; ch++)
+    {
+        if ((frame->valid & (FDC_DONE_CH_1 >> ch)) && (bench_count < BENCH_MAX_SAMPLES))
+        {
+            // 2^-19 pF -> aF
+            double converted = ((int32_t)frame->capacitance[ch] >> 8) * 1e6 / 524288.0 - ch * 1000000.0;
+            double latency = (double)(now_us % BENCH_WAVE_PERIOD_US) - converted;
+            bench_latency[bench_count++] = (uint32_t)((latency < 0) ? latency + BENCH_WAVE_PERIOD_US : latency);
+        }
+    }
+}
+
+static int bench_compare(const void* a, const void* b)
+{
+    uint32_t x = *(const uint32_t*)a;
+    uint32_t y = *(const uint32_t*)b;
+    return (x > y) - (x < y);
+}
+
+static void bench_report(const char* name, uint64_t host_ns, uint32_t ram)
+{
+    FDC_Sim_Stats stats;
+    FDC_Sim_GetStats(&stats);
+    uint64_t elapsed = FDC_Sim_GetTime() - bench_start;
+    if (bench_count == 0)
+    {
+        printf("%-10s no samples\n", name);
+        return;
+    }
+    qsort(bench_latency, bench_count, sizeof(bench_latency[0]), bench_compare);
+    printf("%-10s %6u samples/s, %4u overruns, latency p50 %5u us p99 %5u us max %5u us, "
+           "bus %3.0f%%, host %5.0f ns/sample, %4u B per sensor\n",
+           name, (uint32_t)(bench_count / (elapsed * 1e-9)), stats.overruns,
+           bench_latency[bench_count / 2], bench_latency[(uint64_t)bench_count * 99 / 100],
+           bench_latency[bench_count - 1], 100.0 * stats.bus_time_ns / elapsed,
+           (double)host_ns / bench_count, ram);
+}
+
+static void bench_setup(void)
+{
+    FDC_Sim_Init();
+    FDC_Sim_AttachMux(BENCH_SENSORS);
+    for (uint8_t d = 0; d < BENCH_SENSORS; d++)
+    {
+        FDC_Sim_SelectDevice(d);
+        FDC_Sim_SetWaveform(bench_wave);
+    }
+}
+
+static void bench_setup_blocking(void)
+{
+    bench_setup();
+    for (uint8_t d = 0; d < BENCH_SENSORS; d++)
+    {
+        I2C_Mux_Select(d);
+        FDC_Reset();
+        for (uint8_t ch = 0; ch < 4; ch++)
+        {
+            FDC_ConfigureMeasurementInput(ch, ch, FDC_DISABLED, 0);
+        }
+        FDC_SetSampleRate(bench_rate);
+        FDC_EnableRepeatMeasurement(0xF0);
+    }
+    FDC_Sim_ResetStats();
+    bench_count = 0;
+    bench_start = FDC_Sim_GetTime();
+}
+
+static void bench_async(void)
+{
+    static FDC_AsyncDevice devices[BENCH_SENSORS];
+    static FDC_AsyncContext contexts[BENCH_SENSORS];
+    uint8_t step[BENCH_SENSORS];
+    bench_setup();
+    I2C_Arbiter_Init(bench_clock);
+    I2C_Arbiter_SetBusSelect(I2C_Mux_Select);
+    for (uint8_t d = 0; d < BENCH_SENSORS; d++)
+    {
+        FDC_Async_InitDevice(&devices[d], FDC1004Q_I2C_ADDR, d);
+        FDC_Async_Init(&contexts[d], &devices[d], I2C_ARBITER_PRIORITY_HIGH);
+        step[d] = 0;
+    }
+
+    // Reset, four channels, rate, repeat
+    uint8_t ready = 0;
+    while (ready < BENCH_SENSORS)
+    {
+        for (uint8_t d = 0; d < BENCH_SENSORS; d++)
+        {
+            uint8_t error;
+            if (step[d] == 0)
+            {
+                error = FDC_Async_Reset(&contexts[d]);
+            }
+            else if (step[d] <= 4)
+            {
+                error = FDC_Async_ConfigureMeasurementInput(&contexts[d], step[d] - 1, step[d] - 1, FDC_DISABLED, 0);
+            }
+            else if (step[d] == 5)
+            {
+                error = FDC_Async_SetSampleRate(&contexts[d], bench_rate);
+            }
+            else if (step[d] == 6)
+            {
+                error = FDC_Async_EnableRepeatMeasurement(&contexts[d], 0xF0);
+            }
+            else
+            {
+                continue;
+            }
+            if (error != FDC_ASYNC_PENDING)
+            {
+                ready += (++step[d] == 7);
+            }
+        }
+        I2C_Arbiter_Process();
+    }
+
+    FDC_Sim_ResetStats();
+    bench_count = 0;
+    bench_start = FDC_Sim_GetTime();
+    uint64_t start = bench_now_ns();
+    FDC_Frame frames[BENCH_SENSORS];
+    while (FDC_Sim_GetTime() - bench_start < BENCH_DURATION_NS)
+    {
+        for (uint8_t d = 0; d < BENCH_SENSORS; d++)
+        {
+            if (FDC_Async_ReadAllMeasurements(&contexts[d], FDC_DONE_CH_ALL, &frames[d]) == FDC_OK)
+            {
+                bench_record(&frames[d]);
+            }
+        }
+        // Idle until the next transaction can start
+        if (!I2C_Arbiter_Process())
+        {
+            FDC_Sim_AdvanceTime(10000);
+        }
+    }
+    bench_report("async", bench_now_ns() - start, sizeof(FDC_AsyncContext) + sizeof(FDC_AsyncDevice));
+}
+
+static void bench_round_robin(void)
+{
+    bench_setup_blocking();
+    uint64_t start = bench_now_ns();
+    while (FDC_Sim_GetTime() - bench_start < BENCH_DURATION_NS)
+    {
+        for (uint8_t d = 0; d < BENCH_SENSORS; d++)
+        {
+            I2C_Mux_Select(d);
+            FDC_Frame frame;
+            if (FDC_ReadAllMeasurements(FDC_DONE_CH_ALL, &frame) == FDC_OK)
+            {
+                bench_record(&frame);
+            }
+        }
+    }
+    bench_report("blocking", bench_now_ns() - start, 0);
+}
+
+static void bench_sensor_task(void* parameters)
+{
+    uint8_t device = (uint8_t)(uintptr_t)parameters;
+    while (bench_running)
+    {
+        // The segment stays selected for the whole read
+        FDC_Rtos_Lock();
+        if (FDC_Sim_GetTime() - bench_start >= BENCH_DURATION_NS)
+        {
+            bench_running = 0;
+        }
+        else
+        {
+            I2C_Mux_Select(device);
+            FDC_Frame frame;
+            if (FDC_ReadAllMeasurements(FDC_DONE_CH_ALL, &frame) == FDC_OK)
+            {
+                bench_record(&frame);
+            }
+        }
+        FDC_Rtos_Unlock();
+        taskYIELD();
+    }
+    vTaskDelete(NULL);
+}
+
+static void bench_supervisor(void* parameters)
+{
+    (void)parameters;
+    uint64_t start = bench_now_ns();
+    bench_running = 1;
+    for (uint8_t d = 0; d < BENCH_SENSORS; d++)
+    {
+        xTaskCreate(bench_sensor_task, "sensor", configMINIMAL_STACK_SIZE, (void*)(uintptr_t)d, 1, NULL);
+    }
+    while (bench_running)
+    {
+        vTaskDelay(1);
+    }
+    // Let the tasks give back the mutex
+    FDC_Rtos_Lock();
+    bench_report("tasks", bench_now_ns() - start, configMINIMAL_STACK_SIZE * sizeof(uint32_t));
+    FDC_Rtos_Unlock();
+    vTaskEndScheduler();
+    vTaskDelete(NULL);
+}
+
+int main(int argc, char** argv)
+{
+    uint32_t rate = (argc > 1) ? (uint32_t)atoi(argv[1]) : 400;
+    switch (rate)
+    {
+        case 100:
+            bench_rate = FDC_100_Hz;
+            break;
+        case 200:
+            bench_rate = FDC_200_Hz;
+            break;
+        case 400:
+            bench_rate = FDC_400_Hz;
+            break;
+        default:
+            fprintf(stderr, "Rate of 100, 200 or 400 S/s\n");
+            return 2;
+    }
+    printf("%u sensors at %u S/s\n", BENCH_SENSORS, rate);
+    bench_async();
+    bench_round_robin();
+
+    // The driver mutexes are only taken once the layer is initialized
+    bench_setup_blocking();
+    if (FDC_Rtos_Init(2, configMINIMAL_STACK_SIZE) != FDC_OK)
+    {
+        fprintf(stderr, "Could not create the layer\n");
+        return 1;
+    }
+    xTaskCreate(bench_supervisor, "supervisor", configMINIMAL_STACK_SIZE, NULL, 1, NULL);
+    vTaskStartScheduler();
+    return 0;
+}
+
+/* [] END OF FILE */
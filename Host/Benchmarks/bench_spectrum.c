@@ -0,0 +1,107 @@
+/**
+*   \brief Benchmark of the Welch power spectrum estimation.
+*
+*   Usage: bench_spectrum [samples]
+*
+*   Random samples are added to a #Spectrum_State one at a time with
+*   #Spectrum_AddSample, and in capture blocks of four channels with
+*   #Spectrum_AddCaptureBlock, as when a capture file is analysed on the
+*   host. A segment of #SPECTRUM_FFT_SIZE samples is transformed every
+*   #SPECTRUM_FFT_SIZE / 2 samples. The throughput is reported in
+*   samples/s, with the cost in ns and, on x86, in time stamp counter
+*   cycles per sample and per segment (see Bench.h), and the cost of
+*   reading the average spectrum.
+*/
+
+#include "Bench.h"
+#include "Spectrum.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define BENCH_SAMPLES 4096
+
+static volatile uint64_t bench_sink;
+
+static void bench_report(const char* name, uint64_t ns, uint64_t cycles, uint64_t count)
+{
+    printf("%-26s %6.2f M samples/s %6.1f ns/sample %6.1f cycles/sample, %6.0f ns/segment\n",
+           name, count * 1e3 / ns, (double)ns / count, (double)cycles / count,
+           (double)ns / count * SPECTRUM_FFT_SIZE / 2);
+}
+
+int main(int argc, char** argv)
+{
+    uint32_t rounds = ((argc > 1) ? (uint32_t)atoi(argv[1]) : 10000000) / BENCH_SAMPLES;
+    if (rounds == 0)
+    {
+        fprintf(stderr, "At least %u samples\n", BENCH_SAMPLES);
+        return 2;
+    }
+    static int32_t samples[BENCH_SAMPLES];
+    static FDC_CaptureBlock blocks[BENCH_SAMPLES / FDC_CAPTURE_BLOCK_SAMPLES];
+    srand(1);
+    for (uint32_t i = 0; i < BENCH_SAMPLES; i++)
+    {
+        samples[i] = 524288 + rand() % 2001 - 1000;
+    }
+    for (uint32_t b = 0; b < BENCH_SAMPLES / FDC_CAPTURE_BLOCK_SAMPLES; b++)
+    {
+        blocks[b].header.channel_mask = FDC_RP_CH_1 | FDC_RP_CH_2 | FDC_RP_CH_3 | FDC_RP_CH_4;
+        blocks[b].header.sample_count = FDC_CAPTURE_BLOCK_SAMPLES;
+        for (uint8_t ch = 0; ch < FDC_CAPTURE_CHANNELS; ch++)
+        {
+            for (uint8_t i = 0; i < FDC_CAPTURE_BLOCK_SAMPLES; i++)
+            {
+                blocks[b].raw[ch][i] = samples[(b * FDC_CAPTURE_BLOCK_SAMPLES + i + ch * 1000) % BENCH_SAMPLES];
+            }
+        }
+    }
+    printf("%u-point FFT\n", SPECTRUM_FFT_SIZE);
+
+    static Spectrum_State state;
+    Spectrum_Init(&state, NULL);
+    uint64_t start = bench_now_ns();
+    uint64_t cycles = BENCH_CYCLES();
+    for (uint32_t r = 0; r < rounds; r++)
+    {
+        for (uint32_t i = 0; i < BENCH_SAMPLES; i++)
+        {
+            Spectrum_AddSample(&state, samples[i], 0);
+        }
+    }
+    cycles = BENCH_CYCLES() - cycles;
+    bench_report("Spectrum_AddSample", bench_now_ns() - start, cycles, (uint64_t)rounds * BENCH_SAMPLES);
+
+    static Spectrum_State states[FDC_CAPTURE_CHANNELS];
+    for (uint8_t ch = 0; ch < FDC_CAPTURE_CHANNELS; ch++)
+    {
+        Spectrum_Init(&states[ch], NULL);
+    }
+    // A quarter of the rounds, four channels per block
+    start = bench_now_ns();
+    cycles = BENCH_CYCLES();
+    for (uint32_t r = 0; r < (rounds + 3) / 4; r++)
+    {
+        for (uint32_t b = 0; b < BENCH_SAMPLES / FDC_CAPTURE_BLOCK_SAMPLES; b++)
+        {
+            Spectrum_AddCaptureBlock(states, &blocks[b]);
+        }
+    }
+    cycles = BENCH_CYCLES() - cycles;
+    bench_report("Spectrum_AddCaptureBlock", bench_now_ns() - start, cycles, (uint64_t)(rounds + 3) / 4 * BENCH_SAMPLES * 4);
+
+    uint64_t power[SPECTRUM_BINS];
+    start = bench_now_ns();
+    cycles = BENCH_CYCLES();
+    for (uint32_t r = 0; r < 10000; r++)
+    {
+        Spectrum_GetPsd(&state, power);
+    }
+    cycles = BENCH_CYCLES() - cycles;
+    printf("Spectrum_GetPsd: %6.0f ns %8.0f cycles\n", (bench_now_ns() - start) / 10000.0, cycles / 10000.0);
+    bench_sink = power[1] + states[FDC_CH_4].segments;
+    return 0;
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,140 @@
+/**
+*   \brief Benchmark of the cost per sample of the running statistics.
+*
+*   Usage: bench_stats [frames]
+*
+*   Frames of random samples are added with #Stats_UpdateFrame, with the
+*   block length of main.c (100 frames), and the cost per sample is
+*   reported, block completions included, with the cost of querying all
+*   the windows and of #Fixed_Sqrt (see Bench.h). For comparison, the
+*   samples are also kept in a ring holding the longest window and
+*   summarised with a pass over it in double precision, as a host would
+*   do without the stage.
+*/
+
+#include "Bench.h"
+#include "Fixed.h"
+#include "Stats.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define BENCH_BLOCK_LENGTH 100
+// Samples of a channel in the longest window
+#define BENCH_RING (BENCH_BLOCK_LENGTH * STATS_BLOCKS * STATS_BLOCKS * STATS_BLOCKS)
+
+static volatile uint64_t bench_sink;
+
+static void bench_report(const char* name, uint64_t ns, uint64_t cycles, uint32_t count, const char* unit)
+{
+    printf("%-26s %8.1f ns/%s %9.1f cycles/%s\n", name, (double)ns / count, unit, (double)cycles / count, unit);
+}
+
+int main(int argc, char** argv)
+{
+    uint32_t count = (argc > 1) ? (uint32_t)atoi(argv[1]) : 2000000;
+    if (count == 0)
+    {
+        fprintf(stderr, "At least one frame\n");
+        return 2;
+    }
+    int32_t (*frames)[STATS_CHANNELS] = malloc(count * sizeof(*frames));
+    if (frames == NULL)
+    {
+        return 1;
+    }
+    srand(1);
+    for (uint32_t n = 0; n < count; n++)
+    {
+        for (uint8_t ch = 0; ch < STATS_CHANNELS; ch++)
+        {
+            frames[n][ch] = 5000000 + rand() % 20000;
+        }
+    }
+
+    Stats_Init(BENCH_BLOCK_LENGTH);
+    uint64_t start = bench_now_ns();
+    uint64_t cycles = BENCH_CYCLES();
+    for (uint32_t n = 0; n < count; n++)
+    {
+        Stats_UpdateFrame(frames[n]);
+    }
+    cycles = BENCH_CYCLES() - cycles;
+    bench_report("Stats_UpdateFrame", bench_now_ns() - start, cycles, count * STATS_CHANNELS, "sample");
+
+    Stats_Summary summary;
+    uint64_t sum = 0;
+    uint32_t queries = 0;
+    start = bench_now_ns();
+    cycles = BENCH_CYCLES();
+    for (uint32_t i = 0; i < 10000; i++)
+    {
+        for (uint8_t scale = 0; scale < STATS_SCALES; scale++)
+        {
+            for (uint8_t ch = 0; ch < STATS_CHANNELS; ch++)
+            {
+                if (Stats_GetSliding(ch, scale, &summary) == FDC_OK)
+                {
+                    sum += summary.std_dev;
+                    queries++;
+                }
+            }
+        }
+    }
+    cycles = BENCH_CYCLES() - cycles;
+    if (queries > 0)
+    {
+        bench_report("Stats_GetSliding", bench_now_ns() - start, cycles, queries, "query");
+    }
+
+    start = bench_now_ns();
+    cycles = BENCH_CYCLES();
+    for (uint32_t n = 0; n < count; n++)
+    {
+        sum += Fixed_Sqrt(((uint64_t)(uint32_t)frames[n][0] << 24) + n);
+    }
+    cycles = BENCH_CYCLES() - cycles;
+    bench_report("Fixed_Sqrt", bench_now_ns() - start, cycles, count, "call");
+
+    // Ring of the longest window, summarised once per block
+    static int32_t ring[STATS_CHANNELS][BENCH_RING];
+    uint32_t filled = 0;
+    start = bench_now_ns();
+    cycles = BENCH_CYCLES();
+    for (uint32_t n = 0; n < count; n++)
+    {
+        uint32_t slot = n % BENCH_RING;
+        for (uint8_t ch = 0; ch < STATS_CHANNELS; ch++)
+        {
+            ring[ch][slot] = frames[n][ch];
+        }
+        filled += (filled < BENCH_RING);
+        if ((n + 1) % BENCH_BLOCK_LENGTH != 0)
+        {
+            continue;
+        }
+        for (uint8_t ch = 0; ch < STATS_CHANNELS; ch++)
+        {
+            double mean = 0;
+            double squares = 0;
+            for (uint32_t i = 0; i < filled; i++)
+            {
+                mean += ring[ch][i];
+            }
+            mean /= filled;
+            for (uint32_t i = 0; i < filled; i++)
+            {
+                squares += (ring[ch][i] - mean) * (ring[ch][i] - mean);
+            }
+            sum += (uint64_t)sqrt(squares / filled);
+        }
+    }
+    cycles = BENCH_CYCLES() - cycles;
+    bench_report("ring, summary per block", bench_now_ns() - start, cycles, count * STATS_CHANNELS, "sample");
+    bench_sink = sum;
+    free(frames);
+    return 0;
+}
+
+/* [] END OF FILE */
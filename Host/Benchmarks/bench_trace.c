@@ -0,0 +1,115 @@
+/**
+*   \brief Benchmark of the cost of the register trace.
+*
+*   Usage: bench_trace [events]
+*
+*   Three costs are measured on the host, in ns and in time stamp counter
+*   cycles per event:
+*   - #FDC_Trace_Record alone, with a clock that only counts its calls, as
+*     cheap as the cycle counter read of the Cortex-M3;
+*   - #FDC_ReadRegister on the simulator with the trace recording, then
+*     stopped: the difference is what the trace adds to a register access,
+*     clock reads included;
+*   - the host decoding of a dump of #FDC_TRACE_SIZE events.
+*/
+
+#include "Bench.h"
+#include "FDC1004Q.h"
+#include "FDC1004Q_Sim.h"
+#include "FDC1004Q_Trace.h"
+#include "TraceDecoder.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static uint32_t bench_ticks;
+static uint8_t bench_dump[TRACE_DECODER_HEADER_SIZE + FDC_TRACE_SIZE * TRACE_DECODER_EVENT_SIZE];
+static size_t bench_length;
+static volatile uint32_t bench_sink;
+
+static uint32_t bench_clock(void)
+{
+    return bench_ticks++;
+}
+
+static void bench_write(const uint8_t* data, uint16_t length)
+{
+    memcpy(&bench_dump[bench_length], data, length);
+    bench_length += length;
+}
+
+static void bench_report(const char* name, uint64_t ns, uint64_t cycles, uint32_t events)
+{
+    printf("%-28s %7.1f ns %7.0f cycles per event\n", name, (double)ns / events, (double)cycles / events);
+}
+
+// Time reads of a register, with the trace recording or not
+static void bench_reads(const char* name, uint32_t events, uint64_t* ns, uint64_t* cycles)
+{
+    uint8_t data[2];
+    uint64_t begin = bench_now_ns();
+    uint64_t start = BENCH_CYCLES();
+    for (uint32_t i = 0; i < events; i++)
+    {
+        FDC_ReadRegister(FDC1004Q_FDC_CONF, data);
+    }
+    *cycles = BENCH_CYCLES() - start;
+    *ns = bench_now_ns() - begin;
+    bench_sink = data[0];
+    bench_report(name, *ns, *cycles, events);
+}
+
+int main(int argc, char** argv)
+{
+    uint32_t events = (argc > 1) ? strtoul(argv[1], NULL, 0) : 1000000;
+    if (events == 0)
+    {
+        fprintf(stderr, "events must be at least 1\n");
+        return 1;
+    }
+
+    // Recording alone
+    const uint8_t data[2] = { 0x12, 0x34 };
+    FDC_Trace_Start(bench_clock);
+    uint64_t begin = bench_now_ns();
+    uint64_t start = BENCH_CYCLES();
+    for (uint32_t i = 0; i < events; i++)
+    {
+        FDC_Trace_Record(FDC_Trace_Now(), FDC_TRACE_OP_READ, (uint8_t)i, data, FDC_OK);
+    }
+    bench_report("FDC_Trace_Record", bench_now_ns() - begin, BENCH_CYCLES() - start, events);
+
+    // Register reads, recorded and not
+    FDC_Sim_Init();
+    FDC_Start();
+    uint64_t traced_ns, traced_cycles, plain_ns, plain_cycles;
+    FDC_Trace_Start(bench_clock);
+    bench_reads("FDC_ReadRegister, recording", events, &traced_ns, &traced_cycles);
+    FDC_Trace_Stop();
+    bench_reads("FDC_ReadRegister, stopped", events, &plain_ns, &plain_cycles);
+    printf("%-28s %7.1f ns %7.0f cycles per event\n", "added by the trace",
+           ((double)traced_ns - plain_ns) / events, ((double)traced_cycles - plain_cycles) / events);
+
+    // Decoding
+    FDC_Trace_Start(bench_clock);
+    for (uint16_t i = 0; i < FDC_TRACE_SIZE; i++)
+    {
+        FDC_Trace_Record(FDC_Trace_Now(), FDC_TRACE_OP_WRITE, FDC1004Q_FDC_CONF, data, FDC_OK);
+    }
+    FDC_Trace_Dump(bench_write);
+    static FDC_TraceEvent decoded[FDC_TRACE_SIZE];
+    FDC_TraceHeader header;
+    uint32_t dumps = (events + FDC_TRACE_SIZE - 1) / FDC_TRACE_SIZE;
+    begin = bench_now_ns();
+    start = BENCH_CYCLES();
+    for (uint32_t i = 0; i < dumps; i++)
+    {
+        bench_sink = TraceDecoder_Parse(bench_dump, bench_length, &header, decoded, FDC_TRACE_SIZE);
+    }
+    bench_report("TraceDecoder_Parse", bench_now_ns() - begin, BENCH_CYCLES() - start, 
+                 dumps * FDC_TRACE_SIZE);
+    return 0;
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,143 @@
+/**
+*   \brief Benchmark of the latency and noise of the tracker against a boxcar.
+*
+*   Usage: bench_tracker [noise]
+*
+*   The tracker, for a few tracking indices, and moving averages of a few
+*   lengths filter the same synthetic signals with white Gaussian noise
+*   (100 LSB standard deviation by default):
+*   - a constant, to give the residual noise;
+*   - a noiseless ramp of 5 LSB per sample, to give the lag in samples;
+*   - a noiseless step of 10000 LSB, to give the samples needed to get
+*     within 10% of the new level.
+*/
+
+#include "Tracker.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define BENCH_SAMPLES 20000
+#define BENCH_RAMP_SLOPE 5.0
+#define BENCH_STEP 10000
+#define BENCH_MAX_TAPS 32
+
+// Filter under test: 0 taps for the tracker
+typedef struct {
+    uint8_t taps;
+    uint32_t process_noise;
+    double history[BENCH_MAX_TAPS];
+    double sum;
+    uint32_t count;
+} Bench_Filter;
+
+static double bench_gauss(void)
+{
+    double u = (rand() + 1.0) / (RAND_MAX + 2.0);
+    double v = (rand() + 1.0) / (RAND_MAX + 2.0);
+    return sqrt(-2 * log(u)) * cos(6.283185307179586 * v);
+}
+
+static void bench_reset(Bench_Filter* filter, uint32_t measurement_noise)
+{
+    filter->sum = 0;
+    filter->count = 0;
+    if (filter->taps == 0)
+    {
+        Tracker_SetNoise(FDC_CH_1, filter->process_noise, measurement_noise);
+    }
+}
+
+static double bench_filter(Bench_Filter* filter, double sample)
+{
+    if (filter->taps == 0)
+    {
+        Tracker_Estimate estimate;
+        Tracker_Update(FDC_CH_1, (int32_t)lround(sample), 0, &estimate);
+        return estimate.position;
+    }
+    uint8_t slot = filter->count % filter->taps;
+    if (filter->count >= filter->taps)
+    {
+        filter->sum -= filter->history[slot];
+    }
+    filter->history[slot] = sample;
+    filter->sum += sample;
+    filter->count++;
+    return filter->sum / ((filter->count < filter->taps) ? filter->count : filter->taps);
+}
+
+static void bench_run(Bench_Filter* filter, const char* name, double noise)
+{
+    // Residual noise on a constant
+    srand(1);
+    bench_reset(filter, (uint32_t)noise);
+    double squares = 0;
+    for (uint32_t n = 0; n < BENCH_SAMPLES; n++)
+    {
+        double error = bench_filter(filter, noise * bench_gauss());
+        if (n >= 1000)
+        {
+            squares += error * error;
+        }
+    }
+    double residual = sqrt(squares / (BENCH_SAMPLES - 1000));
+
+    // Lag on a ramp
+    bench_reset(filter, (uint32_t)noise);
+    double bias = 0;
+    for (uint32_t n = 0; n < BENCH_SAMPLES; n++)
+    {
+        double truth = n * BENCH_RAMP_SLOPE;
+        double error = bench_filter(filter, truth) - truth;
+        if (n >= 1000)
+        {
+            bias += error;
+        }
+    }
+    double lag = fabs(bias) / (BENCH_SAMPLES - 1000) / BENCH_RAMP_SLOPE;
+
+    // Settling after a step
+    bench_reset(filter, (uint32_t)noise);
+    for (uint32_t n = 0; n < 1000; n++)
+    {
+        bench_filter(filter, 0);
+    }
+    uint32_t settling = 0;
+    while ((bench_filter(filter, BENCH_STEP) < 0.9 * BENCH_STEP) && (settling < BENCH_SAMPLES))
+    {
+        settling++;
+    }
+    printf("%-24s noise %6.1f LSB rms (%4.2fx), ramp lag %5.2f samples, step to 90%% %4u samples\n",
+           name, residual, residual / noise, lag, settling + 1);
+}
+
+int main(int argc, char** argv)
+{
+    double noise = (argc > 1) ? atof(argv[1]) : 100.0;
+    if (noise < 1)
+    {
+        fprintf(stderr, "Noise of at least 1 LSB\n");
+        return 2;
+    }
+    char name[32];
+    static const uint8_t taps[] = { 4, 8, 16, 32 };
+    for (uint8_t i = 0; i < sizeof(taps); i++)
+    {
+        Bench_Filter filter = { .taps = taps[i] };
+        snprintf(name, sizeof(name), "boxcar %u", taps[i]);
+        bench_run(&filter, name, noise);
+    }
+    // Process noise relative to the measurement noise
+    static const double ratios[] = { 0.01, 0.05, 0.2 };
+    for (uint8_t i = 0; i < sizeof(ratios) / sizeof(ratios[0]); i++)
+    {
+        Bench_Filter filter = { .taps = 0, .process_noise = (uint32_t)ceil(ratios[i] * noise) };
+        snprintf(name, sizeof(name), "tracker lambda %.3f", filter.process_noise / noise);
+        bench_run(&filter, name, noise);
+    }
+    return 0;
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,66 @@
+/**
+*   \file FreeRTOS.h
+*   \brief Host stand-in for the FreeRTOS kernel, built on POSIX threads.
+*
+*   This directory implements the subset of the FreeRTOS API used by the
+*   RTOS layer of the driver (see FDC1004Q_Rtos.h), with the FreeRTOS names
+*   and semantics, so that the layer can be built and measured on a host
+*   without the kernel sources. Each task is a thread, queues and mutexes
+*   are built on pthread mutexes and condition variables, and the tick count
+*   is derived from the monotonic clock. Task priorities are recorded but
+*   not enforced, and there is no preemption model: the threads are
+*   scheduled by the host. The code under test only relies on the blocking
+*   semantics, so it builds unchanged against the real kernel or its POSIX
+*   port.
+*
+*   \author Davide Marzorati
+*/
+
+#ifndef __FREERTOS_H__
+    #define __FREERTOS_H__
+
+    #include <stddef.h>
+    #include <stdint.h>
+
+    #include "FreeRTOSConfig.h"
+
+    typedef long BaseType_t;
+    typedef unsigned long UBaseType_t;
+    typedef uint32_t TickType_t;
+    typedef uint32_t StackType_t;
+
+    #ifndef configSTACK_DEPTH_TYPE
+        #define configSTACK_DEPTH_TYPE uint16_t
+    #endif
+
+    #ifndef configASSERT
+        #define configASSERT(x)
+    #endif
+
+    #define pdFALSE ((BaseType_t)0)
+    #define pdTRUE ((BaseType_t)1)
+    #define pdPASS pdTRUE
+    #define pdFAIL pdFALSE
+    #define errQUEUE_EMPTY ((BaseType_t)0)
+    #define errQUEUE_FULL ((BaseType_t)0)
+
+    /**
+    *   \brief Block without time-out.
+    */
+    #define portMAX_DELAY ((TickType_t)0xFFFFFFFFUL)
+
+    /**
+    *   \brief Convert milliseconds to ticks.
+    */
+    #define pdMS_TO_TICKS(ms) ((TickType_t)(((TickType_t)(ms) * (TickType_t)configTICK_RATE_HZ) / (TickType_t)1000U))
+
+    /**
+    *   \brief Time since the start of the process (us), for timestamps finer than a tick.
+    *
+    *   Not part of the FreeRTOS API: a port for a target provides the same
+    *   from a hardware timer.
+    */
+    uint32_t ulPortGetMicroseconds(void);
+
+#endif
+/* [] END OF FILE */
@@ -0,0 +1,31 @@
+/**
+*   \file FreeRTOSConfig.h
+*   \brief Kernel configuration of the host builds.
+*
+*   \author Davide Marzorati
+*/
+
+#ifndef __FREERTOS_CONFIG_H__
+    #define __FREERTOS_CONFIG_H__
+
+    #include <assert.h>
+
+    #define configTICK_RATE_HZ 1000
+    #define configMAX_PRIORITIES 8
+    #define configMINIMAL_STACK_SIZE 256
+    #define configUSE_MUTEXES 1
+    #define configUSE_RECURSIVE_MUTEXES 1
+    #define configUSE_TASK_NOTIFICATIONS 1
+    #define INCLUDE_vTaskDelete 1
+    #define INCLUDE_vTaskDelay 1
+    #define INCLUDE_xTaskGetCurrentTaskHandle 1
+    #define INCLUDE_xTaskGetSchedulerState 1
+    #define configASSERT(x) assert(x)
+
+    /**
+    *   \brief Timestamp the samples of the RTOS layer in microseconds.
+    */
+    #define FDC_RTOS_CLOCK() ulPortGetMicroseconds()
+
+#endif
+/* [] END OF FILE */
@@ -0,0 +1,395 @@
+/**
+*   \brief Source file of the host stand-in for FreeRTOS.
+*/
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "queue.h"
+#include "semphr.h"
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+struct tskTaskControlBlock {
+    pthread_t thread;
+    TaskFunction_t code;
+    void* parameters;
+    UBaseType_t priority;
+    pthread_mutex_t lock;
+    pthread_cond_t notified;
+    uint32_t notification;
+};
+
+struct QueueDefinition {
+    pthread_mutex_t lock;
+    pthread_cond_t not_empty;
+    pthread_cond_t not_full;
+    uint8_t* items;
+    UBaseType_t length;
+    UBaseType_t item_size;
+    UBaseType_t head;
+    UBaseType_t count;
+    // Recursive mutex: holder and number of takes
+    uint8_t is_mutex;
+    pthread_t holder;
+    UBaseType_t held;
+};
+
+// Task running on the calling thread
+static __thread TaskHandle_t port_current;
+
+// Scheduler state
+static pthread_mutex_t port_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t port_changed = PTHREAD_COND_INITIALIZER;
+static uint8_t port_started;
+static uint8_t port_ended;
+
+// Origin of the clocks
+static pthread_once_t port_once = PTHREAD_ONCE_INIT;
+static struct timespec port_origin;
+
+// Record the origin of the clocks
+static void port_init_clock(void);
+
+// Nanoseconds since the origin
+static uint64_t port_elapsed_ns(void);
+
+// Initialize a condition variable on the monotonic clock
+static void port_cond_init(pthread_cond_t* cond);
+
+// Wait on a condition variable until a deadline computed from a time-out
+// (nothing to do when the time-out is 0), return 0 on time-out
+static int port_wait(pthread_cond_t* cond, pthread_mutex_t* lock,
+                     TickType_t ticks, const struct timespec* deadline);
+
+// Deadline of a time-out in ticks
+static void port_deadline(TickType_t ticks, struct timespec* deadline);
+
+// Thread of a task
+static void* port_task_entry(void* argument);
+
+uint32_t ulPortGetMicroseconds(void)
+{
+    return (uint32_t)(port_elapsed_ns() / 1000);
+}
+
+BaseType_t xTaskCreate(TaskFunction_t code, const char* name,
+                       configSTACK_DEPTH_TYPE stack_depth, void* parameters,
+                       UBaseType_t priority, TaskHandle_t* created)
+{
+    (void)name;
+    (void)stack_depth;
+    TaskHandle_t task = calloc(1, sizeof(*task));
+    if (task == NULL)
+    {
+        return pdFAIL;
+    }
+    task->code = code;
+    task->parameters = parameters;
+    task->priority = priority;
+    pthread_mutex_init(&task->lock, NULL);
+    port_cond_init(&task->notified);
+    if (pthread_create(&task->thread, NULL, port_task_entry, task) != 0)
+    {
+        free(task);
+        return pdFAIL;
+    }
+    if (created != NULL)
+    {
+        *created = task;
+    }
+    pthread_detach(task->thread);
+    return pdPASS;
+}
+
+void vTaskDelete(TaskHandle_t task)
+{
+    configASSERT((task == NULL) || (task == port_current));
+    pthread_exit(NULL);
+}
+
+void vTaskDelay(TickType_t ticks)
+{
+    struct timespec pause = { ticks / configTICK_RATE_HZ,
+                              (long)(ticks % configTICK_RATE_HZ) * (1000000000L / configTICK_RATE_HZ) };
+    nanosleep(&pause, NULL);
+}
+
+void vPortYield(void)
+{
+    sched_yield();
+}
+
+TickType_t xTaskGetTickCount(void)
+{
+    return (TickType_t)(port_elapsed_ns() / (1000000000ULL / configTICK_RATE_HZ));
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void)
+{
+    return port_current;
+}
+
+BaseType_t xTaskGetSchedulerState(void)
+{
+    pthread_mutex_lock(&port_lock);
+    BaseType_t state = port_started ? taskSCHEDULER_RUNNING : taskSCHEDULER_NOT_STARTED;
+    pthread_mutex_unlock(&port_lock);
+    return state;
+}
+
+void vTaskStartScheduler(void)
+{
+    pthread_mutex_lock(&port_lock);
+    port_started = 1;
+    pthread_cond_broadcast(&port_changed);
+    while (!port_ended)
+    {
+        pthread_cond_wait(&port_changed, &port_lock);
+    }
+    pthread_mutex_unlock(&port_lock);
+}
+
+void vTaskEndScheduler(void)
+{
+    pthread_mutex_lock(&port_lock);
+    port_ended = 1;
+    pthread_cond_broadcast(&port_changed);
+    pthread_mutex_unlock(&port_lock);
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task)
+{
+    pthread_mutex_lock(&task->lock);
+    task->notification++;
+    pthread_cond_signal(&task->notified);
+    pthread_mutex_unlock(&task->lock);
+    return pdPASS;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clear, TickType_t ticks)
+{
+    TaskHandle_t task = port_current;
+    configASSERT(task != NULL);
+    struct timespec deadline;
+    port_deadline(ticks, &deadline);
+    pthread_mutex_lock(&task->lock);
+    while ((task->notification == 0) && port_wait(&task->notified, &task->lock, ticks, &deadline))
+    {
+    }
+    uint32_t count = task->notification;
+    if (count > 0)
+    {
+        task->notification = (clear == pdTRUE) ? 0 : count - 1;
+    }
+    pthread_mutex_unlock(&task->lock);
+    return count;
+}
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t item_size)
+{
+    QueueHandle_t queue = calloc(1, sizeof(*queue));
+    if (queue == NULL)
+    {
+        return NULL;
+    }
+    queue->items = malloc(length * item_size);
+    if ((queue->items == NULL) && (length * item_size > 0))
+    {
+        free(queue);
+        return NULL;
+    }
+    queue->length = length;
+    queue->item_size = item_size;
+    pthread_mutex_init(&queue->lock, NULL);
+    port_cond_init(&queue->not_empty);
+    port_cond_init(&queue->not_full);
+    return queue;
+}
+
+void vQueueDelete(QueueHandle_t queue)
+{
+    pthread_mutex_destroy(&queue->lock);
+    pthread_cond_destroy(&queue->not_empty);
+    pthread_cond_destroy(&queue->not_full);
+    free(queue->items);
+    free(queue);
+}
+
+BaseType_t xQueueSendToBack(QueueHandle_t queue, const void* item, TickType_t ticks)
+{
+    struct timespec deadline;
+    port_deadline(ticks, &deadline);
+    pthread_mutex_lock(&queue->lock);
+    while ((queue->count == queue->length) && port_wait(&queue->not_full, &queue->lock, ticks, &deadline))
+    {
+    }
+    if (queue->count == queue->length)
+    {
+        pthread_mutex_unlock(&queue->lock);
+        return errQUEUE_FULL;
+    }
+    UBaseType_t tail = (queue->head + queue->count) % queue->length;
+    memcpy(queue->items + tail * queue->item_size, item, queue->item_size);
+    queue->count++;
+    pthread_cond_signal(&queue->not_empty);
+    pthread_mutex_unlock(&queue->lock);
+    return pdPASS;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t queue, void* item, TickType_t ticks)
+{
+    struct timespec deadline;
+    port_deadline(ticks, &deadline);
+    pthread_mutex_lock(&queue->lock);
+    while ((queue->count == 0) && port_wait(&queue->not_empty, &queue->lock, ticks, &deadline))
+    {
+    }
+    if (queue->count == 0)
+    {
+        pthread_mutex_unlock(&queue->lock);
+        return errQUEUE_EMPTY;
+    }
+    memcpy(item, queue->items + queue->head * queue->item_size, queue->item_size);
+    queue->head = (queue->head + 1) % queue->length;
+    queue->count--;
+    pthread_cond_signal(&queue->not_full);
+    pthread_mutex_unlock(&queue->lock);
+    return pdPASS;
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue)
+{
+    pthread_mutex_lock(&queue->lock);
+    UBaseType_t count = queue->count;
+    pthread_mutex_unlock(&queue->lock);
+    return count;
+}
+
+UBaseType_t uxQueueSpacesAvailable(QueueHandle_t queue)
+{
+    pthread_mutex_lock(&queue->lock);
+    UBaseType_t spaces = queue->length - queue->count;
+    pthread_mutex_unlock(&queue->lock);
+    return spaces;
+}
+
+SemaphoreHandle_t xSemaphoreCreateRecursiveMutex(void)
+{
+    QueueHandle_t mutex = xQueueCreate(0, 0);
+    if (mutex != NULL)
+    {
+        mutex->is_mutex = 1;
+    }
+    return mutex;
+}
+
+BaseType_t xSemaphoreTakeRecursive(SemaphoreHandle_t mutex, TickType_t ticks)
+{
+    pthread_t self = pthread_self();
+    struct timespec deadline;
+    port_deadline(ticks, &deadline);
+    pthread_mutex_lock(&mutex->lock);
+    if ((mutex->held > 0) && pthread_equal(mutex->holder, self))
+    {
+        mutex->held++;
+        pthread_mutex_unlock(&mutex->lock);
+        return pdPASS;
+    }
+    while ((mutex->held > 0) && port_wait(&mutex->not_full, &mutex->lock, ticks, &deadline))
+    {
+    }
+    if (mutex->held > 0)
+    {
+        pthread_mutex_unlock(&mutex->lock);
+        return pdFAIL;
+    }
+    mutex->holder = self;
+    mutex->held = 1;
+    pthread_mutex_unlock(&mutex->lock);
+    return pdPASS;
+}
+
+BaseType_t xSemaphoreGiveRecursive(SemaphoreHandle_t mutex)
+{
+    pthread_mutex_lock(&mutex->lock);
+    if ((mutex->held == 0) || !pthread_equal(mutex->holder, pthread_self()))
+    {
+        pthread_mutex_unlock(&mutex->lock);
+        return pdFAIL;
+    }
+    if (--mutex->held == 0)
+    {
+        pthread_cond_signal(&mutex->not_full);
+    }
+    pthread_mutex_unlock(&mutex->lock);
+    return pdPASS;
+}
+
+void port_init_clock(void)
+{
+    clock_gettime(CLOCK_MONOTONIC, &port_origin);
+}
+
+uint64_t port_elapsed_ns(void)
+{
+    pthread_once(&port_once, port_init_clock);
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)(now.tv_sec - port_origin.tv_sec) * 1000000000ULL + now.tv_nsec - port_origin.tv_nsec;
+}
+
+void port_cond_init(pthread_cond_t* cond)
+{
+    pthread_condattr_t attributes;
+    pthread_condattr_init(&attributes);
+    pthread_condattr_setclock(&attributes, CLOCK_MONOTONIC);
+    pthread_cond_init(cond, &attributes);
+    pthread_condattr_destroy(&attributes);
+}
+
+void port_deadline(TickType_t ticks, struct timespec* deadline)
+{
+    if ((ticks == 0) || (ticks == portMAX_DELAY))
+    {
+        return;
+    }
+    clock_gettime(CLOCK_MONOTONIC, deadline);
+    uint64_t ns = (uint64_t)ticks * (1000000000ULL / configTICK_RATE_HZ) + deadline->tv_nsec;
+    deadline->tv_sec += ns / 1000000000ULL;
+    deadline->tv_nsec = ns % 1000000000ULL;
+}
+
+int port_wait(pthread_cond_t* cond, pthread_mutex_t* lock,
+              TickType_t ticks, const struct timespec* deadline)
+{
+    if (ticks == 0)
+    {
+        return 0;
+    }
+    if (ticks == portMAX_DELAY)
+    {
+        pthread_cond_wait(cond, lock);
+        return 1;
+    }
+    return pthread_cond_timedwait(cond, lock, deadline) == 0;
+}
+
+void* port_task_entry(void* argument)
+{
+    TaskHandle_t task = argument;
+    port_current = task;
+    pthread_mutex_lock(&port_lock);
+    while (!port_started)
+    {
+        pthread_cond_wait(&port_changed, &port_lock);
+    }
+    pthread_mutex_unlock(&port_lock);
+    task->code(task->parameters);
+    return NULL;
+}
+
+/* [] END OF FILE */
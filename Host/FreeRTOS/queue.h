@@ -0,0 +1,52 @@
+/**
+*   \file queue.h
+*   \brief Queues of the host stand-in for FreeRTOS (see FreeRTOS.h).
+*
+*   \author Davide Marzorati
+*/
+
+#ifndef __FREERTOS_QUEUE_H__
+    #define __FREERTOS_QUEUE_H__
+
+    #ifndef __FREERTOS_H__
+        #error "include FreeRTOS.h before queue.h"
+    #endif
+
+    typedef struct QueueDefinition* QueueHandle_t;
+
+    /**
+    *   \brief Create a queue of items copied by value.
+    */
+    QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t item_size);
+
+    /**
+    *   \brief Delete a queue or a semaphore.
+    */
+    void vQueueDelete(QueueHandle_t queue);
+
+    /**
+    *   \brief Copy an item at the back of a queue.
+    *   \return pdPASS, or errQUEUE_FULL if the queue was still full after the time-out.
+    */
+    BaseType_t xQueueSendToBack(QueueHandle_t queue, const void* item, TickType_t ticks);
+
+    #define xQueueSend(queue, item, ticks) xQueueSendToBack((queue), (item), (ticks))
+
+    /**
+    *   \brief Take the item at the front of a queue.
+    *   \return pdPASS, or errQUEUE_EMPTY if the queue was still empty after the time-out.
+    */
+    BaseType_t xQueueReceive(QueueHandle_t queue, void* item, TickType_t ticks);
+
+    /**
+    *   \brief Number of items in a queue.
+    */
+    UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue);
+
+    /**
+    *   \brief Number of free spaces in a queue.
+    */
+    UBaseType_t uxQueueSpacesAvailable(QueueHandle_t queue);
+
+#endif
+/* [] END OF FILE */
@@ -0,0 +1,35 @@
+/**
+*   \file semphr.h
+*   \brief Mutexes of the host stand-in for FreeRTOS (see FreeRTOS.h).
+*
+*   \author Davide Marzorati
+*/
+
+#ifndef __FREERTOS_SEMPHR_H__
+    #define __FREERTOS_SEMPHR_H__
+
+    #include "queue.h"
+
+    typedef QueueHandle_t SemaphoreHandle_t;
+
+    /**
+    *   \brief Create a mutex that the holder can take again.
+    */
+    SemaphoreHandle_t xSemaphoreCreateRecursiveMutex(void);
+
+    /**
+    *   \brief Take a recursive mutex.
+    *   \return pdPASS, or pdFAIL on time-out.
+    */
+    BaseType_t xSemaphoreTakeRecursive(SemaphoreHandle_t mutex, TickType_t ticks);
+
+    /**
+    *   \brief Give a recursive mutex, once for each time it was taken.
+    *   \return pdPASS, or pdFAIL if the caller does not hold it.
+    */
+    BaseType_t xSemaphoreGiveRecursive(SemaphoreHandle_t mutex);
+
+    #define vSemaphoreDelete(mutex) vQueueDelete((QueueHandle_t)(mutex))
+
+#endif
+/* [] END OF FILE */
@@ -0,0 +1,90 @@
+/**
+*   \file task.h
+*   \brief Task functions of the host stand-in for FreeRTOS (see FreeRTOS.h).
+*
+*   \author Davide Marzorati
+*/
+
+#ifndef __FREERTOS_TASK_H__
+    #define __FREERTOS_TASK_H__
+
+    #ifndef __FREERTOS_H__
+        #error "include FreeRTOS.h before task.h"
+    #endif
+
+    typedef struct tskTaskControlBlock* TaskHandle_t;
+    typedef void (*TaskFunction_t)(void* parameters);
+
+    #define tskIDLE_PRIORITY ((UBaseType_t)0U)
+
+    #define taskSCHEDULER_SUSPENDED ((BaseType_t)0)
+    #define taskSCHEDULER_NOT_STARTED ((BaseType_t)1)
+    #define taskSCHEDULER_RUNNING ((BaseType_t)2)
+
+    /**
+    *   \brief Create a task.
+    *
+    *   Tasks created before #vTaskStartScheduler wait for it before running.
+    */
+    BaseType_t xTaskCreate(TaskFunction_t code, const char* name,
+                           configSTACK_DEPTH_TYPE stack_depth, void* parameters,
+                           UBaseType_t priority, TaskHandle_t* created);
+
+    /**
+    *   \brief Delete a task. Only the calling task (NULL) can be deleted.
+    */
+    void vTaskDelete(TaskHandle_t task);
+
+    /**
+    *   \brief Block the calling task for a number of ticks.
+    */
+    void vTaskDelay(TickType_t ticks);
+
+    /**
+    *   \brief Let the other ready tasks run.
+    */
+    void vPortYield(void);
+    #define taskYIELD() vPortYield()
+
+    /**
+    *   \brief Ticks since the scheduler was started.
+    */
+    TickType_t xTaskGetTickCount(void);
+
+    /**
+    *   \brief Handle of the calling task, NULL outside the tasks.
+    */
+    TaskHandle_t xTaskGetCurrentTaskHandle(void);
+
+    /**
+    *   \brief State of the scheduler, #taskSCHEDULER_NOT_STARTED or #taskSCHEDULER_RUNNING.
+    */
+    BaseType_t xTaskGetSchedulerState(void);
+
+    /**
+    *   \brief Start the tasks. Returns after #vTaskEndScheduler.
+    */
+    void vTaskStartScheduler(void);
+
+    /**
+    *   \brief Make #vTaskStartScheduler return.
+    *
+    *   As on the ports that support it, the tasks are not cleaned up.
+    */
+    void vTaskEndScheduler(void);
+
+    /**
+    *   \brief Increment the notification count of a task.
+    */
+    BaseType_t xTaskNotifyGive(TaskHandle_t task);
+
+    /**
+    *   \brief Wait for the notification count of the calling task to be nonzero.
+    *   \param clear pdTRUE to clear the count, pdFALSE to decrement it.
+    *   \param ticks time-out.
+    *   \return the count before it was cleared or decremented, 0 on time-out.
+    */
+    uint32_t ulTaskNotifyTake(BaseType_t clear, TickType_t ticks);
+
+#endif
+/* [] END OF FILE */
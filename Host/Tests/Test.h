@@ -0,0 +1,56 @@
+/**
+*   \file Test.h
+*   \brief Minimal checks for the host tests.
+*
+*   Each test program runs its checks in order, prints the failed ones
+*   with their location, and returns a nonzero exit code if any failed
+*   (see #TEST_RESULT).
+*
+*   \author Davide Marzorati
+*/
+
+#ifndef __TEST_H__
+    #define __TEST_H__
+
+    #include <stdio.h>
+
+    /**
+    *   \brief Number of failed checks.
+    */
+    static int test_failures;
+
+    /**
+    *   \brief Check a condition.
+    */
+    #define CHECK(condition)                                                   \
+        do {                                                                   \
+            if (!(condition))                                                  \
+            {                                                                  \
+                printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+                test_failures++;                                               \
+            }                                                                  \
+        } while (0)
+
+    /**
+    *   \brief Check that two integers are equal, printing both on failure.
+    */
+    #define CHECK_EQUAL(expected, actual)                                      \
+        do {                                                                   \
+            long long test_expected = (long long)(expected);                   \
+            long long test_actual = (long long)(actual);                       \
+            if (test_expected != test_actual)                                  \
+            {                                                                  \
+                printf("%s:%d: expected %s == %lld, got %lld\n", __FILE__,     \
+                       __LINE__, #actual, test_expected, test_actual);         \
+                test_failures++;                                               \
+            }                                                                  \
+        } while (0)
+
+    /**
+    *   \brief Print the outcome and give the exit code of the test program.
+    */
+    #define TEST_RESULT() \
+        (printf("%s: %s\n", __FILE__, test_failures ? "FAILED" : "passed"), test_failures != 0)
+
+#endif
+/* [] END OF FILE */
@@ -0,0 +1,154 @@
+/**
+*   \brief Test of the aggregator with simulated nodes on pseudo-terminals.
+*
+*   Eight nodes stream interleaved blocks; one loses two blocks, one sends
+*   a corrupted block and one sends garbage between two blocks. The test
+*   checks the per-node statistics, that every valid block reaches the
+*   blocking sink unchanged in spite of its small queue, and that the
+*   dropping sink accounts for every block it did not deliver.
+*/
+
+#include "Aggregator.h"
+#include "SimNode.h"
+#include "Test.h"
+
+#include <string.h>
+#include <time.h>
+
+#define TEST_NODES 8
+#define TEST_BLOCKS 60
+#define TEST_FIRST_ID 100
+
+// Blocks seen by the blocking sink, per node
+static uint32_t sink_blocks[TEST_NODES];
+static uint32_t sink_bad_blocks;
+
+static void pause_us(long us)
+{
+    struct timespec pause = { 0, us * 1000 };
+    nanosleep(&pause, NULL);
+}
+
+static void counting_sink(const FDC_CaptureBlock* block, void* context)
+{
+    (void)context;
+    FDC_CaptureBlock copy = *block;
+    copy.header.crc = 0;
+    if ((block->header.node_id < TEST_FIRST_ID) || (block->header.node_id >= TEST_FIRST_ID + TEST_NODES) ||
+        (FDC_Capture_Crc16((const uint8_t*)&copy, sizeof(copy)) != block->header.crc))
+    {
+        sink_bad_blocks++;
+        return;
+    }
+    sink_blocks[block->header.node_id - TEST_FIRST_ID]++;
+    // Slow consumer, so that the decoders have to wait
+    pause_us(100);
+}
+
+static void slow_sink(const FDC_CaptureBlock* block, void* context)
+{
+    (void)block;
+    (void)context;
+    pause_us(1000);
+}
+
+int main(void)
+{
+    SimNode nodes[TEST_NODES];
+    Aggregator* aggregator = Aggregator_Create(3);
+    CHECK(aggregator != NULL);
+    int blocking = Aggregator_AddSink(aggregator, counting_sink, NULL, 2, AGGREGATOR_SINK_BLOCK);
+    int dropping = Aggregator_AddSink(aggregator, slow_sink, NULL, 1, AGGREGATOR_SINK_DROP);
+    CHECK((blocking == 0) && (dropping == 1));
+    for (uint8_t i = 0; i < TEST_NODES; i++)
+    {
+        CHECK_EQUAL(0, SimNode_Open(&nodes[i], TEST_FIRST_ID + i));
+        CHECK_EQUAL(0, Aggregator_AddPort(aggregator, nodes[i].path, 0));
+    }
+    CHECK_EQUAL(0, Aggregator_Start(aggregator));
+
+    // Interleaved streams with faults on nodes 1, 2 and 3
+    uint32_t framed = 0;
+    for (uint32_t b = 0; b < TEST_BLOCKS; b++)
+    {
+        for (uint8_t i = 0; i < TEST_NODES; i++)
+        {
+            if ((i == 1) && ((b == 10) || (b == 11)))
+            {
+                SimNode_LoseBlock(&nodes[i]);
+                continue;
+            }
+            if ((i == 3) && (b == 20))
+            {
+                CHECK_EQUAL(0, SimNode_SendGarbage(&nodes[i], 300));
+            }
+            CHECK_EQUAL(0, SimNode_SendBlock(&nodes[i], (i == 2) && (b == 5)));
+            framed++;
+        }
+    }
+
+    // Close the nodes once everything was read, then drain
+    Aggregator_Stats stats;
+    for (uint32_t wait = 0; wait < 5000; wait++)
+    {
+        Aggregator_GetStats(aggregator, &stats);
+        if (stats.blocks == framed)
+        {
+            break;
+        }
+        pause_us(1000);
+    }
+    CHECK_EQUAL(framed, stats.blocks);
+    for (uint8_t i = 0; i < TEST_NODES; i++)
+    {
+        SimNode_Close(&nodes[i]);
+    }
+    CHECK_EQUAL(0, Aggregator_WaitIdle(aggregator, 10000));
+    Aggregator_Stop(aggregator);
+
+    Aggregator_GetStats(aggregator, &stats);
+    CHECK_EQUAL(TEST_NODES, stats.nodes);
+    CHECK_EQUAL(0, stats.open_ports);
+    CHECK(stats.skipped_bytes >= 300);
+    uint64_t decoded = 0;
+    for (uint8_t w = 0; w < 3; w++)
+    {
+        decoded += stats.decoded[w];
+    }
+    CHECK_EQUAL(framed, decoded);
+
+    uint32_t valid = 0;
+    for (uint8_t i = 0; i < TEST_NODES; i++)
+    {
+        Aggregator_NodeStats node;
+        CHECK_EQUAL(0, Aggregator_GetNodeStats(aggregator, TEST_FIRST_ID + i, &node));
+        uint32_t expected = TEST_BLOCKS - ((i == 1) ? 2 : 0) - ((i == 2) ? 1 : 0);
+        CHECK_EQUAL(expected, node.blocks);
+        CHECK_EQUAL((uint64_t)expected * FDC_CAPTURE_BLOCK_SAMPLES, node.samples);
+        // The corrupted block is missing from the sequence too
+        CHECK_EQUAL((i == 1) ? 2 : ((i == 2) ? 1 : 0), node.sequence_gaps);
+        CHECK_EQUAL((i == 2) ? 1 : 0, node.crc_errors);
+        CHECK_EQUAL(0, node.first_sequence);
+        CHECK_EQUAL(TEST_BLOCKS - 1, node.last_sequence);
+        CHECK(node.latency_max_ns >= node.latency_p99_ns);
+        CHECK(node.latency_p99_ns > 0);
+        CHECK_EQUAL(expected, sink_blocks[i]);
+        valid += expected;
+    }
+    CHECK_EQUAL(0, sink_bad_blocks);
+
+    // Backpressure kept every block, the dropping sink counted its losses
+    Aggregator_SinkStats sink;
+    CHECK_EQUAL(0, Aggregator_GetSinkStats(aggregator, blocking, &sink));
+    CHECK_EQUAL(valid, sink.delivered);
+    CHECK_EQUAL(0, sink.dropped);
+    CHECK(sink.stalls > 0);
+    CHECK_EQUAL(0, Aggregator_GetSinkStats(aggregator, dropping, &sink));
+    CHECK_EQUAL(valid, sink.delivered + sink.dropped);
+    CHECK(sink.dropped > 0);
+
+    Aggregator_Destroy(aggregator);
+    return TEST_RESULT();
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,127 @@
+/**
+*   \brief Tests of the I2C arbiter and of the driver routed through it.
+*
+*   Deadlines are ordered on the wrapping clock, a deadline at clock value 0
+*   is a deadline like any other, and once the driver is given a priority
+*   its register accesses overtake the lower priority traffic.
+*/
+
+#include "FDC1004Q.h"
+#include "FDC1004Q_Sim.h"
+#include "I2C_Arbiter.h"
+#include "Test.h"
+
+#define TEST_AUX_ADDR 0x54
+
+static uint32_t test_now;
+static uint8_t test_order[8];
+static uint8_t test_completed;
+
+static uint32_t test_clock(void)
+{
+    return test_now;
+}
+
+static void test_record(I2C_Transaction* transaction)
+{
+    test_order[test_completed++] = *(uint8_t*)transaction->context;
+}
+
+static void test_prepare(I2C_Transaction* transaction, uint8_t* id, uint8_t priority,
+                         uint8_t has_deadline, uint32_t deadline, uint8_t* data)
+{
+    transaction->device_address = TEST_AUX_ADDR;
+    transaction->register_address = *id;
+    transaction->register_count = 1;
+    transaction->op = I2C_ARBITER_WRITE;
+    transaction->priority = priority;
+    transaction->data = data;
+    transaction->deadline = deadline;
+    transaction->has_deadline = has_deadline;
+    transaction->callback = test_record;
+    transaction->context = id;
+    transaction->bus = 0;
+}
+
+int main(void)
+{
+    FDC_Sim_Init();
+    CHECK_EQUAL(I2C_NO_ERROR, FDC_Sim_AttachAuxDevice(TEST_AUX_ADDR));
+    CHECK_EQUAL(I2C_ERROR, FDC_Sim_AttachAuxDevice(TEST_AUX_ADDR));
+    CHECK_EQUAL(I2C_ERROR, FDC_Sim_AttachAuxDevice(FDC1004Q_I2C_ADDR));
+    I2C_Arbiter_Init(test_clock);
+
+    // Earliest deadline first across the wrap of the clock, 0 included,
+    // then the transactions without deadline in submission order
+    static uint8_t ids[] = { 0, 1, 2, 3, 4 };
+    uint8_t data = 0x5A;
+    I2C_Transaction transactions[5];
+    test_now = 0xFFFFFF00UL;
+    test_prepare(&transactions[0], &ids[0], I2C_ARBITER_PRIORITY_NORMAL, 0, 0, &data);
+    test_prepare(&transactions[1], &ids[1], I2C_ARBITER_PRIORITY_NORMAL, 1, 0x00000100UL, &data);
+    test_prepare(&transactions[2], &ids[2], I2C_ARBITER_PRIORITY_NORMAL, 1, 0, &data);
+    test_prepare(&transactions[3], &ids[3], I2C_ARBITER_PRIORITY_NORMAL, 1, 0xFFFFFFF0UL, &data);
+    test_prepare(&transactions[4], &ids[4], I2C_ARBITER_PRIORITY_NORMAL, 0, 0, &data);
+    for (uint8_t i = 0; i < 5; i++)
+    {
+        CHECK_EQUAL(I2C_NO_ERROR, I2C_Arbiter_Submit(&transactions[i]));
+    }
+    while (I2C_Arbiter_Process())
+    {
+    }
+    static const uint8_t expected[] = { 3, 2, 1, 0, 4 };
+    CHECK_EQUAL(5, test_completed);
+    for (uint8_t i = 0; i < 5; i++)
+    {
+        CHECK_EQUAL(expected[i], test_order[i]);
+    }
+    I2C_ArbiterStats stats;
+    I2C_Arbiter_GetStats(&stats);
+    CHECK_EQUAL(0, stats.deadline_misses[I2C_ARBITER_PRIORITY_NORMAL]);
+
+    // A deadline at 0 is missed once the clock is past it
+    test_now = 1;
+    test_prepare(&transactions[2], &ids[2], I2C_ARBITER_PRIORITY_NORMAL, 1, 0, &data);
+    CHECK_EQUAL(I2C_NO_ERROR, I2C_Arbiter_Transfer(&transactions[2]));
+    I2C_Arbiter_GetStats(&stats);
+    CHECK_EQUAL(1, stats.deadline_misses[I2C_ARBITER_PRIORITY_NORMAL]);
+
+    // The driver overtakes bulk traffic and waits for higher priority traffic
+    test_completed = 0;
+    test_prepare(&transactions[0], &ids[0], I2C_ARBITER_PRIORITY_BULK, 0, 0, &data);
+    test_prepare(&transactions[1], &ids[1], I2C_ARBITER_PRIORITY_HIGH, 0, 0, &data);
+    I2C_Arbiter_Submit(&transactions[0]);
+    I2C_Arbiter_Submit(&transactions[1]);
+    I2C_Arbiter_GetStats(&stats);
+    uint32_t completed = stats.completed[I2C_ARBITER_PRIORITY_NORMAL];
+    FDC_SetBusPriority(I2C_ARBITER_PRIORITY_NORMAL, 0);
+    uint16_t id = 0;
+    CHECK_EQUAL(FDC_OK, FDC_ReadManufacturerId(&id));
+    CHECK_EQUAL(FDC1004Q_MANUFACTURED_ID_VALUE, id);
+    CHECK_EQUAL(1, test_completed);
+    CHECK_EQUAL(1, test_order[0]);
+    CHECK_EQUAL(1, I2C_Arbiter_Pending());
+    I2C_Arbiter_GetStats(&stats);
+    CHECK_EQUAL(completed + 1, stats.completed[I2C_ARBITER_PRIORITY_NORMAL]);
+
+    // Frames are read one register per transaction
+    FDC_Start();
+    FDC_SetSampleRate(FDC_400_Hz);
+    for (uint8_t ch = 0; ch < 4; ch++)
+    {
+        FDC_ConfigureMeasurementInput(ch, ch, FDC_DISABLED, 0);
+    }
+    FDC_EnableRepeatMeasurement(0xF0);
+    FDC_Sim_AdvanceTime(20000000);
+    FDC_Frame frame;
+    CHECK_EQUAL(FDC_OK, FDC_ReadAllMeasurements(FDC_DONE_CH_ALL, &frame));
+    CHECK_EQUAL(FDC_DONE_CH_ALL, frame.valid);
+    CHECK_EQUAL(1, I2C_Arbiter_Pending());
+    FDC_SetBusPriority(FDC_BUS_DIRECT, 0);
+    CHECK_EQUAL(1, I2C_Arbiter_Process());
+    CHECK_EQUAL(0, test_order[1]);
+
+    return TEST_RESULT();
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,210 @@
+/**
+*   \brief Tests of the pre-trigger burst recorder.
+*
+*   Each trigger source fires on its own: a level crossed upwards after
+*   the ring has wrapped, a level crossed downwards with the CAPDAC
+*   changing on the way, a slope with no post-trigger samples, and an
+*   external request with the longest post-trigger window. The burst sent
+*   out must hold the samples oldest first, with the trigger sample at
+*   #FDC_BurstHeader::trigger_index.
+*/
+
+#include "FDC1004Q_Burst.h"
+#include "Test.h"
+
+#include <string.h>
+
+#define TEST_LEVEL (5L << 19)
+
+// Output of FDC_Burst_SendNext
+static FDC_BurstHeader test_header;
+static FDC_BurstSample test_samples[FDC_BURST_SAMPLES];
+static uint32_t test_writes;
+
+static void test_write(const uint8_t* data, uint16_t length)
+{
+    if (test_writes == 0)
+    {
+        CHECK_EQUAL(sizeof(FDC_BurstHeader), length);
+        memcpy(&test_header, data, sizeof(test_header));
+    }
+    else
+    {
+        CHECK_EQUAL(sizeof(FDC_BurstSample), length);
+        if (test_writes <= FDC_BURST_SAMPLES)
+        {
+            memcpy(&test_samples[test_writes - 1], data, sizeof(FDC_BurstSample));
+        }
+    }
+    test_writes++;
+}
+
+// Add a sample whose channel holds value LSB above the offset of capdac
+static uint8_t test_add(uint32_t timestamp, uint8_t channel, int32_t value, uint8_t capdac)
+{
+    uint32_t raw[FDC_BURST_CHANNELS] = { 0, 0, 0, 0 };
+    uint8_t capdacs[FDC_BURST_CHANNELS] = { 0, 0, 0, 0 };
+    raw[channel] = (uint32_t)value << 8;
+    capdacs[channel] = capdac;
+    return FDC_Burst_AddSample(timestamp, raw, capdacs);
+}
+
+// Send out the burst, checking the number of calls returning more data
+static uint32_t test_send(void)
+{
+    test_writes = 0;
+    uint32_t calls = 1;
+    while (FDC_Burst_SendNext(test_write))
+    {
+        calls++;
+    }
+    CHECK_EQUAL(calls, test_writes);
+    CHECK_EQUAL(FDC_BURST_IDLE, FDC_Burst_GetState());
+    CHECK_EQUAL(0, FDC_Burst_SendNext(test_write));
+    return test_writes - 1;
+}
+
+// The samples follow each other one timestamp apart, the trigger in place
+static void test_check_order(uint32_t first_timestamp)
+{
+    CHECK_EQUAL(FDC_BURST_MAGIC, test_header.magic);
+    CHECK_EQUAL(FDC_BURST_VERSION, test_header.version);
+    for (uint16_t i = 0; i < test_header.sample_count; i++)
+    {
+        CHECK_EQUAL(first_timestamp + i, test_samples[i].timestamp);
+    }
+    CHECK_EQUAL(test_header.trigger_timestamp, test_samples[test_header.trigger_index].timestamp);
+}
+
+int main(void)
+{
+    FDC_BurstTrigger trigger = { FDC_BURST_TRIGGER_ABOVE, FDC_CH_2, TEST_LEVEL, 0 };
+
+    // Settings
+    trigger.channel = 4;
+    CHECK_EQUAL(FDC_CONF_ERR, FDC_Burst_Arm(1, &trigger, 0));
+    trigger.channel = FDC_CH_2;
+    CHECK_EQUAL(FDC_CONF_ERR, FDC_Burst_Arm(1, &trigger, FDC_BURST_SAMPLES));
+    CHECK_EQUAL(FDC_BURST_IDLE, FDC_Burst_GetState());
+    CHECK_EQUAL(0, test_add(0, FDC_CH_2, TEST_LEVEL, 0));
+    CHECK_EQUAL(0, FDC_Burst_SendNext(test_write));
+
+    // Above, the ring wrapped one and a half times before the trigger
+    CHECK_EQUAL(FDC_OK, FDC_Burst_Arm(7, &trigger, 10));
+    CHECK_EQUAL(FDC_BURST_ARMED, FDC_Burst_GetState());
+    uint32_t t = 0;
+    for (; t < FDC_BURST_SAMPLES * 3 / 2; t++)
+    {
+        CHECK_EQUAL(0, test_add(t, FDC_CH_2, TEST_LEVEL - 1 - (int32_t)t, 0));
+    }
+    uint32_t fired = t;
+    CHECK_EQUAL(0, test_add(t++, FDC_CH_2, TEST_LEVEL, 0));
+    CHECK_EQUAL(FDC_BURST_TRIGGERED, FDC_Burst_GetState());
+    for (uint16_t i = 0; i < 9; i++)
+    {
+        CHECK_EQUAL(0, test_add(t++, FDC_CH_2, -TEST_LEVEL, 0));
+    }
+    CHECK_EQUAL(1, test_add(t++, FDC_CH_2, -TEST_LEVEL, 0));
+    CHECK_EQUAL(FDC_BURST_READY, FDC_Burst_GetState());
+    // Frozen until sent out
+    CHECK_EQUAL(0, test_add(t++, FDC_CH_2, TEST_LEVEL, 0));
+    CHECK_EQUAL(FDC_BURST_SAMPLES, test_send());
+    CHECK_EQUAL(7, test_header.node_id);
+    CHECK_EQUAL(FDC_BURST_SAMPLES, test_header.sample_count);
+    CHECK_EQUAL(FDC_BURST_SAMPLES - 11, test_header.trigger_index);
+    CHECK_EQUAL(FDC_BURST_TRIGGER_ABOVE, test_header.trigger_source);
+    CHECK_EQUAL(FDC_CH_2, test_header.trigger_channel);
+    CHECK_EQUAL(fired, test_header.trigger_timestamp);
+    test_check_order(fired + 11 - FDC_BURST_SAMPLES);
+    CHECK_EQUAL(TEST_LEVEL, test_samples[test_header.trigger_index].raw[FDC_CH_2]);
+    CHECK_EQUAL(TEST_LEVEL - 1 - (int32_t)(fired - 1), test_samples[test_header.trigger_index - 1].raw[FDC_CH_2]);
+    CHECK_EQUAL(-TEST_LEVEL, test_samples[FDC_BURST_SAMPLES - 1].raw[FDC_CH_2]);
+
+    // Below, on the capacitance with the CAPDAC offset: the raw value
+    // falling for a CAPDAC step up does not fire the trigger
+    trigger.conditions = FDC_BURST_TRIGGER_BELOW;
+    trigger.channel = FDC_CH_4;
+    trigger.level = TEST_LEVEL + FDC_CAPDAC_FIXED_FACTOR;
+    CHECK_EQUAL(FDC_OK, FDC_Burst_Arm(8, &trigger, 2));
+    t = 100;
+    CHECK_EQUAL(0, test_add(t++, FDC_CH_4, TEST_LEVEL + 1, 1));
+    CHECK_EQUAL(0, test_add(t++, FDC_CH_4, TEST_LEVEL + 1 - FDC_CAPDAC_FIXED_FACTOR, 2));
+    CHECK_EQUAL(FDC_BURST_ARMED, FDC_Burst_GetState());
+    CHECK_EQUAL(0, test_add(t++, FDC_CH_4, TEST_LEVEL - FDC_CAPDAC_FIXED_FACTOR, 2));
+    CHECK_EQUAL(FDC_BURST_TRIGGERED, FDC_Burst_GetState());
+    CHECK_EQUAL(0, test_add(t++, FDC_CH_4, 0, 2));
+    CHECK_EQUAL(1, test_add(t++, FDC_CH_4, 0, 2));
+    CHECK_EQUAL(5, test_send());
+    CHECK_EQUAL(5, test_header.sample_count);
+    CHECK_EQUAL(2, test_header.trigger_index);
+    CHECK_EQUAL(FDC_BURST_TRIGGER_BELOW, test_header.trigger_source);
+    CHECK_EQUAL(FDC_CH_4, test_header.trigger_channel);
+    test_check_order(100);
+    CHECK_EQUAL(1, test_samples[0].capdac[FDC_CH_4]);
+    CHECK_EQUAL(2, test_samples[1].capdac[FDC_CH_4]);
+
+    // Slope, with no post-trigger samples: the trigger sample ends the burst
+    trigger.conditions = FDC_BURST_TRIGGER_SLOPE;
+    trigger.channel = FDC_CH_1;
+    trigger.slope = 1000;
+    CHECK_EQUAL(FDC_OK, FDC_Burst_Arm(9, &trigger, 0));
+    t = 1000;
+    // The first sample has no previous one to compare with
+    CHECK_EQUAL(0, test_add(t++, FDC_CH_1, 5000, 0));
+    for (int32_t i = 1; i <= 20; i++)
+    {
+        CHECK_EQUAL(0, test_add(t++, FDC_CH_1, 5000 + i * 999, 0));
+    }
+    CHECK_EQUAL(1, test_add(t++, FDC_CH_1, 5000 + 20 * 999 - 1000, 0));
+    CHECK_EQUAL(FDC_BURST_READY, FDC_Burst_GetState());
+    CHECK_EQUAL(22, test_send());
+    CHECK_EQUAL(22, test_header.sample_count);
+    CHECK_EQUAL(21, test_header.trigger_index);
+    CHECK_EQUAL(FDC_BURST_TRIGGER_SLOPE, test_header.trigger_source);
+    CHECK_EQUAL(t - 1, test_header.trigger_timestamp);
+    test_check_order(1000);
+
+    // External, with the longest post-trigger window: only the trigger
+    // sample is left of the history
+    trigger.conditions = 0;
+    CHECK_EQUAL(FDC_OK, FDC_Burst_Arm(10, &trigger, FDC_BURST_SAMPLES - 1));
+    t = 5000;
+    for (uint16_t i = 0; i < 50; i++)
+    {
+        CHECK_EQUAL(0, test_add(t++, FDC_CH_1, TEST_LEVEL * 2, 0));
+    }
+    CHECK_EQUAL(FDC_BURST_ARMED, FDC_Burst_GetState());
+    FDC_Burst_Trigger();
+    fired = t;
+    CHECK_EQUAL(0, test_add(t++, FDC_CH_1, 0, 0));
+    CHECK_EQUAL(FDC_BURST_TRIGGERED, FDC_Burst_GetState());
+    for (uint16_t i = 0; i < FDC_BURST_SAMPLES - 2; i++)
+    {
+        CHECK_EQUAL(0, test_add(t++, FDC_CH_1, 0, 0));
+    }
+    CHECK_EQUAL(1, test_add(t++, FDC_CH_1, 0, 0));
+    CHECK_EQUAL(FDC_BURST_SAMPLES, test_send());
+    CHECK_EQUAL(0, test_header.trigger_index);
+    CHECK_EQUAL(FDC_BURST_TRIGGER_EXTERNAL, test_header.trigger_source);
+    CHECK_EQUAL(fired, test_header.trigger_timestamp);
+    test_check_order(fired);
+
+    // Disarm drops the burst, arming again discards the one not sent
+    CHECK_EQUAL(FDC_OK, FDC_Burst_Arm(11, &trigger, 5));
+    FDC_Burst_Trigger();
+    CHECK_EQUAL(0, test_add(0, FDC_CH_1, 0, 0));
+    FDC_Burst_Disarm();
+    CHECK_EQUAL(FDC_BURST_IDLE, FDC_Burst_GetState());
+    CHECK_EQUAL(0, test_add(1, FDC_CH_1, 0, 0));
+    CHECK_EQUAL(0, FDC_Burst_SendNext(test_write));
+    CHECK_EQUAL(FDC_OK, FDC_Burst_Arm(12, &trigger, 0));
+    FDC_Burst_Trigger();
+    CHECK_EQUAL(1, test_add(0, FDC_CH_1, 0, 0));
+    CHECK_EQUAL(FDC_OK, FDC_Burst_Arm(12, &trigger, 0));
+    CHECK_EQUAL(FDC_BURST_ARMED, FDC_Burst_GetState());
+    CHECK_EQUAL(0, FDC_Burst_SendNext(test_write));
+
+    return TEST_RESULT();
+}
+
+/* [] END OF FILE */
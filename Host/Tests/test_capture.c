@@ -0,0 +1,171 @@
+/**
+*   \brief Tests of the capture recorder and of the host capture reader.
+*
+*   A capture of two channels is recorded to a file, mapped back and
+*   queried: the samples must come back unchanged, with the CRC of every
+*   block valid. Time ranges starting and ending inside blocks, empty
+*   ranges and channels not recorded are queried, then blocks of a copy
+*   of the file are damaged: a wrong magic is always skipped, a wrong
+*   sample only when the CRC is checked.
+*/
+
+#include "CaptureFile.h"
+#include "Test.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// Samples recorded, the last block is flushed partially filled
+#define TEST_SAMPLES (20 * FDC_CAPTURE_BLOCK_SAMPLES + 7)
+#define TEST_START 1000
+#define TEST_PERIOD 10
+
+static FILE* test_file;
+
+// Samples received by the query
+static uint32_t test_count[4];
+static uint32_t test_next[4];
+static uint32_t test_errors;
+
+static void test_write(const uint8_t* data, uint16_t length)
+{
+    fwrite(data, 1, length, test_file);
+}
+
+static int32_t test_raw(uint32_t index, uint8_t channel)
+{
+    return (int32_t)(index * 7) + channel * 1000 - 300;
+}
+
+static void test_collect(uint8_t channel, const uint32_t* timestamp, const int32_t* raw,
+                         const uint8_t* capdac, uint8_t count, void* context)
+{
+    (void)context;
+    for (uint8_t i = 0; i < count; i++)
+    {
+        uint32_t index = (timestamp[i] - TEST_START) / TEST_PERIOD;
+        // In order and without gaps, across the blocks
+        if ((test_count[channel] > 0) && (index != test_next[channel]))
+        {
+            test_errors++;
+        }
+        if ((raw[i] != test_raw(index, channel)) || (capdac[i] != index % 32))
+        {
+            test_errors++;
+        }
+        test_next[channel] = index + 1;
+        test_count[channel]++;
+    }
+}
+
+static CaptureFile_QueryStats test_query(const CaptureFile* file, uint32_t from, uint32_t to,
+                                         uint8_t mask, uint8_t verify)
+{
+    memset(test_count, 0, sizeof(test_count));
+    test_errors = 0;
+    CaptureFile_QueryStats stats;
+    CaptureFile_Query(file, from, to, mask, verify, test_collect, NULL, &stats);
+    return stats;
+}
+
+int main(void)
+{
+    // CRC-16/CCITT-FALSE check value
+    CHECK_EQUAL(0x29B1, FDC_Capture_Crc16((const uint8_t*)"123456789", 9));
+
+    char path[] = "/tmp/test_captureXXXXXX";
+    int fd = mkstemp(path);
+    CHECK(fd >= 0);
+    test_file = fdopen(fd, "wb");
+    FDC_Capture_Start(7, FDC_RP_CH_1 | FDC_RP_CH_3, test_write);
+    for (uint32_t i = 0; i < TEST_SAMPLES; i++)
+    {
+        uint32_t capacitance[4];
+        uint8_t capdac[4];
+        for (uint8_t ch = 0; ch < 4; ch++)
+        {
+            capacitance[ch] = (uint32_t)test_raw(i, ch) << 8;
+            capdac[ch] = i % 32;
+        }
+        FDC_Capture_AddSample(TEST_START + i * TEST_PERIOD, capacitance, capdac);
+    }
+    FDC_Capture_Flush();
+    fclose(test_file);
+
+    CaptureFile file;
+    CHECK_EQUAL(0, CaptureFile_Open(&file, path));
+    CHECK_EQUAL(21, file.block_count);
+    for (size_t b = 0; b < file.block_count; b++)
+    {
+        CHECK_EQUAL(1, CaptureFile_IsValid(&file.blocks[b]));
+        CHECK_EQUAL(b, file.blocks[b].header.sequence);
+        CHECK_EQUAL(7, file.blocks[b].header.node_id);
+    }
+    CHECK_EQUAL(7, file.blocks[20].header.sample_count);
+
+    // Index
+    CHECK_EQUAL(0, CaptureFile_Seek(&file, 0));
+    CHECK_EQUAL(0, CaptureFile_Seek(&file, TEST_START + 31 * TEST_PERIOD));
+    CHECK_EQUAL(1, CaptureFile_Seek(&file, TEST_START + 31 * TEST_PERIOD + 1));
+    CHECK_EQUAL(20, CaptureFile_Seek(&file, TEST_START + (TEST_SAMPLES - 1) * TEST_PERIOD));
+    CHECK_EQUAL(21, CaptureFile_Seek(&file, TEST_START + TEST_SAMPLES * TEST_PERIOD));
+
+    // Whole file, CH2 was not recorded
+    CaptureFile_QueryStats stats = test_query(&file, 0, UINT32_MAX, 0xF0, 1);
+    CHECK_EQUAL(21, stats.blocks);
+    CHECK_EQUAL(2 * TEST_SAMPLES, stats.samples);
+    CHECK_EQUAL(0, stats.invalid_blocks);
+    CHECK_EQUAL(TEST_SAMPLES, test_count[FDC_CH_1]);
+    CHECK_EQUAL(0, test_count[FDC_CH_2]);
+    CHECK_EQUAL(TEST_SAMPLES, test_count[FDC_CH_3]);
+    CHECK_EQUAL(0, test_errors);
+
+    // From the middle of block 2 to the middle of block 5, on CH3
+    stats = test_query(&file, TEST_START + 70 * TEST_PERIOD, TEST_START + 170 * TEST_PERIOD, FDC_RP_CH_3, 1);
+    CHECK_EQUAL(4, stats.blocks);
+    CHECK_EQUAL(101, test_count[FDC_CH_3]);
+    CHECK_EQUAL(171, test_next[FDC_CH_3]);
+    CHECK_EQUAL(0, test_count[FDC_CH_1]);
+    CHECK_EQUAL(0, test_errors);
+
+    // Between two samples, and past the end
+    stats = test_query(&file, TEST_START + 5, TEST_START + 8, 0xF0, 1);
+    CHECK_EQUAL(0, stats.samples);
+    stats = test_query(&file, TEST_START + TEST_SAMPLES * TEST_PERIOD, UINT32_MAX, 0xF0, 1);
+    CHECK_EQUAL(0, stats.blocks);
+    CaptureFile_Close(&file);
+
+    // Damaged copy: a sample in block 3, the magic of block 5
+    FILE* copy = fopen(path, "r+b");
+    fseek(copy, 3 * sizeof(FDC_CaptureBlock) + offsetof(FDC_CaptureBlock, raw) + 8, SEEK_SET);
+    fputc(0x55, copy);
+    fseek(copy, 5 * sizeof(FDC_CaptureBlock), SEEK_SET);
+    fputc(0x00, copy);
+    fclose(copy);
+    CHECK_EQUAL(0, CaptureFile_Open(&file, path));
+    CHECK_EQUAL(0, CaptureFile_IsValid(&file.blocks[3]));
+    stats = test_query(&file, 0, UINT32_MAX, FDC_RP_CH_1, 0);
+    CHECK_EQUAL(1, stats.invalid_blocks);
+    CHECK_EQUAL(TEST_SAMPLES - 32, test_count[FDC_CH_1]);
+    stats = test_query(&file, 0, UINT32_MAX, FDC_RP_CH_1, 1);
+    CHECK_EQUAL(2, stats.invalid_blocks);
+    CHECK_EQUAL(TEST_SAMPLES - 64, test_count[FDC_CH_1]);
+    CaptureFile_Close(&file);
+
+    // Empty and missing files
+    test_file = fopen(path, "wb");
+    fclose(test_file);
+    CHECK_EQUAL(0, CaptureFile_Open(&file, path));
+    CHECK_EQUAL(0, file.block_count);
+    stats = test_query(&file, 0, UINT32_MAX, 0xF0, 1);
+    CHECK_EQUAL(0, stats.blocks);
+    CaptureFile_Close(&file);
+    unlink(path);
+    CHECK_EQUAL(-1, CaptureFile_Open(&file, path));
+
+    return TEST_RESULT();
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,85 @@
+/**
+*   \brief Tests of the raw measurement conversions.
+*
+*   Over the whole 24-bit range, with every CAPDAC setting in turn and
+*   garbage in the unused low byte, the conversions must give the same
+*   bits as the conversion of the driver before the batch functions:
+*   #FDC_ConvertRawMeasurement the same double, #FDC_ConvertRawMeasurements
+*   that double rounded to float, #FDC_ConvertRawMeasurementsFixed that
+*   double exactly once scaled by 2^19.
+*/
+
+#include "FDC1004Q.h"
+#include "Test.h"
+
+#include <string.h>
+
+#define TEST_BATCH 4096
+
+// Conversion of the driver before the batch functions
+static double test_old_conversion(uint32_t capacitance, uint8_t capdac)
+{
+    double temp_cap = (double)(capacitance >> 8);
+    if (temp_cap > ( (1 << 23) -1))
+    {
+        temp_cap -= ( 1 << 24);
+    }
+    temp_cap /= (2<<18);
+    return temp_cap + capdac * FDC_CAPDAC_FACTOR;
+}
+
+int main(void)
+{
+    static uint32_t raw[TEST_BATCH];
+    static uint8_t capdac[TEST_BATCH];
+    static float converted[TEST_BATCH];
+    static float converted_no_capdac[TEST_BATCH];
+    static int32_t fixed[TEST_BATCH];
+    static int32_t fixed_no_capdac[TEST_BATCH];
+    uint32_t scalar_errors = 0;
+    uint32_t float_errors = 0;
+    uint32_t fixed_errors = 0;
+
+    for (uint32_t value = 0; value < (1UL << 24); value += TEST_BATCH)
+    {
+        for (uint16_t i = 0; i < TEST_BATCH; i++)
+        {
+            raw[i] = ((value + i) << 8) | ((value + i * 37) & 0xFF);
+            capdac[i] = (value / TEST_BATCH + i) % (FDC_CAPDAC_MAX + 1);
+        }
+        FDC_ConvertRawMeasurements(raw, capdac, converted, TEST_BATCH);
+        FDC_ConvertRawMeasurements(raw, NULL, converted_no_capdac, TEST_BATCH);
+        FDC_ConvertRawMeasurementsFixed(raw, capdac, fixed, TEST_BATCH);
+        FDC_ConvertRawMeasurementsFixed(raw, NULL, fixed_no_capdac, TEST_BATCH);
+        for (uint16_t i = 0; i < TEST_BATCH; i++)
+        {
+            double expected = test_old_conversion(raw[i], capdac[i]);
+            double expected_no_capdac = test_old_conversion(raw[i], 0);
+            double scalar = FDC_ConvertRawMeasurement(raw[i]);
+            float expected_float = (float)expected;
+            float expected_float_no_capdac = (float)expected_no_capdac;
+            scalar_errors += memcmp(&scalar, &expected_no_capdac, sizeof(double)) != 0;
+            float_errors += memcmp(&converted[i], &expected_float, sizeof(float)) != 0;
+            float_errors += memcmp(&converted_no_capdac[i], &expected_float_no_capdac, sizeof(float)) != 0;
+            fixed_errors += (fixed[i] / 524288.0) != expected;
+            fixed_errors += (fixed_no_capdac[i] / 524288.0) != expected_no_capdac;
+        }
+    }
+    CHECK_EQUAL(0, scalar_errors);
+    CHECK_EQUAL(0, float_errors);
+    CHECK_EQUAL(0, fixed_errors);
+
+    // Range ends
+    raw[0] = 0x7FFFFF00;
+    raw[1] = 0x80000000;
+    capdac[0] = FDC_CAPDAC_MAX;
+    capdac[1] = 0;
+    FDC_ConvertRawMeasurementsFixed(raw, capdac, fixed, 2);
+    CHECK_EQUAL(0x7FFFFF + FDC_CAPDAC_MAX * FDC_CAPDAC_FIXED_FACTOR, fixed[0]);
+    CHECK_EQUAL(-0x800000, fixed[1]);
+    CHECK(FDC_ConvertRawMeasurement(raw[1]) == -16.0);
+
+    return TEST_RESULT();
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,154 @@
+/**
+*   \brief Tests of the Linux i2c-dev backend of the I2C interface.
+*
+*   The firmware is built with I2C_INTERFACE_LINUX defined, and the ioctl
+*   calls are answered by the simulator through #I2C_Linux_SetIoctl, with
+*   /dev/null as the adapter. Each register access must be a single
+*   I2C_RDWR call, the register pointer and the data separated by a
+*   repeated start, and the measurements of a frame must be read with a
+*   single call.
+*/
+
+#include "FDC1004Q.h"
+#include "FDC1004Q_Sim.h"
+#include "Test.h"
+
+#include <errno.h>
+#include <linux/i2c.h>
+#include <linux/i2c-dev.h>
+
+// Messages of the last call
+#define TEST_MAX_MESSAGES 64
+static struct i2c_msg test_messages[TEST_MAX_MESSAGES];
+static uint8_t test_pointers[TEST_MAX_MESSAGES];
+static uint32_t test_calls;
+static uint32_t test_count;
+static uint8_t test_fail;
+
+// Emulate the adapter on top of the simulator
+static int test_ioctl(int fd, unsigned long request, void* arg)
+{
+    (void)fd;
+    test_calls++;
+    if ((request != I2C_RDWR) || test_fail)
+    {
+        errno = EREMOTEIO;
+        return -1;
+    }
+    const struct i2c_rdwr_ioctl_data* transfer = arg;
+    test_count = transfer->nmsgs;
+    for (uint32_t i = 0; (i < transfer->nmsgs) && (i < TEST_MAX_MESSAGES); i++)
+    {
+        test_messages[i] = transfer->msgs[i];
+        test_pointers[i] = (transfer->msgs[i].len > 0) ? transfer->msgs[i].buf[0] : 0;
+    }
+    for (uint32_t i = 0; i < transfer->nmsgs; i++)
+    {
+        const struct i2c_msg* message = &transfer->msgs[i];
+        I2C_ErrorCode error;
+        if (message->len == 0)
+        {
+            // Address only
+            error = (message->addr == FDC1004Q_I2C_ADDR) ? I2C_NO_ERROR : I2C_ERROR;
+        }
+        else if ((i + 1 < transfer->nmsgs) && (message->len == 1) && (transfer->msgs[i + 1].flags & I2C_M_RD))
+        {
+            // Pointer, repeated start, data
+            error = FDC_Sim_Read(message->addr, message->buf[0], transfer->msgs[i + 1].len, 
+                                 transfer->msgs[i + 1].buf);
+            i++;
+        }
+        else
+        {
+            error = FDC_Sim_Write(message->addr, message->buf[0], message->len - 1, &message->buf[1]);
+        }
+        if (error != I2C_NO_ERROR)
+        {
+            errno = ENXIO;
+            return -1;
+        }
+    }
+    return transfer->nmsgs;
+}
+
+int main(void)
+{
+    // Not started
+    uint8_t data[2];
+    CHECK_EQUAL(I2C_ERROR, I2C_Peripheral_ReadRegisterMulti(FDC1004Q_I2C_ADDR, FDC1004Q_DEVICE_ID, 2, data));
+
+    FDC_Sim_Init();
+    I2C_Linux_SetDevice("/dev/null");
+    I2C_Linux_SetIoctl(test_ioctl);
+    CHECK_EQUAL(FDC_OK, FDC_Start());
+
+    // Register read: pointer, then 2 bytes after a repeated start
+    test_calls = 0;
+    CHECK_EQUAL(FDC_OK, FDC_ReadRegister(FDC1004Q_MANUFACTURER_ID, data));
+    CHECK_EQUAL(FDC1004Q_MANUFACTURED_ID_VALUE, data[0] << 8 | data[1]);
+    CHECK_EQUAL(1, test_calls);
+    CHECK_EQUAL(2, test_count);
+    CHECK_EQUAL(FDC1004Q_I2C_ADDR, test_messages[0].addr);
+    CHECK_EQUAL(0, test_messages[0].flags);
+    CHECK_EQUAL(1, test_messages[0].len);
+    CHECK_EQUAL(FDC1004Q_MANUFACTURER_ID, test_pointers[0]);
+    CHECK_EQUAL(I2C_M_RD, test_messages[1].flags);
+    CHECK_EQUAL(2, test_messages[1].len);
+
+    // Register write: pointer and data in one message
+    test_calls = 0;
+    uint8_t conf[2] = { 0x05, 0x80 };
+    CHECK_EQUAL(FDC_OK, FDC_WriteRegister(FDC1004Q_FDC_CONF, conf));
+    CHECK_EQUAL(1, test_calls);
+    CHECK_EQUAL(1, test_count);
+    CHECK_EQUAL(3, test_messages[0].len);
+    CHECK_EQUAL(FDC1004Q_FDC_CONF, test_pointers[0]);
+    CHECK_EQUAL(FDC_OK, FDC_ReadRegister(FDC1004Q_FDC_CONF, data));
+    CHECK_EQUAL(0x0580, (data[0] << 8 | data[1]) & 0xFFF0);
+
+    // A frame of four channels: FDC_CONF, then the eight halves in one call
+    for (uint8_t ch = FDC_CH_1; ch <= FDC_CH_4; ch++)
+    {
+        FDC_Sim_SetCapacitance(ch, 1000000 * (ch + 1));
+        CHECK_EQUAL(FDC_OK, FDC_ConfigureMeasurementInput(ch, ch, FDC_DISABLED, 0));
+    }
+    CHECK_EQUAL(FDC_OK, FDC_SetSampleRate(FDC_400_Hz));
+    CHECK_EQUAL(FDC_OK, FDC_EnableRepeatMeasurement(0xF0));
+    // Two frame periods, all the channels are done
+    FDC_Sim_AdvanceTime(2 * 4 * 2500000ULL);
+    test_calls = 0;
+    FDC_Frame frame;
+    CHECK_EQUAL(FDC_OK, FDC_ReadAllMeasurements(FDC_DONE_CH_ALL, &frame));
+    CHECK_EQUAL(FDC_DONE_CH_ALL, frame.valid);
+    CHECK_EQUAL(2, test_calls);
+    CHECK_EQUAL(16, test_count);
+    for (uint8_t i = 0; i < 8; i++)
+    {
+        CHECK_EQUAL(1, test_messages[2*i].len);
+        CHECK_EQUAL(FDC1004Q_MEAS1_MSB + i, test_pointers[2*i]);
+        CHECK_EQUAL(I2C_M_RD, test_messages[2*i + 1].flags);
+        CHECK_EQUAL(2, test_messages[2*i + 1].len);
+    }
+    // 1 pF per input, in units of 2^-19 pF
+    for (uint8_t ch = FDC_CH_1; ch <= FDC_CH_4; ch++)
+    {
+        int32_t pf = ((int32_t)frame.capacitance[ch] >> 8) >> 19;
+        CHECK_EQUAL(ch + 1, pf);
+    }
+
+    // Failed calls and a missing device
+    test_fail = 1;
+    CHECK_EQUAL(FDC_COMM_ERR, FDC_ReadRegister(FDC1004Q_DEVICE_ID, data));
+    test_fail = 0;
+    I2C_Connection connection;
+    CHECK_EQUAL(I2C_ERROR, I2C_Peripheral_IsDeviceConnected(0x51, &connection));
+    CHECK_EQUAL(I2C_DEV_UNCONNECTED, connection);
+    CHECK_EQUAL(I2C_NO_ERROR, I2C_Peripheral_IsDeviceConnected(FDC1004Q_I2C_ADDR, &connection));
+    CHECK_EQUAL(I2C_DEV_CONNECTED, connection);
+
+    FDC_Stop();
+    CHECK_EQUAL(I2C_ERROR, I2C_Peripheral_ReadRegisterMulti(FDC1004Q_I2C_ADDR, FDC1004Q_DEVICE_ID, 2, data));
+    return TEST_RESULT();
+}
+
+/* [] END OF FILE */
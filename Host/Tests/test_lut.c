@@ -0,0 +1,89 @@
+/**
+*   \brief Tests of the lookup tables.
+*
+*   Evenly spaced and irregular tables are compared with a floating point
+*   interpolation over the whole input range, invalid tables must be
+*   rejected, and channels without a table return their input.
+*/
+
+#include "Lut.h"
+#include "Test.h"
+
+#define TEST_POINTS 5
+
+// Largest difference from the exact interpolation (output units)
+static double test_max_error(uint8_t channel, const int32_t* input, const int32_t* output)
+{
+    double max_error = 0;
+    for (int32_t value = -100000; value < 5000000; value += 777)
+    {
+        double expected;
+        if (value <= input[0])
+        {
+            expected = output[0];
+        }
+        else if (value >= input[TEST_POINTS - 1])
+        {
+            expected = output[TEST_POINTS - 1];
+        }
+        else
+        {
+            uint8_t i = 0;
+            while (input[i + 1] <= value)
+            {
+                i++;
+            }
+            expected = output[i] + (double)(value - input[i]) * (output[i + 1] - output[i]) /
+                                   (input[i + 1] - input[i]);
+        }
+        double error = Lut_Convert(channel, value) - expected;
+        error = (error < 0) ? -error : error;
+        max_error = (error > max_error) ? error : max_error;
+    }
+    return max_error;
+}
+
+int main(void)
+{
+    static const int32_t uniform[TEST_POINTS] = { 0, 1 << 20, 2 << 20, 3 << 20, 4 << 20 };
+    static const int32_t irregular[TEST_POINTS] = { 0, 1000000, 2500000, 3000000, 4194304 };
+    static const int32_t output[TEST_POINTS] = { 0, 1000, 1500, 1700, 1750 };
+    CHECK_EQUAL(FDC_OK, Lut_Load(FDC_CH_1, uniform, output, TEST_POINTS));
+    CHECK_EQUAL(FDC_OK, Lut_Load(FDC_CH_2, irregular, output, TEST_POINTS));
+
+    // Inputs not strictly increasing, outputs not monotonic, too few points
+    static const int32_t repeated[3] = { 0, 5, 5 };
+    static const int32_t not_monotonic[3] = { 0, 5, 3 };
+    CHECK_EQUAL(FDC_CONF_ERR, Lut_Load(FDC_CH_3, repeated, output, 3));
+    CHECK_EQUAL(FDC_CONF_ERR, Lut_Load(FDC_CH_3, uniform, not_monotonic, 3));
+    CHECK_EQUAL(FDC_CONF_ERR, Lut_Load(FDC_CH_3, uniform, output, 1));
+
+    // Breakpoints are exact. The interpolation is rounded down, so it is
+    // within one unit, plus the truncation of the slope
+    for (uint8_t i = 0; i < TEST_POINTS; i++)
+    {
+        CHECK_EQUAL(output[i], Lut_Convert(FDC_CH_1, uniform[i]));
+        CHECK_EQUAL(output[i], Lut_Convert(FDC_CH_2, irregular[i]));
+    }
+    CHECK(test_max_error(FDC_CH_1, uniform, output) <= 1.001);
+    CHECK(test_max_error(FDC_CH_2, irregular, output) <= 1.001);
+
+    // Channels without a table
+    CHECK_EQUAL(12345, Lut_Convert(FDC_CH_4, 12345));
+    Lut_Clear(FDC_CH_1);
+    CHECK_EQUAL(-5, Lut_Convert(FDC_CH_1, -5));
+
+    // Frames
+    CHECK_EQUAL(FDC_OK, Lut_Load(FDC_CH_1, uniform, output, TEST_POINTS));
+    int32_t frame[4] = { 1 << 19, 1000000, 7, -7 };
+    int32_t result[4];
+    Lut_ConvertFrame(frame, result);
+    CHECK_EQUAL(500, result[0]);
+    CHECK_EQUAL(1000, result[1]);
+    CHECK_EQUAL(7, result[2]);
+    CHECK_EQUAL(-7, result[3]);
+
+    return TEST_RESULT();
+}
+
+/* [] END OF FILE */
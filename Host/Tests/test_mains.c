@@ -0,0 +1,100 @@
+/**
+*   \brief Tests of the mains interference stage with synthetic interference.
+*
+*   The first three channels carry a constant plus harmonics of the mains
+*   frequency, the fourth the constant alone. The tones must be measured
+*   at their aliased frequencies, and removed by the notches when enabled
+*   while the clean channel is left untouched.
+*/
+
+#include "Mains.h"
+#include "Test.h"
+
+#include <math.h>
+
+#define TEST_LEVEL 100000
+#define TEST_SAMPLES 4000
+
+// Process the samples, return the rms interference left on the first
+// channel over the second half
+static double test_run(uint16_t mains_frequency, uint16_t rate, uint8_t harmonics,
+                       const double* amplitude, uint8_t mode)
+{
+    Mains_Config config = { mains_frequency, rate, harmonics, rate, 2, 50UL << MAINS_FRACT_BITS };
+    CHECK_EQUAL(FDC_OK, Mains_Configure(&config));
+    CHECK_EQUAL(FDC_OK, Mains_SetMode(mode));
+    double squares = 0;
+    uint8_t clean = 1;
+    for (uint32_t i = 0; i < TEST_SAMPLES; i++)
+    {
+        double x = TEST_LEVEL;
+        for (uint8_t h = 0; h < harmonics; h++)
+        {
+            x += amplitude[h] * sin(6.283185307179586 * (h + 1) * mains_frequency * i / rate + 0.3 * h + 0.7);
+        }
+        int32_t sample = (int32_t)lround(x);
+        int32_t frame[MAINS_CHANNELS] = { sample, sample, sample, TEST_LEVEL };
+        int32_t result[MAINS_CHANNELS];
+        Mains_ProcessFrame(frame, result);
+        clean &= (result[3] == TEST_LEVEL);
+        if (i >= TEST_SAMPLES / 2)
+        {
+            squares += (result[0] - (double)TEST_LEVEL) * (result[0] - TEST_LEVEL);
+        }
+    }
+    CHECK(clean);
+    return sqrt(squares / (TEST_SAMPLES / 2));
+}
+
+// Check the amplitude of a tone within 1%
+static void test_tone(uint8_t harmonic, uint16_t frequency, double amplitude, uint8_t notch)
+{
+    Mains_Tone tone;
+    CHECK_EQUAL(FDC_OK, Mains_GetTone(0, harmonic, &tone));
+    CHECK_EQUAL(frequency, tone.frequency);
+    CHECK(fabs(tone.amplitude / (double)(1 << MAINS_FRACT_BITS) - amplitude) < amplitude / 100);
+    CHECK_EQUAL(notch, tone.notch);
+}
+
+int main(void)
+{
+    static const double harmonics[3] = { 1000, 300, 100 };
+
+    // 50 Hz at 400 S/s: measured and passed through, then removed
+    double rms = test_run(50, 400, 3, harmonics, MAINS_MONITOR);
+    CHECK(rms > 700);
+    test_tone(0, 50, 1000, 0);
+    test_tone(1, 100, 300, 0);
+    test_tone(2, 150, 100, 0);
+    CHECK(test_run(50, 400, 3, harmonics, MAINS_NOTCH) < 1);
+    test_tone(0, 50, 1000, 1);
+
+    // 60 Hz at 100 S/s: 60 and 120 Hz alias to 40 and 20 Hz, 180 Hz to
+    // 20 Hz again and is skipped
+    CHECK(test_run(60, 100, 3, harmonics, MAINS_NOTCH) < 1);
+    test_tone(0, 40, 1000, 1);
+    Mains_Tone tone;
+    CHECK_EQUAL(FDC_OK, Mains_GetTone(0, 1, &tone));
+    CHECK_EQUAL(20, tone.frequency);
+    CHECK(Mains_GetTone(0, 2, &tone) != FDC_OK);
+
+    // Rate that is not a multiple of the mains frequency
+    static const double single[1] = { 500 };
+    CHECK(test_run(50, 97, 1, single, MAINS_NOTCH) < 1);
+    test_tone(0, 47, 500, 1);
+
+    // Automatic notch, threshold at 50 LSB
+    static const double weak[1] = { 20 };
+    CHECK(test_run(50, 400, 1, weak, MAINS_AUTO) > 10);
+    test_tone(0, 50, 20, 0);
+    CHECK(test_run(50, 400, 1, single, MAINS_AUTO) < 1);
+    test_tone(0, 50, 500, 1);
+
+    // Not a mains frequency
+    Mains_Config bad = { 55, 400, 3, 400, 2, 0 };
+    CHECK_EQUAL(FDC_CONF_ERR, Mains_Configure(&bad));
+
+    return TEST_RESULT();
+}
+
+/* [] END OF FILE */
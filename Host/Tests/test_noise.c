@@ -0,0 +1,140 @@
+/**
+*   \brief Tests of the streaming noise characterisation.
+*
+*   Known signals go through the accumulator: white noise, whose Allan
+*   deviation falls as the square root of the averaging time from the RMS
+*   noise, a constant, a linear drift, whose Allan deviation grows with the
+*   averaging time, and a change of CAPDAC, which starts the accumulator
+*   again.
+*/
+
+#include "Noise.h"
+#include "Test.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define TEST_SAMPLES (1UL << 20)
+// RMS of the white noise (LSB)
+#define TEST_SIGMA 1000.0
+
+static uint64_t test_seed = 1;
+
+// Uniform in (0, 1)
+static double test_uniform(void)
+{
+    test_seed ^= test_seed << 13;
+    test_seed ^= test_seed >> 7;
+    test_seed ^= test_seed << 17;
+    return ((test_seed >> 11) + 0.5) / 9007199254740992.0;
+}
+
+// Normal with zero mean and unit variance (Box-Muller)
+static double test_normal(void)
+{
+    return sqrt(-2 * log(test_uniform())) * cos(2 * M_PI * test_uniform());
+}
+
+// Fixed point result to LSB
+static double test_lsb(uint32_t value)
+{
+    return value / (double)(1 << NOISE_FRACT_BITS);
+}
+
+int main(void)
+{
+    static Noise_State state;
+    Noise_Summary summary;
+    uint32_t deviation;
+
+    // Not enough samples
+    Noise_Init(&state);
+    CHECK_EQUAL(FDC_MEAS_NOT_DONE, Noise_GetSummary(&state, &summary));
+    CHECK_EQUAL(FDC_MEAS_NOT_DONE, Noise_GetAllanDeviation(&state, 0, &deviation));
+    CHECK_EQUAL(FDC_CONF_ERR, Noise_GetAllanDeviation(&state, NOISE_OCTAVES, &deviation));
+
+    // White noise around 1 pF: ADEV(2^k) = sigma / sqrt(2^k), within the
+    // confidence interval of the number of pairs at each octave
+    for (uint32_t i = 0; i < TEST_SAMPLES; i++)
+    {
+        Noise_AddSample(&state, 524288 + (int32_t)lround(TEST_SIGMA * test_normal()), 3);
+    }
+    CHECK_EQUAL(FDC_OK, Noise_GetSummary(&state, &summary));
+    CHECK_EQUAL(TEST_SAMPLES, summary.count);
+    CHECK(abs(summary.mean - 524288) < 5);
+    CHECK(fabs(test_lsb(summary.rms) - TEST_SIGMA) < 0.01 * TEST_SIGMA);
+    double expected_bits = log2(NOISE_FULL_SCALE / TEST_SIGMA);
+    CHECK(fabs(test_lsb(summary.effective_bits) - expected_bits) < 0.02);
+    // 2^20 samples give pairs up to the octave 19
+    CHECK_EQUAL(NOISE_OCTAVES, summary.octaves);
+    for (uint8_t k = 0; k <= 10; k++)
+    {
+        double expected = TEST_SIGMA / sqrt((double)(1UL << k));
+        double pairs = (TEST_SAMPLES >> k) - 1;
+        CHECK_EQUAL(FDC_OK, Noise_GetAllanDeviation(&state, k, &deviation));
+        CHECK(fabs(test_lsb(deviation) - expected) < expected * 4 / sqrt(2 * pairs));
+    }
+
+    // Constant: no noise, the effective bits of the 1/256 LSB resolution
+    Noise_Init(&state);
+    for (uint32_t i = 0; i < 4096; i++)
+    {
+        Noise_AddSample(&state, -12345, 0);
+    }
+    CHECK_EQUAL(FDC_OK, Noise_GetSummary(&state, &summary));
+    CHECK_EQUAL(-12345, summary.mean);
+    CHECK_EQUAL(0, summary.rms);
+    CHECK(fabs(test_lsb(summary.effective_bits) - log2(NOISE_FULL_SCALE * 256.0)) < 0.02);
+    for (uint8_t k = 0; k < 12; k++)
+    {
+        CHECK_EQUAL(FDC_OK, Noise_GetAllanDeviation(&state, k, &deviation));
+        CHECK_EQUAL(0, deviation);
+    }
+    CHECK_EQUAL(FDC_MEAS_NOT_DONE, Noise_GetAllanDeviation(&state, 12, &deviation));
+
+    // Drift of d LSB per sample: ADEV(tau) = d * tau / sqrt(2)
+    Noise_Init(&state);
+    for (uint32_t i = 0; i < 65536; i++)
+    {
+        Noise_AddSample(&state, (int32_t)(i * 4), 0);
+    }
+    for (uint8_t k = 0; k < 12; k++)
+    {
+        CHECK_EQUAL(FDC_OK, Noise_GetAllanDeviation(&state, k, &deviation));
+        CHECK(fabs(test_lsb(deviation) - 4.0 * (1 << k) / sqrt(2.0)) < 0.01 * 4 * (1 << k));
+    }
+
+    // A CAPDAC change starts again from the new sample
+    Noise_AddSample(&state, 100, 1);
+    Noise_AddSample(&state, 102, 1);
+    CHECK_EQUAL(FDC_OK, Noise_GetSummary(&state, &summary));
+    CHECK_EQUAL(2, summary.count);
+    CHECK_EQUAL(101, summary.mean);
+    CHECK_EQUAL(1, summary.octaves);
+
+    // A capture block feeds the recorded channels only
+    static Noise_State states[FDC_CAPTURE_CHANNELS];
+    static FDC_CaptureBlock block;
+    memset(&block, 0, sizeof(block));
+    block.header.channel_mask = FDC_RP_CH_2;
+    block.header.sample_count = 10;
+    for (uint8_t i = 0; i < 10; i++)
+    {
+        block.raw[FDC_CH_2][i] = i;
+        block.capdac[FDC_CH_2][i] = 2;
+    }
+    for (uint8_t ch = 0; ch < FDC_CAPTURE_CHANNELS; ch++)
+    {
+        Noise_Init(&states[ch]);
+    }
+    Noise_AddCaptureBlock(states, &block);
+    CHECK_EQUAL(FDC_MEAS_NOT_DONE, Noise_GetSummary(&states[FDC_CH_1], &summary));
+    CHECK_EQUAL(FDC_OK, Noise_GetSummary(&states[FDC_CH_2], &summary));
+    CHECK_EQUAL(10, summary.count);
+    CHECK_EQUAL(5, summary.mean);
+
+    return TEST_RESULT();
+}
+
+/* [] END OF FILE */
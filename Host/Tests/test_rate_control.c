@@ -0,0 +1,93 @@
+/**
+*   \brief Tests of the tier switches of the rate controller on the simulator.
+*
+*   Two tiers measure different channels: a switch must leave in FDC_CONF
+*   only the repeat bits of the new tier, so that the channels it drops
+*   stop converting, and must program the rate of the tier.
+*/
+
+#include "FDC1004Q.h"
+#include "FDC1004Q_Sim.h"
+#include "RateControl.h"
+#include "Test.h"
+
+// Polling period (ns)
+#define TEST_POLL_NS 100000
+
+// Check FDC_CONF against a tier, and the channels that keep converting
+static void test_check_tier(const RateControl_Tier* tier)
+{
+    uint8_t data[2];
+    CHECK_EQUAL(FDC_OK, FDC_ReadRegister(FDC1004Q_FDC_CONF, data));
+    uint16_t conf = (data[0] << 8) | data[1];
+    CHECK_EQUAL(tier->channels, conf & 0x00F0);
+    CHECK_EQUAL(0x0100, conf & 0x0100);
+    CHECK_EQUAL(tier->rate, (conf >> 10) & 0x03);
+
+    // Clear the done flags, then let every channel convert at least once
+    FDC_Frame frame;
+    FDC_ReadAllMeasurements(FDC_DONE_CH_1 | FDC_DONE_CH_2 | FDC_DONE_CH_3 | FDC_DONE_CH_4, &frame);
+    uint8_t done = 0;
+    for (uint32_t elapsed = 0; elapsed < 50000000; elapsed += TEST_POLL_NS)
+    {
+        FDC_Sim_AdvanceTime(TEST_POLL_NS);
+        if (FDC_ReadAllMeasurements(FDC_DONE_CH_1 | FDC_DONE_CH_2 | FDC_DONE_CH_3 | FDC_DONE_CH_4, 
+                                    &frame) == FDC_OK)
+        {
+            done |= frame.valid | frame.saturated;
+        }
+    }
+    CHECK_EQUAL(tier->channels >> 4, done);
+}
+
+int main(void)
+{
+    FDC_Sim_Init();
+    FDC_Start();
+    for (uint8_t ch = FDC_CH_1; ch <= FDC_CH_4; ch++)
+    {
+        FDC_ConfigureMeasurementInput(ch, ch, FDC_DISABLED, 0);
+    }
+
+    // Quiet tier on CH1 at 100 S/s, active tier on all the channels at 400 S/s
+    RateControl_Config config = {
+        { { FDC_100_Hz, FDC_RP_CH_1, 0, 0 },
+          { FDC_400_Hz, FDC_RP_CH_1 | FDC_RP_CH_2 | FDC_RP_CH_3 | FDC_RP_CH_4, 1000, 500 } },
+        2, 100, 4
+    };
+    CHECK_EQUAL(FDC_OK, RateControl_Init(&config));
+    CHECK_EQUAL(1, RateControl_GetTier());
+    CHECK_EQUAL(FDC_OK, RateControl_Apply());
+    test_check_tier(&config.tiers[1]);
+
+    // Constant input: the controller drops to the quiet tier after the hold time
+    int32_t capacitance[4] = { 0, 0, 0, 0 };
+    uint8_t capdac[4] = { 0, 0, 0, 0 };
+    uint16_t frames = 0;
+    while (!RateControl_Update(capacitance, capdac) && (++frames < 1000))
+    {
+    }
+    CHECK_EQUAL(0, RateControl_GetTier());
+    CHECK_EQUAL(FDC_OK, RateControl_Apply());
+    test_check_tier(&config.tiers[0]);
+
+    // A step on CH1 brings all the channels back
+    RateControl_Update(capacitance, capdac);
+    capacitance[0] = 5000;
+    CHECK_EQUAL(1, RateControl_Update(capacitance, capdac));
+    CHECK_EQUAL(1, RateControl_GetTier());
+    CHECK_EQUAL(FDC_OK, RateControl_Apply());
+    test_check_tier(&config.tiers[1]);
+
+    // Repeated direct switches between disjoint masks
+    CHECK_EQUAL(FDC_OK, FDC_EnableRepeatMeasurement(FDC_RP_CH_2 | FDC_RP_CH_3));
+    RateControl_Tier middle = { FDC_400_Hz, FDC_RP_CH_2 | FDC_RP_CH_3, 0, 0 };
+    test_check_tier(&middle);
+    CHECK_EQUAL(FDC_OK, FDC_EnableRepeatMeasurement(FDC_RP_CH_4));
+    RateControl_Tier last = { FDC_400_Hz, FDC_RP_CH_4, 0, 0 };
+    test_check_tier(&last);
+
+    return TEST_RESULT();
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,176 @@
+/**
+*   \brief Tests of the FreeRTOS layer of the driver.
+*
+*   The bus task streams frames from the simulator to two subscribers, one
+*   that keeps up and one that never reads, while two other tasks submit
+*   register reads through the request queue and read the same registers
+*   directly through the I2C interface. Every read must return the right
+*   value, every frame must reach the first subscriber, and the samples
+*   the second one could not take must be counted as dropped.
+*/
+
+#include "FDC1004Q_Rtos.h"
+#include "FDC1004Q_Sim.h"
+#include "I2C_Interface.h"
+#include "Test.h"
+
+// Frames checked by the test task
+#define TEST_FRAMES 50
+
+// Reads of each concurrent task
+#define TEST_READS 2000
+
+// Manufacturer ID of the FDC1004Q
+#define TEST_MANUFACTURER_ID 0x5449
+
+// Capacitance on each input (aF)
+#define TEST_CAPACITANCE(input) (1000000 + 250000 * (input))
+
+static QueueHandle_t test_fast;
+static QueueHandle_t test_slow;
+
+// Wrong values read by the concurrent tasks, one item per task
+static QueueHandle_t test_done;
+
+// Run on the bus task: let the next conversions complete
+static uint8_t test_advance(void* argument)
+{
+    (void)argument;
+    FDC_Sim_AdvanceTime(10000000);
+    return FDC_OK;
+}
+
+// Run on the bus task: a nested request must be run directly
+static uint8_t test_nested(void* argument)
+{
+    FDC_Rtos_GetStats(argument);
+    return FDC_MEAS_NOT_DONE;
+}
+
+// Run on the bus task: read the manufacturer ID
+static uint8_t test_read_id(void* argument)
+{
+    return FDC_ReadRegister(FDC1004Q_MANUFACTURER_ID, argument);
+}
+
+// Read the manufacturer ID through the request queue
+static void test_requester(void* parameters)
+{
+    (void)parameters;
+    uint32_t wrong = 0;
+    for (uint32_t i = 0; i < TEST_READS; i++)
+    {
+        uint8_t data[2] = { 0, 0 };
+        if ((FDC_Rtos_Call(test_read_id, data) != FDC_OK) ||
+            (((data[0] << 8) | data[1]) != TEST_MANUFACTURER_ID))
+        {
+            wrong++;
+        }
+    }
+    xQueueSend(test_done, &wrong, portMAX_DELAY);
+    vTaskDelete(NULL);
+}
+
+// Read the manufacturer ID directly, as the driver of another device would
+static void test_bus_user(void* parameters)
+{
+    (void)parameters;
+    uint32_t wrong = 0;
+    for (uint32_t i = 0; i < TEST_READS; i++)
+    {
+        uint8_t data[2] = { 0, 0 };
+        if ((I2C_Peripheral_ReadRegisterMulti(FDC1004Q_I2C_ADDR, FDC1004Q_MANUFACTURER_ID, 2, data) != I2C_NO_ERROR) ||
+            (((data[0] << 8) | data[1]) != TEST_MANUFACTURER_ID))
+        {
+            wrong++;
+        }
+    }
+    xQueueSend(test_done, &wrong, portMAX_DELAY);
+    vTaskDelete(NULL);
+}
+
+static void test_task(void* parameters)
+{
+    (void)parameters;
+    CHECK_EQUAL(FDC_OK, FDC_Rtos_StartStreaming(FDC_DONE_CH_ALL, 1));
+    CHECK_EQUAL(FDC_CONF_ERR, FDC_Rtos_StartStreaming(FDC_DONE_CH_ALL, 0));
+
+    uint32_t frames = 0;
+    uint32_t previous = 0;
+    for (uint32_t i = 0; i < TEST_FRAMES; i++)
+    {
+        FDC_Rtos_Call(test_advance, NULL);
+        FDC_Rtos_Sample sample;
+        if (xQueueReceive(test_fast, &sample, pdMS_TO_TICKS(1000)) != pdPASS)
+        {
+            break;
+        }
+        frames++;
+        CHECK_EQUAL(FDC_DONE_CH_ALL, sample.frame.valid);
+        CHECK((i == 0) || ((int32_t)(sample.timestamp - previous) >= 0));
+        previous = sample.timestamp;
+        for (uint8_t ch = 0; ch < 4; ch++)
+        {
+            int32_t capacitance = FDC_Sim_RawToCapacitance((int32_t)sample.frame.capacitance[ch] >> 8, 0);
+            CHECK((capacitance > TEST_CAPACITANCE(ch) - 10) && (capacitance < TEST_CAPACITANCE(ch) + 10));
+        }
+    }
+    CHECK_EQUAL(TEST_FRAMES, frames);
+
+    // Requests from the bus task itself, and results passed back
+    FDC_Rtos_Stats stats;
+    CHECK_EQUAL(FDC_MEAS_NOT_DONE, FDC_Rtos_Call(test_nested, &stats));
+
+    // Requests and direct bus accesses while streaming
+    test_done = xQueueCreate(2, sizeof(uint32_t));
+    xTaskCreate(test_requester, "requester", configMINIMAL_STACK_SIZE, NULL, 1, NULL);
+    xTaskCreate(test_bus_user, "bus user", configMINIMAL_STACK_SIZE, NULL, 1, NULL);
+    for (uint8_t i = 0; i < 2; i++)
+    {
+        uint32_t wrong = 1;
+        xQueueReceive(test_done, &wrong, portMAX_DELAY);
+        CHECK_EQUAL(0, wrong);
+    }
+
+    CHECK_EQUAL(FDC_OK, FDC_Rtos_StopStreaming());
+    FDC_Rtos_Sample sample;
+    while (xQueueReceive(test_fast, &sample, 0) == pdPASS)
+    {
+        frames++;
+    }
+    FDC_Rtos_GetStats(&stats);
+    CHECK_EQUAL(frames, stats.frames);
+    CHECK_EQUAL(0, stats.errors);
+    CHECK_EQUAL(0, FDC_Rtos_GetDropped(test_fast));
+    CHECK_EQUAL(stats.frames - 1, FDC_Rtos_GetDropped(test_slow));
+    CHECK_EQUAL(stats.frames - 1, stats.dropped);
+    CHECK(stats.requests >= TEST_FRAMES + TEST_READS);
+    vTaskEndScheduler();
+    vTaskDelete(NULL);
+}
+
+int main(void)
+{
+    FDC_Sim_Init();
+    for (uint8_t input = 0; input < 4; input++)
+    {
+        FDC_Sim_SetCapacitance(input, TEST_CAPACITANCE(input));
+    }
+    FDC_Start();
+    FDC_SetSampleRate(FDC_400_Hz);
+    for (uint8_t ch = 0; ch < 4; ch++)
+    {
+        FDC_ConfigureMeasurementInput(ch, ch, FDC_DISABLED, 0);
+    }
+    FDC_EnableRepeatMeasurement(0xF0);
+
+    CHECK_EQUAL(FDC_OK, FDC_Rtos_Init(2, configMINIMAL_STACK_SIZE));
+    test_fast = FDC_Rtos_Subscribe(TEST_FRAMES);
+    test_slow = FDC_Rtos_Subscribe(1);
+    CHECK((test_fast != NULL) && (test_slow != NULL));
+    xTaskCreate(test_task, "test", configMINIMAL_STACK_SIZE, NULL, 1, NULL);
+    vTaskStartScheduler();
+    return TEST_RESULT();
+}
+
+/* [] END OF FILE */
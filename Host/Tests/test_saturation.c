@@ -0,0 +1,89 @@
+/**
+*   \brief Tests of the recovery from saturation after a step of the input.
+*
+*   The input of the simulator steps across the +/-15 pF window of the
+*   CAPDAC, and every saturated sample moves the CAPDAC with
+*   #FDC_CorrectiveCapdac, as main.c does. A step into the next window must
+*   cost a single saturated conversion, a step across two windows two.
+*/
+
+#include "FDC1004Q.h"
+#include "FDC1004Q_Sim.h"
+#include "Test.h"
+
+// Conversion period at 400 S/s (ns), and polling period
+#define TEST_CONVERSION_NS 2500000
+#define TEST_POLL_NS 100000
+
+static uint8_t test_capdac;
+
+// Step the input and read until a valid sample.
+// Return the number of conversions, 0 on timeout.
+static uint8_t test_step(int32_t capacitance_af, int32_t* measured_af)
+{
+    FDC_Sim_SetCapacitance(FDC_IN_1, capacitance_af);
+    uint8_t conversions = 0;
+    for (uint32_t elapsed = 0; elapsed < 20 * TEST_CONVERSION_NS; elapsed += TEST_POLL_NS)
+    {
+        FDC_Sim_AdvanceTime(TEST_POLL_NS);
+        FDC_Frame frame;
+        if (FDC_ReadAllMeasurements(FDC_DONE_CH_1, &frame) != FDC_OK)
+        {
+            continue;
+        }
+        if (frame.saturated & FDC_DONE_CH_1)
+        {
+            conversions++;
+            test_capdac = FDC_CorrectiveCapdac(frame.capdac[FDC_CH_1],
+                                               FDC_CheckSaturation(frame.capacitance[FDC_CH_1]));
+            FDC_ConfigureMeasurementInput(FDC_CH_1, FDC_IN_1, FDC_CAPDAC, test_capdac);
+        }
+        else if (frame.valid & FDC_DONE_CH_1)
+        {
+            conversions++;
+            int32_t capacitance[4];
+            FDC_ConvertRawMeasurementsFixed(frame.capacitance, frame.capdac, capacitance, 1);
+            // 2^-19 pF -> aF
+            *measured_af = (int32_t)(((int64_t)capacitance[0] * 1000000) >> 19);
+            return conversions;
+        }
+    }
+    return 0;
+}
+
+int main(void)
+{
+    FDC_Sim_Init();
+    FDC_Start();
+    FDC_SetSampleRate(FDC_400_Hz);
+    FDC_ConfigureMeasurementInput(FDC_CH_1, FDC_IN_1, FDC_CAPDAC, 0);
+    FDC_EnableRepeatMeasurement(FDC_RP_CH_1);
+
+    // Up across several windows, then down, with the conversions needed
+    static const int32_t steps[] = { 5000000, 40000000, 70000000, 96000000, 30000000, 2000000 };
+    static const uint8_t expected[] = { 1, 2, 2, 2, 3, 2 };
+    for (uint8_t i = 0; i < sizeof(steps) / sizeof(steps[0]); i++)
+    {
+        int32_t measured = 0;
+        uint8_t conversions = test_step(steps[i], &measured);
+        CHECK_EQUAL(expected[i], conversions);
+        CHECK((measured > steps[i] - 5000) && (measured < steps[i] + 5000));
+    }
+    uint32_t count = 0;
+    CHECK_EQUAL(FDC_OK, FDC_ReadSaturationCount(FDC_CH_1, &count));
+    CHECK(count > 0);
+
+    // Pinned ends, and detection turned off
+    CHECK_EQUAL(FDC_SAT_HIGH, FDC_CheckSaturation(0x7FFFFF00));
+    CHECK_EQUAL(FDC_SAT_LOW, FDC_CheckSaturation(0x80000000));
+    CHECK_EQUAL(FDC_SAT_NONE, FDC_CheckSaturation(0x12345600));
+    CHECK(FDC_CorrectiveCapdac(0, FDC_SAT_HIGH) > 0);
+    CHECK_EQUAL(0, FDC_CorrectiveCapdac(3, FDC_SAT_LOW));
+    CHECK_EQUAL(FDC_CAPDAC_MAX, FDC_CorrectiveCapdac(FDC_CAPDAC_MAX - 1, FDC_SAT_HIGH));
+    FDC_SetSaturationDetection(FDC_SAT_NONE);
+    CHECK_EQUAL(FDC_SAT_NONE, FDC_CheckSaturation(0x7FFFFF00));
+
+    return TEST_RESULT();
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,53 @@
+/**
+*   \brief Tests of the CAPDAC tuning of the application.
+*
+*   The measurements must be converted with the CAPDAC they were taken
+*   with, and the tuning must start from the current setting, which differs
+*   from the former after a saturation re-range.
+*/
+
+#include "Sensors.h"
+#include "Test.h"
+
+// Raw measurement of a capacitance above the CAPDAC offset, in half pF
+#define TEST_RAW(half_pf) ((uint32_t)(half_pf) << 26)
+
+// Capacitance (pF) in the fixed point units of the conversion
+#define TEST_FIXED(pf) ((int32_t)((pf) << 19))
+
+int main(void)
+{
+    uint32_t raw[SENSORS_CHANNELS] = { TEST_RAW(2), TEST_RAW(2), TEST_RAW(28), TEST_RAW(28) };
+    uint8_t measured[SENSORS_CHANNELS] = { 2, 0, 0, 0 };
+    uint8_t capdac[SENSORS_CHANNELS] = { 4, 0, 0, 1 };
+    int32_t capacitance[SENSORS_CHANNELS];
+
+    // The offset is the one of the measurement, not the current setting
+    uint8_t changed = Sensors_TuneCapdac(raw, measured, capdac, capacitance);
+    CHECK_EQUAL(TEST_FIXED(1) + 2 * FDC_CAPDAC_FIXED_FACTOR, capacitance[0]);
+    CHECK_EQUAL(TEST_FIXED(1), capacitance[1]);
+    CHECK_EQUAL(TEST_FIXED(14), capacitance[2]);
+    CHECK_EQUAL(0, changed);
+    CHECK_EQUAL(4, capdac[0]);
+
+    // Above the margin: only the channel whose current setting is still
+    // too low is increased, the one already re-ranged is left alone
+    raw[2] = TEST_RAW(31);
+    raw[3] = TEST_RAW(31);
+    changed = Sensors_TuneCapdac(raw, measured, capdac, capacitance);
+    CHECK_EQUAL(1 << 2, changed);
+    CHECK_EQUAL(1, capdac[2]);
+    CHECK_EQUAL(1, capdac[3]);
+
+    // The setting never exceeds the maximum
+    raw[0] = TEST_RAW(31);
+    measured[0] = FDC_CAPDAC_MAX;
+    capdac[0] = FDC_CAPDAC_MAX;
+    changed = Sensors_TuneCapdac(raw, measured, capdac, capacitance);
+    CHECK_EQUAL(0, changed & 1);
+    CHECK_EQUAL(FDC_CAPDAC_MAX, capdac[0]);
+
+    return TEST_RESULT();
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,143 @@
+/**
+*   \brief Tests of the slider and wheel stage with synthetic finger sweeps.
+*
+*   A finger moving at constant speed is modelled by a triangular response
+*   of each electrode, reaching zero 1.6 pitches away from its centre, plus
+*   optional Gaussian noise. The position found is compared with the true
+*   one along the sweep.
+*/
+
+#include "Slider.h"
+#include "Test.h"
+
+#include <math.h>
+#include <stdlib.h>
+
+#define TEST_STEPS 2000
+#define TEST_AMPLITUDE 10000
+
+// Largest errors of a sweep (pitches)
+typedef struct {
+    double inner;
+    double edge;
+    uint32_t touched;
+    uint32_t backwards;
+} Test_Sweep;
+
+static double test_gauss(void)
+{
+    double u = (rand() + 1.0) / (RAND_MAX + 2.0);
+    double v = (rand() + 1.0) / (RAND_MAX + 2.0);
+    return sqrt(-2 * log(u)) * cos(6.283185307179586 * v);
+}
+
+static void test_frame(double position, double amplitude, uint8_t type, double noise, int32_t* delta)
+{
+    for (uint8_t i = 0; i < SLIDER_ELECTRODES; i++)
+    {
+        double distance = fabs(position - i);
+        if ((type == SLIDER_WHEEL) && (distance > SLIDER_ELECTRODES / 2))
+        {
+            distance = SLIDER_ELECTRODES - distance;
+        }
+        double response = 1 - distance / 1.6;
+        delta[i] = (int32_t)lrint(amplitude * ((response > 0) ? response : 0) + noise * test_gauss());
+    }
+}
+
+// Sweep from 0 to end pitches. On a slider the edge is the outer half pitch.
+static Test_Sweep test_sweep(uint8_t type, double end, uint8_t filter_shift, double noise)
+{
+    Test_Sweep sweep = { 0, 0, 0, 0 };
+    Slider_State state;
+    Slider_Config config = { type, 4000, 2500, 300, filter_shift };
+    CHECK_EQUAL(FDC_OK, Slider_Init(&state, &config));
+    srand(1);
+    for (uint32_t k = 0; k < TEST_STEPS; k++)
+    {
+        double position = end * k / TEST_STEPS;
+        if (type == SLIDER_WHEEL)
+        {
+            position = fmod(position, SLIDER_ELECTRODES);
+        }
+        int32_t delta[SLIDER_ELECTRODES];
+        Slider_Output output;
+        test_frame(position, TEST_AMPLITUDE, type, noise, delta);
+        Slider_Process(&state, delta, &output);
+        if (!output.touched)
+        {
+            continue;
+        }
+        sweep.touched++;
+        double error = output.position / (double)(1 << SLIDER_FRACT_BITS) - position;
+        if (type == SLIDER_WHEEL)
+        {
+            error += (error > 2) ? -4 : ((error < -2) ? 4 : 0);
+        }
+        // Let the smoothing settle first
+        if (k < 50)
+        {
+            continue;
+        }
+        error = fabs(error);
+        if ((type == SLIDER_LINEAR) && ((position <= 0.5) || (position >= 2.5)))
+        {
+            sweep.edge = (error > sweep.edge) ? error : sweep.edge;
+        }
+        else
+        {
+            sweep.inner = (error > sweep.inner) ? error : sweep.inner;
+        }
+        sweep.backwards += (output.velocity < 0);
+    }
+    return sweep;
+}
+
+int main(void)
+{
+    // Noiseless: within 1/16 pitch, pulled towards the centre at the ends
+    Test_Sweep sweep = test_sweep(SLIDER_LINEAR, 3, 0, 0);
+    CHECK_EQUAL(TEST_STEPS, sweep.touched);
+    CHECK(sweep.inner < 0.0625);
+    CHECK(sweep.edge < 0.3);
+    CHECK_EQUAL(0, sweep.backwards);
+
+    // Two turns of the wheel, across the wrap
+    sweep = test_sweep(SLIDER_WHEEL, 8, 0, 0);
+    CHECK_EQUAL(TEST_STEPS, sweep.touched);
+    CHECK(sweep.inner < 0.0625);
+    CHECK_EQUAL(0, sweep.backwards);
+
+    // Noise at 1% of the touch, smoothed over 4 frames
+    sweep = test_sweep(SLIDER_LINEAR, 3, 2, 100);
+    CHECK_EQUAL(TEST_STEPS, sweep.touched);
+    CHECK(sweep.inner < 0.1);
+    sweep = test_sweep(SLIDER_WHEEL, 8, 2, 100);
+    CHECK_EQUAL(TEST_STEPS, sweep.touched);
+    CHECK(sweep.inner < 0.1);
+
+    // Touch above 4000 LSB, release below 2500 LSB
+    Slider_State state;
+    Slider_Config config = { SLIDER_LINEAR, 4000, 2500, 300, 0 };
+    Slider_Init(&state, &config);
+    static const int32_t amplitudes[] = { 0, 3000, 5500, 3500, 3200, 2900, 0 };
+    static const uint8_t touched[] = { 0, 0, 1, 1, 1, 0, 0 };
+    for (uint8_t i = 0; i < sizeof(amplitudes) / sizeof(amplitudes[0]); i++)
+    {
+        int32_t delta[SLIDER_ELECTRODES];
+        Slider_Output output;
+        test_frame(1.3, amplitudes[i], SLIDER_LINEAR, 0, delta);
+        Slider_Process(&state, delta, &output);
+        CHECK_EQUAL(touched[i], output.touched);
+    }
+
+    // Release threshold above the touch threshold, unknown layout
+    Slider_Config bad = { SLIDER_LINEAR, 100, 200, 0, 0 };
+    CHECK_EQUAL(FDC_CONF_ERR, Slider_Init(&state, &bad));
+    bad = (Slider_Config){ 2, 4000, 2500, 300, 0 };
+    CHECK_EQUAL(FDC_CONF_ERR, Slider_Init(&state, &bad));
+
+    return TEST_RESULT();
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,178 @@
+/**
+*   \brief Tests of the Welch power spectrum estimation.
+*
+*   Known signals go through the analyser: a pure tone on a bin, whose
+*   power must fall in that bin and its two neighbours (Hann window) and
+*   sum to the variance of the tone, a tone between two bins, a small tone
+*   scaled up by the FFT, and white noise, whose spectrum must be flat at
+*   the variance spread over the bins. The segment timing and the CAPDAC
+*   changes are checked too.
+*/
+
+#include "Spectrum.h"
+#include "Test.h"
+
+#include <math.h>
+
+#define TEST_TONE_BIN 16
+// RMS of the white noise (LSB)
+#define TEST_SIGMA 500.0
+
+static uint64_t test_seed = 1;
+static uint32_t test_callbacks;
+
+// Uniform in (0, 1)
+static double test_uniform(void)
+{
+    test_seed ^= test_seed << 13;
+    test_seed ^= test_seed >> 7;
+    test_seed ^= test_seed << 17;
+    return ((test_seed >> 11) + 0.5) / 9007199254740992.0;
+}
+
+// Normal with zero mean and unit variance (Box-Muller)
+static double test_normal(void)
+{
+    return sqrt(-2 * log(test_uniform())) * cos(2 * M_PI * test_uniform());
+}
+
+static void test_count(const Spectrum_State* state)
+{
+    (void)state;
+    test_callbacks++;
+}
+
+// Average spectrum of a tone of amplitude (LSB) and frequency (bins) over 1 pF
+static void test_tone(Spectrum_State* state, double amplitude, double bin, uint32_t samples, double* power)
+{
+    uint64_t psd[SPECTRUM_BINS];
+    Spectrum_Init(state, NULL);
+    for (uint32_t i = 0; i < samples; i++)
+    {
+        double phase = 2 * M_PI * bin * i / SPECTRUM_FFT_SIZE;
+        Spectrum_AddSample(state, 524288 + (int32_t)lround(amplitude * sin(phase)), 0);
+    }
+    Spectrum_GetPsd(state, psd);
+    for (uint16_t k = 0; k < SPECTRUM_BINS; k++)
+    {
+        power[k] = psd[k] / (double)(1 << SPECTRUM_FRACT_BITS);
+    }
+}
+
+static double test_sum(const double* power)
+{
+    double sum = 0;
+    for (uint16_t k = 0; k < SPECTRUM_BINS; k++)
+    {
+        sum += power[k];
+    }
+    return sum;
+}
+
+static uint16_t test_peak(const double* power)
+{
+    uint16_t peak = 0;
+    for (uint16_t k = 1; k < SPECTRUM_BINS; k++)
+    {
+        peak = (power[k] > power[peak]) ? k : peak;
+    }
+    return peak;
+}
+
+int main(void)
+{
+    static Spectrum_State state;
+    uint64_t psd[SPECTRUM_BINS];
+    double power[SPECTRUM_BINS];
+
+    // No segment yet, then one segment after a full buffer and one every
+    // half buffer after that
+    Spectrum_Init(&state, test_count);
+    CHECK_EQUAL(FDC_MEAS_NOT_DONE, Spectrum_GetPsd(&state, psd));
+    CHECK_EQUAL(FDC_MEAS_NOT_DONE, Spectrum_GetSegment(&state, psd));
+    for (uint16_t i = 0; i < SPECTRUM_FFT_SIZE - 1; i++)
+    {
+        Spectrum_AddSample(&state, i, 0);
+    }
+    CHECK_EQUAL(0, test_callbacks);
+    Spectrum_AddSample(&state, 0, 0);
+    CHECK_EQUAL(1, test_callbacks);
+    CHECK_EQUAL(FDC_OK, Spectrum_GetSegment(&state, psd));
+    for (uint16_t i = 0; i < SPECTRUM_FFT_SIZE; i++)
+    {
+        Spectrum_AddSample(&state, i, 0);
+    }
+    CHECK_EQUAL(3, test_callbacks);
+    CHECK_EQUAL(3, state.segments);
+
+    // A CAPDAC change discards the samples of the current segment
+    for (uint16_t i = 0; i < SPECTRUM_FFT_SIZE / 2 - 1; i++)
+    {
+        Spectrum_AddSample(&state, i, 0);
+    }
+    Spectrum_AddSample(&state, 0, 1);
+    CHECK_EQUAL(3, test_callbacks);
+    for (uint16_t i = 0; i < SPECTRUM_FFT_SIZE - 1; i++)
+    {
+        Spectrum_AddSample(&state, i, 1);
+    }
+    CHECK_EQUAL(4, test_callbacks);
+
+    // Tone on a bin: A^2 / 3 in the bin and A^2 / 12 in each neighbour
+    // with the Hann window, A^2 / 2 in total, nothing elsewhere
+    double amplitude = 10000;
+    double variance = amplitude * amplitude / 2;
+    test_tone(&state, amplitude, TEST_TONE_BIN, 64 * SPECTRUM_FFT_SIZE, power);
+    CHECK_EQUAL(TEST_TONE_BIN, test_peak(power));
+    CHECK(fabs(power[TEST_TONE_BIN] - variance * 2 / 3) < 0.01 * variance);
+    CHECK(fabs(power[TEST_TONE_BIN - 1] - variance / 6) < 0.01 * variance);
+    CHECK(fabs(power[TEST_TONE_BIN + 1] - variance / 6) < 0.01 * variance);
+    CHECK(fabs(test_sum(power) - variance) < 0.01 * variance);
+    double leakage = test_sum(power) - power[TEST_TONE_BIN - 1] - power[TEST_TONE_BIN] - power[TEST_TONE_BIN + 1];
+    CHECK(leakage < 1e-4 * variance);
+
+    // The single segment holds the same tone
+    CHECK_EQUAL(FDC_OK, Spectrum_GetSegment(&state, psd));
+    CHECK(fabs(psd[TEST_TONE_BIN] / (double)(1 << SPECTRUM_FRACT_BITS) - variance * 2 / 3) < 0.01 * variance);
+
+    // Between two bins the power is shared, the total is kept
+    test_tone(&state, amplitude, TEST_TONE_BIN + 8.5, 64 * SPECTRUM_FFT_SIZE, power);
+    CHECK((test_peak(power) == TEST_TONE_BIN + 8) || (test_peak(power) == TEST_TONE_BIN + 9));
+    CHECK(fabs(power[TEST_TONE_BIN + 8] - power[TEST_TONE_BIN + 9]) < 0.02 * variance);
+    CHECK(fabs(test_sum(power) - variance) < 0.02 * variance);
+
+    // A tone of a few LSB is scaled up before the FFT
+    amplitude = 8;
+    variance = amplitude * amplitude / 2;
+    test_tone(&state, amplitude, 5, 64 * SPECTRUM_FFT_SIZE, power);
+    CHECK_EQUAL(5, test_peak(power));
+    CHECK(fabs(test_sum(power) - variance) < 0.05 * variance);
+
+    // White noise: 2 sigma^2 / N in each bin, within 6 standard deviations
+    // of the estimate over the segments. The mean removed from each segment
+    // takes DC and, through the window, part of the first bin; Nyquist
+    // counts once
+    Spectrum_Init(&state, NULL);
+    for (uint32_t i = 0; i < 4096 * SPECTRUM_FFT_SIZE / 2; i++)
+    {
+        Spectrum_AddSample(&state, (int32_t)lround(TEST_SIGMA * test_normal()), 0);
+    }
+    CHECK_EQUAL(FDC_OK, Spectrum_GetPsd(&state, psd));
+    double floor = 2 * TEST_SIGMA * TEST_SIGMA / SPECTRUM_FFT_SIZE;
+    double tolerance = 6 / sqrt(state.segments / 2.0);
+    uint16_t outside = 0;
+    double sum = 0;
+    for (uint16_t k = 2; k < SPECTRUM_BINS - 1; k++)
+    {
+        double bin = psd[k] / (double)(1 << SPECTRUM_FRACT_BITS);
+        outside += fabs(bin - floor) > tolerance * floor;
+        sum += bin;
+    }
+    CHECK_EQUAL(0, outside);
+    CHECK(fabs(sum / (SPECTRUM_BINS - 3) - floor) < 0.02 * floor);
+    CHECK(psd[0] / (double)(1 << SPECTRUM_FRACT_BITS) < 0.5 * floor);
+
+    return TEST_RESULT();
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,116 @@
+/**
+*   \brief Tests of the register trace and of its host decoder.
+*
+*   Register reads are traced on the simulator, one by one, batched on the
+*   bus and through the arbiter, then the dump is decoded from a buffer
+*   holding other output around it. Each transfer through the arbiter must
+*   get its own event, while the registers of a batch share the start and
+*   the duration of the single transfer. The events overwritten between
+*   two dumps must be counted, and a damaged dump rejected.
+*/
+
+#include "FDC1004Q.h"
+#include "FDC1004Q_Sim.h"
+#include "FDC1004Q_Trace.h"
+#include "I2C_Arbiter.h"
+#include "TraceDecoder.h"
+#include "Test.h"
+
+#include <string.h>
+
+static uint8_t test_log[4096];
+static size_t test_length;
+
+static uint32_t test_clock(void)
+{
+    return (uint32_t)(FDC_Sim_GetTime() / 1000);
+}
+
+static void test_write(const uint8_t* data, uint16_t length)
+{
+    memcpy(&test_log[test_length], data, length);
+    test_length += length;
+}
+
+static void test_print(const char* text)
+{
+    test_write((const uint8_t*)text, strlen(text));
+}
+
+int main(void)
+{
+    FDC_Sim_Init();
+    FDC_Start();
+    I2C_Arbiter_Init(test_clock);
+    FDC_Trace_Start(test_clock);
+
+    // A single read, then three registers through the arbiter and batched
+    static const uint8_t registers[] = { FDC1004Q_FDC_CONF, FDC1004Q_MEAS1_MSB, FDC1004Q_MEAS1_LSB };
+    uint8_t data[6];
+    CHECK_EQUAL(FDC_OK, FDC_ReadRegister(FDC1004Q_MANUFACTURER_ID, data));
+    FDC_SetBusPriority(I2C_ARBITER_PRIORITY_HIGH, 0);
+    CHECK_EQUAL(FDC_OK, FDC_ReadRegisters(registers, data, 3));
+    FDC_SetBusPriority(FDC_BUS_DIRECT, 0);
+    CHECK_EQUAL(FDC_OK, FDC_ReadRegisters(registers, data, 3));
+
+    test_print("FDC Library Test\n");
+    FDC_Trace_Dump(test_write);
+    test_print("0x0C: 0x0400\n");
+
+    size_t offset = TraceDecoder_Find(test_log, test_length);
+    CHECK_EQUAL(17, offset);
+    FDC_TraceHeader header;
+    FDC_TraceEvent events[FDC_TRACE_SIZE];
+    long size = TraceDecoder_Parse(&test_log[offset], test_length - offset, &header, events, FDC_TRACE_SIZE);
+    CHECK_EQUAL(TRACE_DECODER_HEADER_SIZE + 7 * TRACE_DECODER_EVENT_SIZE, size);
+    CHECK_EQUAL(7, header.event_count);
+    CHECK_EQUAL(7, header.total_events);
+    CHECK_EQUAL(0, TraceDecoder_Lost(&header, 0));
+    CHECK_EQUAL(FDC1004Q_MANUFACTURER_ID, events[0].reg);
+    CHECK_EQUAL(FDC1004Q_MANUFACTURED_ID_VALUE, events[0].value);
+    CHECK_EQUAL(FDC_TRACE_OP_READ, events[0].op);
+    for (uint8_t i = 0; i < 3; i++)
+    {
+        const FDC_TraceEvent* arbiter = &events[1 + i];
+        const FDC_TraceEvent* batch = &events[4 + i];
+        CHECK_EQUAL(registers[i], arbiter->reg);
+        CHECK_EQUAL(registers[i], batch->reg);
+        CHECK(arbiter->duration > 0);
+        // One transfer each, one after the other
+        if (i > 0)
+        {
+            CHECK(arbiter->timestamp >= arbiter[-1].timestamp + arbiter[-1].duration);
+            CHECK_EQUAL(batch[-1].timestamp, batch->timestamp);
+            CHECK_EQUAL(batch[-1].duration, batch->duration);
+        }
+    }
+    // The batch carries the three registers
+    CHECK(events[4].duration >= events[1].duration);
+    CHECK_EQUAL(0, strcmp("FDC_CONF", TraceDecoder_RegisterName(FDC1004Q_FDC_CONF)));
+    CHECK_EQUAL(0, strcmp("DEVICE_ID", TraceDecoder_RegisterName(FDC1004Q_DEVICE_ID)));
+
+    // Wrap the buffer: the 10 events after the first dump are lost
+    for (uint16_t i = 0; i < FDC_TRACE_SIZE + 10; i++)
+    {
+        FDC_ReadRegister(FDC1004Q_DEVICE_ID, data);
+    }
+    test_length = 0;
+    FDC_Trace_Dump(test_write);
+    size = TraceDecoder_Parse(test_log, test_length, &header, events, FDC_TRACE_SIZE);
+    CHECK_EQUAL((long)test_length, size);
+    CHECK_EQUAL(FDC_TRACE_SIZE, header.event_count);
+    CHECK_EQUAL(7 + FDC_TRACE_SIZE + 10, header.total_events);
+    CHECK_EQUAL(10, TraceDecoder_Lost(&header, 7));
+    CHECK_EQUAL(FDC1004Q_DEVICE_ID_VALUE, events[FDC_TRACE_SIZE - 1].value);
+
+    // Cut short, too many events, damaged sequence
+    CHECK_EQUAL(0, TraceDecoder_Parse(test_log, test_length - 1, &header, events, FDC_TRACE_SIZE));
+    CHECK_EQUAL(-1, TraceDecoder_Parse(test_log, test_length, &header, events, FDC_TRACE_SIZE - 1));
+    test_log[TRACE_DECODER_HEADER_SIZE + 5 * TRACE_DECODER_EVENT_SIZE + 10] ^= 0x01;
+    CHECK_EQUAL(-1, TraceDecoder_Parse(test_log, test_length, &header, events, FDC_TRACE_SIZE));
+    CHECK_EQUAL(test_length, TraceDecoder_Find(test_log + 1, test_length - 1) + 1);
+
+    return TEST_RESULT();
+}
+
+/* [] END OF FILE */
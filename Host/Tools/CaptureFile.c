@@ -0,0 +1,145 @@
+/**
+*   \brief Source file for the host reader of the capture files.
+*/
+
+#include "CaptureFile.h"
+
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// Check the magic, the version and the sample count of a block
+static uint8_t capture_file_check_header(const FDC_CaptureHeader* header);
+
+int CaptureFile_Open(CaptureFile* file, const char* path)
+{
+    memset(file, 0, sizeof(*file));
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+    {
+        return -1;
+    }
+    struct stat status;
+    if (fstat(fd, &status) < 0)
+    {
+        close(fd);
+        return -1;
+    }
+    size_t blocks = (size_t)status.st_size / sizeof(FDC_CaptureBlock);
+    if (blocks > 0)
+    {
+        // The mapping stays valid after the file is closed
+        void* data = mmap(NULL, (size_t)status.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data == MAP_FAILED)
+        {
+            close(fd);
+            return -1;
+        }
+        file->blocks = data;
+        file->block_count = blocks;
+        file->size = (size_t)status.st_size;
+    }
+    close(fd);
+    return 0;
+}
+
+void CaptureFile_Close(CaptureFile* file)
+{
+    if (file->blocks != NULL)
+    {
+        munmap((void*)file->blocks, file->size);
+    }
+    memset(file, 0, sizeof(*file));
+}
+
+uint8_t CaptureFile_IsValid(const FDC_CaptureBlock* block)
+{
+    if (!capture_file_check_header(&block->header))
+    {
+        return 0;
+    }
+    // The CRC is computed with its own field set to 0
+    FDC_CaptureBlock copy;
+    memcpy(&copy, block, sizeof(copy));
+    copy.header.crc = 0;
+    return FDC_Capture_Crc16((const uint8_t*)&copy, sizeof(copy)) == block->header.crc;
+}
+
+size_t CaptureFile_Seek(const CaptureFile* file, uint32_t timestamp)
+{
+    size_t low = 0;
+    size_t high = file->block_count;
+    while (low < high)
+    {
+        size_t middle = low + (high - low) / 2;
+        if (file->blocks[middle].header.last_timestamp < timestamp)
+        {
+            low = middle + 1;
+        }
+        else
+        {
+            high = middle;
+        }
+    }
+    return low;
+}
+
+void CaptureFile_Query(const CaptureFile* file, uint32_t from, uint32_t to, uint8_t channel_mask,
+                       uint8_t verify, CaptureFile_Callback callback, void* context,
+                       CaptureFile_QueryStats* stats)
+{
+    CaptureFile_QueryStats count = { 0, 0, 0 };
+    for (size_t b = CaptureFile_Seek(file, from);
+         (b < file->block_count) && (file->blocks[b].header.first_timestamp <= to); b++)
+    {
+        const FDC_CaptureBlock* block = &file->blocks[b];
+        count.blocks++;
+        if (verify ? !CaptureFile_IsValid(block) : !capture_file_check_header(&block->header))
+        {
+            count.invalid_blocks++;
+            continue;
+        }
+        // Samples of the block within the range
+        uint8_t first = 0;
+        uint8_t last = block->header.sample_count;
+        while ((first < last) && (block->timestamp[first] < from))
+        {
+            first++;
+        }
+        while ((last > first) && (block->timestamp[last - 1] > to))
+        {
+            last--;
+        }
+        if (first == last)
+        {
+            continue;
+        }
+        for (uint8_t ch = FDC_CH_1; ch <= FDC_CH_4; ch++)
+        {
+            if (channel_mask & block->header.channel_mask & (FDC_RP_CH_1 >> ch))
+            {
+                callback(ch, &block->timestamp[first], &block->raw[ch][first],
+                         &block->capdac[ch][first], last - first, context);
+                count.samples += last - first;
+            }
+        }
+    }
+    if (stats != NULL)
+    {
+        *stats = count;
+    }
+}
+
+// ===================================================================
+//                         HELPER FUNCTIONS
+// ===================================================================
+
+uint8_t capture_file_check_header(const FDC_CaptureHeader* header)
+{
+    return (header->magic == FDC_CAPTURE_MAGIC) && (header->version == FDC_CAPTURE_VERSION) &&
+           (header->sample_count <= FDC_CAPTURE_BLOCK_SAMPLES);
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,114 @@
+/**
+*   \file CaptureFile.h
+*   \brief Host reader of the capture files.
+*
+*   A capture file (see FDC1004Q_Capture.h) is mapped in memory read-only,
+*   so that a query only touches the pages of the blocks and of the
+*   columns it needs. The time range in the block headers is the index:
+*   the first block of a query is found with a binary search, then the
+*   blocks are walked until the end of the range, and the samples of each
+*   requested channel are handed to the caller as slices of the columns,
+*   without copying them.
+*
+*   The binary search needs the timestamps to grow along the file, as in
+*   the files recorded by a single node whose clock did not wrap. The
+*   blocks are read in place, so the host must be little-endian, as the
+*   nodes are.
+*
+*   \author Davide Marzorati
+*/
+
+#ifndef __CAPTURE_FILE_H__
+    #define __CAPTURE_FILE_H__
+
+    #include "FDC1004Q_Capture.h"
+
+    #include <stddef.h>
+
+    /**
+    *   \brief Capture file mapped in memory.
+    */
+    typedef struct {
+        /** Blocks of the file, NULL if there are none **/
+        const FDC_CaptureBlock* blocks;
+        /** Number of whole blocks, a trailing partial block is ignored **/
+        size_t block_count;
+        /** Size of the mapping (bytes) **/
+        size_t size;
+    } CaptureFile;
+
+    /**
+    *   \brief Statistics of a query.
+    */
+    typedef struct {
+        /** Blocks read **/
+        uint64_t blocks;
+        /** Samples handed to the callback, counted once per channel **/
+        uint64_t samples;
+        /** Blocks skipped because of a wrong magic, version or CRC **/
+        uint32_t invalid_blocks;
+    } CaptureFile_QueryStats;
+
+    /**
+    *   \brief Callback receiving the samples of a query.
+    *   Called once per block and channel, with consecutive samples.
+    *   \param channel the channel, from #FDC_CH_1 to #FDC_CH_4.
+    *   \param[in] timestamp the timestamps of the samples.
+    *   \param[in] raw the sign extended 24-bit measurements.
+    *   \param[in] capdac the CAPDAC settings.
+    *   \param count the number of samples.
+    *   \param context the context pointer given to #CaptureFile_Query.
+    */
+    typedef void (*CaptureFile_Callback)(uint8_t channel, const uint32_t* timestamp, const int32_t* raw,
+                                         const uint8_t* capdac, uint8_t count, void* context);
+
+    /**
+    *   \brief Map a capture file.
+    *   \param[out] file the mapped file.
+    *   \param path the path of the file.
+    *   \retval 0 if the file was mapped.
+    *   \retval -1 if it could not be opened or mapped, with errno set.
+    */
+    int CaptureFile_Open(CaptureFile* file, const char* path);
+
+    /**
+    *   \brief Unmap a capture file.
+    *   \param file the mapped file.
+    */
+    void CaptureFile_Close(CaptureFile* file);
+
+    /**
+    *   \brief Check the magic, the version and the CRC of a block.
+    *   \param[in] block the block.
+    *   \return 1 if the block is valid, 0 otherwise.
+    */
+    uint8_t CaptureFile_IsValid(const FDC_CaptureBlock* block);
+
+    /**
+    *   \brief Find the first block that may hold a timestamp.
+    *   \param[in] file the mapped file.
+    *   \param timestamp the timestamp.
+    *   \return the index of the first block whose last timestamp is not
+    *       below the given one, block_count if there is none.
+    */
+    size_t CaptureFile_Seek(const CaptureFile* file, uint32_t timestamp);
+
+    /**
+    *   \brief Read the samples of a time range.
+    *   \param[in] file the mapped file.
+    *   \param from the first timestamp of the range.
+    *   \param to the last timestamp of the range, included.
+    *   \param channel_mask the channels, as #FDC_RP_CH_1 ... #FDC_RP_CH_4
+    *       flags; channels not recorded in a block are skipped.
+    *   \param verify 1 to check the CRC of each block read, 0 to check
+    *       only its magic and version.
+    *   \param callback the function receiving the samples.
+    *   \param context pointer passed to the callback.
+    *   \param[out] stats the statistics of the query, can be NULL.
+    */
+    void CaptureFile_Query(const CaptureFile* file, uint32_t from, uint32_t to, uint8_t channel_mask,
+                           uint8_t verify, CaptureFile_Callback callback, void* context,
+                           CaptureFile_QueryStats* stats);
+
+#endif
+/* [] END OF FILE */
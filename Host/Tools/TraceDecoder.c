@@ -0,0 +1,143 @@
+/**
+*   \brief Source file for the host decoder of the register trace dumps.
+*/
+
+#include "TraceDecoder.h"
+
+#include <string.h>
+
+// Register names, by address
+static const char* const decoder_names[] = {
+    "MEAS1_MSB", "MEAS1_LSB", "MEAS2_MSB", "MEAS2_LSB",
+    "MEAS3_MSB", "MEAS3_LSB", "MEAS4_MSB", "MEAS4_LSB",
+    "CONF_MEAS1", "CONF_MEAS2", "CONF_MEAS3", "CONF_MEAS4", "FDC_CONF",
+    "OFFSET_CAL_CIN1", "OFFSET_CAL_CIN2", "OFFSET_CAL_CIN3", "OFFSET_CAL_CIN4",
+    "GAIN_CAL_CIN1", "GAIN_CAL_CIN2", "GAIN_CAL_CIN3", "GAIN_CAL_CIN4"
+};
+
+// Little-endian fields
+static uint16_t decoder_u16(const uint8_t* data);
+static uint32_t decoder_u32(const uint8_t* data);
+
+size_t TraceDecoder_Find(const uint8_t* data, size_t length)
+{
+    for (size_t i = 0; i + 4 <= length; i++)
+    {
+        if (decoder_u32(&data[i]) == FDC_TRACE_MAGIC)
+        {
+            return i;
+        }
+    }
+    return length;
+}
+
+long TraceDecoder_Parse(const uint8_t* data, size_t length, FDC_TraceHeader* header,
+                        FDC_TraceEvent* events, uint16_t max_events)
+{
+    if (length < TRACE_DECODER_HEADER_SIZE)
+    {
+        return 0;
+    }
+    header->magic = decoder_u32(&data[0]);
+    header->version = decoder_u16(&data[4]);
+    header->event_count = decoder_u16(&data[6]);
+    header->total_events = decoder_u32(&data[8]);
+    if ((header->magic != FDC_TRACE_MAGIC) || (header->version != FDC_TRACE_VERSION) ||
+        (header->event_count > header->total_events) || (header->event_count > max_events))
+    {
+        return -1;
+    }
+    size_t size = TRACE_DECODER_HEADER_SIZE + (size_t)header->event_count * TRACE_DECODER_EVENT_SIZE;
+    if (length < size)
+    {
+        return 0;
+    }
+    uint32_t sequence = header->total_events - header->event_count;
+    for (uint16_t i = 0; i < header->event_count; i++, sequence++)
+    {
+        const uint8_t* event = &data[TRACE_DECODER_HEADER_SIZE + i * TRACE_DECODER_EVENT_SIZE];
+        events[i].timestamp = decoder_u32(&event[0]);
+        events[i].duration = decoder_u16(&event[4]);
+        events[i].value = decoder_u16(&event[6]);
+        events[i].reg = event[8];
+        events[i].op = event[9];
+        events[i].sequence = decoder_u16(&event[10]);
+        if (events[i].sequence != (uint16_t)sequence)
+        {
+            return -1;
+        }
+    }
+    return (long)size;
+}
+
+uint32_t TraceDecoder_Lost(const FDC_TraceHeader* header, uint32_t previous_total)
+{
+    uint32_t oldest = header->total_events - header->event_count;
+    return (oldest > previous_total) ? oldest - previous_total : 0;
+}
+
+const char* TraceDecoder_RegisterName(uint8_t reg_addr)
+{
+    if (reg_addr < sizeof(decoder_names) / sizeof(decoder_names[0]))
+    {
+        return decoder_names[reg_addr];
+    }
+    if (reg_addr == FDC1004Q_MANUFACTURER_ID)
+    {
+        return "MANUFACTURER_ID";
+    }
+    if (reg_addr == FDC1004Q_DEVICE_ID)
+    {
+        return "DEVICE_ID";
+    }
+    return "?";
+}
+
+void TraceDecoder_Print(FILE* out, const FDC_TraceHeader* header,
+                        const FDC_TraceEvent* events, uint16_t first, double ticks_per_us)
+{
+    uint32_t accesses[256];
+    uint64_t ticks[256];
+    memset(accesses, 0, sizeof(accesses));
+    memset(ticks, 0, sizeof(ticks));
+    const char* unit = (ticks_per_us > 0) ? "us" : "ticks";
+    double scale = (ticks_per_us > 0) ? 1.0 / ticks_per_us : 1.0;
+    for (uint16_t i = first; i < header->event_count; i++)
+    {
+        const FDC_TraceEvent* event = &events[i];
+        // Times relative to the oldest event, across the wrap of the clock
+        uint32_t time = event->timestamp - events[0].timestamp;
+        fprintf(out, "%10u %12.1f %s %8.1f %s %-5s %-16s 0x%04X%s\n",
+                header->total_events - header->event_count + i, time * scale, unit,
+                event->duration * scale, unit,
+                ((event->op & ~FDC_TRACE_ERROR) == FDC_TRACE_OP_WRITE) ? "write" : "read",
+                TraceDecoder_RegisterName(event->reg), event->value,
+                (event->op & FDC_TRACE_ERROR) ? " error" : "");
+        accesses[event->reg]++;
+        ticks[event->reg] += event->duration;
+    }
+    for (uint16_t reg = 0; reg < 256; reg++)
+    {
+        if (accesses[reg] > 0)
+        {
+            fprintf(out, "%-16s %6u accesses, mean %8.1f %s\n", TraceDecoder_RegisterName(reg),
+                    accesses[reg], (double)ticks[reg] / accesses[reg] * scale, unit);
+        }
+    }
+}
+
+// ===================================================================
+//                         HELPER FUNCTIONS
+// ===================================================================
+
+uint16_t decoder_u16(const uint8_t* data)
+{
+    return (uint16_t)(data[0] | data[1] << 8);
+}
+
+uint32_t decoder_u32(const uint8_t* data)
+{
+    return (uint32_t)data[0] | (uint32_t)data[1] << 8 | (uint32_t)data[2] << 16 | (uint32_t)data[3] << 24;
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,86 @@
+/**
+*   \file TraceDecoder.h
+*   \brief Host decoder of the FDC1004Q register trace dumps.
+*
+*   A dump (see FDC1004Q_Trace.h) is received on the same serial stream as
+*   the rest of the output of the firmware, so the decoder first looks for
+*   the magic of the header, then reads the header and the events with
+*   their fields in little-endian order, whatever the byte order of the
+*   host. The events lost before the dump, overwritten in the buffer, are
+*   counted from the gaps in their sequence numbers.
+*
+*   \author Davide Marzorati
+*/
+
+#ifndef __TRACE_DECODER_H__
+    #define __TRACE_DECODER_H__
+
+    #include "FDC1004Q_Trace.h"
+
+    #include <stddef.h>
+    #include <stdio.h>
+
+    /**
+    *   \brief Size of a dumped header (bytes).
+    */
+    #define TRACE_DECODER_HEADER_SIZE 12
+
+    /**
+    *   \brief Size of a dumped event (bytes).
+    */
+    #define TRACE_DECODER_EVENT_SIZE 12
+
+    /**
+    *   \brief Find the start of a dump.
+    *   \param[in] data the received bytes.
+    *   \param length the number of bytes.
+    *   \return the offset of the first magic, or length if there is none.
+    */
+    size_t TraceDecoder_Find(const uint8_t* data, size_t length);
+
+    /**
+    *   \brief Decode a dump.
+    *   \param[in] data the dump, starting with the header.
+    *   \param length the number of bytes available.
+    *   \param[out] header the header.
+    *   \param[out] events the events, from the oldest to the newest.
+    *   \param max_events the room in events.
+    *   \return the number of bytes of the dump, 0 if the dump is not
+    *       complete yet, -1 if the header is not valid, the events do not
+    *       fit in max_events or their sequence numbers do not follow the
+    *       total events of the header.
+    */
+    long TraceDecoder_Parse(const uint8_t* data, size_t length, FDC_TraceHeader* header,
+                            FDC_TraceEvent* events, uint16_t max_events);
+
+    /**
+    *   \brief Count the events lost between two dumps.
+    *   The events recorded after the previous dump that were overwritten
+    *   before this one.
+    *   \param[in] header the header of the dump.
+    *   \param previous_total the total events of the previous dump, 0 if none.
+    *   \return the number of events lost.
+    */
+    uint32_t TraceDecoder_Lost(const FDC_TraceHeader* header, uint32_t previous_total);
+
+    /**
+    *   \brief Name of a register.
+    *   \param reg_addr the register address.
+    *   \return the name, "?" for an unknown address.
+    */
+    const char* TraceDecoder_RegisterName(uint8_t reg_addr);
+
+    /**
+    *   \brief Print the events of a dump, one per line, then the number of
+    *   accesses of each register and the mean duration of their transfers.
+    *   \param out the output stream.
+    *   \param[in] header the header of the dump.
+    *   \param[in] events the events of the dump.
+    *   \param first the first event printed, to skip those of a previous dump.
+    *   \param ticks_per_us the trace clock ticks per us, 0 to print ticks.
+    */
+    void TraceDecoder_Print(FILE* out, const FDC_TraceHeader* header,
+                            const FDC_TraceEvent* events, uint16_t first, double ticks_per_us);
+
+#endif
+/* [] END OF FILE */
@@ -0,0 +1,92 @@
+/**
+*   \brief Query of a time range of a capture file.
+*
+*   Usage: fdc_query [-c channels] [-v] file [from [to]]
+*
+*   The samples of the file with a timestamp between from and to (both
+*   included, the whole file by default) are printed as CSV lines of
+*   timestamp, channel, raw measurement, CAPDAC and capacitance in pF.
+*   With -c only the given channels are printed, e.g. -c 13 for CH1 and
+*   CH3. With -v the CRC of each block read is checked and the corrupted
+*   blocks are skipped. The blocks read and skipped are reported on the
+*   standard error.
+*/
+
+#include "CaptureFile.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// Print the samples of a channel
+static void query_print(uint8_t channel, const uint32_t* timestamp, const int32_t* raw,
+                        const uint8_t* capdac, uint8_t count, void* context);
+
+int main(int argc, char** argv)
+{
+    uint8_t channel_mask = FDC_RP_CH_1 | FDC_RP_CH_2 | FDC_RP_CH_3 | FDC_RP_CH_4;
+    uint8_t verify = 0;
+    int option;
+    while ((option = getopt(argc, argv, "c:v")) != -1)
+    {
+        if (option == 'c')
+        {
+            channel_mask = 0;
+            for (const char* c = optarg; *c != '\0'; c++)
+            {
+                if ((*c >= '1') && (*c <= '4'))
+                {
+                    channel_mask |= FDC_RP_CH_1 >> (*c - '1');
+                }
+            }
+        }
+        else if (option == 'v')
+        {
+            verify = 1;
+        }
+        else
+        {
+            optind = argc;
+            break;
+        }
+    }
+    if ((optind >= argc) || (channel_mask == 0))
+    {
+        fprintf(stderr, "Usage: %s [-c channels] [-v] file [from [to]]\n", argv[0]);
+        return 1;
+    }
+    uint32_t from = (optind + 1 < argc) ? strtoul(argv[optind + 1], NULL, 0) : 0;
+    uint32_t to = (optind + 2 < argc) ? strtoul(argv[optind + 2], NULL, 0) : UINT32_MAX;
+
+    CaptureFile file;
+    if (CaptureFile_Open(&file, argv[optind]) < 0)
+    {
+        fprintf(stderr, "%s: %s\n", argv[optind], strerror(errno));
+        return 1;
+    }
+    CaptureFile_QueryStats stats;
+    printf("timestamp,channel,raw,capdac,capacitance_pf\n");
+    CaptureFile_Query(&file, from, to, channel_mask, verify, query_print, NULL, &stats);
+    fprintf(stderr, "%llu samples from %llu blocks, %u invalid blocks skipped\n",
+            (unsigned long long)stats.samples, (unsigned long long)stats.blocks, stats.invalid_blocks);
+    CaptureFile_Close(&file);
+    return 0;
+}
+
+void query_print(uint8_t channel, const uint32_t* timestamp, const int32_t* raw,
+                 const uint8_t* capdac, uint8_t count, void* context)
+{
+    (void)context;
+    int32_t value[1];
+    for (uint8_t i = 0; i < count; i++)
+    {
+        // Same conversion as the firmware, 2^-19 pF units
+        uint32_t measurement = (uint32_t)raw[i] << 8;
+        FDC_ConvertRawMeasurementsFixed(&measurement, &capdac[i], value, 1);
+        printf("%u,%u,%d,%u,%.6f\n", timestamp[i], channel + 1, raw[i], capdac[i], value[0] / 524288.0);
+    }
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,99 @@
+/**
+*   \brief Decoder of the register trace dumps in a serial log.
+*
+*   Usage: fdc_trace [-c ticks_per_us] [file]
+*
+*   The log (standard input if no file is given) is scanned for trace
+*   dumps, sent by the firmware among the rest of its output (key 't', see
+*   main.c). The events of each dump not already printed with a previous
+*   one are printed with the time spent on each register, along with the
+*   events overwritten between two dumps. With -c the timestamps and the
+*   durations are converted from clock ticks to us, e.g. -c 48 for the
+*   cycle counter of a 48 MHz CPU.
+*/
+
+#include "TraceDecoder.h"
+
+#include <stdlib.h>
+#include <unistd.h>
+
+int main(int argc, char** argv)
+{
+    double ticks_per_us = 0;
+    int option;
+    while ((option = getopt(argc, argv, "c:")) != -1)
+    {
+        if (option == 'c')
+        {
+            ticks_per_us = atof(optarg);
+        }
+        else
+        {
+            fprintf(stderr, "Usage: %s [-c ticks_per_us] [file]\n", argv[0]);
+            return 1;
+        }
+    }
+    FILE* in = (optind < argc) ? fopen(argv[optind], "rb") : stdin;
+    if (in == NULL)
+    {
+        perror(argv[optind]);
+        return 1;
+    }
+
+    // Read the whole log
+    size_t length = 0;
+    size_t capacity = 1 << 16;
+    uint8_t* log = malloc(capacity);
+    size_t got;
+    while (log != NULL && (got = fread(&log[length], 1, capacity - length, in)) > 0)
+    {
+        length += got;
+        if (length == capacity)
+        {
+            capacity *= 2;
+            log = realloc(log, capacity);
+        }
+    }
+    if (log == NULL)
+    {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+
+    static FDC_TraceEvent events[UINT16_MAX];
+    uint32_t dumps = 0;
+    uint32_t printed = 0;
+    size_t offset = 0;
+    while ((offset = offset + TraceDecoder_Find(&log[offset], length - offset)) < length)
+    {
+        FDC_TraceHeader header;
+        long size = TraceDecoder_Parse(&log[offset], length - offset, &header, events, UINT16_MAX);
+        if (size <= 0)
+        {
+            // Not a dump, or cut short: look for the next magic
+            offset++;
+            continue;
+        }
+        // A restarted trace counts from 0 again
+        printed = (header.total_events < printed) ? 0 : printed;
+        uint32_t lost = TraceDecoder_Lost(&header, printed);
+        uint32_t oldest = header.total_events - header.event_count;
+        printf("== Dump %u: %u events, %u in total", ++dumps, header.event_count, header.total_events);
+        if (lost > 0)
+        {
+            printf(", %u lost since the previous dump", lost);
+        }
+        printf("\n");
+        TraceDecoder_Print(stdout, &header, events, (printed > oldest) ? printed - oldest : 0, ticks_per_us);
+        printed = header.total_events;
+        offset += size;
+    }
+    if (dumps == 0)
+    {
+        fprintf(stderr, "no trace dump found\n");
+    }
+    free(log);
+    return (dumps > 0) ? 0 : 1;
+}
+
+/* [] END OF FILE */